@@ -42,6 +42,7 @@
 #include "click-internet-stack-helper.h"
 #include <limits>
 #include <map>
+#include <sstream>
 
 NS_LOG_COMPONENT_DEFINE ("ClickInternetStackHelper");
 
@@ -327,7 +328,7 @@ Ipv4L3ProtocolDropSinkWithoutContext (
 
   Ptr<Packet> p = packet->Copy ();
   p->AddHeader (header);
-  *stream->GetStream () << "d " << Simulator::Now ().GetSeconds () << " " << *p << std::endl;
+  AsciiTraceHelper::WritePacket (stream, 'd', p);
 }
 
 static void
@@ -356,10 +357,11 @@ Ipv4L3ProtocolDropSinkWithContext (
   Ptr<Packet> p = packet->Copy ();
   p->AddHeader (header);
 #ifdef INTERFACE_CONTEXT
-  *stream->GetStream () << "d " << Simulator::Now ().GetSeconds () << " " << context << "(" << interface << ") "
-                        << *p << std::endl;
+  std::ostringstream oss;
+  oss << context << "(" << interface << ")";
+  AsciiTraceHelper::WritePacket (stream, 'd', oss.str (), p);
 #else
-  *stream->GetStream () << "d " << Simulator::Now ().GetSeconds () << " " << context << " "  << *p << std::endl;
+  AsciiTraceHelper::WritePacket (stream, 'd', context, p);
 #endif
 }
 
@@ -22,9 +22,11 @@
 #include "default-simulator-impl.h"
 #include "scheduler.h"
 #include "event-impl.h"
+#include "simulator-profiler.h"
 
 #include "ptr.h"
 #include "pointer.h"
+#include "string.h"
 #include "assert.h"
 #include "log.h"
 
@@ -42,6 +44,14 @@ DefaultSimulatorImpl::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::DefaultSimulatorImpl")
     .SetParent<SimulatorImpl> ()
     .AddConstructor<DefaultSimulatorImpl> ()
+    .AddAttribute ("ProfileFile",
+                   "If not empty, profile the events and the event list, and write the "
+                   "report to this file and the folded stacks to the same name with "
+                   ".folded appended at Simulator::Destroy.",
+                   StringValue (""),
+                   MakeStringAccessor (&DefaultSimulatorImpl::SetProfileFile,
+                                       &DefaultSimulatorImpl::GetProfileFile),
+                   MakeStringChecker ())
   ;
   return tid;
 }
@@ -59,10 +69,28 @@ DefaultSimulatorImpl::DefaultSimulatorImpl ()
   m_currentTs = 0;
   m_currentContext = 0xffffffff;
   m_unscheduledEvents = 0;
+  m_profiler = 0;
+  m_nowHead = 0;
+  m_nowFirst = false;
 }
 
 DefaultSimulatorImpl::~DefaultSimulatorImpl ()
 {
+  delete m_profiler;
+}
+
+void
+DefaultSimulatorImpl::SetProfileFile (std::string filename)
+{
+  m_profileFile = filename;
+  delete m_profiler;
+  m_profiler = filename.empty () ? 0 : new SimulatorProfiler ();
+}
+
+std::string
+DefaultSimulatorImpl::GetProfileFile (void) const
+{
+  return m_profileFile;
 }
 
 void
@@ -73,6 +101,12 @@ DefaultSimulatorImpl::DoDispose (void)
       Scheduler::Event next = m_events->RemoveNext ();
       next.impl->Unref ();
     }
+  for (uint32_t i = m_nowHead; i < m_now.size (); i++)
+    {
+      m_now[i].impl->Unref ();
+    }
+  m_now.clear ();
+  m_nowHead = 0;
   m_events = 0;
   SimulatorImpl::DoDispose ();
 }
@@ -89,6 +123,10 @@ DefaultSimulatorImpl::Destroy ()
           ev->Invoke ();
         }
     }
+  if (m_profiler != 0)
+    {
+      m_profiler->Write (m_profileFile);
+    }
 }
 
 void
@@ -114,31 +152,120 @@ DefaultSimulatorImpl::GetSystemId (void) const
   return 0;
 }
 
+Scheduler::Event
+DefaultSimulatorImpl::PopNow (void)
+{
+  Scheduler::Event next = m_now[m_nowHead];
+  m_nowHead++;
+  if (m_nowHead == m_now.size ())
+    {
+      m_now.clear ();
+      m_nowHead = 0;
+    }
+  else if (m_nowHead >= 64 && m_nowHead * 2 >= m_now.size ())
+    {
+      // a chain of events at the same time never empties the lane, so
+      // drop the events already run once they are half of it
+      m_now.erase (m_now.begin (), m_now.begin () + m_nowHead);
+      m_nowHead = 0;
+    }
+  return next;
+}
+
+bool
+DefaultSimulatorImpl::IsNowNext (void)
+{
+  if (m_nowHead == m_now.size ())
+    {
+      return false;
+    }
+  // the events of the scheduler at the current time were scheduled before
+  // the simulator reached it, so they come before those of the lane. No
+  // event at the current time is inserted in the scheduler, so once it has
+  // none left, it is not asked again until the time moves.
+  if (!m_nowFirst)
+    {
+      m_nowFirst = m_events->IsEmpty () || m_events->PeekNext ().key.m_ts != m_currentTs;
+    }
+  return m_nowFirst;
+}
+
 void
 DefaultSimulatorImpl::ProcessOneEvent (void)
 {
-  Scheduler::Event next = m_events->RemoveNext ();
+  Scheduler::Event next;
+  if (IsNowNext ())
+    {
+      next = PopNow ();
+    }
+  else
+    {
+      m_nowFirst = false;
+      if (m_profiler == 0)
+        {
+          next = m_events->RemoveNext ();
+        }
+      else
+        {
+          uint64_t start = SimulatorProfiler::GetTicks ();
+          next = m_events->RemoveNext ();
+          m_profiler->RecordRemove (SimulatorProfiler::GetTicks () - start);
+        }
+    }
 
   NS_ASSERT (next.key.m_ts >= m_currentTs);
   m_unscheduledEvents--;
 
   NS_LOG_LOGIC ("handle " << next.key.m_ts);
   m_currentTs = next.key.m_ts;
-  m_currentContext = next.key.m_context;
+  m_currentContext = next.impl->GetContext ();
   m_currentUid = next.key.m_uid;
-  next.impl->Invoke ();
+  if (m_profiler == 0)
+    {
+      next.impl->Invoke ();
+    }
+  else
+    {
+      uint64_t start = SimulatorProfiler::GetTicks ();
+      next.impl->Invoke ();
+      m_profiler->RecordEvent (next.impl, m_currentContext, SimulatorProfiler::GetTicks () - start);
+    }
   next.impl->Unref ();
 }
 
+void
+DefaultSimulatorImpl::Insert (const Scheduler::Event &ev)
+{
+  if (ev.key.m_ts == m_currentTs)
+    {
+      m_now.push_back (ev);
+      return;
+    }
+  if (m_profiler == 0)
+    {
+      m_events->Insert (ev);
+    }
+  else
+    {
+      uint64_t start = SimulatorProfiler::GetTicks ();
+      m_events->Insert (ev);
+      m_profiler->RecordInsert (SimulatorProfiler::GetTicks () - start, m_unscheduledEvents);
+    }
+}
+
 bool 
 DefaultSimulatorImpl::IsFinished (void) const
 {
-  return m_events->IsEmpty () || m_stop;
+  return (m_events->IsEmpty () && m_nowHead == m_now.size ()) || m_stop;
 }
 
 uint64_t
 DefaultSimulatorImpl::NextTs (void) const
 {
+  if (m_nowHead < m_now.size ())
+    {
+      return m_currentTs;
+    }
   NS_ASSERT (!m_events->IsEmpty ());
   Scheduler::Event ev = m_events->PeekNext ();
   return ev.key.m_ts;
@@ -154,14 +281,14 @@ void
 DefaultSimulatorImpl::Run (void)
 {
   m_stop = false;
-  while (!m_events->IsEmpty () && !m_stop) 
+  while (!IsFinished ()) 
     {
       ProcessOneEvent ();
     }
 
   // If the simulator stopped naturally by lack of events, make a
   // consistency test to check that we didn't lose any events along the way.
-  NS_ASSERT (!m_events->IsEmpty () || m_unscheduledEvents == 0);
+  NS_ASSERT (m_stop || m_unscheduledEvents == 0);
 }
 
 void
@@ -195,12 +322,12 @@ DefaultSimulatorImpl::Schedule (Time const &time, EventImpl *event)
   Scheduler::Event ev;
   ev.impl = event;
   ev.key.m_ts = (uint64_t) tAbsolute.GetTimeStep ();
-  ev.key.m_context = GetContext ();
+  ev.impl->SetContext (GetContext ());
   ev.key.m_uid = m_uid;
   m_uid++;
   m_unscheduledEvents++;
-  m_events->Insert (ev);
-  return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+  Insert (ev);
+  return EventId (event, ev.key.m_ts, ev.impl->GetContext (), ev.key.m_uid);
 }
 
 void
@@ -211,11 +338,50 @@ DefaultSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &time, E
   Scheduler::Event ev;
   ev.impl = event;
   ev.key.m_ts = m_currentTs + time.GetTimeStep ();
-  ev.key.m_context = context;
+  ev.impl->SetContext (context);
   ev.key.m_uid = m_uid;
   m_uid++;
   m_unscheduledEvents++;
-  m_events->Insert (ev);
+  Insert (ev);
+}
+
+void
+DefaultSimulatorImpl::ScheduleBatch (const EventBatch &batch)
+{
+  NS_LOG_FUNCTION (this << batch.GetSize ());
+  m_batch.clear ();
+  for (uint32_t i = 0; i < batch.GetSize (); i++)
+    {
+      Scheduler::Event ev;
+      ev.impl = batch.PeekEvent (i);
+      ev.key.m_ts = m_currentTs + batch.GetDelay (i).GetTimeStep ();
+      ev.impl->SetContext (batch.GetContext (i));
+      ev.key.m_uid = m_uid;
+      m_uid++;
+      if (ev.key.m_ts == m_currentTs)
+        {
+          m_now.push_back (ev);
+        }
+      else
+        {
+          m_batch.push_back (ev);
+        }
+    }
+  m_unscheduledEvents += batch.GetSize ();
+  if (m_batch.empty ())
+    {
+      return;
+    }
+  if (m_profiler == 0)
+    {
+      m_events->InsertBatch (m_batch);
+    }
+  else
+    {
+      uint64_t start = SimulatorProfiler::GetTicks ();
+      m_events->InsertBatch (m_batch);
+      m_profiler->RecordInsert (SimulatorProfiler::GetTicks () - start, m_unscheduledEvents);
+    }
 }
 
 EventId
@@ -224,12 +390,12 @@ DefaultSimulatorImpl::ScheduleNow (EventImpl *event)
   Scheduler::Event ev;
   ev.impl = event;
   ev.key.m_ts = m_currentTs;
-  ev.key.m_context = GetContext ();
+  ev.impl->SetContext (GetContext ());
   ev.key.m_uid = m_uid;
   m_uid++;
   m_unscheduledEvents++;
-  m_events->Insert (ev);
-  return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+  Insert (ev);
+  return EventId (event, ev.key.m_ts, ev.impl->GetContext (), ev.key.m_uid);
 }
 
 EventId
@@ -283,9 +449,21 @@ DefaultSimulatorImpl::Remove (const EventId &id)
   Scheduler::Event event;
   event.impl = id.PeekEventImpl ();
   event.key.m_ts = id.GetTs ();
-  event.key.m_context = id.GetContext ();
   event.key.m_uid = id.GetUid ();
-  m_events->Remove (event);
+  if (RemoveNow (event))
+    {
+      // the event was in the lane of the current time
+    }
+  else if (m_profiler == 0)
+    {
+      m_events->Remove (event);
+    }
+  else
+    {
+      uint64_t start = SimulatorProfiler::GetTicks ();
+      m_events->Remove (event);
+      m_profiler->RecordRemove (SimulatorProfiler::GetTicks () - start);
+    }
   event.impl->Cancel ();
   // whenever we remove an event from the event list, we have to unref it.
   event.impl->Unref ();
@@ -293,6 +471,25 @@ DefaultSimulatorImpl::Remove (const EventId &id)
   m_unscheduledEvents--;
 }
 
+bool
+DefaultSimulatorImpl::RemoveNow (const Scheduler::Event &ev)
+{
+  if (ev.key.m_ts != m_currentTs)
+    {
+      return false;
+    }
+  for (std::vector<Scheduler::Event>::iterator i = m_now.begin () + m_nowHead; i != m_now.end (); ++i)
+    {
+      if (i->key.m_uid == ev.key.m_uid)
+        {
+          NS_ASSERT (i->impl == ev.impl);
+          m_now.erase (i);
+          return true;
+        }
+    }
+  return false;
+}
+
 void
 DefaultSimulatorImpl::Cancel (const EventId &id)
 {
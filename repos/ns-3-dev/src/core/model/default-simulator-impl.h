@@ -28,9 +28,34 @@
 #include "ptr.h"
 
 #include <list>
+#include <vector>
+#include <string>
 
 namespace ns3 {
 
+class SimulatorProfiler;
+
+/**
+ * \ingroup simulator
+ * \brief the default implementation of the simulator
+ *
+ * When the ProfileFile attribute is set, the simulator measures the time
+ * spent in each event and in the event list, and writes a report and a
+ * folded stack file to this file at Simulator::Destroy: see
+ * SimulatorProfiler. Without it, the only cost left is a test of the
+ * profiler pointer before and after the calls to the scheduler and to
+ * the events.
+ *
+ * The events which expire at the current time, such as those of
+ * ScheduleNow and the zero delay hops between layers, do not go through
+ * the scheduler: they are appended to a FIFO lane, which is drained
+ * before the scheduler moves to a later time. They get increasing uids
+ * at the same time, so the lane is sorted, and the events of the
+ * scheduler at the current time, which were scheduled before the
+ * simulator reached it, always come before them: the events run in the
+ * same (ts, uid) order as through the scheduler. The profiler does not
+ * count the events of the lane as insertions.
+ */
 class DefaultSimulatorImpl : public SimulatorImpl
 {
 public:
@@ -46,6 +71,7 @@ public:
   virtual void Stop (Time const &time);
   virtual EventId Schedule (Time const &time, EventImpl *event);
   virtual void ScheduleWithContext (uint32_t context, Time const &time, EventImpl *event);
+  virtual void ScheduleBatch (const EventBatch &batch);
   virtual EventId ScheduleNow (EventImpl *event);
   virtual EventId ScheduleDestroy (EventImpl *event);
   virtual void Remove (const EventId &ev);
@@ -63,19 +89,38 @@ public:
 private:
   virtual void DoDispose (void);
   void ProcessOneEvent (void);
+  /* Insert the event in the lane if it expires now, in m_events otherwise. */
+  void Insert (const Scheduler::Event &ev);
+  /* Return true if the next event is the first one of the lane. */
+  bool IsNowNext (void);
+  Scheduler::Event PopNow (void);
+  /* Remove the event from the lane; return false if it is not there. */
+  bool RemoveNow (const Scheduler::Event &ev);
   uint64_t NextTs (void) const;
+  void SetProfileFile (std::string filename);
+  std::string GetProfileFile (void) const;
   typedef std::list<EventId> DestroyEvents;
 
   DestroyEvents m_destroyEvents;
   bool m_stop;
   Ptr<Scheduler> m_events;
-  uint32_t m_uid;
-  uint32_t m_currentUid;
+  uint64_t m_uid;
+  uint64_t m_currentUid;
   uint64_t m_currentTs;
   uint32_t m_currentContext;
   // number of events that have been inserted but not yet scheduled,
   // not counting the "destroy" events; this is used for validation
   int m_unscheduledEvents;
+  std::string m_profileFile;
+  SimulatorProfiler *m_profiler;
+  // the events of the last batch, kept to reuse the memory
+  std::vector<Scheduler::Event> m_batch;
+  // the lane: the events which expire at m_currentTs, in uid order,
+  // from m_now[m_nowHead] on
+  std::vector<Scheduler::Event> m_now;
+  uint32_t m_nowHead;
+  // true once m_events has no event left at m_currentTs
+  bool m_nowFirst;
 };
 
 } // namespace ns3
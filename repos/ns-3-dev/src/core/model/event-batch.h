@@ -0,0 +1,103 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef EVENT_BATCH_H
+#define EVENT_BATCH_H
+
+#include "nstime.h"
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+class EventImpl;
+
+/**
+ * \ingroup simulator
+ * \brief a set of events to schedule at once with Simulator::ScheduleBatch
+ *
+ * A channel which delivers a frame to many receivers adds one event per
+ * receiver, each with its own delay and context, and hands them all to
+ * the simulator in a single call. The simulator then inserts them with
+ * Scheduler::InsertBatch, which is cheaper than one Scheduler::Insert
+ * per event with the heap and map schedulers.
+ *
+ * The events of a batch are scheduled in the order they were added, so
+ * the events with the same expiration time run in that order, exactly as
+ * if they had been scheduled one by one. A batch can be reused after
+ * Simulator::ScheduleBatch: it keeps its memory. The events still in a
+ * batch when it is destroyed or cleared are dropped without running.
+ *
+ * \code
+ *   EventBatch batch;
+ *   batch.Add (nodeId, delay, MakeEvent (&Phy::Receive, phy, packet));
+ *   ...
+ *   Simulator::ScheduleBatch (batch);
+ * \endcode
+ */
+class EventBatch
+{
+public:
+  EventBatch ();
+  ~EventBatch ();
+
+  /**
+   * \param context the context of the event
+   * \param delay the delay until the event expires
+   * \param event the event, usually created with MakeEvent. The batch
+   *        takes over the reference of the caller.
+   */
+  void Add (uint32_t context, Time const &delay, EventImpl *event);
+  /**
+   * \returns the number of events in the batch
+   */
+  uint32_t GetSize (void) const;
+  /**
+   * \returns true if there are no events in the batch
+   */
+  bool IsEmpty (void) const;
+  /**
+   * Drop the events of the batch without scheduling them.
+   */
+  void Clear (void);
+
+  /* The following methods are used by the SimulatorImpl subclasses
+   * to schedule the events of the batch.
+   */
+  uint32_t GetContext (uint32_t i) const;
+  Time const &GetDelay (uint32_t i) const;
+  EventImpl *PeekEvent (uint32_t i) const;
+
+private:
+  friend class Simulator;
+  EventBatch (const EventBatch &o);
+  EventBatch &operator = (const EventBatch &o);
+  /* Forget the events once the simulator took them over. */
+  void Release (void);
+
+  struct Entry
+  {
+    Time delay;
+    EventImpl *event;
+    uint32_t context;
+  };
+  std::vector<Entry> m_entries;
+};
+
+} // namespace ns3
+
+#endif /* EVENT_BATCH_H */
@@ -31,7 +31,7 @@ EventId::EventId ()
 {
 }
 
-EventId::EventId (const Ptr<EventImpl> &impl, uint64_t ts, uint32_t context, uint32_t uid)
+EventId::EventId (const Ptr<EventImpl> &impl, uint64_t ts, uint32_t context, uint64_t uid)
   : m_eventImpl (impl),
     m_ts (ts),
     m_context (context),
@@ -68,7 +68,7 @@ EventId::GetContext (void) const
 {
   return m_context;
 }
-uint32_t 
+uint64_t
 EventId::GetUid (void) const
 {
   return m_uid;
@@ -19,15 +19,192 @@
  */
 
 #include "event-impl.h"
+#include "ns3/core-config.h"
+#include <new>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
 
 namespace ns3 {
 
+#ifdef HAVE_THREAD_LOCAL
+// the events of make-event.h take from 16 to about 100 bytes
+static const std::size_t EVENT_SIZE_STEP = 16;
+static const uint32_t EVENT_SIZE_CLASSES = 16;
+// bounds the memory a thread keeps, and the memory lost when an event
+// created by one thread is always deleted by another one
+static const uint32_t EVENT_MAX_FREE = 4096;
+
+struct EventFreeBlock
+{
+  EventFreeBlock *next;
+};
+
+struct EventFreeCache
+{
+  EventFreeBlock *lists[EVENT_SIZE_CLASSES];
+  uint32_t counts[EVENT_SIZE_CLASSES];
+  // set once the cache is in g_eventCaches
+  bool registered;
+  EventFreeCache *prev;
+  EventFreeCache *next;
+};
+
+static __thread EventFreeCache g_eventCache;
+// the caches of the threads which have freed events and not exited
+static EventFreeCache *g_eventCaches;
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t g_eventCachesMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t g_eventKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t g_eventKey;
+#endif
+
+static void
+LockEventCaches (void)
+{
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_lock (&g_eventCachesMutex);
+#endif
+}
+
+static void
+UnlockEventCaches (void)
+{
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_unlock (&g_eventCachesMutex);
+#endif
+}
+
+// called when a thread exits: its free blocks go back to the system
+// allocator
+static void
+ReleaseEventCache (void *p)
+{
+  EventFreeCache *cache = static_cast<EventFreeCache *> (p);
+  for (uint32_t i = 0; i < EVENT_SIZE_CLASSES; i++)
+    {
+      while (cache->lists[i] != 0)
+        {
+          EventFreeBlock *block = cache->lists[i];
+          cache->lists[i] = block->next;
+          ::operator delete (block);
+        }
+      cache->counts[i] = 0;
+    }
+  LockEventCaches ();
+  if (cache->prev != 0)
+    {
+      cache->prev->next = cache->next;
+    }
+  else
+    {
+      g_eventCaches = cache->next;
+    }
+  if (cache->next != 0)
+    {
+      cache->next->prev = cache->prev;
+    }
+  UnlockEventCaches ();
+  cache->registered = false;
+}
+
+#ifdef HAVE_PTHREAD_H
+static void
+CreateEventKey (void)
+{
+  pthread_key_create (&g_eventKey, &ReleaseEventCache);
+}
+#endif
+
+static void
+RegisterEventCache (EventFreeCache *cache)
+{
+  LockEventCaches ();
+  cache->prev = 0;
+  cache->next = g_eventCaches;
+  if (g_eventCaches != 0)
+    {
+      g_eventCaches->prev = cache;
+    }
+  g_eventCaches = cache;
+  UnlockEventCaches ();
+#ifdef HAVE_PTHREAD_H
+  pthread_once (&g_eventKeyOnce, &CreateEventKey);
+  pthread_setspecific (g_eventKey, cache);
+#endif
+  cache->registered = true;
+}
+#endif /* HAVE_THREAD_LOCAL */
+
+void *
+EventImpl::operator new (std::size_t size)
+{
+#ifdef HAVE_THREAD_LOCAL
+  uint32_t sizeClass = (size - 1) / EVENT_SIZE_STEP;
+  if (sizeClass < EVENT_SIZE_CLASSES)
+    {
+      EventFreeCache *cache = &g_eventCache;
+      EventFreeBlock *block = cache->lists[sizeClass];
+      if (block != 0)
+        {
+          cache->lists[sizeClass] = block->next;
+          cache->counts[sizeClass]--;
+          return block;
+        }
+      // any event of the class must fit in the block once it is recycled
+      return ::operator new ((sizeClass + 1) * EVENT_SIZE_STEP);
+    }
+#endif /* HAVE_THREAD_LOCAL */
+  return ::operator new (size);
+}
+
+void
+EventImpl::operator delete (void *p, std::size_t size)
+{
+#ifdef HAVE_THREAD_LOCAL
+  uint32_t sizeClass = (size - 1) / EVENT_SIZE_STEP;
+  EventFreeCache *cache = &g_eventCache;
+  if (sizeClass < EVENT_SIZE_CLASSES && cache->counts[sizeClass] < EVENT_MAX_FREE)
+    {
+      if (!cache->registered)
+        {
+          RegisterEventCache (cache);
+        }
+      EventFreeBlock *block = static_cast<EventFreeBlock *> (p);
+      block->next = cache->lists[sizeClass];
+      cache->lists[sizeClass] = block;
+      cache->counts[sizeClass]++;
+      return;
+    }
+#endif /* HAVE_THREAD_LOCAL */
+  ::operator delete (p);
+}
+
+uint32_t
+EventImpl::GetCachedBlocks (void)
+{
+  uint32_t n = 0;
+#ifdef HAVE_THREAD_LOCAL
+  LockEventCaches ();
+  for (EventFreeCache *cache = g_eventCaches; cache != 0; cache = cache->next)
+    {
+      for (uint32_t i = 0; i < EVENT_SIZE_CLASSES; i++)
+        {
+          n += cache->counts[i];
+        }
+    }
+  UnlockEventCaches ();
+#endif /* HAVE_THREAD_LOCAL */
+  return n;
+}
+
 EventImpl::~EventImpl ()
 {
 }
 
 EventImpl::EventImpl ()
-  : m_cancel (false)
+  : m_context (0),
+    m_cancel (false)
 {
 }
 
@@ -52,4 +229,16 @@ EventImpl::IsCancelled (void)
   return m_cancel;
 }
 
+void
+EventImpl::SetContext (uint32_t context)
+{
+  m_context = context;
+}
+
+uint32_t
+EventImpl::GetContext (void) const
+{
+  return m_context;
+}
+
 } // namespace ns3
@@ -21,6 +21,7 @@
 #define EVENT_IMPL_H
 
 #include <stdint.h>
+#include <cstddef>
 #include "simple-ref-count.h"
 
 namespace ns3 {
@@ -35,6 +36,12 @@ namespace ns3 {
  * obviously (there are Ref and Unref methods) reference-counted and
  * most subclasses are usually created by one of the many Simulator::Schedule
  * methods.
+ *
+ * Events are allocated from per-thread free lists, one per size class,
+ * so that scheduling an event does not usually go through malloc: the
+ * memory of an event deleted by its last Unref is kept for the next
+ * event of the same size created by the same thread, and given back
+ * to the system allocator when the thread exits.
  */
 class EventImpl : public SimpleRefCount<EventImpl>
 {
@@ -57,11 +64,46 @@ public:
    * Invoked by the simulation engine before calling Invoke.
    */
   bool IsCancelled (void);
+  /**
+   * \param context the context the event runs in
+   *
+   * Set by the simulation engine when the event is scheduled.
+   */
+  void SetContext (uint32_t context);
+  /**
+   * \returns the context the event runs in
+   */
+  uint32_t GetContext (void) const;
+
+  /**
+   * \param size the size of the event object
+   * \returns memory for the event, from the free list of the calling
+   *          thread if it is not empty
+   */
+  static void *operator new (std::size_t size);
+  /**
+   * \param p the memory of a deleted event
+   * \param size the size of the event object
+   *
+   * Keep the memory in the free list of the calling thread, unless the
+   * list is full.
+   */
+  static void operator delete (void *p, std::size_t size);
+  /**
+   * \returns the number of event blocks kept in the free lists of the
+   *          threads which have not exited yet.
+   *
+   * The free lists of a thread are released when it exits. The count
+   * is only exact when the other threads do not create or delete
+   * events.
+   */
+  static uint32_t GetCachedBlocks (void);
 
 protected:
   virtual void Notify (void) = 0;
 
 private:
+  uint32_t m_context;
   bool m_cancel;
 };
 
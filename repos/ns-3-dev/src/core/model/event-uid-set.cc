@@ -0,0 +1,117 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "event-uid-set.h"
+#include "assert.h"
+
+namespace ns3 {
+
+// marks a free slot of the table, uids never get this large
+static const uint64_t EMPTY_SLOT = 0xffffffffffffffffULL;
+
+EventUidSet::EventUidSet ()
+  : m_table (16, EMPTY_SLOT),
+    m_size (0)
+{
+}
+
+uint32_t
+EventUidSet::Slot (uint64_t uid) const
+{
+  // fibonacci hashing spreads the sequential uids over the table
+  return (uid * 0x9e3779b97f4a7c15ULL) & (m_table.size () - 1);
+}
+
+void
+EventUidSet::Add (uint64_t uid)
+{
+  NS_ASSERT (uid != EMPTY_SLOT);
+  if (2 * (m_size + 1) > m_table.size ())
+    {
+      std::vector<uint64_t> old (2 * m_table.size (), EMPTY_SLOT);
+      old.swap (m_table);
+      m_size = 0;
+      for (std::vector<uint64_t>::const_iterator i = old.begin (); i != old.end (); ++i)
+        {
+          if (*i != EMPTY_SLOT)
+            {
+              Add (*i);
+            }
+        }
+    }
+  uint32_t mask = m_table.size () - 1;
+  uint32_t slot = Slot (uid);
+  while (m_table[slot] != EMPTY_SLOT)
+    {
+      NS_ASSERT (m_table[slot] != uid);
+      slot = (slot + 1) & mask;
+    }
+  m_table[slot] = uid;
+  m_size++;
+}
+
+bool
+EventUidSet::Take (uint64_t uid)
+{
+  if (m_size == 0)
+    {
+      return false;
+    }
+  uint32_t mask = m_table.size () - 1;
+  uint32_t slot = Slot (uid);
+  while (m_table[slot] != uid)
+    {
+      if (m_table[slot] == EMPTY_SLOT)
+        {
+          return false;
+        }
+      slot = (slot + 1) & mask;
+    }
+  // shift back the entries that probed past the freed slot
+  uint32_t next = slot;
+  while (true)
+    {
+      next = (next + 1) & mask;
+      if (m_table[next] == EMPTY_SLOT)
+        {
+          break;
+        }
+      uint32_t home = Slot (m_table[next]);
+      bool between = slot <= next ? (slot < home && home <= next) : (slot < home || home <= next);
+      if (!between)
+        {
+          m_table[slot] = m_table[next];
+          slot = next;
+        }
+    }
+  m_table[slot] = EMPTY_SLOT;
+  m_size--;
+  return true;
+}
+
+uint32_t
+EventUidSet::GetSize (void) const
+{
+  return m_size;
+}
+
+bool
+EventUidSet::IsEmpty (void) const
+{
+  return m_size == 0;
+}
+
+} // namespace ns3
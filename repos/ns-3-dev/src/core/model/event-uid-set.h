@@ -0,0 +1,63 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef EVENT_UID_SET_H
+#define EVENT_UID_SET_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief a set of event uids for schedulers that remove events lazily
+ *
+ * A scheduler that cannot find an event cheaply can record the uid of
+ * the removed event here and drop the event once it comes across it.
+ * The set is a linear probing hash table without any allocation per
+ * uid, so adding, finding and erasing a uid cost O(1) on average.
+ */
+class EventUidSet
+{
+public:
+  EventUidSet ();
+
+  /**
+   * \param uid the uid to add, it must not be in the set yet
+   */
+  void Add (uint64_t uid);
+  /**
+   * \param uid the uid to look for
+   * \returns true if the uid was in the set, in which case it is erased
+   */
+  bool Take (uint64_t uid);
+  /**
+   * \returns the number of uids in the set
+   */
+  uint32_t GetSize (void) const;
+  bool IsEmpty (void) const;
+
+private:
+  uint32_t Slot (uint64_t uid) const;
+
+  std::vector<uint64_t> m_table;
+  uint32_t m_size;
+};
+
+} // namespace ns3
+
+#endif /* EVENT_UID_SET_H */
@@ -0,0 +1,242 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "four-ary-heap-scheduler.h"
+#include "event-impl.h"
+#include "assert.h"
+#include "log.h"
+
+NS_LOG_COMPONENT_DEFINE ("FourAryHeapScheduler");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (FourAryHeapScheduler);
+
+TypeId
+FourAryHeapScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::FourAryHeapScheduler")
+    .SetParent<Scheduler> ()
+    .AddConstructor<FourAryHeapScheduler> ()
+  ;
+  return tid;
+}
+
+FourAryHeapScheduler::FourAryHeapScheduler ()
+{
+}
+
+FourAryHeapScheduler::~FourAryHeapScheduler ()
+{
+}
+
+void
+FourAryHeapScheduler::SiftUp (uint32_t index)
+{
+  Scheduler::EventKey key = m_keys[index];
+  EventImpl *impl = m_impls[index];
+  while (index > 0)
+    {
+      uint32_t parent = (index - 1) / 4;
+      if (!(key < m_keys[parent]))
+        {
+          break;
+        }
+      m_keys[index] = m_keys[parent];
+      m_impls[index] = m_impls[parent];
+      index = parent;
+    }
+  m_keys[index] = key;
+  m_impls[index] = impl;
+}
+
+void
+FourAryHeapScheduler::SiftDown (uint32_t index)
+{
+  uint32_t size = m_keys.size ();
+  Scheduler::EventKey key = m_keys[index];
+  EventImpl *impl = m_impls[index];
+  while (true)
+    {
+      uint32_t first = 4 * index + 1;
+      if (first >= size)
+        {
+          break;
+        }
+      uint32_t end = first + 4 < size ? first + 4 : size;
+      uint32_t smallest = first;
+      for (uint32_t child = first + 1; child < end; child++)
+        {
+          if (m_keys[child] < m_keys[smallest])
+            {
+              smallest = child;
+            }
+        }
+      if (!(m_keys[smallest] < key))
+        {
+          break;
+        }
+      m_keys[index] = m_keys[smallest];
+      m_impls[index] = m_impls[smallest];
+      index = smallest;
+    }
+  m_keys[index] = key;
+  m_impls[index] = impl;
+}
+
+void
+FourAryHeapScheduler::Pop (void)
+{
+  m_keys.front () = m_keys.back ();
+  m_impls.front () = m_impls.back ();
+  m_keys.pop_back ();
+  m_impls.pop_back ();
+  if (!m_keys.empty ())
+    {
+      SiftDown (0);
+    }
+}
+
+void
+FourAryHeapScheduler::PurgeTop (void)
+{
+  while (!m_removed.IsEmpty () && !m_keys.empty () && m_removed.Take (m_keys.front ().m_uid))
+    {
+      Pop ();
+    }
+}
+
+void
+FourAryHeapScheduler::Compact (void)
+{
+  NS_LOG_FUNCTION (this << m_keys.size () << m_removed.GetSize ());
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < m_keys.size (); i++)
+    {
+      if (m_removed.Take (m_keys[i].m_uid))
+        {
+          continue;
+        }
+      m_keys[kept] = m_keys[i];
+      m_impls[kept] = m_impls[i];
+      kept++;
+    }
+  NS_ASSERT (m_removed.IsEmpty ());
+  m_keys.resize (kept);
+  m_impls.resize (kept);
+  for (uint32_t i = kept / 4 + 1; i > 0; i--)
+    {
+      if (i - 1 < kept)
+        {
+          SiftDown (i - 1);
+        }
+    }
+}
+
+void
+FourAryHeapScheduler::Insert (const Event &ev)
+{
+  m_keys.push_back (ev.key);
+  m_impls.push_back (ev.impl);
+  SiftUp (m_keys.size () - 1);
+}
+
+void
+FourAryHeapScheduler::InsertBatch (const std::vector<Event> &events)
+{
+  if (events.size () < 2)
+    {
+      Scheduler::InsertBatch (events);
+      return;
+    }
+  uint32_t first = m_keys.size ();
+  for (std::vector<Event>::const_iterator i = events.begin (); i != events.end (); ++i)
+    {
+      m_keys.push_back (i->key);
+      m_impls.push_back (i->impl);
+    }
+  if (first == 0)
+    {
+      first = 1;
+    }
+  // the parents of a range of entries are a range, so the out of order
+  // entries are heapified one level at a time, from the bottom up
+  uint32_t lo = (first - 1) / 4;
+  uint32_t hi = (m_keys.size () - 2) / 4;
+  while (true)
+    {
+      for (uint32_t i = hi + 1; i > lo; i--)
+        {
+          SiftDown (i - 1);
+        }
+      if (lo == 0)
+        {
+          break;
+        }
+      lo = (lo - 1) / 4;
+      hi = (hi - 1) / 4;
+    }
+  // sifting down the top may have brought a removed entry up to it
+  PurgeTop ();
+}
+
+bool
+FourAryHeapScheduler::IsEmpty (void) const
+{
+  // removed entries never stay at the top, so a heap with only removed
+  // entries left is empty
+  return m_keys.empty ();
+}
+
+Scheduler::Event
+FourAryHeapScheduler::PeekNext (void) const
+{
+  NS_ASSERT (!IsEmpty ());
+  Event next;
+  next.impl = m_impls.front ();
+  next.key = m_keys.front ();
+  return next;
+}
+
+Scheduler::Event
+FourAryHeapScheduler::RemoveNext (void)
+{
+  NS_ASSERT (!IsEmpty ());
+  Event next = PeekNext ();
+  Pop ();
+  PurgeTop ();
+  return next;
+}
+
+void
+FourAryHeapScheduler::Remove (const Event &ev)
+{
+  NS_ASSERT (!IsEmpty ());
+  if (m_keys.front ().m_uid == ev.key.m_uid)
+    {
+      NS_ASSERT (m_impls.front () == ev.impl);
+      Pop ();
+      PurgeTop ();
+      return;
+    }
+  m_removed.Add (ev.key.m_uid);
+  if (m_removed.GetSize () > m_keys.size () / 2)
+    {
+      Compact ();
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,80 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef FOUR_ARY_HEAP_SCHEDULER_H
+#define FOUR_ARY_HEAP_SCHEDULER_H
+
+#include "scheduler.h"
+#include "event-uid-set.h"
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief a 4-ary heap event scheduler with lazy removal
+ *
+ * The heap is implicit: the children of the entry at index i are at
+ * indexes 4i+1 to 4i+4. The keys are kept in their own array, apart from
+ * the EventImpl pointers, so the four keys compared at each level of a
+ * sift down sit next to each other in memory and the pointers are only
+ * touched when an entry moves. A 4-ary heap is half as deep as a binary
+ * heap, which makes RemoveNext cheaper for large event lists.
+ *
+ * Remove does not search the heap for the event: unless the event is
+ * the next one, its uid is only recorded in an EventUidSet, and the
+ * entry is dropped when it reaches the top of the heap.
+ * Once more than half of the entries are removed ones, the heap is
+ * rebuilt without them in O(n), so they never take up more than half of
+ * the memory.
+ *
+ * InsertBatch appends the events and sifts down the parents of the new
+ * entries level by level up to the root, like HeapScheduler::InsertBatch.
+ */
+class FourAryHeapScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId (void);
+
+  FourAryHeapScheduler ();
+  virtual ~FourAryHeapScheduler ();
+
+  virtual void Insert (const Event &ev);
+  virtual void InsertBatch (const std::vector<Event> &events);
+  virtual bool IsEmpty (void) const;
+  virtual Event PeekNext (void) const;
+  virtual Event RemoveNext (void);
+  virtual void Remove (const Event &ev);
+
+private:
+  void SiftUp (uint32_t index);
+  void SiftDown (uint32_t index);
+  /* Remove the entry at the top of the heap. */
+  void Pop (void);
+  /* Pop the removed entries that reached the top of the heap. */
+  void PurgeTop (void);
+  /* Drop every removed entry and heapify what is left. */
+  void Compact (void);
+
+  std::vector<Scheduler::EventKey> m_keys;
+  std::vector<EventImpl *> m_impls;
+  EventUidSet m_removed;
+};
+
+} // namespace ns3
+
+#endif /* FOUR_ARY_HEAP_SCHEDULER_H */
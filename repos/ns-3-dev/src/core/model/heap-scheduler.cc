@@ -129,9 +129,9 @@ HeapScheduler::IsEmpty (void) const
 }
 
 void
-HeapScheduler::BottomUp (void)
+HeapScheduler::BottomUp (uint32_t start)
 {
-  uint32_t index = Last ();
+  uint32_t index = start;
   while (!IsRoot (index)
          && IsLessStrictly (index, Parent (index)))
     {
@@ -179,7 +179,38 @@ void
 HeapScheduler::Insert (const Event &ev)
 {
   m_heap.push_back (ev);
-  BottomUp ();
+  BottomUp (Last ());
+}
+
+void
+HeapScheduler::InsertBatch (const std::vector<Event> &events)
+{
+  if (events.size () < 2)
+    {
+      Scheduler::InsertBatch (events);
+      return;
+    }
+  uint32_t first = m_heap.size ();
+  m_heap.insert (m_heap.end (), events.begin (), events.end ());
+  // only the ancestors of the new entries may be out of order. The
+  // ancestors of a range of entries at one level are a range at the level
+  // above, so heapify the ranges from the bottom up: each subtree below
+  // the range is a heap by the time its root is sifted down.
+  uint32_t lo = IsRoot (first) ? Root () : Parent (first);
+  uint32_t hi = Parent (Last ());
+  while (true)
+    {
+      for (uint32_t i = hi; i >= lo; i--)
+        {
+          TopDown (i);
+        }
+      if (IsRoot (lo))
+        {
+          break;
+        }
+      lo = Parent (lo);
+      hi = Parent (hi);
+    }
 }
 
 Scheduler::Event
@@ -201,7 +232,7 @@ HeapScheduler::RemoveNext (void)
 void
 HeapScheduler::Remove (const Event &ev)
 {
-  uint32_t uid = ev.key.m_uid;
+  uint64_t uid = ev.key.m_uid;
   for (uint32_t i = 1; i < m_heap.size (); i++)
     {
       if (uid == m_heap[i].key.m_uid)
@@ -209,7 +240,16 @@ HeapScheduler::Remove (const Event &ev)
           NS_ASSERT (m_heap[i].impl == ev.impl);
           Exch (i, Last ());
           m_heap.pop_back ();
-          TopDown (i);
+          // the last event moved into the hole may belong above it as
+          // well as below it
+          if (!IsBottom (i) && !IsRoot (i) && IsLessStrictly (i, Parent (i)))
+            {
+              BottomUp (i);
+            }
+          else
+            {
+              TopDown (i);
+            }
           return;
         }
     }
@@ -43,6 +43,10 @@ namespace ns3 {
  *    the index of the root is 1.
  *  - It uses a slightly non-standard while loop for top-down heapify
  *    to move one if statement out of the loop.
+ *  - InsertBatch appends the events and heapifies the parents of the
+ *    new entries, then their parents, up to the root. This is O(k + log(n)^2)
+ *    for k events instead of O(k log(n)) when the events are earlier
+ *    than most of the heap, such as the receptions of a broadcast.
  */
 class HeapScheduler : public Scheduler
 {
@@ -53,6 +57,7 @@ public:
   virtual ~HeapScheduler ();
 
   virtual void Insert (const Event &ev);
+  virtual void InsertBatch (const std::vector<Event> &events);
   virtual bool IsEmpty (void) const;
   virtual Event PeekNext (void) const;
   virtual Event RemoveNext (void);
@@ -74,7 +79,7 @@ private:
   inline uint32_t Smallest (uint32_t a, uint32_t b) const;
 
   inline void Exch (uint32_t a, uint32_t b);
-  void BottomUp (void);
+  void BottomUp (uint32_t start);
   void TopDown (uint32_t start);
 
   BinaryHeap m_heap;
@@ -0,0 +1,356 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ladder-queue-scheduler.h"
+#include "event-impl.h"
+#include "uinteger.h"
+#include "assert.h"
+#include "log.h"
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE ("LadderQueueScheduler");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (LadderQueueScheduler);
+
+// ends the list of entries of a bucket
+static const uint32_t NO_ENTRY = 0xffffffff;
+
+static bool
+Later (const Scheduler::Event &a, const Scheduler::Event &b)
+{
+  return b.key < a.key;
+}
+
+TypeId
+LadderQueueScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LadderQueueScheduler")
+    .SetParent<Scheduler> ()
+    .AddConstructor<LadderQueueScheduler> ()
+    .AddAttribute ("BucketThreshold",
+                   "A bucket with more events than this is split into a new rung.",
+                   UintegerValue (50),
+                   MakeUintegerAccessor (&LadderQueueScheduler::m_threshold),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("MaxRungs",
+                   "The maximum number of rungs of the ladder.",
+                   UintegerValue (8),
+                   MakeUintegerAccessor (&LadderQueueScheduler::m_maxRungs),
+                   MakeUintegerChecker<uint32_t> (1))
+  ;
+  return tid;
+}
+
+LadderQueueScheduler::LadderQueueScheduler ()
+  : m_threshold (50),
+    m_maxRungs (8),
+    m_topMin (0),
+    m_topMax (0),
+    m_topStart (0),
+    m_nRungs (0),
+    m_size (0)
+{
+}
+
+LadderQueueScheduler::~LadderQueueScheduler ()
+{
+}
+
+uint64_t
+LadderQueueScheduler::CurrentStart (const Rung &rung)
+{
+  return rung.start + rung.current * rung.width;
+}
+
+LadderQueueScheduler::Rung &
+LadderQueueScheduler::AddRung (uint64_t start, uint64_t span, uint32_t n)
+{
+  NS_LOG_FUNCTION (this << start << span << n);
+  NS_ASSERT (span > 0 && n > 0);
+  if (m_rungs.size () == m_nRungs)
+    {
+      m_rungs.resize (m_nRungs + 1);
+    }
+  Rung &rung = m_rungs[m_nRungs];
+  m_nRungs++;
+  // about one event per bucket
+  rung.start = start;
+  rung.width = (span + n - 1) / n;
+  rung.current = 0;
+  uint32_t buckets = (span + rung.width - 1) / rung.width;
+  rung.heads.assign (buckets, NO_ENTRY);
+  rung.counts.assign (buckets, 0);
+  rung.entries.clear ();
+  return rung;
+}
+
+void
+LadderQueueScheduler::AddToRung (Rung &rung, const Event &ev)
+{
+  uint32_t bucket = (ev.key.m_ts - rung.start) / rung.width;
+  NS_ASSERT (bucket >= rung.current && bucket < rung.heads.size ());
+  Entry entry;
+  entry.ev = ev;
+  entry.next = rung.heads[bucket];
+  rung.heads[bucket] = rung.entries.size ();
+  rung.entries.push_back (entry);
+  rung.counts[bucket]++;
+}
+
+void
+LadderQueueScheduler::AddToBottom (const Event &ev)
+{
+  m_bottom.insert (std::lower_bound (m_bottom.begin (), m_bottom.end (), ev, &Later), ev);
+  if (m_bottom.size () > m_threshold && m_nRungs < m_maxRungs)
+    {
+      SplitBottom ();
+    }
+}
+
+void
+LadderQueueScheduler::SplitBottom (void)
+{
+  // everything in the bottom comes before the current bucket of the
+  // lowest rung, or before the top if there is no ladder
+  uint64_t start = m_bottom.back ().key.m_ts;
+  uint64_t end = m_nRungs > 0 ? CurrentStart (m_rungs[m_nRungs - 1]) : m_topStart;
+  NS_ASSERT (end > start);
+  if (end - start == 1)
+    {
+      // all the events have the same timestamp
+      return;
+    }
+  NS_LOG_FUNCTION (this << m_bottom.size ());
+  Rung &rung = AddRung (start, end - start, m_bottom.size ());
+  for (std::vector<Event>::const_iterator i = m_bottom.begin (); i != m_bottom.end (); ++i)
+    {
+      AddToRung (rung, *i);
+    }
+  m_bottom.clear ();
+}
+
+void
+LadderQueueScheduler::TopToLadder (void)
+{
+  NS_LOG_FUNCTION (this << m_top.size ());
+  Rung &rung = AddRung (m_topMin, m_topMax - m_topMin + 1, m_top.size ());
+  m_topStart = rung.start + rung.width * rung.heads.size ();
+  for (std::vector<Event>::const_iterator i = m_top.begin (); i != m_top.end (); ++i)
+    {
+      if (!m_removed.IsEmpty () && m_removed.Take (i->key.m_uid))
+        {
+          m_size--;
+          continue;
+        }
+      AddToRung (rung, *i);
+    }
+  m_top.clear ();
+}
+
+void
+LadderQueueScheduler::RefillBottom (void)
+{
+  while (m_bottom.empty ())
+    {
+      if (m_nRungs == 0)
+        {
+          if (m_top.empty ())
+            {
+              return;
+            }
+          TopToLadder ();
+        }
+      uint32_t lowest = m_nRungs - 1;
+      Rung &rung = m_rungs[lowest];
+      while (rung.current < rung.heads.size () && rung.counts[rung.current] == 0)
+        {
+          rung.current++;
+        }
+      if (rung.current == rung.heads.size ())
+        {
+          m_nRungs--;
+          continue;
+        }
+      uint64_t start = CurrentStart (rung);
+      uint32_t count = rung.counts[rung.current];
+      uint32_t head = rung.heads[rung.current];
+      rung.current++;
+      if (count > m_threshold && rung.width > 1 && m_nRungs < m_maxRungs)
+        {
+          // AddRung can move the rungs around
+          Rung &child = AddRung (start, m_rungs[lowest].width, count);
+          const std::vector<Entry> &entries = m_rungs[lowest].entries;
+          for (uint32_t i = head; i != NO_ENTRY; i = entries[i].next)
+            {
+              AddToRung (child, entries[i].ev);
+            }
+          continue;
+        }
+      for (uint32_t i = head; i != NO_ENTRY; i = rung.entries[i].next)
+        {
+          const Event &ev = rung.entries[i].ev;
+          if (!m_removed.IsEmpty () && m_removed.Take (ev.key.m_uid))
+            {
+              m_size--;
+              continue;
+            }
+          m_bottom.push_back (ev);
+        }
+      std::sort (m_bottom.begin (), m_bottom.end (), &Later);
+    }
+}
+
+void
+LadderQueueScheduler::Prepare (void)
+{
+  while (true)
+    {
+      RefillBottom ();
+      if (m_bottom.empty ()
+          || m_removed.IsEmpty ()
+          || !m_removed.Take (m_bottom.back ().key.m_uid))
+        {
+          return;
+        }
+      m_bottom.pop_back ();
+      m_size--;
+    }
+}
+
+void
+LadderQueueScheduler::Compact (void)
+{
+  NS_LOG_FUNCTION (this << m_size << m_removed.GetSize ());
+  std::vector<Event> live;
+  live.reserve (m_size - m_removed.GetSize ());
+  for (std::vector<Event>::const_iterator i = m_bottom.begin (); i != m_bottom.end (); ++i)
+    {
+      if (!m_removed.Take (i->key.m_uid))
+        {
+          live.push_back (*i);
+        }
+    }
+  for (uint32_t r = 0; r < m_nRungs; r++)
+    {
+      const Rung &rung = m_rungs[r];
+      // the entries of the buckets before the current one are gone
+      for (uint32_t b = rung.current; b < rung.heads.size (); b++)
+        {
+          for (uint32_t i = rung.heads[b]; i != NO_ENTRY; i = rung.entries[i].next)
+            {
+              if (!m_removed.Take (rung.entries[i].ev.key.m_uid))
+                {
+                  live.push_back (rung.entries[i].ev);
+                }
+            }
+        }
+    }
+  for (std::vector<Event>::const_iterator i = m_top.begin (); i != m_top.end (); ++i)
+    {
+      if (!m_removed.Take (i->key.m_uid))
+        {
+          live.push_back (*i);
+        }
+    }
+  NS_ASSERT (m_removed.IsEmpty ());
+  m_bottom.clear ();
+  m_nRungs = 0;
+  m_topStart = 0;
+  m_top.clear ();
+  m_size = 0;
+  for (std::vector<Event>::const_iterator i = live.begin (); i != live.end (); ++i)
+    {
+      Insert (*i);
+    }
+}
+
+void
+LadderQueueScheduler::Insert (const Event &ev)
+{
+  uint64_t ts = ev.key.m_ts;
+  m_size++;
+  if (ts >= m_topStart)
+    {
+      if (m_top.empty ())
+        {
+          m_topMin = ts;
+          m_topMax = ts;
+        }
+      else
+        {
+          m_topMin = std::min (m_topMin, ts);
+          m_topMax = std::max (m_topMax, ts);
+        }
+      m_top.push_back (ev);
+      return;
+    }
+  for (uint32_t r = 0; r < m_nRungs; r++)
+    {
+      if (ts >= CurrentStart (m_rungs[r]))
+        {
+          AddToRung (m_rungs[r], ev);
+          return;
+        }
+    }
+  AddToBottom (ev);
+}
+
+bool
+LadderQueueScheduler::IsEmpty (void) const
+{
+  return m_size == m_removed.GetSize ();
+}
+
+Scheduler::Event
+LadderQueueScheduler::PeekNext (void) const
+{
+  NS_ASSERT (!IsEmpty ());
+  const_cast<LadderQueueScheduler *> (this)->Prepare ();
+  return m_bottom.back ();
+}
+
+Scheduler::Event
+LadderQueueScheduler::RemoveNext (void)
+{
+  NS_ASSERT (!IsEmpty ());
+  Prepare ();
+  Event next = m_bottom.back ();
+  m_bottom.pop_back ();
+  m_size--;
+  return next;
+}
+
+void
+LadderQueueScheduler::Remove (const Event &ev)
+{
+  NS_ASSERT (!IsEmpty ());
+  if (!m_bottom.empty () && m_bottom.back ().key.m_uid == ev.key.m_uid)
+    {
+      NS_ASSERT (m_bottom.back ().impl == ev.impl);
+      m_bottom.pop_back ();
+      m_size--;
+      return;
+    }
+  m_removed.Add (ev.key.m_uid);
+  if (m_removed.GetSize () > m_size / 2)
+    {
+      Compact ();
+    }
+}
+
+} // namespace ns3
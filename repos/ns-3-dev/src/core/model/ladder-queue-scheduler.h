@@ -0,0 +1,120 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LADDER_QUEUE_SCHEDULER_H
+#define LADDER_QUEUE_SCHEDULER_H
+
+#include "scheduler.h"
+#include "event-uid-set.h"
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief a ladder queue event scheduler
+ *
+ * The events are spread over three tiers, as described by Tang, Goh and
+ * Thng in "Ladder Queue: An O(1) Priority Queue Structure for Large-Scale
+ * Discrete Event Simulation":
+ *  - top: an unsorted array holding the events of the far future,
+ *  - ladder: up to MaxRungs rungs of buckets, each rung splitting one
+ *    bucket of the rung above it into smaller buckets,
+ *  - bottom: a small sorted array holding the next events to run.
+ *
+ * When the bottom runs dry, it is refilled from the first non-empty
+ * bucket of the lowest rung. A bucket holding more than BucketThreshold
+ * events is split into a new rung instead, and once the ladder is empty
+ * the whole top becomes its first rung. The number of buckets and their
+ * width are chosen again every time a rung is built, from the events it
+ * receives, so the buckets follow the distribution of the timestamps
+ * without any resize step. Each event is sorted once, when its bucket
+ * reaches the bottom, with the full (ts, uid) key.
+ *
+ * The buckets of a rung share one array: an event added to a rung is
+ * appended to it and linked to the previous head of its bucket. The
+ * arrays of the rungs are kept once the rungs are used up, so a steady
+ * simulation does not allocate memory.
+ *
+ * Like the FourAryHeapScheduler, Remove only records the uid of the
+ * event in an EventUidSet and the event is dropped when it reaches the
+ * bottom.
+ */
+class LadderQueueScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId (void);
+
+  LadderQueueScheduler ();
+  virtual ~LadderQueueScheduler ();
+
+  virtual void Insert (const Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Event PeekNext (void) const;
+  virtual Event RemoveNext (void);
+  virtual void Remove (const Event &ev);
+
+private:
+  struct Entry
+  {
+    Event ev;
+    uint32_t next; //!< index of the next entry of the bucket
+  };
+  struct Rung
+  {
+    uint64_t start;                //!< timestamp of the start of the first bucket
+    uint64_t width;                //!< width of the buckets
+    uint32_t current;              //!< index of the next bucket to dequeue
+    std::vector<uint32_t> heads;   //!< index of the first entry of each bucket
+    std::vector<uint32_t> counts;  //!< number of entries of each bucket
+    std::vector<Entry> entries;    //!< storage of all the buckets
+  };
+
+  /* Start timestamp of the current bucket of a rung. */
+  static uint64_t CurrentStart (const Rung &rung);
+  /* Make rung number m_nRungs the lowest one, covering [start, start + span). */
+  Rung &AddRung (uint64_t start, uint64_t span, uint32_t n);
+  void AddToRung (Rung &rung, const Event &ev);
+  void AddToBottom (const Event &ev);
+  /* Move the bottom into a new rung once it grows too large. */
+  void SplitBottom (void);
+  /* Move the top into the first rung. */
+  void TopToLadder (void);
+  /* Refill the bottom from the ladder. */
+  void RefillBottom (void);
+  /* Make sure the last entry of the bottom, if any, is the next event. */
+  void Prepare (void);
+  /* Drop every removed event and move the others back to the top. */
+  void Compact (void);
+
+  uint32_t m_threshold;
+  uint32_t m_maxRungs;
+
+  std::vector<Event> m_top;
+  uint64_t m_topMin;
+  uint64_t m_topMax;
+  uint64_t m_topStart; //!< events at or after this timestamp go to the top
+  std::vector<Rung> m_rungs;
+  uint32_t m_nRungs;
+  std::vector<Event> m_bottom; //!< sorted in decreasing order
+  uint32_t m_size; //!< number of stored events, including removed ones
+  EventUidSet m_removed;
+};
+
+} // namespace ns3
+
+#endif /* LADDER_QUEUE_SCHEDULER_H */
@@ -57,6 +57,18 @@ MapScheduler::Insert (const Event &ev)
   NS_ASSERT (result.second);
 }
 
+void
+MapScheduler::InsertBatch (const std::vector<Event> &events)
+{
+  NS_LOG_FUNCTION (this << events.size ());
+  EventMapI hint = m_list.end ();
+  for (std::vector<Event>::const_iterator i = events.begin (); i != events.end (); ++i)
+    {
+      hint = m_list.insert (hint, std::make_pair (i->key, i->impl));
+      NS_ASSERT (hint->second == i->impl);
+    }
+}
+
 bool
 MapScheduler::IsEmpty (void) const
 {
@@ -34,6 +34,11 @@ namespace ns3 {
  *
  * This class implements the an event scheduler using an std::map
  * data structure.
+ *
+ * InsertBatch inserts each event with the previous one as a hint: an
+ * event which ends up right before or right after the previous one, as
+ * the receptions of a broadcast sorted by distance do, is inserted in
+ * amortized constant time instead of a search from the root of the tree.
  */
 class MapScheduler : public Scheduler
 {
@@ -44,6 +49,7 @@ public:
   virtual ~MapScheduler ();
 
   virtual void Insert (const Event &ev);
+  virtual void InsertBatch (const std::vector<Event> &events);
   virtual bool IsEmpty (void) const;
   virtual Event PeekNext (void) const;
   virtual Event RemoveNext (void);
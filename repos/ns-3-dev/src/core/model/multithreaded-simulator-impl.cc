@@ -0,0 +1,708 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "multithreaded-simulator-impl.h"
+#include "simulator.h"
+#include "system-thread.h"
+#include "uinteger.h"
+#include "assert.h"
+#include "log.h"
+
+#include <algorithm>
+#include <pthread.h>
+
+NS_LOG_COMPONENT_DEFINE ("MultithreadedSimulatorImpl");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (MultithreadedSimulatorImpl);
+
+// index + 1 of the partition run by the calling thread, 0 outside of
+// the windows
+static __thread uint32_t g_currentPartition = 0;
+
+// context of the events scheduled without one before Run
+static const uint32_t NO_CONTEXT = 0xffffffff;
+static const uint32_t NO_PARTITION = 0xffffffff;
+
+// window end of a partition with no event that could run
+static const uint64_t NO_EVENT = 0xffffffffffffffffULL;
+
+/**
+ * The barrier between the windows. SystemCondition::Wait clears the
+ * condition before it waits, which loses a wake up sent before the
+ * wait, so this uses plain pthread conditions with round counters.
+ * Each thread has its own condition, so that only the partitions with
+ * work in a window are woken.
+ */
+struct MultithreadedSimulatorImpl::RoundSync
+{
+  pthread_mutex_t mutex;
+  std::vector<pthread_cond_t> start; //!< by partition
+  std::vector<uint64_t> round; //!< by partition, incremented when its window starts
+  pthread_cond_t done;
+  uint32_t running;  //!< partitions still in the current window
+  bool quit;
+};
+
+TypeId
+MultithreadedSimulatorImpl::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::MultithreadedSimulatorImpl")
+    .SetParent<SimulatorImpl> ()
+    .AddConstructor<MultithreadedSimulatorImpl> ()
+    .AddAttribute ("Partitions",
+                   "The number of event lists, each run by its own thread.",
+                   UintegerValue (2),
+                   MakeUintegerAccessor (&MultithreadedSimulatorImpl::m_nPartitions),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("LookAhead",
+                   "The smallest delay of an event scheduled for another partition, "
+                   "which sets the length of the windows.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&MultithreadedSimulatorImpl::m_lookAhead),
+                   MakeTimeChecker ())
+  ;
+  return tid;
+}
+
+MultithreadedSimulatorImpl::MultithreadedSimulatorImpl ()
+  : m_nPartitions (2),
+    m_stop (false),
+    m_stopTs (0xffffffffffffffffULL),
+    m_currentTs (0),
+    m_currentContext (NO_CONTEXT)
+{
+  m_sync = new RoundSync;
+  pthread_mutex_init (&m_sync->mutex, 0);
+  pthread_cond_init (&m_sync->done, 0);
+  m_sync->running = 0;
+  m_sync->quit = false;
+}
+
+MultithreadedSimulatorImpl::~MultithreadedSimulatorImpl ()
+{
+  pthread_cond_destroy (&m_sync->done);
+  pthread_mutex_destroy (&m_sync->mutex);
+  delete m_sync;
+}
+
+void
+MultithreadedSimulatorImpl::DoDispose (void)
+{
+  for (std::vector<Partition *>::iterator i = m_partitions.begin (); i != m_partitions.end (); ++i)
+    {
+      Partition *partition = *i;
+      while (!partition->events->IsEmpty ())
+        {
+          Scheduler::Event next = partition->events->RemoveNext ();
+          next.impl->Unref ();
+        }
+      for (uint32_t j = 0; j < partition->outbox.size (); j++)
+        {
+          for (uint32_t k = 0; k < partition->outbox[j].size (); k++)
+            {
+              partition->outbox[j][k].impl->Unref ();
+            }
+        }
+      delete partition;
+    }
+  m_partitions.clear ();
+  SimulatorImpl::DoDispose ();
+}
+
+void
+MultithreadedSimulatorImpl::Destroy ()
+{
+  while (!m_destroyEvents.empty ())
+    {
+      Ptr<EventImpl> ev = m_destroyEvents.front ().PeekEventImpl ();
+      m_destroyEvents.pop_front ();
+      NS_LOG_LOGIC ("handle destroy " << ev);
+      if (!ev->IsCancelled ())
+        {
+          ev->Invoke ();
+        }
+    }
+}
+
+void
+MultithreadedSimulatorImpl::CreatePartitions (void)
+{
+  NS_LOG_FUNCTION (this << m_nPartitions);
+  for (uint32_t i = 0; i < m_nPartitions; i++)
+    {
+      Partition *partition = new Partition;
+      partition->sim = this;
+      partition->index = i;
+      // uids are allocated from 4, as in DefaultSimulatorImpl, and
+      // interleaved so that they are unique across partitions
+      partition->nextUid = 4 + i;
+      partition->currentUid = 0;
+      partition->currentTs = 0;
+      partition->currentContext = NO_CONTEXT;
+      partition->windowEnd = 0;
+      partition->outbox.resize (m_nPartitions);
+      partition->stop = false;
+      partition->stopTs = NO_EVENT;
+      m_partitions.push_back (partition);
+    }
+}
+
+void
+MultithreadedSimulatorImpl::SetScheduler (ObjectFactory schedulerFactory)
+{
+  if (m_partitions.empty ())
+    {
+      CreatePartitions ();
+    }
+  for (std::vector<Partition *>::iterator i = m_partitions.begin (); i != m_partitions.end (); ++i)
+    {
+      Ptr<Scheduler> scheduler = schedulerFactory.Create<Scheduler> ();
+      if ((*i)->events != 0)
+        {
+          while (!(*i)->events->IsEmpty ())
+            {
+              scheduler->Insert ((*i)->events->RemoveNext ());
+            }
+        }
+      (*i)->events = scheduler;
+    }
+}
+
+void
+MultithreadedSimulatorImpl::SetPartition (uint32_t context, uint32_t partition)
+{
+  NS_LOG_FUNCTION (this << context << partition);
+  NS_ASSERT (partition < m_nPartitions);
+  if (context >= m_partitionOf.size ())
+    {
+      m_partitionOf.resize (context + 1, NO_PARTITION);
+    }
+  m_partitionOf[context] = partition;
+}
+
+uint32_t
+MultithreadedSimulatorImpl::GetPartitionIndex (uint32_t context) const
+{
+  if (context < m_partitionOf.size () && m_partitionOf[context] != NO_PARTITION)
+    {
+      return m_partitionOf[context];
+    }
+  return context % m_nPartitions;
+}
+
+MultithreadedSimulatorImpl::Partition *
+MultithreadedSimulatorImpl::GetCurrent (void) const
+{
+  if (g_currentPartition == 0)
+    {
+      return 0;
+    }
+  return m_partitions[g_currentPartition - 1];
+}
+
+// System ID for non-distributed simulation is always zero
+uint32_t
+MultithreadedSimulatorImpl::GetSystemId (void) const
+{
+  return 0;
+}
+
+void
+MultithreadedSimulatorImpl::Insert (Partition *partition, Scheduler::Event &ev)
+{
+  ev.key.m_uid = partition->nextUid;
+  partition->nextUid += m_nPartitions;
+  partition->events->Insert (ev);
+}
+
+void
+MultithreadedSimulatorImpl::ProcessOneEvent (Partition *partition)
+{
+  Scheduler::Event next = partition->events->RemoveNext ();
+
+  NS_ASSERT (next.key.m_ts >= partition->currentTs);
+  NS_LOG_LOGIC ("handle " << next.key.m_ts << " in partition " << partition->index);
+  partition->currentTs = next.key.m_ts;
+  partition->currentContext = next.impl->GetContext ();
+  partition->currentUid = next.key.m_uid;
+  next.impl->Invoke ();
+  next.impl->Unref ();
+}
+
+void
+MultithreadedSimulatorImpl::DeliverOutboxes (void)
+{
+  // sources and events are taken in a fixed order so that the uids, and
+  // thus the order of simultaneous events, do not depend on the threads
+  for (std::vector<Partition *>::iterator i = m_partitions.begin (); i != m_partitions.end (); ++i)
+    {
+      for (uint32_t j = 0; j < m_nPartitions; j++)
+        {
+          std::vector<Scheduler::Event> &outbox = (*i)->outbox[j];
+          for (std::vector<Scheduler::Event>::iterator k = outbox.begin (); k != outbox.end (); ++k)
+            {
+              Insert (m_partitions[j], *k);
+            }
+          outbox.clear ();
+        }
+    }
+}
+
+MultithreadedSimulatorImpl::Partition *
+MultithreadedSimulatorImpl::GetEarliest (void) const
+{
+  Partition *earliest = 0;
+  uint64_t ts = 0;
+  for (std::vector<Partition *>::const_iterator i = m_partitions.begin (); i != m_partitions.end (); ++i)
+    {
+      if (!(*i)->events->IsEmpty ())
+        {
+          uint64_t next = (*i)->events->PeekNext ().key.m_ts;
+          if (earliest == 0 || next < ts)
+            {
+              earliest = *i;
+              ts = next;
+            }
+        }
+    }
+  return earliest;
+}
+
+bool
+MultithreadedSimulatorImpl::IsFinished (void) const
+{
+  // the outboxes are always empty outside of Run
+  return m_stop || GetEarliest () == 0;
+}
+
+Time
+MultithreadedSimulatorImpl::Next (void) const
+{
+  Partition *earliest = GetEarliest ();
+  NS_ASSERT (earliest != 0);
+  return TimeStep (earliest->events->PeekNext ().key.m_ts);
+}
+
+void
+MultithreadedSimulatorImpl::RunWindow (Partition *partition)
+{
+  g_currentPartition = partition->index + 1;
+  while (!partition->events->IsEmpty () && !partition->stop
+         && partition->events->PeekNext ().key.m_ts < partition->windowEnd)
+    {
+      ProcessOneEvent (partition);
+    }
+  g_currentPartition = 0;
+}
+
+void
+MultithreadedSimulatorImpl::CollectStop (Partition *partition)
+{
+  if (partition->stop)
+    {
+      m_stop = true;
+      partition->stop = false;
+    }
+  m_stopTs = std::min (m_stopTs, partition->stopTs);
+  partition->stopTs = NO_EVENT;
+}
+
+void
+MultithreadedSimulatorImpl::RunThread (Partition *partition)
+{
+  MultithreadedSimulatorImpl *sim = partition->sim;
+  RoundSync *sync = sim->m_sync;
+  uint32_t index = partition->index;
+  pthread_mutex_lock (&sync->mutex);
+  // the first window may have started before this thread got here
+  uint64_t round = 0;
+  while (true)
+    {
+      while (sync->round[index] == round && !sync->quit)
+        {
+          pthread_cond_wait (&sync->start[index], &sync->mutex);
+        }
+      if (sync->quit)
+        {
+          break;
+        }
+      round = sync->round[index];
+      pthread_mutex_unlock (&sync->mutex);
+      sim->RunWindow (partition);
+      pthread_mutex_lock (&sync->mutex);
+      sync->running--;
+      if (sync->running == 0)
+        {
+          pthread_cond_signal (&sync->done);
+        }
+    }
+  pthread_mutex_unlock (&sync->mutex);
+}
+
+void
+MultithreadedSimulatorImpl::Run (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_stop = false;
+  m_sync->quit = false;
+  m_sync->start.resize (m_nPartitions);
+  m_sync->round.assign (m_nPartitions, 0);
+  for (uint32_t i = 0; i < m_nPartitions; i++)
+    {
+      pthread_cond_init (&m_sync->start[i], 0);
+    }
+  for (std::vector<Partition *>::iterator i = m_partitions.begin (); i != m_partitions.end (); ++i)
+    {
+      Ptr<SystemThread> thread = Create<SystemThread> (MakeBoundCallback (&MultithreadedSimulatorImpl::RunThread, *i));
+      thread->Start ();
+      m_threads.push_back (thread);
+    }
+  uint64_t lookAhead = m_lookAhead.GetTimeStep ();
+  std::vector<uint64_t> next (m_nPartitions);
+  std::vector<Partition *> active;
+  while (true)
+    {
+      DeliverOutboxes ();
+      // the earliest event of each partition, and the two smallest of them
+      uint64_t first = NO_EVENT;
+      uint64_t second = NO_EVENT;
+      uint32_t firstIndex = 0;
+      for (uint32_t i = 0; i < m_nPartitions; i++)
+        {
+          const Ptr<Scheduler> &events = m_partitions[i]->events;
+          next[i] = events->IsEmpty () ? NO_EVENT : events->PeekNext ().key.m_ts;
+          if (next[i] < first)
+            {
+              second = first;
+              first = next[i];
+              firstIndex = i;
+            }
+          else if (next[i] < second)
+            {
+              second = next[i];
+            }
+        }
+      if (m_stop || first == NO_EVENT)
+        {
+          break;
+        }
+      uint64_t stopTs = m_stopTs;
+      if (first > stopTs)
+        {
+          m_stopTs = 0xffffffffffffffffULL;
+          m_currentTs = stopTs;
+          break;
+        }
+      m_currentTs = first;
+      active.clear ();
+      for (uint32_t i = 0; i < m_nPartitions; i++)
+        {
+          if (next[i] == NO_EVENT)
+            {
+              continue;
+            }
+          // an event of another partition sends its messages at least
+          // lookAhead later, and the replies to the messages of this one
+          // come back at least twice lookAhead later. The events of the
+          // earliest time always run, even with a zero lookAhead.
+          uint64_t other = i == firstIndex ? second : first;
+          uint64_t end = next[i] + 2 * lookAhead;
+          if (other != NO_EVENT)
+            {
+              end = std::min (end, other + lookAhead);
+            }
+          end = std::max (end, first + 1);
+          if (end > stopTs)
+            {
+              end = stopTs + 1;
+            }
+          m_partitions[i]->windowEnd = end;
+          if (next[i] < end)
+            {
+              NS_LOG_LOGIC ("window [" << next[i] << "," << end << ") in partition " << i);
+              active.push_back (m_partitions[i]);
+            }
+        }
+      if (active.size () == 1)
+        {
+          RunWindow (active.front ());
+          CollectStop (active.front ());
+          continue;
+        }
+      pthread_mutex_lock (&m_sync->mutex);
+      m_sync->running = active.size ();
+      for (std::vector<Partition *>::iterator i = active.begin (); i != active.end (); ++i)
+        {
+          uint32_t index = (*i)->index;
+          m_sync->round[index]++;
+          pthread_cond_signal (&m_sync->start[index]);
+        }
+      while (m_sync->running != 0)
+        {
+          pthread_cond_wait (&m_sync->done, &m_sync->mutex);
+        }
+      pthread_mutex_unlock (&m_sync->mutex);
+      // the barrier publishes what the threads wrote during the window
+      for (std::vector<Partition *>::iterator i = active.begin (); i != active.end (); ++i)
+        {
+          CollectStop (*i);
+        }
+    }
+  pthread_mutex_lock (&m_sync->mutex);
+  m_sync->quit = true;
+  for (uint32_t i = 0; i < m_nPartitions; i++)
+    {
+      pthread_cond_signal (&m_sync->start[i]);
+    }
+  pthread_mutex_unlock (&m_sync->mutex);
+  for (std::vector<Ptr<SystemThread> >::iterator i = m_threads.begin (); i != m_threads.end (); ++i)
+    {
+      (*i)->Join ();
+    }
+  m_threads.clear ();
+  for (uint32_t i = 0; i < m_nPartitions; i++)
+    {
+      pthread_cond_destroy (&m_sync->start[i]);
+    }
+  for (std::vector<Partition *>::iterator i = m_partitions.begin (); i != m_partitions.end (); ++i)
+    {
+      m_currentTs = std::max (m_currentTs, (*i)->currentTs);
+    }
+}
+
+void
+MultithreadedSimulatorImpl::RunOneEvent (void)
+{
+  Partition *earliest = GetEarliest ();
+  NS_ASSERT (earliest != 0);
+  g_currentPartition = earliest->index + 1;
+  ProcessOneEvent (earliest);
+  g_currentPartition = 0;
+  CollectStop (earliest);
+  m_currentTs = earliest->currentTs;
+  DeliverOutboxes ();
+}
+
+void
+MultithreadedSimulatorImpl::Stop (void)
+{
+  Partition *current = GetCurrent ();
+  if (current != 0)
+    {
+      // the other partitions stop at the end of the window
+      current->stop = true;
+    }
+  else
+    {
+      m_stop = true;
+    }
+}
+
+void
+MultithreadedSimulatorImpl::Stop (Time const &time)
+{
+  uint64_t ts = Now ().GetTimeStep () + time.GetTimeStep ();
+  Partition *current = GetCurrent ();
+  if (current == 0)
+    {
+      m_stopTs = std::min (m_stopTs, ts);
+      return;
+    }
+  // the windows of the other partitions end at most lookAhead after the
+  // earliest event of this one, so they can't run past the stop time;
+  // the window of this partition may end later, clip it.
+  NS_ASSERT_MSG (time >= m_lookAhead, "Stop scheduled " << time << " ahead, below the lookahead "
+                 << m_lookAhead);
+  current->stopTs = std::min (current->stopTs, ts);
+  current->windowEnd = std::min (current->windowEnd, ts + 1);
+}
+
+//
+// Schedule an event for a _relative_ time in the future.
+//
+EventId
+MultithreadedSimulatorImpl::Schedule (Time const &time, EventImpl *event)
+{
+  Time tAbsolute = time + Now ();
+
+  NS_ASSERT (tAbsolute.IsPositive ());
+  NS_ASSERT (tAbsolute >= Now ());
+  Partition *current = GetCurrent ();
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = (uint64_t) tAbsolute.GetTimeStep ();
+  ev.impl->SetContext (GetContext ());
+  Insert (current != 0 ? current : m_partitions[GetPartitionIndex (ev.impl->GetContext ())], ev);
+  return EventId (event, ev.key.m_ts, ev.impl->GetContext (), ev.key.m_uid);
+}
+
+void
+MultithreadedSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &time, EventImpl *event)
+{
+  NS_LOG_FUNCTION (this << context << time.GetTimeStep () << event);
+
+  Partition *current = GetCurrent ();
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = Now ().GetTimeStep () + time.GetTimeStep ();
+  ev.impl->SetContext (context);
+  uint32_t target = GetPartitionIndex (context);
+  if (current == 0 || current->index == target)
+    {
+      Insert (m_partitions[target], ev);
+    }
+  else
+    {
+      NS_ASSERT_MSG (time >= m_lookAhead, "event for context " << context << " in another partition "
+                     "scheduled " << time << " ahead, below the lookahead " << m_lookAhead);
+      current->outbox[target].push_back (ev);
+    }
+}
+
+EventId
+MultithreadedSimulatorImpl::ScheduleNow (EventImpl *event)
+{
+  return Schedule (TimeStep (0), event);
+}
+
+EventId
+MultithreadedSimulatorImpl::ScheduleDestroy (EventImpl *event)
+{
+  EventId id (Ptr<EventImpl> (event, false), Now ().GetTimeStep (), 0xffffffff, 2);
+  pthread_mutex_lock (&m_sync->mutex);
+  m_destroyEvents.push_back (id);
+  pthread_mutex_unlock (&m_sync->mutex);
+  return id;
+}
+
+Time
+MultithreadedSimulatorImpl::Now (void) const
+{
+  Partition *current = GetCurrent ();
+  return TimeStep (current != 0 ? current->currentTs : m_currentTs);
+}
+
+Time
+MultithreadedSimulatorImpl::GetDelayLeft (const EventId &id) const
+{
+  if (IsExpired (id))
+    {
+      return TimeStep (0);
+    }
+  else
+    {
+      return TimeStep (id.GetTs () - Now ().GetTimeStep ());
+    }
+}
+
+void
+MultithreadedSimulatorImpl::Remove (const EventId &id)
+{
+  if (id.GetUid () == 2)
+    {
+      // destroy events.
+      pthread_mutex_lock (&m_sync->mutex);
+      for (DestroyEvents::iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == id)
+            {
+              m_destroyEvents.erase (i);
+              break;
+            }
+        }
+      pthread_mutex_unlock (&m_sync->mutex);
+      return;
+    }
+  if (IsExpired (id))
+    {
+      return;
+    }
+  Partition *partition = m_partitions[GetPartitionIndex (id.GetContext ())];
+  NS_ASSERT_MSG (GetCurrent () == 0 || GetCurrent () == partition,
+                 "an event can only be removed from its own partition");
+  Scheduler::Event event;
+  event.impl = id.PeekEventImpl ();
+  event.key.m_ts = id.GetTs ();
+  event.key.m_uid = id.GetUid ();
+  partition->events->Remove (event);
+  event.impl->Cancel ();
+  // whenever we remove an event from the event list, we have to unref it.
+  event.impl->Unref ();
+}
+
+void
+MultithreadedSimulatorImpl::Cancel (const EventId &id)
+{
+  if (!IsExpired (id))
+    {
+      id.PeekEventImpl ()->Cancel ();
+    }
+}
+
+bool
+MultithreadedSimulatorImpl::IsExpired (const EventId &ev) const
+{
+  if (ev.GetUid () == 2)
+    {
+      if (ev.PeekEventImpl () == 0 ||
+          ev.PeekEventImpl ()->IsCancelled ())
+        {
+          return true;
+        }
+      // destroy events.
+      for (DestroyEvents::const_iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == ev)
+            {
+              return false;
+            }
+        }
+      return true;
+    }
+  if (ev.PeekEventImpl () == 0)
+    {
+      return true;
+    }
+  const Partition *partition = m_partitions[GetPartitionIndex (ev.GetContext ())];
+  if (ev.GetTs () < partition->currentTs ||
+      (ev.GetTs () == partition->currentTs &&
+       ev.GetUid () <= partition->currentUid) ||
+      ev.PeekEventImpl ()->IsCancelled ())
+    {
+      return true;
+    }
+  else
+    {
+      return false;
+    }
+}
+
+Time
+MultithreadedSimulatorImpl::GetMaximumSimulationTime (void) const
+{
+  return TimeStep (0x7fffffffffffffffLL);
+}
+
+uint32_t
+MultithreadedSimulatorImpl::GetContext (void) const
+{
+  Partition *current = GetCurrent ();
+  return current != 0 ? current->currentContext : m_currentContext;
+}
+
+} // namespace ns3
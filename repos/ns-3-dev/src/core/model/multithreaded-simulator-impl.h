@@ -0,0 +1,177 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MULTITHREADED_SIMULATOR_IMPL_H
+#define MULTITHREADED_SIMULATOR_IMPL_H
+
+#include "simulator-impl.h"
+#include "scheduler.h"
+#include "event-impl.h"
+#include "nstime.h"
+#include "ptr.h"
+
+#include <list>
+#include <vector>
+
+namespace ns3 {
+
+class SystemThread;
+
+/**
+ * \ingroup simulator
+ * \brief a conservative parallel simulator running on threads
+ *
+ * The events are split over Partitions event lists by their context,
+ * which is the node id for most of them: context c goes to partition
+ * c modulo Partitions unless SetPartition assigned it somewhere else,
+ * for example to keep the nodes of a channel together. Each partition
+ * has its own scheduler and runs in its own thread.
+ *
+ * The threads advance in windows, with a barrier in between. An event
+ * scheduled with ScheduleWithContext for a node of another partition
+ * must be at least LookAhead in the future: it is only queued, and moved
+ * to the event list of its partition at the barrier, without any copy
+ * or serialization of its arguments. LookAhead should be set to the
+ * smallest propagation delay of the channels that connect the
+ * partitions.
+ *
+ * Each partition gets its own window end: nothing can reach it before
+ * the earliest event of the other partitions plus LookAhead, and none
+ * of its own events can come back before its earliest event plus twice
+ * LookAhead. A partition with no event in its window is left asleep,
+ * and when a single partition has work, the window runs in the calling
+ * thread without waking any other. With a zero LookAhead, the windows
+ * hold a single timestamp, and the cost of a window is mostly the
+ * synchronization of the partitions that have an event at that time.
+ * The partitions never run past their window end: there is no
+ * optimistic synchronization with rollback.
+ *
+ * The events of different partitions run at the same time, so they must
+ * not share any state except through ScheduleWithContext. Events
+ * scheduled with Simulator::Schedule stay in the partition of the
+ * running event, and an event can only be removed, cancelled or checked
+ * for expiration from the partition that owns it. Simulator::Stop (time)
+ * runs all the events up to and including the stop time; called by an
+ * event, the time must be at least LookAhead, like the delay of an
+ * event for another partition. Simulator::Stop called by an event stops
+ * its partition at once, and the other partitions at the end of the
+ * window.
+ *
+ * Unlike the other objects, a packet can be handed to a node of another
+ * partition by ScheduleWithContext while the sender keeps using it or
+ * its copies: the packets, and the buffers they share with their
+ * copies, are safe to use from several threads (see ns3::Packet).
+ *
+ * Select it with the "SimulatorImplementationType" global value:
+ * \code
+ * GlobalValue::Bind ("SimulatorImplementationType",
+ *                    StringValue ("ns3::MultithreadedSimulatorImpl"));
+ * \endcode
+ */
+class MultithreadedSimulatorImpl : public SimulatorImpl
+{
+public:
+  static TypeId GetTypeId (void);
+
+  MultithreadedSimulatorImpl ();
+  ~MultithreadedSimulatorImpl ();
+
+  virtual void Destroy ();
+  virtual bool IsFinished (void) const;
+  virtual Time Next (void) const;
+  virtual void Stop (void);
+  virtual void Stop (Time const &time);
+  virtual EventId Schedule (Time const &time, EventImpl *event);
+  virtual void ScheduleWithContext (uint32_t context, Time const &time, EventImpl *event);
+  virtual EventId ScheduleNow (EventImpl *event);
+  virtual EventId ScheduleDestroy (EventImpl *event);
+  virtual void Remove (const EventId &ev);
+  virtual void Cancel (const EventId &ev);
+  virtual bool IsExpired (const EventId &ev) const;
+  virtual void Run (void);
+  virtual void RunOneEvent (void);
+  virtual Time Now (void) const;
+  virtual Time GetDelayLeft (const EventId &id) const;
+  virtual Time GetMaximumSimulationTime (void) const;
+  virtual void SetScheduler (ObjectFactory schedulerFactory);
+  virtual uint32_t GetSystemId (void) const;
+  virtual uint32_t GetContext (void) const;
+
+  /**
+   * \param context the context of a node
+   * \param partition the partition that runs its events
+   *
+   * Must be called before any event is scheduled for the context.
+   */
+  void SetPartition (uint32_t context, uint32_t partition);
+
+private:
+  struct Partition
+  {
+    MultithreadedSimulatorImpl *sim;
+    uint32_t index;
+    Ptr<Scheduler> events;
+    uint64_t nextUid;
+    uint64_t currentUid;
+    uint64_t currentTs;
+    uint32_t currentContext;
+    /* end of the current window, excluded */
+    uint64_t windowEnd;
+    /* events for the other partitions, by destination, whose uid is set on delivery */
+    std::vector<std::vector<Scheduler::Event> > outbox;
+    /* Stop requested by an event of the window, published at the barrier */
+    bool stop;
+    /* earliest Stop (time) requested by an event of the window, published at the barrier */
+    uint64_t stopTs;
+  };
+  struct RoundSync;
+
+  virtual void DoDispose (void);
+  void CreatePartitions (void);
+  uint32_t GetPartitionIndex (uint32_t context) const;
+  /* The partition of the calling thread, or zero outside of the windows. */
+  Partition *GetCurrent (void) const;
+  void Insert (Partition *partition, Scheduler::Event &ev);
+  void ProcessOneEvent (Partition *partition);
+  /* Move the queued events to their partitions. */
+  void DeliverOutboxes (void);
+  /* \returns the partition with the earliest event, or zero if none */
+  Partition *GetEarliest (void) const;
+  void RunWindow (Partition *partition);
+  /* Take the stop requests of the events of the last window of the partition. */
+  void CollectStop (Partition *partition);
+  static void RunThread (Partition *partition);
+
+  typedef std::list<EventId> DestroyEvents;
+
+  uint32_t m_nPartitions;
+  Time m_lookAhead;
+  std::vector<Partition *> m_partitions;
+  std::vector<uint32_t> m_partitionOf;
+  std::vector<Ptr<SystemThread> > m_threads;
+  RoundSync *m_sync;
+
+  DestroyEvents m_destroyEvents;
+  /* only accessed by the thread which called Run, outside of the windows */
+  bool m_stop;
+  uint64_t m_stopTs;
+  uint64_t m_currentTs;
+  uint32_t m_currentContext;
+};
+
+} // namespace ns3
+
+#endif /* MULTITHREADED_SIMULATOR_IMPL_H */
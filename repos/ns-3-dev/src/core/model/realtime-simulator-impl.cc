@@ -334,7 +334,7 @@ RealtimeSimulatorImpl::ProcessOneEvent (void)
     // is frozen until the next event is executed.
     //
     m_currentTs = next.key.m_ts;
-    m_currentContext = next.key.m_context;
+    m_currentContext = next.impl->GetContext ();
     m_currentUid = next.key.m_uid;
 
     // 
@@ -518,7 +518,7 @@ RealtimeSimulatorImpl::RunOneEvent (void)
 
     NS_LOG_LOGIC ("handle " << next.key.m_ts);
     m_currentTs = next.key.m_ts;
-    m_currentContext = next.key.m_context;
+    m_currentContext = next.impl->GetContext ();
     m_currentUid = next.key.m_uid;
     event = next.impl;
   }
@@ -561,7 +561,7 @@ RealtimeSimulatorImpl::Schedule (Time const &time, EventImpl *impl)
     NS_ASSERT_MSG (tAbsolute >= TimeStep (m_currentTs), "RealtimeSimulatorImpl::Schedule(): time < m_currentTs");
     ev.impl = impl;
     ev.key.m_ts = (uint64_t) tAbsolute.GetTimeStep ();
-    ev.key.m_context = GetContext ();
+    ev.impl->SetContext (GetContext ());
     ev.key.m_uid = m_uid;
     m_uid++;
     m_unscheduledEvents++;
@@ -569,7 +569,7 @@ RealtimeSimulatorImpl::Schedule (Time const &time, EventImpl *impl)
     m_synchronizer->Signal ();
   }
 
-  return EventId (impl, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+  return EventId (impl, ev.key.m_ts, ev.impl->GetContext (), ev.key.m_uid);
 }
 
 void
@@ -586,7 +586,7 @@ RealtimeSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &time,
     Scheduler::Event ev;
     ev.impl = impl;
     ev.key.m_ts = ts;
-    ev.key.m_context = context;
+    ev.impl->SetContext (context);
     ev.key.m_uid = m_uid;
     m_uid++;
     m_unscheduledEvents++;
@@ -605,7 +605,7 @@ RealtimeSimulatorImpl::ScheduleNow (EventImpl *impl)
 
     ev.impl = impl;
     ev.key.m_ts = m_currentTs;
-    ev.key.m_context = GetContext ();
+    ev.impl->SetContext (GetContext ());
     ev.key.m_uid = m_uid;
     m_uid++;
     m_unscheduledEvents++;
@@ -613,7 +613,7 @@ RealtimeSimulatorImpl::ScheduleNow (EventImpl *impl)
     m_synchronizer->Signal ();
   }
 
-  return EventId (impl, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+  return EventId (impl, ev.key.m_ts, ev.impl->GetContext (), ev.key.m_uid);
 }
 
 Time
@@ -671,7 +671,7 @@ RealtimeSimulatorImpl::ScheduleRealtimeNowWithContext (uint32_t context, EventIm
     ev.impl = impl;
     ev.key.m_ts = ts;
     ev.key.m_uid = m_uid;
-    ev.key.m_context = context;
+    ev.impl->SetContext (context);
     m_uid++;
     m_unscheduledEvents++;
     m_events->Insert (ev);
@@ -758,7 +758,6 @@ RealtimeSimulatorImpl::Remove (const EventId &id)
     Scheduler::Event event;
     event.impl = id.PeekEventImpl ();
     event.key.m_ts = id.GetTs ();
-    event.key.m_context = id.GetContext ();
     event.key.m_uid = id.GetUid ();
 
     m_events->Remove (event);
@@ -100,8 +100,8 @@ private:
   // The following variables are protected using the m_mutex
   Ptr<Scheduler> m_events;
   int m_unscheduledEvents;
-  uint32_t m_uid;
-  uint32_t m_currentUid;
+  uint64_t m_uid;
+  uint64_t m_currentUid;
   uint64_t m_currentTs;
   uint32_t m_currentContext;
 
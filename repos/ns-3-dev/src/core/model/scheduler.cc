@@ -38,4 +38,13 @@ Scheduler::GetTypeId (void)
   return tid;
 }
 
+void
+Scheduler::InsertBatch (const std::vector<Event> &events)
+{
+  for (std::vector<Event>::const_iterator i = events.begin (); i != events.end (); ++i)
+    {
+      Insert (*i);
+    }
+}
+
 } // namespace ns3
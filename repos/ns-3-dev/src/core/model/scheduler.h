@@ -22,6 +22,7 @@
 #define SCHEDULER_H
 
 #include <stdint.h>
+#include <vector>
 #include "object.h"
 
 namespace ns3 {
@@ -49,6 +50,11 @@ class EventImpl;
  * calling EventId::Ref and SimpleRefCount::Unref at the right time.
  * Typically, EventId::Ref is called before Insert and SimpleRefCount::Unref is called
  * after a call to one of the Remove methods.
+ *
+ * The events are ordered by their EventKey, a timestamp and a 64-bit
+ * uid which breaks the ties in scheduling order and does not wrap
+ * around in practice. The key is kept to 16 bytes, so the context of
+ * an event is not part of it: it is stored in the EventImpl.
  */
 class Scheduler : public Object
 {
@@ -58,8 +64,7 @@ public:
   struct EventKey
   {
     uint64_t m_ts;
-    uint32_t m_uid;
-    uint32_t m_context;
+    uint64_t m_uid;
   };
   struct Event
   {
@@ -73,6 +78,16 @@ public:
    * \param ev event to store in the event list
    */
   virtual void Insert (const Event &ev) = 0;
+  /**
+   * \param events the events to store in the event list
+   *
+   * Stores several events at once, in any order. The default
+   * implementation calls Insert for each of them; the schedulers which
+   * can merge a batch of events faster than one event at a time, such
+   * as the heaps, which rebuild the part of the heap above the new events
+   * in a single pass, override it.
+   */
+  virtual void InsertBatch (const std::vector<Event> &events);
   /**
    * \returns true if the event list is empty and false otherwise.
    */
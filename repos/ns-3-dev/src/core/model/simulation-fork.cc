@@ -0,0 +1,117 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "simulation-fork.h"
+#include "log.h"
+#include "assert.h"
+#include "fatal-error.h"
+#include <iostream>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <set>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+NS_LOG_COMPONENT_DEFINE ("SimulationFork");
+
+namespace ns3 {
+
+SimulationFork::SimulationFork ()
+  : m_parallel (1),
+    m_isParent (true),
+    m_failures (0)
+{
+}
+
+void
+SimulationFork::SetParallel (uint32_t parallel)
+{
+  NS_ASSERT (parallel > 0);
+  m_parallel = parallel;
+}
+
+uint32_t
+SimulationFork::Fork (uint32_t branches)
+{
+  NS_LOG_FUNCTION (this << branches << m_parallel);
+  NS_ASSERT (m_isParent);
+  m_failures = 0;
+  std::set<pid_t> running;
+  uint32_t next = 0;
+  while (next < branches || !running.empty ())
+    {
+      if (next < branches && running.size () < m_parallel)
+        {
+          // the buffered output would be written once by each process
+          std::cout.flush ();
+          std::cerr.flush ();
+          std::clog.flush ();
+          std::fflush (0);
+          pid_t pid = fork ();
+          if (pid < 0)
+            {
+              NS_FATAL_ERROR ("fork failed: " << std::strerror (errno));
+            }
+          if (pid == 0)
+            {
+              m_isParent = false;
+              return next;
+            }
+          NS_LOG_LOGIC ("branch " << next << " runs in process " << pid);
+          running.insert (pid);
+          next++;
+          continue;
+        }
+      int status;
+      pid_t pid = wait (&status);
+      if (pid < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+          NS_FATAL_ERROR ("wait failed: " << std::strerror (errno));
+        }
+      if (running.erase (pid) == 0)
+        {
+          // not one of the branches
+          continue;
+        }
+      if (!WIFEXITED (status) || WEXITSTATUS (status) != 0)
+        {
+          NS_LOG_WARN ("process " << pid << " failed with status " << status);
+          m_failures++;
+        }
+    }
+  return branches;
+}
+
+bool
+SimulationFork::IsParent (void) const
+{
+  return m_isParent;
+}
+
+uint32_t
+SimulationFork::GetFailures (void) const
+{
+  return m_failures;
+}
+
+} // namespace ns3
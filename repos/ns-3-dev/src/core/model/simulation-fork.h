@@ -0,0 +1,92 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef SIMULATION_FORK_H
+#define SIMULATION_FORK_H
+
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * \ingroup simulator
+ * \brief run several branches of a simulation from a common state
+ *
+ * A parameter sweep often repeats the same warm-up, for example the
+ * convergence of the routing protocol, before each point. Instead, run
+ * the warm-up once, up to a Simulator::Stop, and call Fork: each branch
+ * continues in its own child process from a copy of the whole state of
+ * the simulation, the pending events, the objects and the random number
+ * generators included, and applies its own parameters before calling
+ * Simulator::Run again.
+ *
+ * \code
+ *   Simulator::Stop (Seconds (50));
+ *   Simulator::Run ();
+ *   SimulationFork fork;
+ *   uint32_t branch = fork.Fork (rates.size ());
+ *   if (fork.IsParent ())
+ *     {
+ *       return fork.GetFailures () == 0 ? 0 : 1;
+ *     }
+ *   apps.Get (0)->SetAttribute ("DataRate", StringValue (rates[branch]));
+ *   Simulator::Stop (Seconds (100));
+ *   Simulator::Run ();
+ * \endcode
+ *
+ * The state is copied by fork(2), so it is not written anywhere and the
+ * branches share the memory of the warm-up until they modify it. Fork
+ * must be called between two calls to Simulator::Run, not from an event:
+ * the threads of the realtime and multithreaded simulators do not exist
+ * in the children. The files opened before the fork, such as the trace
+ * files, are shared by the branches, which should open their own.
+ */
+class SimulationFork
+{
+public:
+  SimulationFork ();
+
+  /**
+   * \param parallel the number of branches which run at the same time,
+   *        1 by default
+   */
+  void SetParallel (uint32_t parallel);
+  /**
+   * \param branches the number of branches
+   * \returns in each child, the index of its branch, from 0 to
+   *          branches - 1. In the parent, branches, once all the
+   *          children have exited.
+   */
+  uint32_t Fork (uint32_t branches);
+  /**
+   * \returns true in the process which called Fork, false in the branches
+   */
+  bool IsParent (void) const;
+  /**
+   * \returns the number of branches which did not exit with a zero status
+   */
+  uint32_t GetFailures (void) const;
+
+private:
+  uint32_t m_parallel;
+  bool m_isParent;
+  uint32_t m_failures;
+};
+
+} // namespace ns3
+
+#endif /* SIMULATION_FORK_H */
@@ -11,4 +11,13 @@ SimulatorImpl::GetTypeId (void)
   return tid;
 }
 
+void
+SimulatorImpl::ScheduleBatch (const EventBatch &batch)
+{
+  for (uint32_t i = 0; i < batch.GetSize (); i++)
+    {
+      ScheduleWithContext (batch.GetContext (i), batch.GetDelay (i), batch.PeekEvent (i));
+    }
+}
+
 } // namespace ns3
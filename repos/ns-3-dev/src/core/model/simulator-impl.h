@@ -23,6 +23,7 @@
 
 #include "event-impl.h"
 #include "event-id.h"
+#include "event-batch.h"
 #include "nstime.h"
 #include "object.h"
 #include "object-factory.h"
@@ -93,6 +94,14 @@ public:
    * to delegate events to their own subclass of the EventImpl base class.
    */
   virtual void ScheduleWithContext (uint32_t context, Time const &time, EventImpl *event) = 0;
+  /**
+   * \param batch the events to schedule
+   *
+   * Takes over the events of the batch, which the caller then
+   * forgets. The default implementation calls ScheduleWithContext for
+   * each event.
+   */
+  virtual void ScheduleBatch (const EventBatch &batch);
   /**
    * \param event the event to schedule
    * \returns a unique identifier for the newly-scheduled event.
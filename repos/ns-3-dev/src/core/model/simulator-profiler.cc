@@ -0,0 +1,231 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "simulator-profiler.h"
+#include "event-impl.h"
+#include "log.h"
+
+#include <sys/time.h>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#if (__GNUC__ >= 3)
+#include <stdlib.h>
+#include <cxxabi.h>
+#endif
+
+NS_LOG_COMPONENT_DEFINE ("SimulatorProfiler");
+
+namespace ns3 {
+
+static uint64_t
+GetWallClockUs (void)
+{
+  struct timeval tv;
+  gettimeofday (&tv, 0);
+  return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+SimulatorProfiler::Cost::Cost ()
+  : count (0),
+    ticks (0)
+{
+}
+
+SimulatorProfiler::SimulatorProfiler ()
+  : m_maxPending (0)
+{
+  m_startTicks = GetTicks ();
+  m_startUs = GetWallClockUs ();
+}
+
+uint64_t
+SimulatorProfiler::GetTicks (void)
+{
+#if defined (__GNUC__) && (defined (__i386__) || defined (__x86_64__))
+  uint32_t low, high;
+  __asm__ __volatile__ ("rdtsc" : "=a" (low), "=d" (high));
+  return ((uint64_t)high << 32) | low;
+#else
+  return GetWallClockUs () * 1000;
+#endif
+}
+
+void
+SimulatorProfiler::RecordEvent (const EventImpl *event, uint32_t context, uint64_t ticks)
+{
+  Cost &cost = m_events[Key (&typeid (*event), context)];
+  cost.count++;
+  cost.ticks += ticks;
+}
+
+void
+SimulatorProfiler::RecordInsert (uint64_t ticks, uint32_t pending)
+{
+  m_insert.count++;
+  m_insert.ticks += ticks;
+  m_maxPending = std::max (m_maxPending, pending);
+}
+
+void
+SimulatorProfiler::RecordRemove (uint64_t ticks)
+{
+  m_remove.count++;
+  m_remove.ticks += ticks;
+}
+
+std::string
+SimulatorProfiler::GetTypeName (const std::type_info *type)
+{
+  std::string name = type->name ();
+#if (__GNUC__ >= 3)
+  int status;
+  char *demangled = abi::__cxa_demangle (name.c_str (), 0, 0, &status);
+  if (status == 0)
+    {
+      name = demangled;
+    }
+  free (demangled);
+#endif
+  // semicolons separate the frames of a folded stack
+  std::replace (name.begin (), name.end (), ';', ',');
+  return name;
+}
+
+std::string
+SimulatorProfiler::GetContextName (uint32_t context)
+{
+  if (context == 0xffffffff)
+    {
+      return "no context";
+    }
+  std::ostringstream oss;
+  oss << "context " << context;
+  return oss.str ();
+}
+
+namespace {
+
+struct Row
+{
+  Row () : count (0), ticks (0) {}
+  std::string name;
+  uint64_t count;
+  uint64_t ticks;
+  bool operator < (const Row &o) const
+  {
+    return ticks > o.ticks || (ticks == o.ticks && name < o.name);
+  }
+};
+
+void
+WriteRows (std::ostream &os, std::string title, std::map<std::string, Row> &byName,
+           double nsPerTick, uint64_t totalTicks)
+{
+  std::vector<Row> rows;
+  for (std::map<std::string, Row>::const_iterator i = byName.begin (); i != byName.end (); ++i)
+    {
+      rows.push_back (i->second);
+    }
+  std::sort (rows.begin (), rows.end ());
+  os << std::endl << title << std::endl
+     << std::setw (12) << "count" << std::setw (14) << "total ms" << std::setw (8) << "%"
+     << std::setw (12) << "ns/event" << "  name" << std::endl;
+  for (std::vector<Row>::const_iterator i = rows.begin (); i != rows.end (); ++i)
+    {
+      os << std::setw (12) << i->count
+         << std::setw (14) << std::fixed << std::setprecision (3) << i->ticks * nsPerTick / 1e6
+         << std::setw (8) << std::setprecision (1) << (totalTicks > 0 ? 100.0 * i->ticks / totalTicks : 0.0)
+         << std::setw (12) << std::setprecision (0) << (i->count > 0 ? i->ticks * nsPerTick / i->count : 0.0)
+         << "  " << i->name << std::endl;
+    }
+}
+
+} // anonymous namespace
+
+void
+SimulatorProfiler::Write (std::string filename) const
+{
+  NS_LOG_FUNCTION (this << filename);
+  double nsPerTick = 1.0;
+#if defined (__GNUC__) && (defined (__i386__) || defined (__x86_64__))
+  uint64_t ticks = GetTicks () - m_startTicks;
+  uint64_t us = GetWallClockUs () - m_startUs;
+  if (ticks > 0)
+    {
+      nsPerTick = 1000.0 * us / ticks;
+    }
+#endif
+
+  // the same type can have several type_info objects, one per library
+  std::map<std::string, Row> byType;
+  std::map<std::string, Row> byContext;
+  std::map<std::string, uint64_t> stacks;
+  uint64_t count = 0;
+  uint64_t totalTicks = 0;
+  for (Costs::const_iterator i = m_events.begin (); i != m_events.end (); ++i)
+    {
+      std::string type = GetTypeName (i->first.first);
+      std::string context = GetContextName (i->first.second);
+      Row &t = byType[type];
+      t.name = type;
+      t.count += i->second.count;
+      t.ticks += i->second.ticks;
+      Row &c = byContext[context];
+      c.name = context;
+      c.count += i->second.count;
+      c.ticks += i->second.ticks;
+      stacks["Simulator::Run;" + context + ";" + type] += i->second.ticks;
+      count += i->second.count;
+      totalTicks += i->second.ticks;
+    }
+  stacks["Simulator::Run;Scheduler::Insert"] += m_insert.ticks;
+  stacks["Simulator::Run;Scheduler::Remove"] += m_remove.ticks;
+
+  std::ofstream report (filename.c_str ());
+  if (!report.is_open ())
+    {
+      NS_LOG_WARN ("cannot open " << filename);
+      return;
+    }
+  report << count << " events, " << std::fixed << std::setprecision (3)
+         << totalTicks * nsPerTick / 1e6 << " ms" << std::endl
+         << m_insert.count << " inserts, "
+         << m_insert.ticks * nsPerTick / 1e6 << " ms" << std::endl
+         << m_remove.count << " removes, "
+         << m_remove.ticks * nsPerTick / 1e6 << " ms" << std::endl
+         << m_maxPending << " pending events at most" << std::endl;
+  WriteRows (report, "by event type:", byType, nsPerTick, totalTicks);
+  WriteRows (report, "by context:", byContext, nsPerTick, totalTicks);
+
+  std::string foldedName = filename + ".folded";
+  std::ofstream folded (foldedName.c_str ());
+  if (!folded.is_open ())
+    {
+      NS_LOG_WARN ("cannot open " << foldedName);
+      return;
+    }
+  for (std::map<std::string, uint64_t>::const_iterator i = stacks.begin (); i != stacks.end (); ++i)
+    {
+      folded << i->first << " " << (uint64_t)(i->second * nsPerTick) << std::endl;
+    }
+}
+
+} // namespace ns3
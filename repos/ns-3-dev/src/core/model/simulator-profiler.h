@@ -0,0 +1,105 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef SIMULATOR_PROFILER_H
+#define SIMULATOR_PROFILER_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <typeinfo>
+#include <utility>
+
+namespace ns3 {
+
+class EventImpl;
+
+/**
+ * \ingroup simulator
+ * \brief the cost of the events and of the event list of a simulation
+ *
+ * Counts the events and adds up the time spent in them by event type,
+ * which is the EventImpl subclass created by Simulator::Schedule and
+ * thus names the callback signature and class, and by context. It also
+ * keeps the time spent in the Insert and Remove methods of the scheduler
+ * and the largest number of pending events. The time of an event
+ * includes the insertions it makes.
+ *
+ * The times are read from the time stamp counter on x86 and converted
+ * to nanoseconds with the wall clock time elapsed since the profiler was
+ * created, and from gettimeofday elsewhere.
+ */
+class SimulatorProfiler
+{
+public:
+  SimulatorProfiler ();
+
+  /**
+   * \returns the current time in ticks
+   */
+  static uint64_t GetTicks (void);
+
+  /**
+   * \param event the event that ran
+   * \param context the context it ran in
+   * \param ticks the ticks spent in EventImpl::Invoke
+   */
+  void RecordEvent (const EventImpl *event, uint32_t context, uint64_t ticks);
+  /**
+   * \param ticks the ticks spent in Scheduler::Insert or Scheduler::InsertBatch
+   * \param pending the number of pending events after the insertion
+   */
+  void RecordInsert (uint64_t ticks, uint32_t pending);
+  /**
+   * \param ticks the ticks spent in Scheduler::RemoveNext or Scheduler::Remove
+   */
+  void RecordRemove (uint64_t ticks);
+
+  /**
+   * \param filename the file of the report
+   *
+   * Writes the event types and the contexts sorted by decreasing time
+   * to the file, and the same times as folded stacks, one
+   * "Simulator::Run;context;event type nanoseconds" line per event type
+   * and context, to filename.folded, the input of flamegraph.pl.
+   */
+  void Write (std::string filename) const;
+
+private:
+  struct Cost
+  {
+    Cost ();
+    uint64_t count;
+    uint64_t ticks;
+  };
+  typedef std::pair<const std::type_info *, uint32_t> Key;
+  typedef std::map<Key, Cost> Costs;
+
+  static std::string GetTypeName (const std::type_info *type);
+  static std::string GetContextName (uint32_t context);
+
+  Costs m_events;
+  Cost m_insert;
+  Cost m_remove;
+  uint32_t m_maxPending;
+  uint64_t m_startTicks;
+  uint64_t m_startUs;
+};
+
+} // namespace ns3
+
+#endif /* SIMULATOR_PROFILER_H */
@@ -218,6 +218,13 @@ Simulator::ScheduleWithContext (uint32_t context, const Time &time, EventImpl *i
 {
   return GetImpl ()->ScheduleWithContext (context, time, impl);
 }
+void
+Simulator::ScheduleBatch (EventBatch &batch)
+{
+  NS_LOG_FUNCTION (batch.GetSize ());
+  GetImpl ()->ScheduleBatch (batch);
+  batch.Release ();
+}
 EventId
 Simulator::ScheduleDestroy (const Ptr<EventImpl> &ev)
 {
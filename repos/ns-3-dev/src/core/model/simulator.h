@@ -23,6 +23,7 @@
 
 #include "event-id.h"
 #include "event-impl.h"
+#include "event-batch.h"
 #include "make-event.h"
 #include "nstime.h"
 
@@ -753,6 +754,18 @@ public:
    */
   static void ScheduleWithContext (uint32_t context, const Time &time, EventImpl *event);
 
+  /**
+   * \param batch the events to schedule, each with its own context and
+   *        delay. The batch is empty on return.
+   *
+   * Schedule all the events of the batch at once. The events are
+   * scheduled in the order they were added to the batch, as with a
+   * sequence of calls to ScheduleWithContext, but they are inserted in
+   * the event list in a single call to Scheduler::InsertBatch. This is
+   * meant for the channels which deliver a frame to many receivers.
+   */
+  static void ScheduleBatch (EventBatch &batch);
+
   /**
    * \param event the event to schedule
    * \returns a unique identifier for the newly-scheduled event.
@@ -0,0 +1,259 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/multithreaded-simulator-impl.h"
+#include "ns3/default-simulator-impl.h"
+#include "ns3/global-value.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * Passes tokens around a set of nodes, each node forwarding every token
+ * it receives to another node, most of them in other partitions, and
+ * running a local timer that it sometimes cancels. The counters of a
+ * node are only touched by its own events, so the run must give the
+ * same counts with the multithreaded simulator as with the default one.
+ */
+class MultithreadedSimulatorTestCase : public TestCase
+{
+public:
+  MultithreadedSimulatorTestCase (uint32_t partitions, Time lookAhead);
+  virtual void DoRun (void);
+private:
+  struct Counts
+  {
+    std::vector<uint32_t> tokens;
+    std::vector<uint32_t> timers;
+    std::vector<uint64_t> lastTs;
+    std::vector<uint32_t> errors;
+  };
+  void RunNodes (Ptr<SimulatorImpl> impl, Counts *counts);
+  void Receive (uint32_t node, Time expected);
+  void Timer (uint32_t node);
+
+  static const uint32_t NODES = 16;
+  uint32_t m_partitions;
+  Time m_lookAhead;
+  Counts *m_counts;
+  std::vector<EventId> m_timers;
+};
+
+MultithreadedSimulatorTestCase::MultithreadedSimulatorTestCase (uint32_t partitions, Time lookAhead)
+  : TestCase ("Check the multithreaded simulator against the default one"),
+    m_partitions (partitions),
+    m_lookAhead (lookAhead),
+    m_counts (0)
+{
+}
+
+void
+MultithreadedSimulatorTestCase::Receive (uint32_t node, Time expected)
+{
+  m_counts->tokens[node]++;
+  m_counts->lastTs[node] = Simulator::Now ().GetTimeStep ();
+  if (Simulator::Now () != expected || Simulator::GetContext () != node)
+    {
+      m_counts->errors[node]++;
+    }
+  uint32_t next = (node * 5 + 3) % NODES;
+  Time delay = m_lookAhead + MicroSeconds (1 + node % 3);
+  Simulator::ScheduleWithContext (next, delay, &MultithreadedSimulatorTestCase::Receive, this,
+                                  next, Simulator::Now () + delay);
+  if (m_counts->tokens[node] % 3 == 0)
+    {
+      // a pending timer of the node is always in the partition of the node
+      m_timers[node].Cancel ();
+    }
+  if (m_timers[node].IsExpired ())
+    {
+      // off the microsecond grid of the tokens, so that a timer never
+      // expires at the same time as a token arrives, whose order would
+      // depend on the uids
+      m_timers[node] = Simulator::Schedule (MicroSeconds (7) + NanoSeconds (1),
+                                            &MultithreadedSimulatorTestCase::Timer, this, node);
+    }
+}
+
+void
+MultithreadedSimulatorTestCase::Timer (uint32_t node)
+{
+  m_counts->timers[node]++;
+  if (Simulator::GetContext () != node)
+    {
+      m_counts->errors[node]++;
+    }
+}
+
+void
+MultithreadedSimulatorTestCase::RunNodes (Ptr<SimulatorImpl> impl, Counts *counts)
+{
+  counts->tokens.assign (NODES, 0);
+  counts->timers.assign (NODES, 0);
+  counts->lastTs.assign (NODES, 0);
+  counts->errors.assign (NODES, 0);
+  m_counts = counts;
+  m_timers.assign (NODES, EventId ());
+  Simulator::SetImplementation (impl);
+  for (uint32_t i = 0; i < NODES; i++)
+    {
+      Simulator::ScheduleWithContext (i, MicroSeconds (i), &MultithreadedSimulatorTestCase::Receive, this,
+                                      i, MicroSeconds (i));
+    }
+  // between two events: at the stop time itself, the default simulator
+  // only runs the events scheduled before the call to Stop
+  Simulator::Stop (MilliSeconds (10) + NanoSeconds (500));
+  Simulator::Run ();
+  Simulator::Destroy ();
+  m_timers.clear ();
+}
+
+void
+MultithreadedSimulatorTestCase::DoRun (void)
+{
+  Simulator::Destroy ();
+
+  Counts expected;
+  RunNodes (CreateObject<DefaultSimulatorImpl> (), &expected);
+
+  Ptr<MultithreadedSimulatorImpl> impl = CreateObject<MultithreadedSimulatorImpl> ();
+  impl->SetAttribute ("Partitions", UintegerValue (m_partitions));
+  impl->SetAttribute ("LookAhead", TimeValue (m_lookAhead));
+  Counts counts;
+  RunNodes (impl, &counts);
+
+  for (uint32_t i = 0; i < NODES; i++)
+    {
+      NS_TEST_EXPECT_MSG_GT (expected.tokens[i], 100, "too few tokens at node " << i);
+      NS_TEST_EXPECT_MSG_EQ (counts.tokens[i], expected.tokens[i], "wrong token count at node " << i);
+      NS_TEST_EXPECT_MSG_EQ (counts.timers[i], expected.timers[i], "wrong timer count at node " << i);
+      NS_TEST_EXPECT_MSG_EQ (counts.lastTs[i], expected.lastTs[i], "wrong last token time at node " << i);
+      NS_TEST_EXPECT_MSG_EQ (counts.errors[i], 0, "wrong time or context at node " << i);
+    }
+}
+
+// last tick of a node which never ticked
+static const uint64_t NO_TICK = 0xffffffffffffffffULL;
+
+/**
+ * Node 0 ticks every microsecond and calls Simulator::Stop (time) from
+ * its first tick, while the other nodes only start to tick later: the
+ * first window of the partition of node 0 is twice the lookahead, longer
+ * than the delay of the stop, and must still end at the stop time.
+ */
+class MultithreadedSimulatorStopTestCase : public TestCase
+{
+public:
+  MultithreadedSimulatorStopTestCase (uint32_t partitions, Time lookAhead);
+  virtual void DoRun (void);
+private:
+  void Tick (uint32_t node);
+
+  static const uint32_t NODES = 8;
+  uint32_t m_partitions;
+  Time m_lookAhead;
+  std::vector<uint64_t> m_lastTs;
+};
+
+MultithreadedSimulatorStopTestCase::MultithreadedSimulatorStopTestCase (uint32_t partitions, Time lookAhead)
+  : TestCase ("Check that Simulator::Stop (time) called by an event stops all the partitions"),
+    m_partitions (partitions),
+    m_lookAhead (lookAhead)
+{
+}
+
+void
+MultithreadedSimulatorStopTestCase::Tick (uint32_t node)
+{
+  m_lastTs[node] = Simulator::Now ().GetTimeStep ();
+  if (node == 0 && Simulator::Now ().IsZero ())
+    {
+      // between two ticks, see MultithreadedSimulatorTestCase
+      Simulator::Stop (m_lookAhead + NanoSeconds (500));
+    }
+  Simulator::Schedule (MicroSeconds (1), &MultithreadedSimulatorStopTestCase::Tick, this, node);
+}
+
+void
+MultithreadedSimulatorStopTestCase::DoRun (void)
+{
+  Simulator::Destroy ();
+  Ptr<MultithreadedSimulatorImpl> impl = CreateObject<MultithreadedSimulatorImpl> ();
+  impl->SetAttribute ("Partitions", UintegerValue (m_partitions));
+  impl->SetAttribute ("LookAhead", TimeValue (m_lookAhead));
+  Simulator::SetImplementation (impl);
+  m_lastTs.assign (NODES, NO_TICK);
+  for (uint32_t i = 0; i < NODES; i++)
+    {
+      Simulator::ScheduleWithContext (i, MicroSeconds (i == 0 ? 0 : 50), &MultithreadedSimulatorStopTestCase::Tick, this, i);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_EXPECT_MSG_EQ (m_lastTs[0], (uint64_t) m_lookAhead.GetTimeStep (), "wrong last tick at node 0");
+  for (uint32_t i = 1; i < NODES; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_lastTs[i], NO_TICK, "tick after the stop time at node " << i);
+    }
+}
+
+class MultithreadedSimulatorSelectionTestCase : public TestCase
+{
+public:
+  MultithreadedSimulatorSelectionTestCase ();
+  virtual void DoRun (void);
+};
+
+MultithreadedSimulatorSelectionTestCase::MultithreadedSimulatorSelectionTestCase ()
+  : TestCase ("Check that SimulatorImplementationType selects the multithreaded simulator")
+{
+}
+
+void
+MultithreadedSimulatorSelectionTestCase::DoRun (void)
+{
+  Simulator::Destroy ();
+  StringValue previous;
+  GlobalValue::GetValueByName ("SimulatorImplementationType", previous);
+  GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::MultithreadedSimulatorImpl"));
+  NS_TEST_EXPECT_MSG_EQ (Simulator::GetImplementation ()->GetInstanceTypeId (),
+                         MultithreadedSimulatorImpl::GetTypeId (), "wrong simulator implementation");
+  Simulator::Destroy ();
+  GlobalValue::Bind ("SimulatorImplementationType", previous);
+}
+
+class MultithreadedSimulatorTestSuite : public TestSuite
+{
+public:
+  MultithreadedSimulatorTestSuite ()
+    : TestSuite ("multithreaded-simulator", UNIT)
+  {
+    AddTestCase (new MultithreadedSimulatorSelectionTestCase ());
+    AddTestCase (new MultithreadedSimulatorTestCase (1, MicroSeconds (5)));
+    AddTestCase (new MultithreadedSimulatorTestCase (4, MicroSeconds (5)));
+    AddTestCase (new MultithreadedSimulatorTestCase (4, Seconds (0)));
+    AddTestCase (new MultithreadedSimulatorTestCase (7, MicroSeconds (20)));
+    // most windows leave some partitions idle
+    AddTestCase (new MultithreadedSimulatorTestCase (16, MicroSeconds (1)));
+    AddTestCase (new MultithreadedSimulatorTestCase (16, Seconds (0)));
+    AddTestCase (new MultithreadedSimulatorStopTestCase (2, MicroSeconds (3)));
+    AddTestCase (new MultithreadedSimulatorStopTestCase (4, Seconds (0)));
+  }
+} g_multithreadedSimulatorTestSuite;
@@ -0,0 +1,121 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/simulation-fork.h"
+#include "ns3/random-variable.h"
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+using namespace ns3;
+
+/**
+ * Runs a simulation for 10s, forks it into four branches which each run
+ * 10s more with their own parameter, one of them failing, and checks
+ * the results the branches wrote: each branch went on from the state of
+ * the warm-up, with the same random numbers.
+ */
+class SimulationForkTestCase : public TestCase
+{
+public:
+  SimulationForkTestCase ();
+  virtual void DoRun (void);
+private:
+  void Tick (void);
+  uint32_t m_ticks;
+  uint32_t m_step;
+  double m_sum;
+  UniformVariable m_random;
+};
+
+SimulationForkTestCase::SimulationForkTestCase ()
+  : TestCase ("Check that the branches of a SimulationFork go on from the same state"),
+    m_ticks (0),
+    m_step (1),
+    m_sum (0)
+{
+}
+
+void
+SimulationForkTestCase::Tick (void)
+{
+  m_ticks += m_step;
+  m_sum += m_random.GetValue ();
+  Simulator::Schedule (Seconds (1), &SimulationForkTestCase::Tick, this);
+}
+
+void
+SimulationForkTestCase::DoRun (void)
+{
+  Simulator::Schedule (Seconds (1), &SimulationForkTestCase::Tick, this);
+  Simulator::Stop (Seconds (10.5));
+  Simulator::Run ();
+
+  std::string prefix = CreateTempDirFilename ("simulation-fork-");
+  SimulationFork fork;
+  fork.SetParallel (2);
+  uint32_t branch = fork.Fork (4);
+  if (!fork.IsParent ())
+    {
+      m_step = branch + 1;
+      Simulator::Stop (Seconds (10));
+      Simulator::Run ();
+      std::ostringstream filename;
+      filename << prefix << branch;
+      std::ofstream out (filename.str ().c_str ());
+      out << Simulator::Now ().GetSeconds () << " " << m_ticks << " " << m_sum << std::endl;
+      out.close ();
+      // the branches must not go back to the test runner
+      _exit (branch == 3 ? 1 : 0);
+    }
+  Simulator::Destroy ();
+
+  NS_TEST_EXPECT_MSG_EQ (branch, 4, "the parent should get the number of branches");
+  NS_TEST_EXPECT_MSG_EQ (fork.GetFailures (), 1, "branch 3 should have failed");
+  double sum = 0;
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      std::ostringstream filename;
+      filename << prefix << i;
+      std::ifstream in (filename.str ().c_str ());
+      NS_TEST_ASSERT_MSG_EQ (in.is_open (), true, "branch " << i << " wrote nothing");
+      double now;
+      uint32_t ticks;
+      double branchSum;
+      in >> now >> ticks >> branchSum;
+      NS_TEST_EXPECT_MSG_EQ_TOL (now, 20.5, 1e-9, "branch " << i << " stopped at the wrong time");
+      // 10 ticks before the fork, 10 after it
+      NS_TEST_EXPECT_MSG_EQ (ticks, 10 + 10 * (i + 1), "branch " << i << " did not go on from the warm-up");
+      if (i == 0)
+        {
+          sum = branchSum;
+        }
+      NS_TEST_EXPECT_MSG_EQ_TOL (branchSum, sum, 1e-9, "branch " << i << " drew other random numbers");
+    }
+}
+
+class SimulationForkTestSuite : public TestSuite
+{
+public:
+  SimulationForkTestSuite ()
+    : TestSuite ("simulation-fork", UNIT)
+  {
+    AddTestCase (new SimulationForkTestCase ());
+  }
+} g_simulationForkTestSuite;
@@ -0,0 +1,124 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/default-simulator-impl.h"
+#include "ns3/string.h"
+#include <fstream>
+#include <sstream>
+#include <map>
+
+using namespace ns3;
+
+/**
+ * Runs events of two types in two contexts with the profiler enabled,
+ * and checks the counts of the report and the stacks of the folded
+ * file written at Simulator::Destroy.
+ */
+class SimulatorProfilerTestCase : public TestCase
+{
+public:
+  SimulatorProfilerTestCase ();
+  virtual void DoRun (void);
+private:
+  void Tick (void);
+  static void Tock (int i);
+};
+
+SimulatorProfilerTestCase::SimulatorProfilerTestCase ()
+  : TestCase ("Check the report and the folded stacks of the simulator profiler")
+{
+}
+
+void
+SimulatorProfilerTestCase::Tick (void)
+{
+}
+
+void
+SimulatorProfilerTestCase::Tock (int i)
+{
+}
+
+void
+SimulatorProfilerTestCase::DoRun (void)
+{
+  std::string filename = CreateTempDirFilename ("simulator-profile.txt");
+  Simulator::Destroy ();
+  Ptr<DefaultSimulatorImpl> impl = CreateObject<DefaultSimulatorImpl> ();
+  impl->SetAttribute ("ProfileFile", StringValue (filename));
+  Simulator::SetImplementation (impl);
+  for (uint32_t i = 0; i < 10; i++)
+    {
+      Simulator::ScheduleWithContext (7, MicroSeconds (i), &SimulatorProfilerTestCase::Tick, this);
+    }
+  for (int i = 0; i < 5; i++)
+    {
+      Simulator::Schedule (MicroSeconds (i), &SimulatorProfilerTestCase::Tock, i);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  std::ifstream report (filename.c_str ());
+  NS_TEST_ASSERT_MSG_EQ (report.is_open (), true, "no report in " << filename);
+  std::string line;
+  std::getline (report, line);
+  NS_TEST_EXPECT_MSG_EQ (line.substr (0, 10), "15 events,", "wrong event count");
+  std::getline (report, line);
+  // the two events at time 0 go through the lane of the current time,
+  // not through the scheduler
+  NS_TEST_EXPECT_MSG_EQ (line.substr (0, 11), "13 inserts,", "wrong insert count");
+  std::getline (report, line);
+  NS_TEST_EXPECT_MSG_EQ (line.substr (0, 11), "13 removes,", "wrong remove count");
+  std::getline (report, line);
+  NS_TEST_EXPECT_MSG_EQ (line, "15 pending events at most", "wrong peak of pending events");
+
+  std::ifstream folded ((filename + ".folded").c_str ());
+  NS_TEST_ASSERT_MSG_EQ (folded.is_open (), true, "no folded stacks in " << filename << ".folded");
+  std::map<std::string, uint32_t> frames;
+  uint32_t lines = 0;
+  while (std::getline (folded, line))
+    {
+      lines++;
+      // every line is a stack of frames separated by ';' and a number
+      std::string::size_type space = line.rfind (' ');
+      NS_TEST_ASSERT_MSG_NE (space, std::string::npos, "no count in " << line);
+      std::istringstream iss (line.substr (space + 1));
+      uint64_t ns;
+      NS_TEST_EXPECT_MSG_EQ ((bool)(iss >> ns), true, "bad count in " << line);
+      std::string stack = line.substr (0, space);
+      NS_TEST_EXPECT_MSG_EQ (stack.substr (0, 15), "Simulator::Run;", "bad root frame in " << line);
+      std::string::size_type second = stack.find (';', 15);
+      frames[stack.substr (15, second == std::string::npos ? std::string::npos : second - 15)]++;
+    }
+  NS_TEST_EXPECT_MSG_EQ (lines, 4, "wrong number of stacks");
+  NS_TEST_EXPECT_MSG_EQ (frames["context 7"], 1, "missing the events of context 7");
+  NS_TEST_EXPECT_MSG_EQ (frames["no context"], 1, "missing the events without context");
+  NS_TEST_EXPECT_MSG_EQ (frames["Scheduler::Insert"], 1, "missing the insertions");
+  NS_TEST_EXPECT_MSG_EQ (frames["Scheduler::Remove"], 1, "missing the removals");
+}
+
+class SimulatorProfilerTestSuite : public TestSuite
+{
+public:
+  SimulatorProfilerTestSuite ()
+    : TestSuite ("simulator-profiler", UNIT)
+  {
+    AddTestCase (new SimulatorProfilerTestCase ());
+  }
+} g_simulatorProfilerTestSuite;
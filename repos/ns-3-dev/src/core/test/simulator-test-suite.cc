@@ -24,6 +24,15 @@
 #include "ns3/map-scheduler.h"
 #include "ns3/calendar-scheduler.h"
 #include "ns3/ns2-calendar-scheduler.h"
+#include "ns3/four-ary-heap-scheduler.h"
+#include "ns3/ladder-queue-scheduler.h"
+#include "ns3/uinteger.h"
+#include "ns3/make-event.h"
+#include "ns3/core-config.h"
+#include <set>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
 
 namespace ns3 {
 
@@ -460,6 +469,400 @@ SimulatorTemplateTestCase::DoRun (void)
   Simulator::Destroy ();
 }
 
+class EventRecyclingTestCase : public TestCase
+{
+public:
+  EventRecyclingTestCase ();
+  virtual void DoRun (void);
+};
+
+EventRecyclingTestCase::EventRecyclingTestCase ()
+  : TestCase ("Check that the memory of deleted events is reused")
+{
+}
+
+void
+EventRecyclingTestCase::DoRun (void)
+{
+  EventImpl *first = MakeEvent (&ber1, 0);
+  first->Unref ();
+  EventImpl *second = MakeEvent (&ber1, 1);
+#ifdef HAVE_THREAD_LOCAL
+  NS_TEST_EXPECT_MSG_EQ (second, first, "the event should take the memory of the deleted one");
+#endif
+  // a larger event comes from another size class
+  EventImpl *large = MakeEvent (&ber5, 0, 0, 0, 0, 0);
+  NS_TEST_EXPECT_MSG_NE (large, second, "events alive at the same time should not share memory");
+  second->Unref ();
+  large->Unref ();
+}
+
+#if defined (HAVE_THREAD_LOCAL) && defined (HAVE_PTHREAD_H)
+class EventThreadExitTestCase : public TestCase
+{
+public:
+  EventThreadExitTestCase ();
+  virtual void DoRun (void);
+  static void *CreateEvents (void *arg);
+};
+
+EventThreadExitTestCase::EventThreadExitTestCase ()
+  : TestCase ("Check that the free events of a thread are released when it exits")
+{
+}
+
+void *
+EventThreadExitTestCase::CreateEvents (void *arg)
+{
+  uint32_t *cached = static_cast<uint32_t *> (arg);
+  EventImpl *events[100];
+  for (uint32_t i = 0; i < 100; i++)
+    {
+      events[i] = MakeEvent (&cber1, 0);
+    }
+  for (uint32_t i = 0; i < 100; i++)
+    {
+      events[i]->Unref ();
+    }
+  *cached = EventImpl::GetCachedBlocks ();
+  return 0;
+}
+
+void
+EventThreadExitTestCase::DoRun (void)
+{
+  uint32_t before = EventImpl::GetCachedBlocks ();
+  uint32_t cached = 0;
+  pthread_t thread;
+  pthread_create (&thread, 0, &EventThreadExitTestCase::CreateEvents, &cached);
+  pthread_join (thread, 0);
+  NS_TEST_EXPECT_MSG_EQ (cached, before + 100, "the thread should keep its deleted events");
+  NS_TEST_EXPECT_MSG_EQ (EventImpl::GetCachedBlocks (), before, "the thread should release its events when it exits");
+}
+#endif /* HAVE_THREAD_LOCAL && HAVE_PTHREAD_H */
+
+/**
+ * Drives a scheduler directly with a long random mix of inserts, batch
+ * inserts, removals of pending events and removals of the next event, many of them at the
+ * same timestamp, and checks that it always hands out the smallest
+ * (ts, uid) key, like a std::set of the pending keys would. As in a
+ * simulation, events are never inserted before the last event removed.
+ * The uids start at firstUid, so that they can cross 2^32 during the
+ * test, which a 32-bit uid would wrap around.
+ */
+class SchedulerOrderTestCase : public TestCase
+{
+public:
+  SchedulerOrderTestCase (ObjectFactory schedulerFactory, uint64_t firstUid);
+  virtual void DoRun (void);
+private:
+  uint32_t Random (uint32_t max);
+  ObjectFactory m_schedulerFactory;
+  uint64_t m_firstUid;
+  uint32_t m_state;
+};
+
+SchedulerOrderTestCase::SchedulerOrderTestCase (ObjectFactory schedulerFactory, uint64_t firstUid)
+  : TestCase ("Check that events come out in (ts, uid) order with " +
+              schedulerFactory.GetTypeId ().GetName () +
+              (firstUid > 0xffff0000ULL ? " across uid 2^32" : "")),
+    m_schedulerFactory (schedulerFactory),
+    m_firstUid (firstUid),
+    m_state (1)
+{
+}
+
+uint32_t
+SchedulerOrderTestCase::Random (uint32_t max)
+{
+  // a fixed linear congruential sequence keeps the test reproducible
+  m_state = m_state * 1103515245 + 12345;
+  return (m_state >> 8) % max;
+}
+
+void
+SchedulerOrderTestCase::DoRun (void)
+{
+  NS_TEST_ASSERT_MSG_EQ (sizeof (Scheduler::EventKey), 16, "the event key should stay 16 bytes");
+  Ptr<Scheduler> scheduler = m_schedulerFactory.Create<Scheduler> ();
+  std::set<Scheduler::EventKey> pending;
+  std::vector<Scheduler::EventKey> keys;
+  uint64_t uid = m_firstUid;
+  uint64_t now = 0;
+  for (uint32_t step = 0; step < 20000; step++)
+    {
+      uint32_t action = Random (10);
+      if (action == 4)
+        {
+          // a broadcast: a batch of events, mostly just after now, so
+          // before most of the pending ones
+          std::vector<Scheduler::Event> batch (Random (40) + 1);
+          for (uint32_t i = 0; i < batch.size (); i++)
+            {
+              batch[i].impl = 0;
+              batch[i].key.m_ts = now + Random (3);
+              batch[i].key.m_uid = uid++;
+              pending.insert (batch[i].key);
+              keys.push_back (batch[i].key);
+            }
+          scheduler->InsertBatch (batch);
+        }
+      else if (action < 5 || pending.empty ())
+        {
+          Scheduler::Event ev;
+          ev.impl = 0;
+          // mostly near events, with many equal timestamps, and a few
+          // far ones
+          ev.key.m_ts = now + (Random (10) == 0 ? Random (100000) : Random (50));
+          ev.key.m_uid = uid++;
+          scheduler->Insert (ev);
+          pending.insert (ev.key);
+          keys.push_back (ev.key);
+        }
+      else if (action < 8)
+        {
+          NS_TEST_ASSERT_MSG_EQ (scheduler->PeekNext ().key.m_uid, pending.begin ()->m_uid,
+                                 "wrong next event at step " << step);
+          Scheduler::Event next = scheduler->RemoveNext ();
+          NS_TEST_ASSERT_MSG_EQ (next.key.m_uid, pending.begin ()->m_uid, "wrong event at step " << step);
+          NS_TEST_ASSERT_MSG_EQ (next.key.m_ts, pending.begin ()->m_ts, "wrong time at step " << step);
+          now = next.key.m_ts;
+          pending.erase (pending.begin ());
+        }
+      else
+        {
+          Scheduler::EventKey key = keys[Random (keys.size ())];
+          if (pending.find (key) == pending.end ())
+            {
+              continue;
+            }
+          Scheduler::Event ev;
+          ev.impl = 0;
+          ev.key = key;
+          scheduler->Remove (ev);
+          pending.erase (key);
+        }
+      NS_TEST_ASSERT_MSG_EQ (scheduler->IsEmpty (), pending.empty (), "wrong emptiness at step " << step);
+    }
+  while (!pending.empty ())
+    {
+      Scheduler::Event next = scheduler->RemoveNext ();
+      NS_TEST_ASSERT_MSG_EQ (next.key.m_uid, pending.begin ()->m_uid, "wrong event while draining");
+      pending.erase (pending.begin ());
+    }
+  NS_TEST_ASSERT_MSG_EQ (scheduler->IsEmpty (), true, "scheduler should be empty");
+}
+
+/**
+ * Schedules events with Simulator::ScheduleBatch and checks that they run
+ * at the right time, in the right context, and in the order they were
+ * added to the batch when they expire at the same time.
+ */
+class ScheduleBatchTestCase : public TestCase
+{
+public:
+  ScheduleBatchTestCase (ObjectFactory schedulerFactory);
+  virtual void DoRun (void);
+private:
+  void Record (uint32_t id);
+  void Broadcast (void);
+  ObjectFactory m_schedulerFactory;
+  std::vector<uint32_t> m_ids;
+  std::vector<uint32_t> m_contexts;
+  std::vector<uint64_t> m_times;
+};
+
+ScheduleBatchTestCase::ScheduleBatchTestCase (ObjectFactory schedulerFactory)
+  : TestCase ("Check Simulator::ScheduleBatch with " +
+              schedulerFactory.GetTypeId ().GetName ()),
+    m_schedulerFactory (schedulerFactory)
+{
+}
+
+void
+ScheduleBatchTestCase::Record (uint32_t id)
+{
+  m_ids.push_back (id);
+  m_contexts.push_back (Simulator::GetContext ());
+  m_times.push_back (Simulator::Now ().GetMicroSeconds ());
+}
+
+void
+ScheduleBatchTestCase::Broadcast (void)
+{
+  // events 10 to 19 expire at 6us, 7us and 8us, interleaved with event 20,
+  // which was scheduled before the batch
+  EventBatch batch;
+  for (uint32_t i = 0; i < 10; i++)
+    {
+      batch.Add (100 + i, MicroSeconds (1 + i % 3), MakeEvent (&ScheduleBatchTestCase::Record, this, 10 + i));
+    }
+  Simulator::ScheduleBatch (batch);
+  NS_TEST_EXPECT_MSG_EQ (batch.IsEmpty (), true, "the batch should be empty once scheduled");
+  // a batch can be reused
+  batch.Add (200, MicroSeconds (3), MakeEvent (&ScheduleBatchTestCase::Record, this, 21));
+  Simulator::ScheduleBatch (batch);
+}
+
+void
+ScheduleBatchTestCase::DoRun (void)
+{
+  Simulator::SetScheduler (m_schedulerFactory);
+  Simulator::ScheduleWithContext (7, MicroSeconds (7), &ScheduleBatchTestCase::Record, this, 20);
+  Simulator::Schedule (MicroSeconds (5), &ScheduleBatchTestCase::Broadcast, this);
+  {
+    // the events of a batch which is never scheduled are dropped
+    EventBatch dropped;
+    dropped.Add (0, Seconds (0), MakeEvent (&ScheduleBatchTestCase::Record, this, 99));
+    dropped.Add (0, Seconds (0), MakeEvent (&ScheduleBatchTestCase::Record, this, 99));
+  }
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  uint32_t ids[] = { 10, 13, 16, 19, 20, 11, 14, 17, 12, 15, 18, 21 };
+  uint64_t times[] = { 6, 6, 6, 6, 7, 7, 7, 7, 8, 8, 8, 8 };
+  NS_TEST_ASSERT_MSG_EQ (m_ids.size (), 12, "wrong number of events");
+  for (uint32_t i = 0; i < 12; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_ids[i], ids[i], "wrong event at position " << i);
+      NS_TEST_EXPECT_MSG_EQ (m_times[i], times[i], "wrong time at position " << i);
+      uint32_t context = ids[i] == 20 ? 7 : ids[i] == 21 ? 200 : 100 + ids[i] - 10;
+      NS_TEST_EXPECT_MSG_EQ (m_contexts[i], context, "wrong context at position " << i);
+    }
+}
+
+/**
+ * Bounces events through every way of scheduling an event at the current
+ * time, mixed with events at later times and with events which were
+ * scheduled for the current time before the simulator reached it, and
+ * checks that they run in the order they were scheduled, as they would
+ * through the scheduler alone. Some of the pending events are removed or
+ * cancelled on the way.
+ */
+class SameTimeOrderTestCase : public TestCase
+{
+public:
+  SameTimeOrderTestCase (ObjectFactory schedulerFactory);
+  virtual void DoRun (void);
+private:
+  void Hop (uint32_t id);
+  void ScheduleHop (uint32_t how);
+  uint32_t Random (uint32_t max);
+  ObjectFactory m_schedulerFactory;
+  uint32_t m_state;
+  uint32_t m_nextId;
+  uint32_t m_run;
+  uint64_t m_lastTs;
+  uint32_t m_lastId;
+  std::vector<EventId> m_ids;
+  std::set<uint32_t> m_removed;
+};
+
+SameTimeOrderTestCase::SameTimeOrderTestCase (ObjectFactory schedulerFactory)
+  : TestCase ("Check the order of the events at the current time with " +
+              schedulerFactory.GetTypeId ().GetName ()),
+    m_schedulerFactory (schedulerFactory),
+    m_state (1),
+    m_nextId (0),
+    m_run (0),
+    m_lastTs (0),
+    m_lastId (0)
+{
+}
+
+uint32_t
+SameTimeOrderTestCase::Random (uint32_t max)
+{
+  m_state = m_state * 1103515245 + 12345;
+  return (m_state >> 8) % max;
+}
+
+void
+SameTimeOrderTestCase::ScheduleHop (uint32_t how)
+{
+  uint32_t id = m_nextId++;
+  EventId ev;
+  switch (how)
+    {
+    case 0:
+      ev = Simulator::ScheduleNow (&SameTimeOrderTestCase::Hop, this, id);
+      break;
+    case 1:
+      ev = Simulator::Schedule (Seconds (0), &SameTimeOrderTestCase::Hop, this, id);
+      break;
+    case 2:
+      Simulator::ScheduleWithContext (id, Seconds (0), &SameTimeOrderTestCase::Hop, this, id);
+      break;
+    case 3:
+      {
+        EventBatch batch;
+        batch.Add (id, Seconds (0), MakeEvent (&SameTimeOrderTestCase::Hop, this, id));
+        id = m_nextId++;
+        batch.Add (id, NanoSeconds (1), MakeEvent (&SameTimeOrderTestCase::Hop, this, id));
+        id = m_nextId++;
+        batch.Add (id, Seconds (0), MakeEvent (&SameTimeOrderTestCase::Hop, this, id));
+        Simulator::ScheduleBatch (batch);
+      }
+      break;
+    default:
+      ev = Simulator::Schedule (NanoSeconds (Random (3)), &SameTimeOrderTestCase::Hop, this, id);
+      break;
+    }
+  m_ids.resize (m_nextId);
+  m_ids[id] = ev;
+}
+
+void
+SameTimeOrderTestCase::Hop (uint32_t id)
+{
+  NS_TEST_EXPECT_MSG_EQ (m_removed.count (id), 0, "event " << id << " was removed");
+  uint64_t now = Simulator::Now ().GetTimeStep ();
+  NS_TEST_EXPECT_MSG_EQ ((now > m_lastTs || id > m_lastId), true,
+                         "event " << id << " ran after event " << m_lastId << " at the same time");
+  m_lastTs = now;
+  m_lastId = id;
+  m_run++;
+  if (m_nextId > 5000)
+    {
+      return;
+    }
+  // a long chain of events at the same time every now and then
+  uint32_t n = Random (20) == 0 ? 100 : 2;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      ScheduleHop (n > 2 ? 0 : Random (6));
+    }
+  uint32_t victim = Random (m_ids.size ());
+  if (m_ids[victim].IsRunning ())
+    {
+      if (Random (2) == 0)
+        {
+          Simulator::Remove (m_ids[victim]);
+        }
+      else
+        {
+          Simulator::Cancel (m_ids[victim]);
+        }
+      m_removed.insert (victim);
+    }
+}
+
+void
+SameTimeOrderTestCase::DoRun (void)
+{
+  Simulator::SetScheduler (m_schedulerFactory);
+  // the events at 1us after the first one are in the scheduler when the
+  // simulator reaches 1us, and must run before the events it schedules now
+  for (uint32_t i = 0; i < 10; i++)
+    {
+      uint32_t id = m_nextId++;
+      m_ids.push_back (Simulator::Schedule (MicroSeconds (1), &SameTimeOrderTestCase::Hop, this, id));
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+  NS_TEST_EXPECT_MSG_EQ (m_run + m_removed.size (), m_nextId, "lost events");
+}
+
 class SimulatorTestSuite : public TestSuite
 {
 public:
@@ -478,6 +881,33 @@ public:
     AddTestCase (new SimulatorEventsTestCase (factory));
     factory.SetTypeId (Ns2CalendarScheduler::GetTypeId ());
     AddTestCase (new SimulatorEventsTestCase (factory));
+    factory.SetTypeId (FourAryHeapScheduler::GetTypeId ());
+    AddTestCase (new SimulatorEventsTestCase (factory));
+    factory.SetTypeId (LadderQueueScheduler::GetTypeId ());
+    AddTestCase (new SimulatorEventsTestCase (factory));
+    AddTestCase (new EventRecyclingTestCase ());
+#if defined (HAVE_THREAD_LOCAL) && defined (HAVE_PTHREAD_H)
+    AddTestCase (new EventThreadExitTestCase ());
+#endif
+
+    const char *schedulers[] = { "ns3::ListScheduler", "ns3::MapScheduler", "ns3::HeapScheduler",
+                                 "ns3::CalendarScheduler", "ns3::Ns2CalendarScheduler",
+                                 "ns3::FourAryHeapScheduler", "ns3::LadderQueueScheduler" };
+    for (uint32_t i = 0; i < sizeof (schedulers) / sizeof (schedulers[0]); i++)
+      {
+        factory.SetTypeId (schedulers[i]);
+        AddTestCase (new SchedulerOrderTestCase (factory, 100));
+        // about 10000 insertions, half of them past 2^32
+        AddTestCase (new SchedulerOrderTestCase (factory, 0xffffffffULL - 5000));
+        AddTestCase (new ScheduleBatchTestCase (factory));
+        AddTestCase (new SameTimeOrderTestCase (factory));
+      }
+    // small buckets and a short ladder make the ladder queue split its
+    // buckets and run out of rungs all the time
+    factory.SetTypeId (LadderQueueScheduler::GetTypeId ());
+    factory.Set ("BucketThreshold", UintegerValue (4));
+    factory.Set ("MaxRungs", UintegerValue (3));
+    AddTestCase (new SchedulerOrderTestCase (factory, 100));
   }
 } g_simulatorTestSuite;
 
@@ -171,6 +171,7 @@
 #include "ns3/ipv6-static-routing-helper.h"
 #include <limits>
 #include <map>
+#include <sstream>
 
 NS_LOG_COMPONENT_DEFINE ("InternetStackHelper");
 
@@ -619,7 +620,7 @@ Ipv4L3ProtocolDropSinkWithoutContext (
 
   Ptr<Packet> p = packet->Copy ();
   p->AddHeader (header);
-  *stream->GetStream () << "d " << Simulator::Now ().GetSeconds () << " " << *p << std::endl;
+  AsciiTraceHelper::WritePacket (stream, 'd', p);
 }
 
 static void
@@ -648,10 +649,11 @@ Ipv4L3ProtocolDropSinkWithContext (
   Ptr<Packet> p = packet->Copy ();
   p->AddHeader (header);
 #ifdef INTERFACE_CONTEXT
-  *stream->GetStream () << "d " << Simulator::Now ().GetSeconds () << " " << context << "(" << interface << ") " 
-                        << *p << std::endl;
+  std::ostringstream oss;
+  oss << context << "(" << interface << ")";
+  AsciiTraceHelper::WritePacket (stream, 'd', oss.str (), p);
 #else
-  *stream->GetStream () << "d " << Simulator::Now ().GetSeconds () << " " << context << " "  << *p << std::endl;
+  AsciiTraceHelper::WritePacket (stream, 'd', context, p);
 #endif
 }
 
@@ -814,7 +816,7 @@ Ipv6L3ProtocolDropSinkWithoutContext (
 
   Ptr<Packet> p = packet->Copy ();
   p->AddHeader (header);
-  *stream->GetStream () << "d " << Simulator::Now ().GetSeconds () << " " << *p << std::endl;
+  AsciiTraceHelper::WritePacket (stream, 'd', p);
 }
 
 static void
@@ -843,10 +845,11 @@ Ipv6L3ProtocolDropSinkWithContext (
   Ptr<Packet> p = packet->Copy ();
   p->AddHeader (header);
 #ifdef INTERFACE_CONTEXT
-  *stream->GetStream () << "d " << Simulator::Now ().GetSeconds () << " " << context << "(" << interface << ") " 
-                        << *p << std::endl;
+  std::ostringstream oss;
+  oss << context << "(" << interface << ")";
+  AsciiTraceHelper::WritePacket (stream, 'd', oss.str (), p);
 #else
-  *stream->GetStream () << "d " << Simulator::Now ().GetSeconds () << " " << context << " " << *p << std::endl;
+  AsciiTraceHelper::WritePacket (stream, 'd', context, p);
 #endif
 }
 
@@ -241,7 +241,7 @@ DistributedSimulatorImpl::ProcessOneEvent (void)
 
   NS_LOG_LOGIC ("handle " << next.key.m_ts);
   m_currentTs = next.key.m_ts;
-  m_currentContext = next.key.m_context;
+  m_currentContext = next.impl->GetContext ();
   m_currentUid = next.key.m_uid;
   next.impl->Invoke ();
   next.impl->Unref ();
@@ -361,12 +361,12 @@ DistributedSimulatorImpl::Schedule (Time const &time, EventImpl *event)
   Scheduler::Event ev;
   ev.impl = event;
   ev.key.m_ts = static_cast<uint64_t> (tAbsolute.GetTimeStep ());
-  ev.key.m_context = GetContext ();
+  ev.impl->SetContext (GetContext ());
   ev.key.m_uid = m_uid;
   m_uid++;
   m_unscheduledEvents++;
   m_events->Insert (ev);
-  return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+  return EventId (event, ev.key.m_ts, ev.impl->GetContext (), ev.key.m_uid);
 }
 
 void
@@ -377,7 +377,7 @@ DistributedSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &tim
   Scheduler::Event ev;
   ev.impl = event;
   ev.key.m_ts = m_currentTs + time.GetTimeStep ();
-  ev.key.m_context = context;
+  ev.impl->SetContext (context);
   ev.key.m_uid = m_uid;
   m_uid++;
   m_unscheduledEvents++;
@@ -390,12 +390,12 @@ DistributedSimulatorImpl::ScheduleNow (EventImpl *event)
   Scheduler::Event ev;
   ev.impl = event;
   ev.key.m_ts = m_currentTs;
-  ev.key.m_context = GetContext ();
+  ev.impl->SetContext (GetContext ());
   ev.key.m_uid = m_uid;
   m_uid++;
   m_unscheduledEvents++;
   m_events->Insert (ev);
-  return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+  return EventId (event, ev.key.m_ts, ev.impl->GetContext (), ev.key.m_uid);
 }
 
 EventId
@@ -449,7 +449,6 @@ DistributedSimulatorImpl::Remove (const EventId &id)
   Scheduler::Event event;
   event.impl = id.PeekEventImpl ();
   event.key.m_ts = id.GetTs ();
-  event.key.m_context = id.GetContext ();
   event.key.m_uid = id.GetUid ();
   m_events->Remove (event);
   event.impl->Cancel ();
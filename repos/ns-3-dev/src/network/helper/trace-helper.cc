@@ -170,6 +170,9 @@ PcapHelper::DefaultSink (Ptr<PcapFileWrapper> file, Ptr<const Packet> p)
   file->Write (Simulator::Now (), p);
 }
 
+bool AsciiTraceHelper::m_binary = false;
+enum BinaryTraceWriter::Compression AsciiTraceHelper::m_compression = BinaryTraceWriter::NONE;
+
 AsciiTraceHelper::AsciiTraceHelper ()
 {
   NS_LOG_FUNCTION_NOARGS ();
@@ -185,6 +188,11 @@ AsciiTraceHelper::CreateFileStream (std::string filename, std::ios::openmode fil
 {
   NS_LOG_FUNCTION (filename << filemode);
 
+  if (m_binary)
+    {
+      return CreateBinaryFileStream (filename, filemode, m_compression);
+    }
+
   Ptr<OutputStreamWrapper> StreamWrapper = Create<OutputStreamWrapper> (filename, filemode);
 
   //
@@ -201,6 +209,55 @@ AsciiTraceHelper::CreateFileStream (std::string filename, std::ios::openmode fil
   return StreamWrapper;
 }
 
+Ptr<OutputStreamWrapper>
+AsciiTraceHelper::CreateBinaryFileStream (std::string filename, std::ios::openmode filemode,
+                                          enum BinaryTraceWriter::Compression compression)
+{
+  NS_LOG_FUNCTION (filename << filemode << compression);
+  Ptr<BinaryTraceWriter> writer = Create<BinaryTraceWriter> (filename, filemode, compression);
+  return Create<OutputStreamWrapper> (writer);
+}
+
+void
+AsciiTraceHelper::EnableBinaryFileStreams (enum BinaryTraceWriter::Compression compression)
+{
+  NS_LOG_FUNCTION (compression);
+  m_binary = true;
+  m_compression = compression;
+}
+
+void
+AsciiTraceHelper::DisableBinaryFileStreams (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  m_binary = false;
+}
+
+void
+AsciiTraceHelper::WritePacket (Ptr<OutputStreamWrapper> stream, char event, Ptr<const Packet> p)
+{
+  Ptr<BinaryTraceWriter> writer = stream->GetBinaryWriter ();
+  if (writer != 0)
+    {
+      writer->WritePacket (event, p);
+      return;
+    }
+  *stream->GetStream () << event << " " << Simulator::Now ().GetSeconds () << " " << *p << std::endl;
+}
+
+void
+AsciiTraceHelper::WritePacket (Ptr<OutputStreamWrapper> stream, char event,
+                               std::string const &context, Ptr<const Packet> p)
+{
+  Ptr<BinaryTraceWriter> writer = stream->GetBinaryWriter ();
+  if (writer != 0)
+    {
+      writer->WritePacket (event, context, p);
+      return;
+    }
+  *stream->GetStream () << event << " " << Simulator::Now ().GetSeconds () << " " << context << " " << *p << std::endl;
+}
+
 std::string
 AsciiTraceHelper::GetFilenameFromDevice (std::string prefix, Ptr<NetDevice> device, bool useObjectNames)
 {
@@ -303,14 +360,14 @@ void
 AsciiTraceHelper::DefaultEnqueueSinkWithoutContext (Ptr<OutputStreamWrapper> stream, Ptr<const Packet> p)
 {
   NS_LOG_FUNCTION (stream << p);
-  *stream->GetStream () << "+ " << Simulator::Now ().GetSeconds () << " " << *p << std::endl;
+  WritePacket (stream, '+', p);
 }
 
 void
 AsciiTraceHelper::DefaultEnqueueSinkWithContext (Ptr<OutputStreamWrapper> stream, std::string context, Ptr<const Packet> p)
 {
   NS_LOG_FUNCTION (stream << p);
-  *stream->GetStream () << "+ " << Simulator::Now ().GetSeconds () << " " << context << " " << *p << std::endl;
+  WritePacket (stream, '+', context, p);
 }
 
 //
@@ -329,14 +386,14 @@ void
 AsciiTraceHelper::DefaultDropSinkWithoutContext (Ptr<OutputStreamWrapper> stream, Ptr<const Packet> p)
 {
   NS_LOG_FUNCTION (stream << p);
-  *stream->GetStream () << "d " << Simulator::Now ().GetSeconds () << " " << *p << std::endl;
+  WritePacket (stream, 'd', p);
 }
 
 void
 AsciiTraceHelper::DefaultDropSinkWithContext (Ptr<OutputStreamWrapper> stream, std::string context, Ptr<const Packet> p)
 {
   NS_LOG_FUNCTION (stream << p);
-  *stream->GetStream () << "d " << Simulator::Now ().GetSeconds () << " " << context << " " << *p << std::endl;
+  WritePacket (stream, 'd', context, p);
 }
 
 //
@@ -356,14 +413,14 @@ void
 AsciiTraceHelper::DefaultDequeueSinkWithoutContext (Ptr<OutputStreamWrapper> stream, Ptr<const Packet> p)
 {
   NS_LOG_FUNCTION (stream << p);
-  *stream->GetStream () << "- " << Simulator::Now ().GetSeconds () << " " << *p << std::endl;
+  WritePacket (stream, '-', p);
 }
 
 void
 AsciiTraceHelper::DefaultDequeueSinkWithContext (Ptr<OutputStreamWrapper> stream, std::string context, Ptr<const Packet> p)
 {
   NS_LOG_FUNCTION (stream << p);
-  *stream->GetStream () << "- " << Simulator::Now ().GetSeconds () << " " << context << " " << *p << std::endl;
+  WritePacket (stream, '-', context, p);
 }
 
 //
@@ -380,14 +437,14 @@ void
 AsciiTraceHelper::DefaultReceiveSinkWithoutContext (Ptr<OutputStreamWrapper> stream, Ptr<const Packet> p)
 {
   NS_LOG_FUNCTION (stream << p);
-  *stream->GetStream () << "r " << Simulator::Now ().GetSeconds () << " " << *p << std::endl;
+  WritePacket (stream, 'r', p);
 }
 
 void
 AsciiTraceHelper::DefaultReceiveSinkWithContext (Ptr<OutputStreamWrapper> stream, std::string context, Ptr<const Packet> p)
 {
   NS_LOG_FUNCTION (stream << p);
-  *stream->GetStream () << "r " << Simulator::Now ().GetSeconds () << " " << context << " " << *p << std::endl;
+  WritePacket (stream, 'r', context, p);
 }
 
 void 
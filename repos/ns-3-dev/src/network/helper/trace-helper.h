@@ -155,6 +155,46 @@ public:
   Ptr<OutputStreamWrapper> CreateFileStream (std::string filename, 
                                              std::ios::openmode filemode = std::ios::out);
 
+  /**
+   * @brief Create an output stream object which records the traced events in
+   * the binary format of BinaryTraceWriter.
+   *
+   * Formatting each event as text is often the main cost of a traced
+   * simulation: the binary stream only copies the serialized packets, and
+   * utils/convert-binary-trace turns the file into the usual ascii trace.
+   * The sinks which do not know about binary streams still work: their text
+   * is stored as-is.
+   */
+  Ptr<OutputStreamWrapper> CreateBinaryFileStream (std::string filename,
+                                                   std::ios::openmode filemode = std::ios::out,
+                                                   enum BinaryTraceWriter::Compression compression = BinaryTraceWriter::NONE);
+
+  /**
+   * @brief Make CreateFileStream create binary streams, as CreateBinaryFileStream.
+   *
+   * This lets the EnableAscii methods of all the helpers write binary trace
+   * files. Call DisableBinaryFileStreams to go back to text files.
+   */
+  static void EnableBinaryFileStreams (enum BinaryTraceWriter::Compression compression = BinaryTraceWriter::NONE);
+
+  /**
+   * @brief Make CreateFileStream create text streams again.
+   */
+  static void DisableBinaryFileStreams (void);
+
+  /**
+   * @brief Write a packet event without context to an ascii trace stream,
+   * as text or in the binary format of the stream.
+   */
+  static void WritePacket (Ptr<OutputStreamWrapper> stream, char event, Ptr<const Packet> p);
+
+  /**
+   * @brief Write a packet event with context to an ascii trace stream,
+   * as text or in the binary format of the stream.
+   */
+  static void WritePacket (Ptr<OutputStreamWrapper> stream, char event,
+                           std::string const &context, Ptr<const Packet> p);
+
   /**
    * @brief Hook a trace source to the default enqueue operation trace sink that
    * does not accept nor log a trace context.
@@ -226,6 +266,10 @@ public:
 
   static void DefaultReceiveSinkWithoutContext (Ptr<OutputStreamWrapper> file, Ptr<const Packet> p);
   static void DefaultReceiveSinkWithContext (Ptr<OutputStreamWrapper> file, std::string context, Ptr<const Packet> p);
+
+private:
+  static bool m_binary;
+  static enum BinaryTraceWriter::Compression m_compression;
 };
 
 template <typename T> void
@@ -18,6 +18,7 @@
  * Author: Mathieu Lacage <mathieu.lacage@sophia.inria.fr>
  */
 #include "buffer.h"
+#include "packet-data-pool.h"
 #include "ns3/assert.h"
 #include "ns3/log.h"
 
@@ -45,148 +46,241 @@ static struct Zeroes
 
 namespace ns3 {
 
-
-uint32_t Buffer::g_recommendedStart = 0;
-#ifdef BUFFER_FREE_LIST
-/* The following macros are pretty evil but they are needed to allow us to
- * keep track of 3 possible states for the g_freeList variable:
- *  - uninitialized means that no one has created a buffer yet
- *    so no one has created the associated free list (it is created
- *    on-demand when the first buffer is created)
- *  - initialized means that the free list exists and is valid
- *  - destroyed means that the static destructors of this compilation unit
- *    have run so, the free list has been cleared from its content
- * The key is that in destroyed state, we are careful not re-create it
- * which is a typical weakness of lazy evaluation schemes which use 
- * '0' as a special value to indicate both un-initialized and destroyed.
- * Note that it is important to use '0' as the marker for un-initialized state
- * because the variable holding this state information is initialized to zero
- * which the compiler assigns to zero-memory which is initialized to _zero_
- * before the constructors run so this ensures perfect handling of crazy 
- * constructor orderings.
+/* below this number of real bytes, AddAtEnd (Buffer) and the headers
+ * and trailers added to a shared BufferData copy the bytes instead of
+ * creating chunks.
  */
-#define MAGIC_DESTROYED (~(long) 0)
-#define IS_UNINITIALIZED(x) (x == (Buffer::FreeList*)0)
-#define IS_DESTROYED(x) (x == (Buffer::FreeList*)MAGIC_DESTROYED)
-#define IS_INITIALIZED(x) (!IS_UNINITIALIZED (x) && !IS_DESTROYED (x))
-#define DESTROYED ((Buffer::FreeList*)MAGIC_DESTROYED)
-#define UNINITIALIZED ((Buffer::FreeList*)0)
-uint32_t Buffer::g_maxSize = 0;
-Buffer::FreeList *Buffer::g_freeList = 0;
-struct Buffer::LocalStaticDestructor Buffer::g_localStaticDestructor;
-
-Buffer::LocalStaticDestructor::~LocalStaticDestructor(void)
-{
-  if (IS_INITIALIZED (g_freeList))
-    {
-      for (Buffer::FreeList::iterator i = g_freeList->begin ();
-           i != g_freeList->end (); i++)
-        {
-          Buffer::Deallocate (*i);
-        }
-      delete g_freeList;
-      g_freeList = DESTROYED;
-    }
-}
+static const uint32_t CHUNK_MIN_SIZE = 256;
+/* the room left for the next headers when the bytes of a buffer are
+ * moved to its chunks by AddAtStart.
+ */
+static const uint32_t CHUNK_HEADROOM = 64;
+
+struct Buffer::ChunkList
+{
+  /* updated atomically, like Buffer::Data::m_count */
+  uint32_t m_count;
+  /* the sum of the sizes of the chunks */
+  uint32_t m_size;
+  std::vector<Buffer> m_chunks;
+};
 
+uint32_t Buffer::g_recommendedStart = 0;
 void
 Buffer::Recycle (struct Buffer::Data *data)
 {
   NS_ASSERT (data->m_count == 0);
-  NS_ASSERT (!IS_UNINITIALIZED (g_freeList));
-  g_maxSize = std::max (g_maxSize, data->m_size);
-  /* feed into free list */
-  if (data->m_size < g_maxSize ||
-      IS_DESTROYED (g_freeList) ||
-      g_freeList->size () > 1000)
+  PacketDataPool::Deallocate (data);
+}
+
+void
+Buffer::Release (struct Buffer::Data *data)
+{
+  if (__sync_sub_and_fetch (&data->m_count, 1) == 0)
     {
-      Buffer::Deallocate (data);
+      Recycle (data);
     }
-  else
+}
+
+void
+Buffer::RecommendStart (uint32_t start)
+{
+  if (start > __atomic_load_n (&g_recommendedStart, __ATOMIC_RELAXED))
     {
-      NS_ASSERT (IS_INITIALIZED (g_freeList));
-      g_freeList->push_back (data);
+      __atomic_store_n (&g_recommendedStart, start, __ATOMIC_RELAXED);
     }
 }
 
-Buffer::Data *
-Buffer::Create (uint32_t dataSize)
+struct Buffer::Data *
+Buffer::Create (uint32_t reqSize)
 {
-  /* try to find a buffer correctly sized. */
-  if (IS_UNINITIALIZED (g_freeList))
+  if (reqSize == 0) 
     {
-      g_freeList = new Buffer::FreeList ();
+      reqSize = 1;
     }
-  else if (IS_INITIALIZED (g_freeList))
+  uint32_t capacity;
+  void *block = PacketDataPool::Allocate (reqSize - 1 + sizeof (struct Buffer::Data), &capacity);
+  struct Buffer::Data *data = static_cast<struct Buffer::Data *> (block);
+  // use the spare room of the size class too
+  data->m_size = capacity + 1 - sizeof (struct Buffer::Data);
+  data->m_count = 1;
+  return data;
+}
+
+Buffer
+Buffer::CreateChunk (uint32_t size)
+{
+  Buffer chunk (0, false);
+  chunk.m_data = Create (size);
+  chunk.m_maxZeroAreaStart = 0;
+  chunk.m_start = 0;
+  chunk.m_zeroAreaStart = size;
+  chunk.m_zeroAreaEnd = size;
+  chunk.m_end = size;
+  chunk.m_data->m_dirtyStart = 0;
+  chunk.m_data->m_dirtyEnd = size;
+  return chunk;
+}
+
+void
+Buffer::RefChunks (struct Buffer::ChunkList *chunks)
+{
+  __sync_fetch_and_add (&chunks->m_count, 1);
+}
+
+void
+Buffer::ReleaseChunks (void)
+{
+  if (m_chunks != 0)
     {
-      while (!g_freeList->empty ()) 
+      if (__sync_sub_and_fetch (&m_chunks->m_count, 1) == 0)
         {
-          struct Buffer::Data *data = g_freeList->back ();
-          g_freeList->pop_back ();
-          if (data->m_size >= dataSize) 
-            {
-              data->m_count = 1;
-              return data;
-            }
-          Buffer::Deallocate (data);
+          delete m_chunks;
         }
+      m_chunks = 0;
     }
-  struct Buffer::Data *data = Buffer::Allocate (dataSize);
-  NS_ASSERT (data->m_count == 1);
-  return data;
+  m_chunksOffset = 0;
+  m_chunksSize = 0;
 }
-#else /* BUFFER_FREE_LIST */
+
 void
-Buffer::Recycle (struct Buffer::Data *data)
+Buffer::UnshareChunks (void)
 {
-  NS_ASSERT (data->m_count == 0);
-  Deallocate (data);
+  if (m_chunks == 0)
+    {
+      m_chunks = new ChunkList ();
+      m_chunks->m_count = 1;
+      m_chunks->m_size = 0;
+      m_chunksOffset = 0;
+      return;
+    }
+  if (__atomic_load_n (&m_chunks->m_count, __ATOMIC_ACQUIRE) == 1 && m_chunksOffset == 0 && m_chunks->m_size == m_chunksSize)
+    {
+      return;
+    }
+  // copy the chunks of this buffer only, without the bytes removed
+  // from its start or its end.
+  ChunkList *chunks = new ChunkList ();
+  chunks->m_count = 1;
+  chunks->m_size = m_chunksSize;
+  uint32_t skip = m_chunksOffset;
+  uint32_t left = m_chunksSize;
+  for (std::vector<Buffer>::const_iterator i = m_chunks->m_chunks.begin ();
+       i != m_chunks->m_chunks.end () && left > 0; ++i)
+    {
+      uint32_t size = i->GetSize ();
+      if (skip >= size)
+        {
+          skip -= size;
+          continue;
+        }
+      uint32_t length = std::min (size - skip, left);
+      chunks->m_chunks.push_back (i->CreateFragment (skip, length));
+      skip = 0;
+      left -= length;
+    }
+  uint32_t chunksSize = m_chunksSize;
+  ReleaseChunks ();
+  m_chunks = chunks;
+  m_chunksSize = chunksSize;
 }
 
-Buffer::Data *
-Buffer::Create (uint32_t size)
+void
+Buffer::AddChunk (const Buffer &chunk)
 {
-  return Allocate (size);
+  NS_ASSERT (chunk.m_chunks == 0);
+  uint32_t size = chunk.GetSize ();
+  if (size == 0)
+    {
+      return;
+    }
+  UnshareChunks ();
+  m_chunksSize += size;
+  m_chunks->m_size += size;
+  std::vector<Buffer> &chunks = m_chunks->m_chunks;
+  if (!chunks.empty ())
+    {
+      Buffer &last = chunks.back ();
+      if (last.m_data == chunk.m_data &&
+          last.m_zeroAreaStart == last.m_zeroAreaEnd &&
+          chunk.m_zeroAreaStart == chunk.m_zeroAreaEnd &&
+          last.m_end == chunk.m_start)
+        {
+          // adjacent bytes of the same BufferData, typically two
+          // fragments of the same packet
+          last.m_end = chunk.m_end;
+          return;
+        }
+      if (last.m_zeroAreaEnd == last.m_end &&
+          chunk.m_start == chunk.m_zeroAreaStart &&
+          chunk.m_zeroAreaEnd == chunk.m_end)
+        {
+          // zero bytes following zero bytes
+          last.m_zeroAreaEnd += size;
+          last.m_end += size;
+          return;
+        }
+    }
+  chunks.push_back (chunk);
 }
-#endif /* BUFFER_FREE_LIST */
 
-struct Buffer::Data *
-Buffer::Allocate (uint32_t reqSize)
+void
+Buffer::RemoveChunksAtStart (uint32_t start)
 {
-  if (reqSize == 0) 
+  NS_ASSERT (start <= m_chunksSize);
+  if (start == m_chunksSize)
     {
-      reqSize = 1;
+      ReleaseChunks ();
+      return;
     }
-  NS_ASSERT (reqSize >= 1);
-  uint32_t size = reqSize - 1 + sizeof (struct Buffer::Data);
-  uint8_t *b = new uint8_t [size];
-  struct Buffer::Data *data = reinterpret_cast<struct Buffer::Data*>(b);
-  data->m_size = reqSize;
-  data->m_count = 1;
-  return data;
+  // the chunks stay shared: iterators on a Buffer from which bytes
+  // were removed keep pointing to valid chunks.
+  m_chunksOffset += start;
+  m_chunksSize -= start;
 }
 
 void
-Buffer::Deallocate (struct Buffer::Data *data)
+Buffer::RemoveChunksAtEnd (uint32_t end)
 {
-  NS_ASSERT (data->m_count == 0);
-  uint8_t *buf = reinterpret_cast<uint8_t *> (data);
-  delete [] buf;
+  NS_ASSERT (end <= m_chunksSize);
+  if (end == m_chunksSize)
+    {
+      ReleaseChunks ();
+      return;
+    }
+  m_chunksSize -= end;
+}
+
+Buffer
+Buffer::GetHead (void) const
+{
+  Buffer head = *this;
+  head.ReleaseChunks ();
+  return head;
 }
 
 Buffer::Buffer ()
+  : m_chunks (0),
+    m_chunksOffset (0),
+    m_chunksSize (0)
 {
   NS_LOG_FUNCTION (this);
   Initialize (0);
 }
 
 Buffer::Buffer (uint32_t dataSize)
+  : m_chunks (0),
+    m_chunksOffset (0),
+    m_chunksSize (0)
 {
   NS_LOG_FUNCTION (this << dataSize);
   Initialize (dataSize);
 }
 
 Buffer::Buffer (uint32_t dataSize, bool initialize)
+  : m_chunks (0),
+    m_chunksOffset (0),
+    m_chunksSize (0)
 {
   NS_LOG_FUNCTION (this << dataSize << initialize);
   if (initialize == true)
@@ -213,8 +307,17 @@ Buffer::CheckInternalState (void) const
   bool internalSizeOk = m_end - (m_zeroAreaEnd - m_zeroAreaStart) <= m_data->m_size &&
     m_start <= m_data->m_size &&
     m_zeroAreaStart <= m_data->m_size;
+  // once RemoveAtStart has reached the chunks, the offsets are beyond
+  // m_data and only the empty area at m_start is left there
+  if (m_start == m_end && m_chunks != 0)
+    {
+      dirtyOk = true;
+      internalSizeOk = true;
+    }
+  bool chunksOk = (m_chunks == 0) == (m_chunksSize == 0) &&
+    (m_chunks == 0 || m_chunksOffset + m_chunksSize <= m_chunks->m_size);
 
-  bool ok = m_data->m_count > 0 && offsetsOk && dirtyOk && internalSizeOk;
+  bool ok = m_data->m_count > 0 && offsetsOk && dirtyOk && internalSizeOk && chunksOk;
   if (!ok)
     {
       LOG_INTERNAL_STATE ("check " << this << 
@@ -233,7 +336,7 @@ Buffer::Initialize (uint32_t zeroSize)
 {
   NS_LOG_FUNCTION (this << zeroSize);
   m_data = Buffer::Create (0);
-  m_start = std::min (m_data->m_size, g_recommendedStart);
+  m_start = std::min (m_data->m_size, __atomic_load_n (&g_recommendedStart, __ATOMIC_RELAXED));
   m_maxZeroAreaStart = m_start;
   m_zeroAreaStart = m_start;
   m_zeroAreaEnd = m_zeroAreaStart + zeroSize;
@@ -251,15 +354,22 @@ Buffer::operator = (Buffer const&o)
   if (m_data != o.m_data) 
     {
       // not assignment to self.
-      m_data->m_count--;
-      if (m_data->m_count == 0) 
+      Release (m_data);
+      m_data = o.m_data;
+      __sync_fetch_and_add (&m_data->m_count, 1);
+    }
+  if (m_chunks != o.m_chunks)
+    {
+      ReleaseChunks ();
+      m_chunks = o.m_chunks;
+      if (m_chunks != 0)
         {
-          Recycle (m_data);
+          RefChunks (m_chunks);
         }
-      m_data = o.m_data;
-      m_data->m_count++;
     }
-  g_recommendedStart = std::max (g_recommendedStart, m_maxZeroAreaStart);
+  m_chunksOffset = o.m_chunksOffset;
+  m_chunksSize = o.m_chunksSize;
+  RecommendStart (m_maxZeroAreaStart);
   m_maxZeroAreaStart = o.m_maxZeroAreaStart;
   m_zeroAreaStart = o.m_zeroAreaStart;
   m_zeroAreaEnd = o.m_zeroAreaEnd;
@@ -273,12 +383,9 @@ Buffer::~Buffer ()
 {
   NS_LOG_FUNCTION (this);
   NS_ASSERT (CheckInternalState ());
-  g_recommendedStart = std::max (g_recommendedStart, m_maxZeroAreaStart);
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
-    {
-      Recycle (m_data);
-    }
+  RecommendStart (m_maxZeroAreaStart);
+  Release (m_data);
+  ReleaseChunks ();
 }
 
 uint32_t
@@ -298,30 +405,53 @@ Buffer::AddAtStart (uint32_t start)
   NS_LOG_FUNCTION (this << start);
   bool dirty;
   NS_ASSERT (CheckInternalState ());
-  bool isDirty = m_data->m_count > 1 && m_start > m_data->m_dirtyStart;
-  if (m_start >= start && !isDirty)
+  bool unique = __atomic_load_n (&m_data->m_count, __ATOMIC_ACQUIRE) == 1;
+  if (m_start >= start && m_start <= m_data->m_size &&
+      (unique || __sync_bool_compare_and_swap (&m_data->m_dirtyStart, m_start, m_start - start)))
     {
       /* enough space in the buffer and not dirty. 
        * To add: |..|
        * Before: |*****---------***|
        * After:  |***..---------***|
+       * A shared BufferData has been claimed up to the new start by
+       * the compare and swap, which fails if another copy, maybe of
+       * another thread, already wrote there.
        */
-      NS_ASSERT (m_data->m_count == 1 || m_start == m_data->m_dirtyStart);
       m_start -= start;
-      dirty = m_start > m_data->m_dirtyStart;
-      // update dirty area
-      m_data->m_dirtyStart = m_start;
+      dirty = unique && m_start > m_data->m_dirtyStart;
+      if (unique)
+        {
+          // update dirty area
+          m_data->m_dirtyStart = m_start;
+        }
     } 
+  else if (GetInternalSize () >= CHUNK_MIN_SIZE)
+    {
+      /* Instead of copying many bytes to a new BufferData, move them
+       * to the chunks, behind a new BufferData for the new bytes.
+       */
+      Buffer head = GetHead ();
+      UnshareChunks ();
+      m_chunks->m_chunks.insert (m_chunks->m_chunks.begin (), head);
+      m_chunks->m_size += head.GetSize ();
+      m_chunksSize += head.GetSize ();
+      Release (m_data);
+      m_data = Buffer::Create (start + CHUNK_HEADROOM);
+      m_end = m_data->m_size;
+      m_start = m_end - start;
+      m_zeroAreaStart = m_start;
+      m_zeroAreaEnd = m_start;
+      m_maxZeroAreaStart = m_zeroAreaStart;
+      m_data->m_dirtyStart = m_start;
+      m_data->m_dirtyEnd = m_end;
+      dirty = true;
+    }
   else
     {
       uint32_t newSize = GetInternalSize () + start;
       struct Buffer::Data *newData = Buffer::Create (newSize);
       memcpy (newData->m_data + start, m_data->m_data + m_start, GetInternalSize ());
-      m_data->m_count--;
-      if (m_data->m_count == 0)
-        {
-          Buffer::Recycle (m_data);
-        }
+      Release (m_data);
       m_data = newData;
 
       int32_t delta = start - m_start;
@@ -349,32 +479,42 @@ Buffer::AddAtEnd (uint32_t end)
   NS_LOG_FUNCTION (this << end);
   bool dirty;
   NS_ASSERT (CheckInternalState ());
-  bool isDirty = m_data->m_count > 1 && m_end < m_data->m_dirtyEnd;
-  if (GetInternalEnd () + end <= m_data->m_size && !isDirty)
+  bool unique = __atomic_load_n (&m_data->m_count, __ATOMIC_ACQUIRE) == 1;
+  if (m_chunks == 0 && GetInternalEnd () + end <= m_data->m_size &&
+      (unique || __sync_bool_compare_and_swap (&m_data->m_dirtyEnd, m_end, m_end + end)))
     {
       /* enough space in buffer and not dirty
        * Add:    |...|
        * Before: |**----*****|
        * After:  |**----...**|
+       * As in AddAtStart, a shared BufferData has been claimed by the
+       * compare and swap.
        */
-      NS_ASSERT (m_data->m_count == 1 || m_end == m_data->m_dirtyEnd);
       m_end += end;
-      // update dirty area.
-      m_data->m_dirtyEnd = m_end;
+      if (unique)
+        {
+          // update dirty area.
+          m_data->m_dirtyEnd = m_end;
+        }
 
-      dirty = m_end < m_data->m_dirtyEnd;
+      dirty = false;
 
     } 
+  else if (m_chunks != 0 || GetInternalSize () >= CHUNK_MIN_SIZE)
+    {
+      /* The new bytes can't follow m_end, or too many bytes would have
+       * to be copied to make room for them: put them in a new chunk.
+       */
+      AddChunk (CreateChunk (end));
+      NS_ASSERT (CheckInternalState ());
+      return true;
+    }
   else
     {
       uint32_t newSize = GetInternalSize () + end;
       struct Buffer::Data *newData = Buffer::Create (newSize);
       memcpy (newData->m_data, m_data->m_data + m_start, GetInternalSize ());
-      m_data->m_count--;
-      if (m_data->m_count == 0) 
-        {
-          Buffer::Recycle (m_data);
-        }
+      Release (m_data);
       m_data = newData;
 
       int32_t delta = -m_start;
@@ -402,28 +542,64 @@ void
 Buffer::AddAtEnd (const Buffer &o)
 {
   NS_LOG_FUNCTION (this << &o);
-  if (m_data->m_count == 1 &&
-      m_end == m_zeroAreaEnd &&
-      m_end == m_data->m_dirtyEnd &&
-      o.m_start == o.m_zeroAreaStart &&
-      o.m_zeroAreaEnd - o.m_zeroAreaStart > 0)
-    {
-      /**
-       * This is an optimization which kicks in when
-       * we attempt to aggregate two buffers which contain
-       * adjacent zero areas.
-       */
-      uint32_t zeroSize = o.m_zeroAreaEnd - o.m_zeroAreaStart;
-      m_zeroAreaEnd += zeroSize;
-      m_end = m_zeroAreaEnd;
-      m_data->m_dirtyEnd = m_zeroAreaEnd;
-      uint32_t endData = o.m_end - o.m_zeroAreaEnd;
-      AddAtEnd (endData);
-      Buffer::Iterator dst = End ();
-      dst.Prev (endData);
-      Buffer::Iterator src = o.End ();
-      src.Prev (endData);
-      dst.Write (src, o.End ());
+  if (m_chunks == 0 && o.m_chunks == 0)
+    {
+      if (__atomic_load_n (&m_data->m_count, __ATOMIC_ACQUIRE) == 1 &&
+          m_end == m_zeroAreaEnd &&
+          m_end == m_data->m_dirtyEnd &&
+          o.m_start == o.m_zeroAreaStart &&
+          o.m_zeroAreaEnd - o.m_zeroAreaStart > 0)
+        {
+          /**
+           * This is an optimization which kicks in when
+           * we attempt to aggregate two buffers which contain
+           * adjacent zero areas.
+           */
+          uint32_t zeroSize = o.m_zeroAreaEnd - o.m_zeroAreaStart;
+          m_zeroAreaEnd += zeroSize;
+          m_end = m_zeroAreaEnd;
+          m_data->m_dirtyEnd = m_zeroAreaEnd;
+          uint32_t endData = o.m_end - o.m_zeroAreaEnd;
+          AddAtEnd (endData);
+          Buffer::Iterator dst = End ();
+          dst.Prev (endData);
+          Buffer::Iterator src = o.End ();
+          src.Prev (endData);
+          dst.Write (src, o.End ());
+          NS_ASSERT (CheckInternalState ());
+          return;
+        }
+      if (m_data == o.m_data &&
+          m_zeroAreaStart == m_zeroAreaEnd &&
+          o.m_zeroAreaStart == o.m_zeroAreaEnd &&
+          m_end == o.m_start)
+        {
+          /**
+           * The two buffers are adjacent parts of the same
+           * BufferData, typically two fragments of a packet.
+           */
+          m_end = o.m_end;
+          NS_ASSERT (CheckInternalState ());
+          return;
+        }
+    }
+
+  if (m_chunks != 0 || o.m_chunks != 0 ||
+      GetSize () + o.GetSize () >= CHUNK_MIN_SIZE)
+    {
+      // share the bytes of o instead of copying them. o may be this
+      // buffer, so keep a reference to its chunks.
+      Buffer src = o;
+      AddChunk (src.GetHead ());
+      if (src.m_chunks != 0)
+        {
+          src.UnshareChunks ();
+          const std::vector<Buffer> &chunks = src.m_chunks->m_chunks;
+          for (std::vector<Buffer>::const_iterator i = chunks.begin (); i != chunks.end (); ++i)
+            {
+              AddChunk (*i);
+            }
+        }
       NS_ASSERT (CheckInternalState ());
       return;
     }
@@ -444,6 +620,22 @@ Buffer::RemoveAtStart (uint32_t start)
 {
   NS_LOG_FUNCTION (this << start);
   NS_ASSERT (CheckInternalState ());
+  if (m_chunks != 0 && start > m_end - m_start)
+    {
+      /* Remove all the bytes of m_data, then the start of the chunks.
+       * The offsets keep counting the bytes removed, beyond m_data.
+       */
+      uint32_t chunkStart = std::min (start - (m_end - m_start), m_chunksSize);
+      RemoveAtStart (m_end - m_start);
+      RemoveChunksAtStart (chunkStart);
+      m_start += chunkStart;
+      m_zeroAreaStart = m_start;
+      m_zeroAreaEnd = m_start;
+      m_end = m_start;
+      LOG_INTERNAL_STATE ("rem start=" << start << ", ");
+      NS_ASSERT (CheckInternalState ());
+      return;
+    }
   uint32_t newStart = m_start + start;
   if (newStart <= m_zeroAreaStart)
     {
@@ -489,6 +681,12 @@ Buffer::RemoveAtEnd (uint32_t end)
 {
   NS_LOG_FUNCTION (this << end);
   NS_ASSERT (CheckInternalState ());
+  if (m_chunks != 0)
+    {
+      uint32_t chunkEnd = std::min (end, m_chunksSize);
+      RemoveChunksAtEnd (chunkEnd);
+      end -= chunkEnd;
+    }
   uint32_t newEnd = m_end - std::min (end, m_end - m_start);
   if (newEnd > m_zeroAreaEnd)
     {
@@ -537,19 +735,11 @@ Buffer::CreateFullCopy (void) const
 {
   NS_LOG_FUNCTION (this);
   NS_ASSERT (CheckInternalState ());
-  if (m_zeroAreaEnd - m_zeroAreaStart != 0) 
-    {
-      Buffer tmp;
-      tmp.AddAtStart (m_zeroAreaEnd - m_zeroAreaStart);
-      tmp.Begin ().WriteU8 (0, m_zeroAreaEnd - m_zeroAreaStart);
-      uint32_t dataStart = m_zeroAreaStart - m_start;
-      tmp.AddAtStart (dataStart);
-      tmp.Begin ().Write (m_data->m_data+m_start, dataStart);
-      uint32_t dataEnd = m_end - m_zeroAreaEnd;
-      tmp.AddAtEnd (dataEnd);
-      Buffer::Iterator i = tmp.End ();
-      i.Prev (dataEnd);
-      i.Write (m_data->m_data+m_zeroAreaStart,dataEnd);
+  if (m_chunks != 0 || m_zeroAreaEnd - m_zeroAreaStart != 0) 
+    {
+      // a single BufferData, without zero area and without chunks
+      Buffer tmp = CreateChunk (GetSize ());
+      CopyData (tmp.m_data->m_data, GetSize ());
       NS_ASSERT (tmp.CheckInternalState ());
       return tmp;
     }
@@ -560,6 +750,10 @@ Buffer::CreateFullCopy (void) const
 uint32_t 
 Buffer::GetSerializedSize (void) const
 {
+  if (m_chunks != 0)
+    {
+      return CreateFullCopy ().GetSerializedSize ();
+    }
   uint32_t dataStart = (m_zeroAreaStart - m_start + 3) & (~0x3);
   uint32_t dataEnd = (m_end - m_zeroAreaEnd + 3) & (~0x3);
 
@@ -579,11 +773,15 @@ Buffer::GetSerializedSize (void) const
 uint32_t
 Buffer::Serialize (uint8_t* buffer, uint32_t maxSize) const
 {
+  NS_LOG_FUNCTION (this);
+  if (m_chunks != 0)
+    {
+      return CreateFullCopy ().Serialize (buffer, maxSize);
+    }
+
   uint32_t* p = reinterpret_cast<uint32_t *> (buffer);
   uint32_t size = 0;
 
-  NS_LOG_FUNCTION (this);
-
   // Add the zero data length
   if (size + 4 <= maxSize)
     {
@@ -698,7 +896,7 @@ Buffer::GetCurrentStartOffset (void) const
 int32_t 
 Buffer::GetCurrentEndOffset (void) const
 {
-  return m_end;
+  return m_end + m_chunksSize;
 }
 
 
@@ -724,6 +922,7 @@ Buffer::PeekData (void) const
 void
 Buffer::CopyData (std::ostream *os, uint32_t size) const
 {
+  uint32_t chunksSize = size > m_end - m_start ? size - (m_end - m_start) : 0;
   if (size > 0)
     {
       uint32_t tmpsize = std::min (m_zeroAreaStart-m_start, size);
@@ -747,6 +946,26 @@ Buffer::CopyData (std::ostream *os, uint32_t size) const
             }
         }
     }
+  if (chunksSize > 0 && m_chunks != 0)
+    {
+      chunksSize = std::min (chunksSize, m_chunksSize);
+      uint32_t skip = m_chunksOffset;
+      const std::vector<Buffer> &chunks = m_chunks->m_chunks;
+      for (std::vector<Buffer>::const_iterator i = chunks.begin (); 
+           i != chunks.end () && chunksSize > 0; ++i)
+        {
+          uint32_t chunkSize = i->GetSize ();
+          if (skip >= chunkSize)
+            {
+              skip -= chunkSize;
+              continue;
+            }
+          uint32_t tmpsize = std::min (chunkSize - skip, chunksSize);
+          i->CreateFragment (skip, tmpsize).CopyData (os, tmpsize);
+          chunksSize -= tmpsize;
+          skip = 0;
+        }
+    }
 }
 
 uint32_t 
@@ -775,10 +994,33 @@ Buffer::CopyData (uint8_t *buffer, uint32_t size) const
             {
               tmpsize = std::min (m_end - m_zeroAreaEnd, size);
               memcpy (buffer, (const char*)(m_data->m_data + m_zeroAreaStart), tmpsize);
+              buffer += tmpsize;
               size -= tmpsize;
             }
         }
     }
+  if (size > 0 && m_chunks != 0)
+    {
+      uint32_t chunksSize = std::min (size, m_chunksSize);
+      uint32_t skip = m_chunksOffset;
+      const std::vector<Buffer> &chunks = m_chunks->m_chunks;
+      for (std::vector<Buffer>::const_iterator i = chunks.begin (); 
+           i != chunks.end () && chunksSize > 0; ++i)
+        {
+          uint32_t chunkSize = i->GetSize ();
+          if (skip >= chunkSize)
+            {
+              skip -= chunkSize;
+              continue;
+            }
+          uint32_t tmpsize = std::min (chunkSize - skip, chunksSize);
+          i->CreateFragment (skip, tmpsize).CopyData (buffer, tmpsize);
+          buffer += tmpsize;
+          size -= tmpsize;
+          chunksSize -= tmpsize;
+          skip = 0;
+        }
+    }
   return originalSize - size;
 }
 
@@ -846,6 +1088,14 @@ Buffer::Iterator::Write (Iterator start, Iterator end)
   uint32_t size = end.m_current - start.m_current;
   NS_ASSERT_MSG (CheckNoZero (m_current, m_current + size),
                  GetWriteErrorMessage ());
+  if (end.m_current > start.m_chunksStart || m_current + size > m_chunksStart)
+    {
+      while (start.m_current < end.m_current)
+        {
+          WriteU8 (start.ReadU8 ());
+        }
+      return;
+    }
   if (start.m_current <= start.m_zeroStart)
     {
       uint32_t toCopy = std::min (size, start.m_zeroStart - start.m_current);
@@ -950,6 +1200,14 @@ Buffer::Iterator::Write (uint8_t const*buffer, uint32_t size)
 {
   NS_ASSERT_MSG (CheckNoZero (m_current, size),
                  GetWriteErrorMessage ());
+  if (m_current + size > m_chunksStart)
+    {
+      for (uint32_t i = 0; i < size; i++)
+        {
+          WriteU8 (buffer[i]);
+        }
+      return;
+    }
   uint8_t *to;
   if (m_current <= m_zeroStart)
     {
@@ -1008,6 +1266,57 @@ Buffer::Iterator::ReadU64 (void)
 
   return data;
 }
+const Buffer &
+Buffer::Iterator::GetChunk (uint32_t *offset)
+{
+  NS_ASSERT (m_chunks != 0 && m_current >= m_chunksStart && m_current < m_dataEnd);
+  const std::vector<Buffer> &chunks = m_chunks->m_chunks;
+  // the offset from the start of the first chunk of the list
+  uint32_t current = m_current - m_chunksStart + m_chunksOffset;
+  if (current < m_chunkStart)
+    {
+      m_chunkIndex = 0;
+      m_chunkStart = 0;
+    }
+  // the bytes are mostly accessed in order, so start from the last chunk
+  while (current >= m_chunkStart + chunks[m_chunkIndex].GetSize ())
+    {
+      m_chunkStart += chunks[m_chunkIndex].GetSize ();
+      m_chunkIndex++;
+    }
+  *offset = current - m_chunkStart;
+  return chunks[m_chunkIndex];
+}
+uint8_t
+Buffer::Iterator::SlowReadU8 (void)
+{
+  if (m_chunks == 0)
+    {
+      uint8_t data = m_data[m_current - (m_zeroEnd-m_zeroStart)];
+      m_current++;
+      return data;
+    }
+  uint32_t offset;
+  Buffer::Iterator i = GetChunk (&offset).Begin ();
+  i.Next (offset);
+  m_current++;
+  return i.ReadU8 ();
+}
+void
+Buffer::Iterator::SlowWriteU8 (uint8_t data)
+{
+  if (m_chunks == 0)
+    {
+      m_data[m_current - (m_zeroEnd-m_zeroStart)] = data;
+      m_current++;
+      return;
+    }
+  uint32_t offset;
+  Buffer::Iterator i = GetChunk (&offset).Begin ();
+  i.Next (offset);
+  i.WriteU8 (data);
+  m_current++;
+}
 uint16_t 
 Buffer::Iterator::SlowReadNtohU16 (void)
 {
@@ -25,8 +25,6 @@
 #include <ostream>
 #include "ns3/assert.h"
 
-#define noBUFFER_FREE_LIST 1
-
 namespace ns3 {
 
 /**
@@ -59,6 +57,12 @@ namespace ns3 {
  * In every other case, the BufferData must be copied before
  * being modified.
  *
+ * The copies of a Buffer may live in different threads, so the
+ * reference counts are updated atomically, and a Buffer whose
+ * BufferData is shared claims the bytes it adds in front of or
+ * behind the dirty area with a compare and swap on its bounds: only
+ * one of the copies gets them, and the others copy the BufferData.
+ *
  * To understand the way the Buffer::Add and Buffer::Remove methods
  * work, you first need to understand the "virtual offsets" used to
  * keep track of the content of buffers. Each Buffer instance
@@ -86,9 +90,23 @@ namespace ns3 {
  *                        |------------------------------------------^ m_end
  *
  * A simple state invariant is that m_start <= m_zeroStart <= m_zeroEnd <= m_end
+ *
+ * Large buffers appended with AddAtEnd (Buffer) are not copied: they
+ * are kept as a list of chunks which follows the virtual byte buffer
+ * above, from m_end on. Each chunk is itself a Buffer without chunks,
+ * which shares the BufferData of the appended buffer, so fragmenting
+ * and concatenating packets keeps sharing their payload. The list is
+ * shared by the copies of a Buffer and copied before being modified.
+ * The chunks are also used instead of copying a large BufferData when
+ * a header or a trailer is added to a Buffer which shares it. The
+ * Iterator reads and writes the chunks one byte at a time, and
+ * PeekData, CreateFullCopy and Serialize copy them into a single
+ * BufferData.
  */
 class Buffer 
 {
+private:
+  struct ChunkList;
 public:
   /**
    * \brief iterator in a Buffer instance
@@ -366,6 +384,9 @@ private:
     bool Check (uint32_t i) const;
     uint16_t SlowReadNtohU16 (void);
     uint32_t SlowReadNtohU32 (void);
+    uint8_t SlowReadU8 (void);
+    void SlowWriteU8 (uint8_t data);
+    const Buffer &GetChunk (uint32_t *offset);
     std::string GetReadErrorMessage (void) const;
     std::string GetWriteErrorMessage (void) const;
 
@@ -393,6 +414,21 @@ private:
      * to this pointer.
      */
     uint8_t *m_data;
+    /* offset in virtual bytes from the start of the data buffer to the
+     * start of the chunks. Equal to m_dataEnd if there are no chunks.
+     */
+    uint32_t m_chunksStart;
+    /* the chunks of the buffer, or zero.
+     */
+    const struct Buffer::ChunkList *m_chunks;
+    /* the number of bytes of the chunks before the ones of the buffer.
+     */
+    uint32_t m_chunksOffset;
+    /* the last chunk accessed, and the offset in bytes from the start
+     * of the first chunk to its start.
+     */
+    uint32_t m_chunkIndex;
+    uint32_t m_chunkStart;
   };
 
   /**
@@ -407,7 +443,9 @@ private:
    * The returned pointer points to an area of
    * memory which is ns3::Buffer::GetSize () bytes big.
    * Please, try to never ever use this method. It is really
-   * evil and is present only for a few specific uses.
+   * evil and is present only for a few specific uses. It
+   * modifies the buffer, so it must not be called while another
+   * thread uses the same Buffer instance.
    */
   uint8_t const*PeekData (void) const;
 
@@ -546,6 +584,7 @@ private:
   {
     /* The reference count of an instance of this data structure.
      * Each buffer which references an instance holds a count.
+     * It is only updated with atomic operations.
        */
     uint32_t m_count;
     /* the size of the m_data field below.
@@ -553,10 +592,12 @@ private:
     uint32_t m_size;
     /* offset from the start of the m_data field below to the
      * start of the area in which user bytes were written.
+     * Updated with a compare and swap while m_count is above one.
      */
     uint32_t m_dirtyStart;
     /* offset from the start of the m_data field below to the
      * end of the area in which user bytes were written.
+     * Updated with a compare and swap while m_count is above one.
      */
     uint32_t m_dirtyEnd;
     /* The real data buffer holds _at least_ one byte.
@@ -571,9 +612,19 @@ private:
   uint32_t GetInternalSize (void) const;
   uint32_t GetInternalEnd (void) const;
   static void Recycle (struct Buffer::Data *data);
+  /* Drop a reference to data, and recycle it with the last one. */
+  static void Release (struct Buffer::Data *data);
+  /* Raise g_recommendedStart to start. */
+  static void RecommendStart (uint32_t start);
   static struct Buffer::Data *Create (uint32_t size);
-  static struct Buffer::Data *Allocate (uint32_t reqSize);
-  static void Deallocate (struct Buffer::Data *data);
+  static Buffer CreateChunk (uint32_t size);
+  static void RefChunks (struct ChunkList *chunks);
+  void ReleaseChunks (void);
+  void UnshareChunks (void);
+  void AddChunk (const Buffer &chunk);
+  void RemoveChunksAtStart (uint32_t start);
+  void RemoveChunksAtEnd (uint32_t end);
+  Buffer GetHead (void) const;
 
   struct Data *m_data;
 
@@ -590,7 +641,8 @@ private:
   /**
    * location in a newly-allocated buffer where you should start
    * writing data. i.e., m_start should be initialized to this 
-   * value.
+   * value. Only a hint, read and written without ordering by every
+   * thread.
    */
   static uint32_t g_recommendedStart;
 
@@ -610,17 +662,17 @@ private:
    * instance from the start of m_data->m_data
    */
   uint32_t m_end;
-
-#ifdef BUFFER_FREE_LIST
-  typedef std::vector<struct Buffer::Data*> FreeList;
-  struct LocalStaticDestructor 
-  {
-    ~LocalStaticDestructor ();
-  };
-  static uint32_t g_maxSize;
-  static FreeList *g_freeList;
-  static struct LocalStaticDestructor g_localStaticDestructor;
-#endif
+  /* the chunks which follow m_end, or zero. The chunks are shared
+   * between copies of the Buffer.
+   */
+  struct ChunkList *m_chunks;
+  /* the number of bytes of the chunks removed from the start of
+   * this Buffer
+   */
+  uint32_t m_chunksOffset;
+  /* the number of bytes of the chunks which are part of this Buffer
+   */
+  uint32_t m_chunksSize;
 };
 
 } // namespace ns3
@@ -636,7 +688,12 @@ Buffer::Iterator::Iterator ()
     m_dataStart (0),
     m_dataEnd (0),
     m_current (0),
-    m_data (0)
+    m_data (0),
+    m_chunksStart (0),
+    m_chunks (0),
+    m_chunksOffset (0),
+    m_chunkIndex (0),
+    m_chunkStart (0)
 {
 }
 Buffer::Iterator::Iterator (Buffer const*buffer)
@@ -656,8 +713,13 @@ Buffer::Iterator::Construct (const Buffer *buffer)
   m_zeroStart = buffer->m_zeroAreaStart;
   m_zeroEnd = buffer->m_zeroAreaEnd;
   m_dataStart = buffer->m_start;
-  m_dataEnd = buffer->m_end;
+  m_dataEnd = buffer->m_end + buffer->m_chunksSize;
   m_data = buffer->m_data->m_data;
+  m_chunksStart = buffer->m_end;
+  m_chunks = buffer->m_chunks;
+  m_chunksOffset = buffer->m_chunksOffset;
+  m_chunkIndex = 0;
+  m_chunkStart = 0;
 }
 
 void 
@@ -695,11 +757,15 @@ Buffer::Iterator::WriteU8 (uint8_t data)
       m_data[m_current] = data;
       m_current++;
     }
-  else
+  else if (m_current < m_chunksStart)
     {
       m_data[m_current - (m_zeroEnd-m_zeroStart)] = data;
       m_current++;
     }
+  else
+    {
+      SlowWriteU8 (data);
+    }
 }
 
 void 
@@ -707,7 +773,14 @@ Buffer::Iterator::WriteU8 (uint8_t  data, uint32_t len)
 {
   NS_ASSERT_MSG (CheckNoZero (m_current, m_current + len),
                  GetWriteErrorMessage ());
-  if (m_current <= m_zeroStart)
+  if (m_current + len > m_chunksStart)
+    {
+      for (uint32_t i = 0; i < len; i++)
+        {
+          WriteU8 (data);
+        }
+    }
+  else if (m_current <= m_zeroStart)
     {
       memset (&(m_data[m_current]), data, len);
       m_current += len;
@@ -730,10 +803,16 @@ Buffer::Iterator::WriteHtonU16 (uint16_t data)
     {
       buffer = &m_data[m_current];
     }
-  else
+  else if (m_current + 2 <= m_chunksStart)
     {
       buffer = &m_data[m_current - (m_zeroEnd - m_zeroStart)];
     }
+  else
+    {
+      WriteU8 ((data >> 8) & 0xff);
+      WriteU8 ((data >> 0) & 0xff);
+      return;
+    }
   buffer[0] = (data >> 8)& 0xff;
   buffer[1] = (data >> 0)& 0xff;
   m_current+= 2;
@@ -750,10 +829,18 @@ Buffer::Iterator::WriteHtonU32 (uint32_t data)
     {
       buffer = &m_data[m_current];
     }
-  else
+  else if (m_current + 4 <= m_chunksStart)
     {
       buffer = &m_data[m_current - (m_zeroEnd - m_zeroStart)];
     }
+  else
+    {
+      WriteU8 ((data >> 24) & 0xff);
+      WriteU8 ((data >> 16) & 0xff);
+      WriteU8 ((data >> 8) & 0xff);
+      WriteU8 ((data >> 0) & 0xff);
+      return;
+    }
   buffer[0] = (data >> 24)& 0xff;
   buffer[1] = (data >> 16)& 0xff;
   buffer[2] = (data >> 8)& 0xff;
@@ -769,9 +856,9 @@ Buffer::Iterator::ReadNtohU16 (void)
     {
       buffer = &m_data[m_current];
     }
-  else if (m_current >= m_zeroEnd)
+  else if (m_current >= m_zeroEnd && m_current + 2 <= m_chunksStart)
     {
-      buffer = &m_data[m_current];
+      buffer = &m_data[m_current - (m_zeroEnd - m_zeroStart)];
     }
   else
     {
@@ -793,9 +880,9 @@ Buffer::Iterator::ReadNtohU32 (void)
     {
       buffer = &m_data[m_current];
     }
-  else if (m_current >= m_zeroEnd)
+  else if (m_current >= m_zeroEnd && m_current + 4 <= m_chunksStart)
     {
-      buffer = &m_data[m_current];
+      buffer = &m_data[m_current - (m_zeroEnd - m_zeroStart)];
     }
   else
     {
@@ -831,12 +918,16 @@ Buffer::Iterator::ReadU8 (void)
       m_current++;
       return 0;
     }
-  else
+  else if (m_current < m_chunksStart)
     {
       uint8_t data = m_data[m_current - (m_zeroEnd-m_zeroStart)];
       m_current++;
       return data;
     }
+  else
+    {
+      return SlowReadU8 ();
+    }
 }
 
 uint16_t 
@@ -857,16 +948,23 @@ Buffer::Buffer (Buffer const&o)
     m_zeroAreaStart (o.m_zeroAreaStart),
     m_zeroAreaEnd (o.m_zeroAreaEnd),
     m_start (o.m_start),
-    m_end (o.m_end)
+    m_end (o.m_end),
+    m_chunks (o.m_chunks),
+    m_chunksOffset (o.m_chunksOffset),
+    m_chunksSize (o.m_chunksSize)
 {
-  m_data->m_count++;
+  __sync_fetch_and_add (&m_data->m_count, 1);
+  if (m_chunks != 0)
+    {
+      RefChunks (m_chunks);
+    }
   NS_ASSERT (CheckInternalState ());
 }
 
 uint32_t 
 Buffer::GetSize (void) const
 {
-  return m_end - m_start;
+  return m_end - m_start + m_chunksSize;
 }
 
 Buffer::Iterator 
@@ -18,14 +18,14 @@
  * Author: Mathieu Lacage <mathieu.lacage@sophia.inria.fr>
  */
 #include "byte-tag-list.h"
+#include "packet-data-pool.h"
 #include "ns3/log.h"
-#include <vector>
+#include <algorithm>
 #include <string.h>
 
 NS_LOG_COMPONENT_DEFINE ("ByteTagList");
 
-#define USE_FREE_LIST 1
-#define FREE_LIST_SIZE 1000
+#define INITIAL_SIZE 64
 #define OFFSET_MAX (2147483647)
 
 namespace ns3 {
@@ -37,25 +37,6 @@ struct ByteTagListData {
   uint8_t data[4];
 };
 
-#ifdef USE_FREE_LIST
-static class ByteTagListDataFreeList : public std::vector<struct ByteTagListData *>
-{
-public:
-  ~ByteTagListDataFreeList ();
-} g_freeList;
-static uint32_t g_maxSize = 0;
-
-ByteTagListDataFreeList::~ByteTagListDataFreeList ()
-{
-  for (ByteTagListDataFreeList::iterator i = begin ();
-       i != end (); i++)
-    {
-      uint8_t *buffer = (uint8_t *)(*i);
-      delete [] buffer;
-    }
-}
-#endif /* USE_FREE_LIST */
-
 ByteTagList::Iterator::Item::Item (TagBuffer buf_)
   : buf (buf_)
 {
@@ -129,7 +110,7 @@ ByteTagList::ByteTagList (const ByteTagList &o)
   NS_LOG_FUNCTION (this << &o);
   if (m_data != 0)
     {
-      m_data->count++;
+      __sync_fetch_and_add (&m_data->count, 1);
     }
 }
 ByteTagList &
@@ -146,7 +127,7 @@ ByteTagList::operator = (const ByteTagList &o)
   m_used = o.m_used;
   if (m_data != 0)
     {
-      m_data->count++;
+      __sync_fetch_and_add (&m_data->count, 1);
     }
   return *this;
 }
@@ -170,8 +151,11 @@ ByteTagList::Add (TypeId tid, uint32_t bufferSize, int32_t start, int32_t end)
       m_used = 0;
     } 
   else if (m_data->size < spaceNeeded ||
-           (m_data->count != 1 && m_data->dirty != m_used))
+           (__atomic_load_n (&m_data->count, __ATOMIC_ACQUIRE) != 1 &&
+            !__sync_bool_compare_and_swap (&m_data->dirty, m_used, spaceNeeded)))
     {
+      // the shared buffer is full, or another list, maybe of another
+      // thread, already appended to it: copy it.
       struct ByteTagListData *newData = Allocate (spaceNeeded);
       memcpy (&newData->data, &m_data->data, m_used);
       Deallocate (m_data);
@@ -184,7 +168,8 @@ ByteTagList::Add (TypeId tid, uint32_t bufferSize, int32_t start, int32_t end)
   tag.WriteU32 (start);
   tag.WriteU32 (end);
   m_used = spaceNeeded;
-  m_data->dirty = m_used;
+  // a shared buffer was already claimed up to there above
+  __atomic_store_n (&m_data->dirty, m_used, __ATOMIC_RELAXED);
   return tag;
 }
 
@@ -333,69 +318,19 @@ ByteTagList::AddAtStart (int32_t adjustment, int32_t prependOffset)
   *this = list;
 }
 
-#ifdef USE_FREE_LIST
-
-struct ByteTagListData *
-ByteTagList::Allocate (uint32_t size)
-{
-  NS_LOG_FUNCTION (this << size);
-  while (!g_freeList.empty ())
-    {
-      struct ByteTagListData *data = g_freeList.back ();
-      g_freeList.pop_back ();
-      NS_ASSERT (data != 0);
-      if (data->size >= size)
-        {
-          data->count = 1;
-          data->dirty = 0;
-          return data;
-        }
-      uint8_t *buffer = (uint8_t *)data;
-      delete [] buffer;
-    }
-  uint8_t *buffer = new uint8_t [std::max (size, g_maxSize) + sizeof (struct ByteTagListData) - 4];
-  struct ByteTagListData *data = (struct ByteTagListData *)buffer;
-  data->count = 1;
-  data->size = size;
-  data->dirty = 0;
-  return data;
-}
-
-void 
-ByteTagList::Deallocate (struct ByteTagListData *data)
-{
-  NS_LOG_FUNCTION (this << data);
-  if (data == 0)
-    {
-      return;
-    }
-  g_maxSize = std::max (g_maxSize, data->size);
-  data->count--;
-  if (data->count == 0)
-    {
-      if (g_freeList.size () > FREE_LIST_SIZE ||
-          data->size < g_maxSize)
-        {
-          uint8_t *buffer = (uint8_t *)data;
-          delete [] buffer;
-        }
-      else
-        {
-          g_freeList.push_back (data);
-        }
-    }
-}
-
-#else /* USE_FREE_LIST */
-
 struct ByteTagListData *
 ByteTagList::Allocate (uint32_t size)
 {
   NS_LOG_FUNCTION (this << size);
-  uint8_t *buffer = new uint8_t [size + sizeof (struct ByteTagListData) - 4];
-  struct ByteTagListData *data = (struct ByteTagListData *)buffer;
+  // leave room for a couple more tags so that the common case does
+  // not have to reallocate, and use whatever spare room the pool
+  // block has.
+  uint32_t reqSize = std::max (size, (uint32_t)INITIAL_SIZE) + sizeof (struct ByteTagListData) - 4;
+  uint32_t capacity;
+  void *block = PacketDataPool::Allocate (reqSize, &capacity);
+  struct ByteTagListData *data = (struct ByteTagListData *)block;
   data->count = 1;
-  data->size = size;
+  data->size = capacity - (sizeof (struct ByteTagListData) - 4);
   data->dirty = 0;
   return data;
 }
@@ -408,15 +343,11 @@ ByteTagList::Deallocate (struct ByteTagListData *data)
     {
       return;
     }
-  data->count--;
-  if (data->count == 0)
+  if (__sync_sub_and_fetch (&data->count, 1) == 0)
     {
-      uint8_t *buffer = (uint8_t *)data;
-      delete [] buffer;
+      PacketDataPool::Deallocate (data);
     }
 }
 
-#endif /* USE_FREE_LIST */
-
 
 } // namespace ns3
@@ -46,7 +46,11 @@ struct ByteTagListData;
  *
  *   - the struct ByteTagListData structure which contains the tag byte buffer
  *     is shared and, thus, reference-counted. This data structure is unshared
- *     as-needed to emulate COW semantics.
+ *     as-needed to emulate COW semantics. Its reference count is atomic,
+ *     and the lists which share it, maybe in different threads, claim
+ *     the bytes they append with a compare and swap. It is allocated
+ *     from the PacketDataPool with room for a few tags, so that adding
+ *     the first tags to a packet does not reallocate it.
  *
  *   - each tag tags a unique set of bytes identified by the pair of offsets 
  *     (start,end). These offsets are provided by Buffer::GetCurrentStartOffset
@@ -0,0 +1,400 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "packet-data-pool.h"
+#include "ns3/core-config.h"
+#include "ns3/assert.h"
+#include <new>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+namespace ns3 {
+
+namespace {
+
+// the classes go from 64 bytes to 64 KiB: 64, 96, 128, 192, 256, ...
+static const uint32_t POOL_MIN_SHIFT = 6;
+static const uint32_t POOL_CLASSES = 21;
+// the class of the blocks which are too large to be pooled
+static const uint32_t POOL_LARGE = POOL_CLASSES;
+
+struct PoolCache;
+
+// in front of each block, and kept while it is in a free list
+union BlockHeader
+{
+  struct
+  {
+    PoolCache *owner;
+    uint32_t sizeClass;
+  } block;
+  uint64_t align[2];
+};
+
+// in the body of a free block
+struct FreeBlock
+{
+  FreeBlock *next;
+};
+
+// the free lists of a thread
+struct PoolCache
+{
+  PoolCache ();
+  FreeBlock *lists[POOL_CLASSES];
+  uint32_t counts[POOL_CLASSES];
+  // the blocks of this cache freed by other threads
+  FreeBlock * volatile remote;
+  // set when the thread has exited, until another thread takes the cache
+  volatile bool orphan;
+  PacketDataPool::Stats stats;
+  PoolCache *nextCache;
+};
+
+PoolCache::PoolCache ()
+  : remote (0),
+    orphan (false),
+    nextCache (0)
+{
+  for (uint32_t i = 0; i < POOL_CLASSES; i++)
+    {
+      lists[i] = 0;
+      counts[i] = 0;
+    }
+}
+
+#ifdef HAVE_THREAD_LOCAL
+static __thread PoolCache *g_cache;
+#else
+static PoolCache *g_cache;
+#endif
+// all the caches ever created, never deleted
+static PoolCache *g_caches;
+static uint32_t g_maxCachedBytes = 256 * 1024;
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t g_cachesMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+#if defined (HAVE_THREAD_LOCAL) && defined (HAVE_PTHREAD_H)
+static pthread_once_t g_keyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t g_key;
+#endif
+
+void
+LockCaches (void)
+{
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_lock (&g_cachesMutex);
+#endif
+}
+
+void
+UnlockCaches (void)
+{
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_unlock (&g_cachesMutex);
+#endif
+}
+
+uint32_t
+GetClassSize (uint32_t sizeClass)
+{
+  if (sizeClass == 0)
+    {
+      return 1U << POOL_MIN_SHIFT;
+    }
+  uint32_t shift = POOL_MIN_SHIFT + (sizeClass - 1) / 2;
+  return (sizeClass % 2 == 1) ? (3U << (shift - 1)) : (2U << shift);
+}
+
+uint32_t
+GetSizeClass (uint32_t bytes)
+{
+  if (bytes <= (1U << POOL_MIN_SHIFT))
+    {
+      return 0;
+    }
+  if (bytes > GetClassSize (POOL_CLASSES - 1))
+    {
+      return POOL_LARGE;
+    }
+  // find the power of two such that 2^shift < bytes <= 2^(shift+1)
+  uint32_t shift = POOL_MIN_SHIFT;
+  while ((2U << shift) < bytes)
+    {
+      shift++;
+    }
+  uint32_t sizeClass = 2 * (shift - POOL_MIN_SHIFT) + 1;
+  if (bytes > (3U << (shift - 1)))
+    {
+      sizeClass++;
+    }
+  return sizeClass;
+}
+
+uint32_t
+GetMaxCount (uint32_t sizeClass)
+{
+  if (g_maxCachedBytes == 0)
+    {
+      return 0;
+    }
+  uint32_t count = g_maxCachedBytes / GetClassSize (sizeClass);
+  return count < 8 ? 8 : count;
+}
+
+void
+Release (PoolCache *cache, BlockHeader *header)
+{
+  cache->stats.releases++;
+  ::operator delete (header);
+}
+
+void
+PushLocal (PoolCache *cache, BlockHeader *header)
+{
+  uint32_t sizeClass = header->block.sizeClass;
+  if (cache->counts[sizeClass] >= GetMaxCount (sizeClass))
+    {
+      Release (cache, header);
+      return;
+    }
+  FreeBlock *block = reinterpret_cast<FreeBlock *> (header + 1);
+  block->next = cache->lists[sizeClass];
+  cache->lists[sizeClass] = block;
+  cache->counts[sizeClass]++;
+  cache->stats.cachedBytes += GetClassSize (sizeClass);
+}
+
+void
+PushRemote (PoolCache *owner, BlockHeader *header)
+{
+  FreeBlock *block = reinterpret_cast<FreeBlock *> (header + 1);
+  FreeBlock *head;
+  do
+    {
+      head = owner->remote;
+      block->next = head;
+    }
+  while (!__sync_bool_compare_and_swap (&owner->remote, head, block));
+}
+
+// take back the blocks freed by the other threads. Only the owner
+// pops from the list, and it takes the whole list at once, so the
+// pushes never see a block come back under them.
+void
+DrainRemote (PoolCache *cache)
+{
+  FreeBlock *block = __sync_lock_test_and_set (&cache->remote, (FreeBlock *)0);
+  while (block != 0)
+    {
+      FreeBlock *next = block->next;
+      PushLocal (cache, reinterpret_cast<BlockHeader *> (block) - 1);
+      block = next;
+    }
+}
+
+// called when a thread exits: its free blocks go back to the system
+// allocator, and the cache waits for the next thread
+void
+ReleaseCache (void *p)
+{
+  PoolCache *cache = static_cast<PoolCache *> (p);
+  FreeBlock *block = __sync_lock_test_and_set (&cache->remote, (FreeBlock *)0);
+  while (block != 0)
+    {
+      FreeBlock *next = block->next;
+      Release (cache, reinterpret_cast<BlockHeader *> (block) - 1);
+      block = next;
+    }
+  for (uint32_t i = 0; i < POOL_CLASSES; i++)
+    {
+      while (cache->lists[i] != 0)
+        {
+          block = cache->lists[i];
+          cache->lists[i] = block->next;
+          cache->stats.cachedBytes -= GetClassSize (i);
+          Release (cache, reinterpret_cast<BlockHeader *> (block) - 1);
+        }
+      cache->counts[i] = 0;
+    }
+  LockCaches ();
+  cache->orphan = true;
+  UnlockCaches ();
+}
+
+#if defined (HAVE_THREAD_LOCAL) && defined (HAVE_PTHREAD_H)
+void
+CreateKey (void)
+{
+  pthread_key_create (&g_key, &ReleaseCache);
+}
+#endif
+
+PoolCache *
+AcquireCache (void)
+{
+  PoolCache *cache = 0;
+  LockCaches ();
+  for (PoolCache *i = g_caches; i != 0; i = i->nextCache)
+    {
+      if (i->orphan)
+        {
+          cache = i;
+          cache->orphan = false;
+          break;
+        }
+    }
+  if (cache == 0)
+    {
+      cache = new PoolCache ();
+      cache->nextCache = g_caches;
+      g_caches = cache;
+    }
+  UnlockCaches ();
+#if defined (HAVE_THREAD_LOCAL) && defined (HAVE_PTHREAD_H)
+  pthread_once (&g_keyOnce, &CreateKey);
+  pthread_setspecific (g_key, cache);
+#endif
+  g_cache = cache;
+  return cache;
+}
+
+inline PoolCache *
+GetCache (void)
+{
+  PoolCache *cache = g_cache;
+  if (cache == 0)
+    {
+      cache = AcquireCache ();
+    }
+  return cache;
+}
+
+} // anonymous namespace
+
+PacketDataPool::Stats::Stats ()
+  : allocations (0),
+    hits (0),
+    remoteFrees (0),
+    releases (0),
+    cachedBytes (0)
+{
+}
+
+void *
+PacketDataPool::Allocate (uint32_t size, uint32_t *capacity)
+{
+  PoolCache *cache = GetCache ();
+  cache->stats.allocations++;
+  uint32_t bytes = size + sizeof (BlockHeader);
+  uint32_t sizeClass = GetSizeClass (bytes);
+  BlockHeader *header;
+  if (sizeClass == POOL_LARGE)
+    {
+      header = static_cast<BlockHeader *> (::operator new (bytes));
+      header->block.owner = 0;
+      header->block.sizeClass = POOL_LARGE;
+      *capacity = size;
+      return header + 1;
+    }
+  if (cache->lists[sizeClass] == 0 && cache->remote != 0)
+    {
+      DrainRemote (cache);
+    }
+  FreeBlock *block = cache->lists[sizeClass];
+  uint32_t classSize = GetClassSize (sizeClass);
+  if (block != 0)
+    {
+      cache->lists[sizeClass] = block->next;
+      cache->counts[sizeClass]--;
+      cache->stats.cachedBytes -= classSize;
+      cache->stats.hits++;
+      header = reinterpret_cast<BlockHeader *> (block) - 1;
+      NS_ASSERT (header->block.owner == cache && header->block.sizeClass == sizeClass);
+    }
+  else
+    {
+      header = static_cast<BlockHeader *> (::operator new (classSize));
+      header->block.owner = cache;
+      header->block.sizeClass = sizeClass;
+    }
+  *capacity = classSize - sizeof (BlockHeader);
+  return header + 1;
+}
+
+void
+PacketDataPool::Deallocate (void *block)
+{
+  BlockHeader *header = static_cast<BlockHeader *> (block) - 1;
+  if (header->block.sizeClass == POOL_LARGE)
+    {
+      ::operator delete (header);
+      return;
+    }
+  PoolCache *cache = GetCache ();
+  PoolCache *owner = header->block.owner;
+  if (owner == cache)
+    {
+      PushLocal (cache, header);
+      return;
+    }
+  cache->stats.remoteFrees++;
+  if (owner->orphan)
+    {
+      // nobody would take it back before a new thread starts
+      Release (cache, header);
+    }
+  else
+    {
+      PushRemote (owner, header);
+    }
+}
+
+void
+PacketDataPool::SetMaxCachedBytes (uint32_t bytes)
+{
+  g_maxCachedBytes = bytes;
+}
+
+struct PacketDataPool::Stats
+PacketDataPool::GetStats (void)
+{
+  Stats stats;
+  LockCaches ();
+  for (PoolCache *i = g_caches; i != 0; i = i->nextCache)
+    {
+      stats.allocations += i->stats.allocations;
+      stats.hits += i->stats.hits;
+      stats.remoteFrees += i->stats.remoteFrees;
+      stats.releases += i->stats.releases;
+      stats.cachedBytes += i->stats.cachedBytes;
+    }
+  UnlockCaches ();
+  return stats;
+}
+
+void
+PacketDataPool::PrintStats (std::ostream &os)
+{
+  Stats stats = GetStats ();
+  os << "allocations=" << stats.allocations
+     << " hits=" << stats.hits
+     << " remote-frees=" << stats.remoteFrees
+     << " releases=" << stats.releases
+     << " cached-bytes=" << stats.cachedBytes;
+}
+
+} // namespace ns3
@@ -0,0 +1,102 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef PACKET_DATA_POOL_H
+#define PACKET_DATA_POOL_H
+
+#include <stdint.h>
+#include <ostream>
+
+namespace ns3 {
+
+/**
+ * \ingroup packet
+ *
+ * \brief per-thread, size-classed pool of the data blocks of the packets
+ *
+ * The Buffer and PacketMetadata classes get their reference-counted
+ * data blocks from this pool. Each thread keeps its own lists of free
+ * blocks, one per size class: the classes go from 64 bytes to 64 KiB
+ * in steps of 1.5 and 2, so a block is at most 50% larger than
+ * requested and the spare room is usable by its owner. Larger blocks
+ * are not pooled.
+ *
+ * A block freed by the thread which allocated it goes back to the
+ * lists of that thread. A block freed by another thread is pushed,
+ * without a lock, on a list of the owner thread which takes the whole
+ * list back on its next miss. When a thread exits, its free blocks are
+ * released and its lists are reused by the next thread.
+ *
+ * Each thread keeps at most SetMaxCachedBytes bytes of free blocks per
+ * size class; the blocks freed beyond that go back to the system
+ * allocator. GetStats tells how often the lists are hit, to tune it.
+ *
+ * Without support for __thread variables, there is a single pool
+ * which, like the rest of the packets, is not thread safe.
+ */
+class PacketDataPool
+{
+public:
+  /**
+   * \brief counters of the pool, summed over all the threads
+   */
+  struct Stats
+  {
+    Stats ();
+    uint64_t allocations; //!< blocks handed out
+    uint64_t hits;        //!< blocks handed out from the free lists
+    uint64_t remoteFrees; //!< blocks freed by another thread than their owner
+    uint64_t releases;    //!< blocks given back to the system allocator
+    uint64_t cachedBytes; //!< bytes held in the free lists
+  };
+
+  /**
+   * \param size the number of bytes requested
+   * \param capacity set to the number of usable bytes of the block,
+   *        at least size
+   * \returns a block aligned for any type
+   *
+   * This can be called from any thread.
+   */
+  static void *Allocate (uint32_t size, uint32_t *capacity);
+  /**
+   * \param block a block returned by Allocate, from any thread
+   */
+  static void Deallocate (void *block);
+
+  /**
+   * \param bytes the largest number of bytes of free blocks which
+   *        each thread keeps for each size class.
+   *
+   * Defaults to 256 KiB. Each thread keeps at least 8 blocks of each
+   * class, unless bytes is zero, which disables the free lists.
+   */
+  static void SetMaxCachedBytes (uint32_t bytes);
+  /**
+   * \returns the counters of all the threads. The counters of the
+   *          other running threads can be slightly out of date.
+   */
+  static struct Stats GetStats (void);
+  /**
+   * \param os the output stream
+   *
+   * Print the counters of GetStats.
+   */
+  static void PrintStats (std::ostream &os);
+};
+
+} // namespace ns3
+
+#endif /* PACKET_DATA_POOL_H */
@@ -23,6 +23,7 @@
 #include "ns3/fatal-error.h"
 #include "ns3/log.h"
 #include "packet-metadata.h"
+#include "packet-data-pool.h"
 #include "buffer.h"
 #include "header.h"
 #include "trailer.h"
@@ -33,19 +34,9 @@ namespace ns3 {
 
 bool PacketMetadata::m_enable = false;
 bool PacketMetadata::m_enableChecking = false;
+bool PacketMetadata::m_enableCompact = false;
 bool PacketMetadata::m_metadataSkipped = false;
-uint32_t PacketMetadata::m_maxSize = 0;
 uint16_t PacketMetadata::m_chunkUid = 0;
-PacketMetadata::DataFreeList PacketMetadata::m_freeList;
-
-PacketMetadata::DataFreeList::~DataFreeList ()
-{
-  for (iterator i = begin (); i != end (); i++)
-    {
-      PacketMetadata::Deallocate (*i);
-    }
-  PacketMetadata::m_enable = false;
-}
 
 void 
 PacketMetadata::Enable (void)
@@ -67,14 +58,37 @@ PacketMetadata::EnableChecking (void)
   m_enableChecking = true;
 }
 
+void
+PacketMetadata::EnableCompact (void)
+{
+  NS_ASSERT_MSG (!m_enable || m_enableCompact,
+                 "Error: attempting to enable the compact packet metadata "
+                 "after the full packet metadata was enabled. Call "
+                 "ns3::PacketMetadata::EnableCompact () before enabling "
+                 "any tracing.");
+  Enable ();
+  m_enableCompact = true;
+}
+
+bool
+PacketMetadata::IsEnabled (void)
+{
+  return m_enable;
+}
+
+bool
+PacketMetadata::IsCompact (void)
+{
+  return m_enableCompact;
+}
+
 void
 PacketMetadata::ReserveCopy (uint32_t size)
 {
   struct PacketMetadata::Data *newData = PacketMetadata::Create (m_used + size);
   memcpy (newData->m_data, m_data->m_data, m_used);
   newData->m_dirtyEnd = m_used;
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
+  if (__sync_sub_and_fetch (&m_data->m_count, 1) == 0)
     {
       PacketMetadata::Recycle (m_data);
     }
@@ -97,7 +111,7 @@ PacketMetadata::Reserve (uint32_t size)
   NS_ASSERT (m_data != 0);
   if (m_data->m_size >= m_used + size &&
       (m_head == 0xffff ||
-       m_data->m_count == 1 ||
+       __atomic_load_n (&m_data->m_count, __ATOMIC_ACQUIRE) == 1 ||
        m_data->m_dirtyEnd == m_used))
     {
       /* enough room, not dirty. */
@@ -109,6 +123,16 @@ PacketMetadata::Reserve (uint32_t size)
     }
 }
 
+bool
+PacketMetadata::ClaimAtEnd (uint32_t n)
+{
+  if (__atomic_load_n (&m_data->m_count, __ATOMIC_ACQUIRE) == 1)
+    {
+      return true;
+    }
+  return __sync_bool_compare_and_swap (&m_data->m_dirtyEnd, m_used, m_used + n);
+}
+
 bool
 PacketMetadata::IsSharedPointerOk (uint16_t pointer) const
 {
@@ -125,6 +149,11 @@ PacketMetadata::IsPointerOk (uint16_t pointer) const
 bool
 PacketMetadata::IsStateOk (void) const
 {
+  if (m_data == 0)
+    {
+      // compact metadata
+      return m_head == 0xffff && m_tail == 0xffff;
+    }
   bool ok = m_used <= m_data->m_size;
   ok &= IsPointerOk (m_head);
   ok &= IsPointerOk (m_tail);
@@ -327,7 +356,8 @@ PacketMetadata::UpdateTail (uint16_t written)
   NS_ASSERT (m_head != 0xffff);
   NS_ASSERT (written >= 8);
   m_used += written;
-  m_data->m_dirtyEnd = m_used;
+  // a shared m_data was already claimed up to there by ClaimAtEnd
+  __atomic_store_n (&m_data->m_dirtyEnd, m_used, __ATOMIC_RELAXED);
 }
 
 
@@ -354,7 +384,8 @@ PacketMetadata::UpdateHead (uint16_t written)
   NS_ASSERT (m_head != 0xffff);
   NS_ASSERT (written >= 8);
   m_used += written;
-  m_data->m_dirtyEnd = m_used;
+  // a shared m_data was already claimed up to there by ClaimAtEnd
+  __atomic_store_n (&m_data->m_dirtyEnd, m_used, __ATOMIC_RELAXED);
 }
 
 uint16_t
@@ -366,10 +397,7 @@ PacketMetadata::AddSmall (const struct PacketMetadata::SmallItem *item)
   uint32_t typeUidSize = GetUleb128Size (item->typeUid);
   uint32_t sizeSize = GetUleb128Size (item->size);
   uint32_t n =  2 + 2 + typeUidSize + sizeSize + 2;
-  if (m_used + n > m_data->m_size ||
-      (m_head != 0xffff &&
-       m_data->m_count != 1 &&
-       m_used != m_data->m_dirtyEnd))
+  if (m_used + n > m_data->m_size || !ClaimAtEnd (n))
     {
       ReserveCopy (n);
     }
@@ -404,10 +432,7 @@ PacketMetadata::AddBig (uint32_t next, uint32_t prev,
   uint32_t fragEndSize = GetUleb128Size (extraItem->fragmentEnd);
   uint32_t n = 2 + 2 + typeUidSize + sizeSize + 2 + fragStartSize + fragEndSize + 4;
 
-  if (m_used + n > m_data->m_size ||
-      (m_head != 0xffff &&
-       m_data->m_count != 1 &&
-       m_used != m_data->m_dirtyEnd))
+  if (m_used + n > m_data->m_size || !ClaimAtEnd (n))
     {
       ReserveCopy (n);
     }
@@ -455,7 +480,9 @@ PacketMetadata::ReplaceTail (PacketMetadata::SmallItem *item,
    * we can try to use that extra space to avoid falling in the slow
    * path below.
    */
-  if (m_tail + available == m_used &&
+  bool unique = __atomic_load_n (&m_data->m_count, __ATOMIC_ACQUIRE) == 1;
+  if (unique &&
+      m_tail + available == m_used &&
       m_used == m_data->m_dirtyEnd)
     {
       available = m_data->m_size - m_tail;
@@ -468,8 +495,7 @@ PacketMetadata::ReplaceTail (PacketMetadata::SmallItem *item,
   uint32_t fragEndSize = GetUleb128Size (extraItem->fragmentEnd);
   uint32_t n = 2 + 2 + typeUidSize + sizeSize + 2 + fragStartSize + fragEndSize + 4;
 
-  if (available >= n &&
-      m_data->m_count == 1)
+  if (available >= n && unique)
     {
       uint8_t *buffer = &m_data->m_data[m_tail];
       Append16 (item->next, buffer);
@@ -565,70 +591,28 @@ PacketMetadata::ReadItems (uint16_t current,
 struct PacketMetadata::Data *
 PacketMetadata::Create (uint32_t size)
 {
-  NS_LOG_LOGIC ("create size="<<size<<", max="<<m_maxSize);
-  if (size > m_maxSize)
+  NS_LOG_LOGIC ("create size="<<size);
+  if (size <= 10)
     {
-      m_maxSize = size;
-    }
-  while (!m_freeList.empty ()) 
-    {
-      struct PacketMetadata::Data *data = m_freeList.back ();
-      m_freeList.pop_back ();
-      if (data->m_size >= size) 
-        {
-          NS_LOG_LOGIC ("create found size="<<data->m_size);
-          data->m_count = 1;
-          return data;
-        }
-      PacketMetadata::Deallocate (data);
-      NS_LOG_LOGIC ("create dealloc size="<<data->m_size);
+      size = 10;
     }
-  NS_LOG_LOGIC ("create alloc size="<<m_maxSize);
-  return PacketMetadata::Allocate (m_maxSize);
+  uint32_t capacity;
+  void *block = PacketDataPool::Allocate (sizeof (struct Data) + size - 10, &capacity);
+  struct PacketMetadata::Data *data = static_cast<struct PacketMetadata::Data *> (block);
+  // use the spare room of the size class too, as far as the 16 bit
+  // offsets of the items can reach
+  data->m_size = std::min<uint32_t> (capacity - (sizeof (struct Data) - 10), 0xffff);
+  data->m_count = 1;
+  data->m_dirtyEnd = 0;
+  return data;
 }
 
 void
 PacketMetadata::Recycle (struct PacketMetadata::Data *data)
 {
-  if (!m_enable)
-    {
-      PacketMetadata::Deallocate (data);
-      return;
-    } 
-  NS_LOG_LOGIC ("recycle size="<<data->m_size<<", list="<<m_freeList.size ());
+  NS_LOG_LOGIC ("recycle size="<<data->m_size);
   NS_ASSERT (data->m_count == 0);
-  if (m_freeList.size () > 1000 ||
-      data->m_size < m_maxSize) 
-    {
-      PacketMetadata::Deallocate (data);
-    } 
-  else 
-    {
-      m_freeList.push_back (data);
-    }
-}
-
-struct PacketMetadata::Data *
-PacketMetadata::Allocate (uint32_t n)
-{
-  uint32_t size = sizeof (struct Data);
-  if (n <= 10)
-    {
-      n = 10;
-    }
-  size += n - 10;
-  uint8_t *buf = new uint8_t [size];
-  struct PacketMetadata::Data *data = (struct PacketMetadata::Data *)buf;
-  data->m_size = n;
-  data->m_count = 1;
-  data->m_dirtyEnd = 0;
-  return data;
-}
-void 
-PacketMetadata::Deallocate (struct PacketMetadata::Data *data)
-{
-  uint8_t *buf = (uint8_t *)data;
-  delete [] buf;
+  PacketDataPool::Deallocate (data);
 }
 
 
@@ -658,14 +642,19 @@ PacketMetadata::DoAddHeader (uint32_t uid, uint32_t size)
       m_metadataSkipped = true;
       return;
     }
+  if (m_enableCompact)
+    {
+      m_compact.size += size;
+      DoAddCompactItem (true, uid, size);
+      return;
+    }
 
   struct PacketMetadata::SmallItem item;
   item.next = m_head;
   item.prev = 0xffff;
   item.typeUid = uid;
   item.size = size;
-  item.chunkUid = m_chunkUid;
-  m_chunkUid++;
+  item.chunkUid = __sync_fetch_and_add (&m_chunkUid, 1);
   uint16_t written = AddSmall (&item);
   UpdateHead (written);
 }
@@ -680,6 +669,11 @@ PacketMetadata::RemoveHeader (const Header &header, uint32_t size)
       m_metadataSkipped = true;
       return;
     }
+  if (m_enableCompact)
+    {
+      DoRemoveCompactItem (true, uid, size);
+      return;
+    }
   struct PacketMetadata::SmallItem item;
   struct PacketMetadata::ExtraItem extraItem;
   uint32_t read = ReadItems (m_head, &item, &extraItem);
@@ -728,13 +722,18 @@ PacketMetadata::AddTrailer (const Trailer &trailer, uint32_t size)
       m_metadataSkipped = true;
       return;
     }
+  if (m_enableCompact)
+    {
+      m_compact.size += size;
+      DoAddCompactItem (false, uid, size);
+      return;
+    }
   struct PacketMetadata::SmallItem item;
   item.next = 0xffff;
   item.prev = m_tail;
   item.typeUid = uid;
   item.size = size;
-  item.chunkUid = m_chunkUid;
-  m_chunkUid++;
+  item.chunkUid = __sync_fetch_and_add (&m_chunkUid, 1);
   uint16_t written = AddSmall (&item);
   UpdateTail (written);
   NS_ASSERT (IsStateOk ());
@@ -750,6 +749,11 @@ PacketMetadata::RemoveTrailer (const Trailer &trailer, uint32_t size)
       m_metadataSkipped = true;
       return;
     }
+  if (m_enableCompact)
+    {
+      DoRemoveCompactItem (false, uid, size);
+      return;
+    }
   struct PacketMetadata::SmallItem item;
   struct PacketMetadata::ExtraItem extraItem;
   uint32_t read = ReadItems (m_tail, &item, &extraItem);
@@ -797,6 +801,11 @@ PacketMetadata::AddAtEnd (PacketMetadata const&o)
       m_metadataSkipped = true;
       return;
     }
+  if (m_enableCompact)
+    {
+      DoAddCompactAtEnd (o);
+      return;
+    }
   if (m_tail == 0xffff)
     {
       // We have no items so 'AddAtEnd' is 
@@ -873,6 +882,12 @@ PacketMetadata::AddPaddingAtEnd (uint32_t end)
       m_metadataSkipped = true;
       return;
     }
+  if (m_enableCompact)
+    {
+      // the trailers are not at the end of the packet anymore
+      m_compact.size += end;
+      m_compact.nTrailers = 0;
+    }
 }
 void 
 PacketMetadata::RemoveAtStart (uint32_t start)
@@ -884,6 +899,11 @@ PacketMetadata::RemoveAtStart (uint32_t start)
       m_metadataSkipped = true;
       return;
     }
+  if (m_enableCompact)
+    {
+      DoRemoveCompactAtStart (start);
+      return;
+    }
   NS_ASSERT (m_data != 0);
   uint32_t leftToRemove = start;
   uint16_t current = m_head;
@@ -947,6 +967,11 @@ PacketMetadata::RemoveAtEnd (uint32_t end)
       m_metadataSkipped = true;
       return;
     }
+  if (m_enableCompact)
+    {
+      DoRemoveCompactAtEnd (end);
+      return;
+    }
   NS_ASSERT (m_data != 0);
 
   uint32_t leftToRemove = end;
@@ -1002,6 +1027,177 @@ PacketMetadata::RemoveAtEnd (uint32_t end)
   NS_ASSERT (leftToRemove == 0);
   NS_ASSERT (IsStateOk ());
 }
+void
+PacketMetadata::DoAddCompactItem (bool isHeader, uint32_t uid, uint32_t size)
+{
+  NS_LOG_FUNCTION (this << isHeader << uid << size);
+  struct PacketMetadata::CompactItem *items = isHeader ? m_compact.headers : m_compact.trailers;
+  uint8_t *n = isHeader ? &m_compact.nHeaders : &m_compact.nTrailers;
+  uint32_t max = isHeader ? COMPACT_HEADERS : COMPACT_TRAILERS;
+  if (uid == 0 || size > 0xffff)
+    {
+      // payload, or an item too large to be recorded, is now the
+      // outermost item: the recorded items become part of the payload.
+      *n = 0;
+      return;
+    }
+  if (*n == max)
+    {
+      // the innermost item becomes part of the payload
+      memmove (items, items + 1, (max - 1) * sizeof (struct PacketMetadata::CompactItem));
+      (*n)--;
+    }
+  items[*n].typeUid = uid >> 1;
+  items[*n].size = size;
+  (*n)++;
+}
+void
+PacketMetadata::DoRemoveCompactItem (bool isHeader, uint32_t uid, uint32_t size)
+{
+  NS_LOG_FUNCTION (this << isHeader << uid << size);
+  NS_ASSERT (size <= m_compact.size);
+  m_compact.size -= size;
+  struct PacketMetadata::CompactItem *items = isHeader ? m_compact.headers : m_compact.trailers;
+  uint8_t *n = isHeader ? &m_compact.nHeaders : &m_compact.nTrailers;
+  if (*n == 0)
+    {
+      // the item was not recorded: it was part of the payload.
+    }
+  else if (items[*n - 1].typeUid != (uid >> 1) || items[*n - 1].size != size)
+    {
+      if (m_enableChecking)
+        {
+          if (isHeader)
+            {
+              NS_FATAL_ERROR ("Removing unexpected header.");
+            }
+          else
+            {
+              NS_FATAL_ERROR ("Removing unexpected trailer.");
+            }
+        }
+      *n = 0;
+    }
+  else
+    {
+      (*n)--;
+    }
+  if (GetCompactSize (true) + GetCompactSize (false) > m_compact.size)
+    {
+      // the bytes removed from the payload were not enough.
+      m_compact.nHeaders = 0;
+      m_compact.nTrailers = 0;
+    }
+}
+void
+PacketMetadata::DoAddCompactAtEnd (PacketMetadata const&o)
+{
+  NS_LOG_FUNCTION (this << &o);
+  if (m_compact.size == 0)
+    {
+      *this = o;
+      return;
+    }
+  struct PacketMetadata::Compact first = m_compact;
+  bool firstHasOnlyHeaders = GetCompactSize (true) == m_compact.size;
+  bool otherHasOnlyTrailers = o.GetCompactSize (false) == o.m_compact.size;
+  m_compact.nHeaders = 0;
+  m_compact.nTrailers = 0;
+  m_compact.size = first.size + o.m_compact.size;
+  // add the items from the innermost to the outermost ones. 
+  if (firstHasOnlyHeaders)
+    {
+      for (uint8_t i = 0; i < o.m_compact.nHeaders; i++)
+        {
+          DoAddCompactItem (true, o.m_compact.headers[i].typeUid << 1,
+                            o.m_compact.headers[i].size);
+        }
+    }
+  for (uint8_t i = 0; i < first.nHeaders; i++)
+    {
+      DoAddCompactItem (true, first.headers[i].typeUid << 1, first.headers[i].size);
+    }
+  if (otherHasOnlyTrailers)
+    {
+      for (uint8_t i = 0; i < first.nTrailers; i++)
+        {
+          DoAddCompactItem (false, first.trailers[i].typeUid << 1,
+                            first.trailers[i].size);
+        }
+    }
+  for (uint8_t i = 0; i < o.m_compact.nTrailers; i++)
+    {
+      DoAddCompactItem (false, o.m_compact.trailers[i].typeUid << 1,
+                        o.m_compact.trailers[i].size);
+    }
+}
+void
+PacketMetadata::DoRemoveCompactAtStart (uint32_t start)
+{
+  NS_LOG_FUNCTION (this << start);
+  NS_ASSERT (start <= m_compact.size);
+  m_compact.size -= start;
+  while (start > 0 && m_compact.nHeaders > 0)
+    {
+      uint32_t size = m_compact.headers[m_compact.nHeaders - 1].size;
+      if (size > start)
+        {
+          // the rest of this header is now in front of the others.
+          m_compact.nHeaders = 0;
+          break;
+        }
+      m_compact.nHeaders--;
+      start -= size;
+    }
+  while (m_compact.nTrailers > 0 &&
+         GetCompactSize (true) + GetCompactSize (false) > m_compact.size)
+    {
+      // the innermost trailer was removed too, at least partly.
+      memmove (m_compact.trailers, m_compact.trailers + 1, 
+               (COMPACT_TRAILERS - 1) * sizeof (struct PacketMetadata::CompactItem));
+      m_compact.nTrailers--;
+    }
+}
+void
+PacketMetadata::DoRemoveCompactAtEnd (uint32_t end)
+{
+  NS_LOG_FUNCTION (this << end);
+  NS_ASSERT (end <= m_compact.size);
+  m_compact.size -= end;
+  while (end > 0 && m_compact.nTrailers > 0)
+    {
+      uint32_t size = m_compact.trailers[m_compact.nTrailers - 1].size;
+      if (size > end)
+        {
+          // the rest of this trailer is now behind the others.
+          m_compact.nTrailers = 0;
+          break;
+        }
+      m_compact.nTrailers--;
+      end -= size;
+    }
+  while (m_compact.nHeaders > 0 &&
+         GetCompactSize (true) + GetCompactSize (false) > m_compact.size)
+    {
+      // the innermost header was removed too, at least partly.
+      memmove (m_compact.headers, m_compact.headers + 1, 
+               (COMPACT_HEADERS - 1) * sizeof (struct PacketMetadata::CompactItem));
+      m_compact.nHeaders--;
+    }
+}
+uint32_t
+PacketMetadata::GetCompactSize (bool isHeader) const
+{
+  const struct PacketMetadata::CompactItem *items = isHeader ? m_compact.headers : m_compact.trailers;
+  uint8_t n = isHeader ? m_compact.nHeaders : m_compact.nTrailers;
+  uint32_t size = 0;
+  for (uint8_t i = 0; i < n; i++)
+    {
+      size += items[i].size;
+    }
+  return size;
+}
+
 uint32_t
 PacketMetadata::GetTotalSize (void) const
 {
@@ -1037,14 +1233,39 @@ PacketMetadata::BeginItem (Buffer buffer) const
 PacketMetadata::ItemIterator::ItemIterator (const PacketMetadata *metadata, Buffer buffer)
   : m_metadata (metadata),
     m_buffer (buffer),
-    m_current (metadata->m_head),
+    m_current (m_enableCompact ? 0 : metadata->m_head),
     m_offset (0),
     m_hasReadTail (false)
 {
 }
+uint32_t
+PacketMetadata::ItemIterator::GetCompactPayloadSize (void) const
+{
+  uint32_t items = m_metadata->GetCompactSize (true) + m_metadata->GetCompactSize (false);
+  if (items > m_buffer.GetSize ())
+    {
+      // should not happen: report everything as payload.
+      return m_buffer.GetSize ();
+    }
+  return m_buffer.GetSize () - items;
+}
 bool
 PacketMetadata::ItemIterator::HasNext (void) const
 {
+  if (m_enableCompact)
+    {
+      uint32_t n = m_metadata->m_compact.nHeaders + m_metadata->m_compact.nTrailers;
+      if (GetCompactPayloadSize () == m_buffer.GetSize ())
+        {
+          // only payload
+          n = 0;
+        }
+      if (GetCompactPayloadSize () > 0)
+        {
+          n++;
+        }
+      return m_current < n;
+    }
   if (m_current == 0xffff)
     {
       return false;
@@ -1058,6 +1279,10 @@ PacketMetadata::ItemIterator::HasNext (void) const
 PacketMetadata::Item
 PacketMetadata::ItemIterator::Next (void)
 {
+  if (m_enableCompact)
+    {
+      return NextCompact ();
+    }
   struct PacketMetadata::Item item;
   struct PacketMetadata::SmallItem smallItem;
   struct PacketMetadata::ExtraItem extraItem;
@@ -1115,6 +1340,52 @@ PacketMetadata::ItemIterator::Next (void)
   m_offset += extraItem.fragmentEnd - extraItem.fragmentStart;
   return item;
 }
+PacketMetadata::Item
+PacketMetadata::ItemIterator::NextCompact (void)
+{
+  const struct PacketMetadata::Compact &compact = m_metadata->m_compact;
+  uint32_t payloadSize = GetCompactPayloadSize ();
+  uint32_t nHeaders = compact.nHeaders;
+  if (payloadSize == m_buffer.GetSize ())
+    {
+      nHeaders = 0;
+    }
+  struct PacketMetadata::Item item;
+  item.isFragment = false;
+  item.currentTrimedFromStart = 0;
+  item.currentTrimedFromEnd = 0;
+  if (m_current < nHeaders)
+    {
+      const struct PacketMetadata::CompactItem &header = compact.headers[nHeaders - 1 - m_current];
+      item.type = PacketMetadata::Item::HEADER;
+      item.tid.SetUid (header.typeUid);
+      item.currentSize = header.size;
+      ns3::Buffer tmp = m_buffer;
+      tmp.RemoveAtStart (m_offset);
+      tmp.RemoveAtEnd (tmp.GetSize () - item.currentSize);
+      item.current = tmp.Begin ();
+    }
+  else if (m_current == nHeaders && payloadSize > 0)
+    {
+      item.type = PacketMetadata::Item::PAYLOAD;
+      item.currentSize = payloadSize;
+    }
+  else
+    {
+      uint32_t index = m_current - nHeaders - (payloadSize > 0 ? 1 : 0);
+      const struct PacketMetadata::CompactItem &trailer = compact.trailers[index];
+      item.type = PacketMetadata::Item::TRAILER;
+      item.tid.SetUid (trailer.typeUid);
+      item.currentSize = trailer.size;
+      ns3::Buffer tmp = m_buffer;
+      tmp.RemoveAtEnd (tmp.GetSize () - (m_offset + item.currentSize));
+      tmp.RemoveAtStart (tmp.GetSize () - item.currentSize);
+      item.current = tmp.End ();
+    }
+  m_current++;
+  m_offset += item.currentSize;
+  return item;
+}
 
 uint32_t 
 PacketMetadata::GetSerializedSize (void) const
@@ -1132,6 +1403,21 @@ PacketMetadata::GetSerializedSize (void) const
     {
       return totalSize;
     }
+  if (m_enableCompact)
+    {
+      // the size of the packet, the number of headers and of trailers,
+      // then the name and the size of each of them.
+      totalSize += 4 + 1 + 1;
+      for (uint8_t i = 0; i < m_compact.nHeaders + m_compact.nTrailers; i++)
+        {
+          const struct PacketMetadata::CompactItem &compactItem = i < m_compact.nHeaders ?
+            m_compact.headers[i] : m_compact.trailers[i - m_compact.nHeaders];
+          TypeId tid;
+          tid.SetUid (compactItem.typeUid);
+          totalSize += 4 + tid.GetName ().size () + 2;
+        }
+      return totalSize;
+    }
 
   struct PacketMetadata::SmallItem item;
   struct PacketMetadata::ExtraItem extraItem;
@@ -1172,6 +1458,51 @@ PacketMetadata::Serialize (uint8_t* buffer, uint32_t maxSize) const
     {
       return 0;
     }
+  if (m_enableCompact)
+    {
+      buffer = AddToRawU32 (m_compact.size, start, buffer, maxSize);
+      if (buffer == 0) 
+        {
+          return 0;
+        }
+      buffer = AddToRawU8 (m_compact.nHeaders, start, buffer, maxSize);
+      if (buffer == 0) 
+        {
+          return 0;
+        }
+      buffer = AddToRawU8 (m_compact.nTrailers, start, buffer, maxSize);
+      if (buffer == 0) 
+        {
+          return 0;
+        }
+      for (uint8_t i = 0; i < m_compact.nHeaders + m_compact.nTrailers; i++)
+        {
+          const struct PacketMetadata::CompactItem &compactItem = i < m_compact.nHeaders ?
+            m_compact.headers[i] : m_compact.trailers[i - m_compact.nHeaders];
+          TypeId tid;
+          tid.SetUid (compactItem.typeUid);
+          std::string uidString = tid.GetName ();
+          uint32_t uidStringSize = uidString.size ();
+          buffer = AddToRawU32 (uidStringSize, start, buffer, maxSize);
+          if (buffer == 0) 
+            {
+              return 0;
+            }
+          buffer = AddToRaw (reinterpret_cast<const uint8_t *> (uidString.c_str ()), 
+                             uidStringSize, start, buffer, maxSize);
+          if (buffer == 0) 
+            {
+              return 0;
+            }
+          buffer = AddToRawU16 (compactItem.size, start, buffer, maxSize);
+          if (buffer == 0) 
+            {
+              return 0;
+            }
+        }
+      NS_ASSERT (static_cast<uint32_t> (buffer - start) == maxSize);
+      return 1;
+    }
 
   struct PacketMetadata::SmallItem item;
   struct PacketMetadata::ExtraItem extraItem;
@@ -1272,6 +1603,39 @@ PacketMetadata::Deserialize (const uint8_t* buffer, uint32_t size)
   buffer = ReadFromRawU64 (m_packetUid, start, buffer, size);
   desSize -= 8;
 
+  if (m_enableCompact)
+    {
+      buffer = ReadFromRawU32 (m_compact.size, start, buffer, size);
+      desSize -= 4;
+      buffer = ReadFromRawU8 (m_compact.nHeaders, start, buffer, size);
+      desSize--;
+      buffer = ReadFromRawU8 (m_compact.nTrailers, start, buffer, size);
+      desSize--;
+      NS_ASSERT (m_compact.nHeaders <= COMPACT_HEADERS && 
+                 m_compact.nTrailers <= COMPACT_TRAILERS);
+      for (uint8_t i = 0; i < m_compact.nHeaders + m_compact.nTrailers; i++)
+        {
+          struct PacketMetadata::CompactItem &compactItem = i < m_compact.nHeaders ?
+            m_compact.headers[i] : m_compact.trailers[i - m_compact.nHeaders];
+          uint32_t uidStringSize = 0;
+          buffer = ReadFromRawU32 (uidStringSize, start, buffer, size);
+          desSize -= 4;
+          std::string uidString;
+          for (uint32_t j = 0; j < uidStringSize; j++)
+            {
+              uint8_t ch = 0;
+              buffer = ReadFromRawU8 (ch, start, buffer, size);
+              uidString.push_back (ch);
+              desSize--;
+            }
+          compactItem.typeUid = TypeId::LookupByName (uidString).GetUid ();
+          buffer = ReadFromRawU16 (compactItem.size, start, buffer, size);
+          desSize -= 2;
+        }
+      NS_ASSERT (desSize == 0);
+      return (desSize !=0) ? 0 : 1;
+    }
+
   struct PacketMetadata::SmallItem item;
   struct PacketMetadata::ExtraItem extraItem;
   while (desSize > 0)
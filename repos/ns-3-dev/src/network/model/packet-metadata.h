@@ -74,6 +74,13 @@ class Trailer;
  * integers, and some others as variable-size 32-bit integers.
  * The variable-size 32 bit integers are stored using the uleb128
  * encoding.
+ *
+ * A compact mode, selected with EnableCompact, replaces this linked
+ * list with a fixed-size array stored in the PacketMetadata instance
+ * itself. It records the type and the size of the outermost headers
+ * and trailers of the packet, and the size of the packet: everything
+ * else is reported as payload. No memory is allocated to maintain
+ * it, which is enough to print the packets in ascii traces.
  */
 class PacketMetadata 
 {
@@ -117,6 +124,8 @@ public:
     bool HasNext (void) const;
     Item Next (void);
 private:
+    uint32_t GetCompactPayloadSize (void) const;
+    Item NextCompact (void);
     const PacketMetadata *m_metadata;
     Buffer m_buffer;
     uint16_t m_current;
@@ -126,6 +135,20 @@ private:
 
   static void Enable (void);
   static void EnableChecking (void);
+  /**
+   * Record only the outermost headers and trailers of each packet,
+   * without allocating memory. This must be called before any packet
+   * is created, and before Enable is called by any helper. 
+   */
+  static void EnableCompact (void);
+  /**
+   * \returns true if the full or the compact metadata is enabled.
+   */
+  static bool IsEnabled (void);
+  /**
+   * \returns true if the compact metadata is enabled.
+   */
+  static bool IsCompact (void);
 
   inline PacketMetadata (uint64_t uid, uint32_t size);
   inline PacketMetadata (PacketMetadata const &o);
@@ -209,12 +232,14 @@ private:
                                   const uint8_t* current,
                                   uint32_t maxSize);
   struct Data {
-    /* number of references to this struct Data instance. */
+    /* number of references to this struct Data instance,
+     * only updated with atomic operations. */
     uint16_t m_count;
     /* size (in bytes) of m_data buffer below */
     uint16_t m_size;
     /* max of the m_used field over all objects which 
-     * reference this struct Data instance */
+     * reference this struct Data instance. While m_count is
+     * above one, it is only raised by ClaimAtEnd. */
     uint16_t m_dirtyEnd;
     /* variable-sized buffer of bytes */
     uint8_t m_data[10];
@@ -265,6 +290,28 @@ private:
      */
     uint16_t chunkUid;
   };
+  /* the outermost headers and trailers of a packet in compact mode.
+   */
+  struct CompactItem {
+    /* the uid of the TypeId of the header or trailer. */
+    uint16_t typeUid;
+    /* the size (in bytes) of the header or trailer. */
+    uint16_t size;
+  };
+  enum {
+    COMPACT_HEADERS = 6,
+    COMPACT_TRAILERS = 2
+  };
+  struct Compact {
+    /* the headers, from the innermost to the outermost one. */
+    struct CompactItem headers[COMPACT_HEADERS];
+    /* the trailers, from the innermost to the outermost one. */
+    struct CompactItem trailers[COMPACT_TRAILERS];
+    uint8_t nHeaders;
+    uint8_t nTrailers;
+    /* the size (in bytes) of the packet. */
+    uint32_t size;
+  };
   struct ExtraItem {
     /* offset (in bytes) from start of original header to 
        the start of the fragment still present.
@@ -284,14 +331,8 @@ private:
     uint64_t packetUid;
   };
 
-  class DataFreeList : public std::vector<struct Data *>
-  {
-public:
-    ~DataFreeList ();
-  };
-
-  friend DataFreeList::~DataFreeList ();
   friend class ItemIterator;
+  friend class PacketMetadataCompactTest;
 
   PacketMetadata ();
 
@@ -312,6 +353,10 @@ public:
   void AppendValueExtra (uint32_t value, uint8_t *buffer);
   inline void Reserve (uint32_t n);
   void ReserveCopy (uint32_t n);
+  /* \returns true if the n bytes at m_used can be written in place:
+   * either m_data is not shared, or no copy of this metadata, in any
+   * thread, wrote there yet and this one got them. */
+  bool ClaimAtEnd (uint32_t n);
   uint32_t GetTotalSize (void) const;
   uint32_t ReadItems (uint16_t current, 
                       struct PacketMetadata::SmallItem *item,
@@ -320,23 +365,26 @@ public:
   bool IsStateOk (void) const;
   bool IsPointerOk (uint16_t pointer) const;
   bool IsSharedPointerOk (uint16_t pointer) const;
+  void DoAddCompactItem (bool isHeader, uint32_t uid, uint32_t size);
+  void DoRemoveCompactItem (bool isHeader, uint32_t uid, uint32_t size);
+  void DoAddCompactAtEnd (PacketMetadata const&o);
+  void DoRemoveCompactAtStart (uint32_t start);
+  void DoRemoveCompactAtEnd (uint32_t end);
+  uint32_t GetCompactSize (bool isHeader) const;
 
 
   static struct PacketMetadata::Data *Create (uint32_t size);
   static void Recycle (struct PacketMetadata::Data *data);
-  static struct PacketMetadata::Data *Allocate (uint32_t n);
-  static void Deallocate (struct PacketMetadata::Data *data);
 
-  static DataFreeList m_freeList;
   static bool m_enable;
   static bool m_enableChecking;
+  static bool m_enableCompact;
 
   // set to true when adding metadata to a packet is skipped because
   // m_enable is false; used to detect enabling of metadata in the
   // middle of a simulation, which isn't allowed.
   static bool m_metadataSkipped;
 
-  static uint32_t m_maxSize;
   static uint16_t m_chunkUid;
 
   struct Data *m_data;
@@ -349,6 +397,7 @@ public:
   uint16_t m_tail;
   uint16_t m_used;
   uint64_t m_packetUid;
+  struct Compact m_compact;
 };
 
 } // namespace ns3
@@ -356,13 +405,19 @@ public:
 namespace ns3 {
 
 PacketMetadata::PacketMetadata (uint64_t uid, uint32_t size)
-  : m_data (PacketMetadata::Create (10)),
+  : m_data (m_enableCompact ? 0 : PacketMetadata::Create (10)),
     m_head (0xffff),
     m_tail (0xffff),
     m_used (0),
     m_packetUid (uid)
 {
-  memset (m_data->m_data, 0xff, 4);
+  if (m_data != 0)
+    {
+      memset (m_data->m_data, 0xff, 4);
+    }
+  m_compact.nHeaders = 0;
+  m_compact.nTrailers = 0;
+  m_compact.size = 0;
   if (size > 0)
     {
       DoAddHeader (0, size);
@@ -373,10 +428,13 @@ PacketMetadata::PacketMetadata (PacketMetadata const &o)
     m_head (o.m_head),
     m_tail (o.m_tail),
     m_used (o.m_used),
-    m_packetUid (o.m_packetUid)
+    m_packetUid (o.m_packetUid),
+    m_compact (o.m_compact)
 {
-  NS_ASSERT (m_data != 0);
-  m_data->m_count++;
+  if (m_data != 0)
+    {
+      __sync_fetch_and_add (&m_data->m_count, 1);
+    }
 }
 PacketMetadata &
 PacketMetadata::operator = (PacketMetadata const& o)
@@ -384,27 +442,34 @@ PacketMetadata::operator = (PacketMetadata const& o)
   if (m_data != o.m_data) 
     {
       // not self assignment
-      NS_ASSERT (m_data != 0);
-      m_data->m_count--;
-      if (m_data->m_count == 0) 
+      if (m_data != 0)
         {
-          PacketMetadata::Recycle (m_data);
+          if (__sync_sub_and_fetch (&m_data->m_count, 1) == 0)
+            {
+              PacketMetadata::Recycle (m_data);
+            }
         }
       m_data = o.m_data;
-      NS_ASSERT (m_data != 0);
-      m_data->m_count++;
+      if (m_data != 0)
+        {
+          __sync_fetch_and_add (&m_data->m_count, 1);
+        }
     }
   m_head = o.m_head;
   m_tail = o.m_tail;
   m_used = o.m_used;
   m_packetUid = o.m_packetUid;
+  m_compact = o.m_compact;
   return *this;
 }
 PacketMetadata::~PacketMetadata ()
 {
-  NS_ASSERT (m_data != 0);
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
+  if (m_data == 0)
+    {
+      // compact metadata
+      return;
+    }
+  if (__sync_sub_and_fetch (&m_data->m_count, 1) == 0)
     {
       PacketMetadata::Recycle (m_data);
     }
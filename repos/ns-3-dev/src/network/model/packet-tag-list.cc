@@ -18,114 +18,145 @@
  * Author: Mathieu Lacage <mathieu.lacage@sophia.inria.fr>
  */
 #include "packet-tag-list.h"
+#include "packet-data-pool.h"
 #include "tag-buffer.h"
 #include "tag.h"
 #include "ns3/fatal-error.h"
 #include "ns3/log.h"
+#include <algorithm>
 #include <string.h>
 
 NS_LOG_COMPONENT_DEFINE ("PacketTagList");
 
 namespace ns3 {
 
-#ifdef USE_FREE_LIST
+/**
+ * \param tid the uid of a TypeId
+ * \returns the bit of PacketTagList::m_mask which tells whether
+ *          a tag of this type can be present in the list.
+ */
+static inline uint16_t
+GetMask (uint16_t tid)
+{
+  return 1U << (tid & 0xf);
+}
 
-struct PacketTagList::TagData *PacketTagList::g_free = 0;
-uint32_t PacketTagList::g_nfree = 0;
+struct PacketTagList::TagArray *
+PacketTagList::AllocArray (uint32_t capacity)
+{
+  NS_LOG_FUNCTION (capacity);
+  uint32_t size = sizeof (struct TagArray) + (capacity - 1) * sizeof (struct TagData);
+  uint32_t blockSize;
+  void *block = PacketDataPool::Allocate (size, &blockSize);
+  struct TagArray *array = (struct TagArray *)block;
+  array->count = 1;
+  array->size = 0;
+  array->capacity = capacity + (blockSize - size) / sizeof (struct TagData);
+  return array;
+}
 
-struct PacketTagList::TagData *
-PacketTagList::AllocData (void) const
+void
+PacketTagList::FreeArray (struct TagArray *array)
 {
-  NS_LOG_FUNCTION (g_nfree);
-  struct PacketTagList::TagData *retval;
-  if (g_free != 0) 
-    {
-      retval = g_free;
-      g_free = g_free->m_next;
-      g_nfree--;
-    } 
-  else 
+  NS_LOG_FUNCTION (array);
+  if (__sync_sub_and_fetch (&array->count, 1) == 0)
     {
-      retval = new struct PacketTagList::TagData ();
+      PacketDataPool::Deallocate (array);
     }
-  return retval;
 }
 
-void
-PacketTagList::FreeData (struct TagData *data) const
+uint32_t
+PacketTagList::Find (uint16_t tid) const
 {
-  NS_LOG_FUNCTION (g_nfree << data);
-  if (g_nfree > 1000) 
+  if ((m_mask & GetMask (tid)) == 0)
+    {
+      return m_size;
+    }
+  // the most recently added tags are the most likely to be looked up.
+  const struct TagData *tags = GetTags ();
+  for (uint32_t i = m_size; i > 0; i--)
     {
-      delete data;
-      return;
+      if (tags[i - 1].tid == tid)
+        {
+          return i - 1;
+        }
     }
-  g_nfree++;
-  data->next = g_free;
-  data->tid = TypeId ();
-  g_free = data;
+  return m_size;
 }
-#else
-struct PacketTagList::TagData *
-PacketTagList::AllocData (void) const
+
+void
+PacketTagList::Grow (uint32_t capacity)
 {
-  NS_LOG_FUNCTION_NOARGS ();
-  struct PacketTagList::TagData *retval;
-  retval = new struct PacketTagList::TagData ();
-  return retval;
+  NS_LOG_FUNCTION (this << capacity);
+  NS_ASSERT (capacity > INLINE_TAGS);
+  struct TagArray *array = AllocArray (std::max (capacity, 2U * INLINE_TAGS));
+  memcpy (array->tags, GetTags (), m_size * sizeof (struct TagData));
+  array->size = m_size;
+  if (m_array != 0)
+    {
+      FreeArray (m_array);
+    }
+  m_array = array;
 }
 
 void
-PacketTagList::FreeData (struct TagData *data) const
+PacketTagList::Shrink (void)
 {
-  NS_LOG_FUNCTION (data);
-  delete data;
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (m_array != 0 && m_size <= INLINE_TAGS);
+  memcpy (m_inline, m_array->tags, m_size * sizeof (struct TagData));
+  FreeArray (m_array);
+  m_array = 0;
 }
-#endif
 
 bool
 PacketTagList::Remove (Tag &tag)
 {
   NS_LOG_FUNCTION (this << tag.GetInstanceTypeId ());
-  TypeId tid = tag.GetInstanceTypeId ();
-  bool found = false;
-  for (struct TagData *cur = m_next; cur != 0; cur = cur->next) 
+  uint16_t tid = tag.GetInstanceTypeId ().GetUid ();
+  uint32_t index = Find (tid);
+  if (index == m_size) 
     {
-      if (cur->tid == tid) 
-        {
-          found = true;
-          tag.Deserialize (TagBuffer (cur->data, cur->data+PACKET_TAG_MAX_SIZE));
-        }
+      return false;
     }
-  if (!found) 
+  struct TagData *cur = GetTags () + index;
+  tag.Deserialize (TagBuffer (cur->data, cur->data+PACKET_TAG_MAX_SIZE));
+  bool shared = m_array != 0 && __atomic_load_n (&m_array->count, __ATOMIC_ACQUIRE) != 1;
+  if (shared && m_size - 1 <= INLINE_TAGS)
     {
-      return false;
+      // copy the remaining tags inline rather than copying the
+      // shared array.
+      const struct TagData *tags = m_array->tags;
+      memcpy (m_inline, tags, index * sizeof (struct TagData));
+      memcpy (m_inline + index, tags + index + 1, (m_size - index - 1) * sizeof (struct TagData));
+      FreeArray (m_array);
+      m_array = 0;
+      m_size--;
     }
-  struct TagData *start = 0;
-  struct TagData **prevNext = &start;
-  for (struct TagData *cur = m_next; cur != 0; cur = cur->next) 
+  else
     {
-      if (cur->tid == tid) 
+      if (shared)
         {
-          /**
-           * XXX
-           * Note: I believe that we could optimize this to
-           * avoid copying each TagData located after the target id
-           * and just link the already-copied list to the next tag.
-           */
-          continue;
+          Grow (m_size);
+        }
+      struct TagData *tags = GetTags ();
+      m_size--;
+      memmove (tags + index, tags + index + 1, (m_size - index) * sizeof (struct TagData));
+      if (m_array != 0)
+        {
+          m_array->size = m_size;
+          if (m_size <= INLINE_TAGS)
+            {
+              Shrink ();
+            }
         }
-      struct TagData *copy = AllocData ();
-      copy->tid = cur->tid;
-      copy->count = 1;
-      copy->next = 0;
-      memcpy (copy->data, cur->data, PACKET_TAG_MAX_SIZE);
-      *prevNext = copy;
-      prevNext = &copy->next;
     }
-  *prevNext = 0;
-  RemoveAll ();
-  m_next = start;
+  const struct TagData *tags = GetTags ();
+  m_mask = 0;
+  for (uint32_t i = 0; i < m_size; i++)
+    {
+      m_mask |= GetMask (tags[i].tid);
+    }
   return true;
 }
 
@@ -133,44 +164,52 @@ void
 PacketTagList::Add (const Tag &tag) const
 {
   NS_LOG_FUNCTION (this << tag.GetInstanceTypeId ());
+  uint16_t tid = tag.GetInstanceTypeId ().GetUid ();
   // ensure this id was not yet added
-  for (struct TagData *cur = m_next; cur != 0; cur = cur->next) 
+  NS_ASSERT (Find (tid) == m_size);
+  NS_ASSERT (tag.GetSerializedSize () <= PACKET_TAG_MAX_SIZE);
+  PacketTagList *self = const_cast<PacketTagList *> (this);
+  if (m_array != 0)
     {
-      NS_ASSERT (cur->tid != tag.GetInstanceTypeId ());
+      bool unique = __atomic_load_n (&m_array->count, __ATOMIC_ACQUIRE) == 1;
+      if (m_array->capacity == m_size ||
+          (unique ? m_array->size != m_size :
+           !__sync_bool_compare_and_swap (&m_array->size, m_size, m_size + 1)))
+        {
+          // another list appended to our shared array, or it is full.
+          self->Grow (m_size + 1);
+        }
     }
-  struct TagData *head = AllocData ();
-  head->count = 1;
-  head->next = 0;
-  head->tid = tag.GetInstanceTypeId ();
-  head->next = m_next;
-  NS_ASSERT (tag.GetSerializedSize () <= PACKET_TAG_MAX_SIZE);
+  else if (m_size == INLINE_TAGS)
+    {
+      self->Grow (m_size + 1);
+    }
+  struct TagData *head = self->GetTags () + m_size;
+  head->tid = tid;
   tag.Serialize (TagBuffer (head->data, head->data+tag.GetSerializedSize ()));
-
-  const_cast<PacketTagList *> (this)->m_next = head;
+  self->m_size++;
+  self->m_mask |= GetMask (tid);
+  if (m_array != 0)
+    {
+      // a shared array was already claimed up to there above
+      __atomic_store_n (&m_array->size, m_size, __ATOMIC_RELAXED);
+    }
 }
 
 bool
 PacketTagList::Peek (Tag &tag) const
 {
   NS_LOG_FUNCTION (this << tag.GetInstanceTypeId ());
-  TypeId tid = tag.GetInstanceTypeId ();
-  for (struct TagData *cur = m_next; cur != 0; cur = cur->next) 
+  uint32_t index = Find (tag.GetInstanceTypeId ().GetUid ());
+  if (index == m_size)
     {
-      if (cur->tid == tid) 
-        {
-          /* found tag */
-          tag.Deserialize (TagBuffer (cur->data, cur->data+PACKET_TAG_MAX_SIZE));
-          return true;
-        }
+      /* no tag found */
+      return false;
     }
-  /* no tag found */
-  return false;
-}
-
-const struct PacketTagList::TagData *
-PacketTagList::Head (void) const
-{
-  return m_next;
+  /* found tag */
+  struct TagData *cur = const_cast<struct TagData *> (GetTags ()) + index;
+  tag.Deserialize (TagBuffer (cur->data, cur->data+PACKET_TAG_MAX_SIZE));
+  return true;
 }
 
 } // namespace ns3
@@ -21,6 +21,7 @@
 #define PACKET_TAG_LIST_H
 
 #include <stdint.h>
+#include <string.h>
 #include <ostream>
 #include "ns3/type-id.h"
 
@@ -36,14 +37,44 @@ class Tag;
  */
 #define PACKET_TAG_MAX_SIZE 20
 
+/**
+ * \ingroup packet
+ *
+ * \brief keep track of the packet tags stored in a packet.
+ *
+ * This class is mostly private to the Packet implementation and users
+ * should never have to access it directly.
+ *
+ * \internal
+ * The implementation of this class is a bit tricky so, there are a couple
+ * of things to keep in mind here:
+ *
+ *   - it stores all tags in a flat array of TagData entries, in the order
+ *     in which they were added. Up to INLINE_TAGS entries live inline in
+ *     the list itself so that adding, copying and removing the handful of
+ *     tags a packet usually carries never allocates.
+ *
+ *   - longer lists move to an array allocated from the PacketDataPool.
+ *     This array is shared and, thus, reference-counted. Each list sees
+ *     the first m_size entries of its array: like ByteTagList, a list can
+ *     append in place to a shared array as long as no other list has
+ *     appended to it since they were copied. Other changes unshare the
+ *     array as-needed to emulate COW semantics. The lists which share
+ *     an array may be used by different threads: the reference count
+ *     is atomic, and a compare and swap on the size of a shared array
+ *     decides which list may append to it.
+ *
+ *   - each list keeps a 16 bit mask indexed by the low bits of the uid
+ *     of the TypeId of each of its tags: lookups for tags which are not
+ *     present, the most common case on a forwarding path, are answered
+ *     from the mask without scanning the entries.
+ */
 class PacketTagList 
 {
 public:
   struct TagData {
     uint8_t data[PACKET_TAG_MAX_SIZE];
-    struct TagData *next;
-    TypeId tid;
-    uint32_t count;
+    uint16_t tid; //!< the uid of the TypeId of the tag
   };
 
   inline PacketTagList ();
@@ -56,18 +87,39 @@ public:
   bool Peek (Tag &tag) const;
   inline void RemoveAll (void);
 
-  const struct PacketTagList::TagData *Head (void) const;
+  /**
+   * \returns a pointer to the first (oldest) tag of this list.
+   */
+  inline const struct PacketTagList::TagData *Begin (void) const;
+  /**
+   * \returns a pointer past the last (most recently added) tag of this list.
+   */
+  inline const struct PacketTagList::TagData *End (void) const;
 
 private:
+  enum {
+    INLINE_TAGS = 3
+  };
+  struct TagArray {
+    uint32_t count;
+    uint32_t size;
+    uint32_t capacity;
+    struct TagData tags[1];
+  };
 
-  bool Remove (TypeId tid);
-  struct PacketTagList::TagData *AllocData (void) const;
-  void FreeData (struct TagData *data) const;
-
-  static struct PacketTagList::TagData *g_free;
-  static uint32_t g_nfree;
-
-  struct TagData *m_next;
+  inline void CopyFrom (PacketTagList const &o);
+  inline const struct TagData *GetTags (void) const;
+  inline struct TagData *GetTags (void);
+  uint32_t Find (uint16_t tid) const;
+  void Grow (uint32_t capacity);
+  void Shrink (void);
+  static struct PacketTagList::TagArray *AllocArray (uint32_t capacity);
+  static void FreeArray (struct TagArray *array);
+
+  uint16_t m_size;
+  uint16_t m_mask;
+  struct TagArray *m_array;
+  struct TagData m_inline[INLINE_TAGS];
 };
 
 } // namespace ns3
@@ -79,33 +131,27 @@ private:
 namespace ns3 {
 
 PacketTagList::PacketTagList ()
-  : m_next ()
+  : m_size (0),
+    m_mask (0),
+    m_array (0)
 {
 }
 
 PacketTagList::PacketTagList (PacketTagList const &o)
-  : m_next (o.m_next)
 {
-  if (m_next != 0)
-    {
-      m_next->count++;
-    }
+  CopyFrom (o);
 }
 
 PacketTagList &
 PacketTagList::operator = (PacketTagList const &o)
 {
   // self assignment
-  if (m_next == o.m_next) 
+  if (this == &o) 
     {
       return *this;
     }
   RemoveAll ();
-  m_next = o.m_next;
-  if (m_next != 0) 
-    {
-      m_next->count++;
-    }
+  CopyFrom (o);
   return *this;
 }
 
@@ -117,25 +163,53 @@ PacketTagList::~PacketTagList ()
 void
 PacketTagList::RemoveAll (void)
 {
-  struct TagData *prev = 0;
-  for (struct TagData *cur = m_next; cur != 0; cur = cur->next) 
+  if (m_array != 0)
     {
-      cur->count--;
-      if (cur->count > 0) 
-        {
-          break;
-        }
-      if (prev != 0) 
-        {
-          FreeData (prev);
-        }
-      prev = cur;
+      FreeArray (m_array);
+      m_array = 0;
     }
-  if (prev != 0) 
+  m_size = 0;
+  m_mask = 0;
+}
+
+void
+PacketTagList::CopyFrom (PacketTagList const &o)
+{
+  m_size = o.m_size;
+  m_mask = o.m_mask;
+  m_array = o.m_array;
+  if (m_array != 0)
     {
-      FreeData (prev);
+      __sync_fetch_and_add (&m_array->count, 1);
     }
-  m_next = 0;
+  else
+    {
+      memcpy (m_inline, o.m_inline, m_size * sizeof (struct TagData));
+    }
+}
+
+const struct PacketTagList::TagData *
+PacketTagList::GetTags (void) const
+{
+  return (m_array != 0) ? m_array->tags : m_inline;
+}
+
+struct PacketTagList::TagData *
+PacketTagList::GetTags (void)
+{
+  return (m_array != 0) ? m_array->tags : m_inline;
+}
+
+const struct PacketTagList::TagData *
+PacketTagList::Begin (void) const
+{
+  return GetTags ();
+}
+
+const struct PacketTagList::TagData *
+PacketTagList::End (void) const
+{
+  return GetTags () + m_size;
 }
 
 } // namespace ns3
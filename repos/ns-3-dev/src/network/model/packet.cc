@@ -30,6 +30,14 @@ namespace ns3 {
 
 uint32_t Packet::m_globalUid = 0;
 
+uint32_t
+Packet::AllocateUid (void)
+{
+  // the threads of MultithreadedSimulatorImpl create packets at the
+  // same time
+  return __sync_fetch_and_add (&m_globalUid, 1);
+}
+
 TypeId 
 ByteTagIterator::Item::GetTypeId (void) const
 {
@@ -81,22 +89,24 @@ ByteTagIterator::ByteTagIterator (ByteTagList::Iterator i)
 }
 
 
-PacketTagIterator::PacketTagIterator (const struct PacketTagList::TagData *head)
-  : m_current (head)
+PacketTagIterator::PacketTagIterator (const struct PacketTagList::TagData *begin,
+                                      const struct PacketTagList::TagData *end)
+  : m_begin (begin),
+    m_current (end)
 {
 }
 bool
 PacketTagIterator::HasNext (void) const
 {
-  return m_current != 0;
+  return m_current != m_begin;
 }
 PacketTagIterator::Item
 PacketTagIterator::Next (void)
 {
   NS_ASSERT (HasNext ());
-  const struct PacketTagList::TagData *prev = m_current;
-  m_current = m_current->next;
-  return PacketTagIterator::Item (prev);
+  // report the most recently added tags first.
+  m_current--;
+  return PacketTagIterator::Item (m_current);
 }
 
 PacketTagIterator::Item::Item (const struct PacketTagList::TagData *data)
@@ -106,12 +116,14 @@ PacketTagIterator::Item::Item (const struct PacketTagList::TagData *data)
 TypeId
 PacketTagIterator::Item::GetTypeId (void) const
 {
-  return m_data->tid;
+  TypeId tid;
+  tid.SetUid (m_data->tid);
+  return tid;
 }
 void
 PacketTagIterator::Item::GetTag (Tag &tag) const
 {
-  NS_ASSERT (tag.GetInstanceTypeId () == m_data->tid);
+  NS_ASSERT (tag.GetInstanceTypeId ().GetUid () == m_data->tid);
   tag.Deserialize (TagBuffer ((uint8_t*)m_data->data, (uint8_t*)m_data->data+PACKET_TAG_MAX_SIZE));
 }
 
@@ -135,10 +147,9 @@ Packet::Packet ()
      * zero.  The lower 32 bits are for the 
      * global UID
      */
-    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, 0),
+    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | AllocateUid (), 0),
     m_nixVector (0)
 {
-  m_globalUid++;
 }
 
 Packet::Packet (const Packet &o)
@@ -177,10 +188,9 @@ Packet::Packet (uint32_t size)
      * zero.  The lower 32 bits are for the 
      * global UID
      */
-    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, size),
+    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | AllocateUid (), size),
     m_nixVector (0)
 {
-  m_globalUid++;
 }
 Packet::Packet (uint8_t const *buffer, uint32_t size, bool magic)
   : m_buffer (0, false),
@@ -203,10 +213,9 @@ Packet::Packet (uint8_t const*buffer, uint32_t size)
      * zero.  The lower 32 bits are for the 
      * global UID
      */
-    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, size),
+    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | AllocateUid (), size),
     m_nixVector (0)
 {
-  m_globalUid++;
   m_buffer.AddAtStart (size);
   Buffer::Iterator i = m_buffer.Begin ();
   i.Write (buffer, size);
@@ -553,6 +562,13 @@ Packet::EnablePrinting (void)
   PacketMetadata::Enable ();
 }
 
+void
+Packet::EnableCompactPrinting (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  PacketMetadata::EnableCompact ();
+}
+
 void
 Packet::EnableChecking (void)
 {
@@ -887,7 +903,7 @@ Packet::PrintPacketTags (std::ostream &os) const
 PacketTagIterator 
 Packet::GetPacketTagIterator (void) const
 {
-  return PacketTagIterator (m_packetTagList.Head ());
+  return PacketTagIterator (m_packetTagList.Begin (), m_packetTagList.End ());
 }
 
 std::ostream& operator<< (std::ostream& os, const Packet &packet)
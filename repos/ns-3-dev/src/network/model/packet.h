@@ -147,7 +147,9 @@ private:
   Item Next (void);
 private:
   friend class Packet;
-  PacketTagIterator (const struct PacketTagList::TagData *head);
+  PacketTagIterator (const struct PacketTagList::TagData *begin,
+                     const struct PacketTagList::TagData *end);
+  const struct PacketTagList::TagData *m_begin;
   const struct PacketTagList::TagData *m_current;
 };
 
@@ -196,6 +198,15 @@ private:
  * Implementing a new type of Tag requires roughly the same amount of
  * work and this work is described in the ns3::Tag API documentation.
  *
+ * Packets can be passed between the threads of
+ * ns3::MultithreadedSimulatorImpl: the reference counts of a packet
+ * and of the buffers, metadata and tags it shares with its copies are
+ * atomic, so that copies in different threads can be read, modified
+ * and released at the same time, and a Ptr<const Packet> can be read
+ * and copied by several threads. Only AddByteTag, AddPacketTag and
+ * PeekData change a packet through a const pointer: they must not be
+ * called on a packet which another thread uses.
+ *
  * The performance aspects of the Packet API are discussed in 
  * \ref packetperf
  */
@@ -420,6 +431,16 @@ public:
    * simulation setup and before any packet is created.
    */
   static void EnablePrinting (void);
+  /**
+   * Keep only the metadata about the outermost headers and trailers
+   * of each packet, without allocating any memory for it. This is
+   * enough for the Print methods to print the headers of the packets
+   * in ascii traces, and the rest of the packet is printed as
+   * payload. This must be invoked during the simulation setup, before
+   * any packet is created and before any helper enables tracing:
+   * EnablePrinting then keeps the compact metadata.
+   */
+  static void EnableCompactPrinting (void);
   /**
    * The packet metadata is also used to perform extensive
    * sanity checks at runtime when performing operations on a 
@@ -557,6 +578,7 @@ private:
           const PacketTagList &packetTagList, const PacketMetadata &metadata);
 
   uint32_t Deserialize (uint8_t const*buffer, uint32_t size);
+  static uint32_t AllocateUid (void);
 
   Buffer m_buffer;
   ByteTagList m_byteTagList;
@@ -569,6 +591,28 @@ private:
   static uint32_t m_globalUid;
 };
 
+/**
+ * The reference count of a packet is atomic, so that a packet can be
+ * handed to another thread while the sender still holds a pointer to
+ * it.
+ */
+template <>
+inline void
+SimpleRefCount<Packet>::Ref (void) const
+{
+  __sync_fetch_and_add (&m_count, 1);
+}
+
+template <>
+inline void
+SimpleRefCount<Packet>::Unref (void) const
+{
+  if (__sync_sub_and_fetch (&m_count, 1) == 0)
+    {
+      DefaultDeleter<Packet>::Delete (static_cast<Packet *> (const_cast<SimpleRefCount *> (this)));
+    }
+}
+
 std::ostream& operator<< (std::ostream& os, const Packet &packet);
 
 /**
@@ -0,0 +1,318 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "ns3/binary-trace-writer.h"
+#include "ns3/output-stream-wrapper.h"
+#include "ns3/trace-helper.h"
+#include "ns3/llc-snap-header.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "ns3/core-config.h"
+#include "ns3/test.h"
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+namespace ns3 {
+
+static Ptr<Packet>
+CreateTracedPacket (uint32_t i)
+{
+  Ptr<Packet> p = Create<Packet> (100 + i % 50);
+  LlcSnapHeader llc;
+  llc.SetType (i);
+  p->AddHeader (llc);
+  return p;
+}
+
+class BinaryTraceConvertTestCase : public TestCase
+{
+public:
+  BinaryTraceConvertTestCase (enum BinaryTraceWriter::Compression compression, uint32_t n);
+private:
+  virtual void DoSetup (void);
+  virtual void DoRun (void);
+  virtual void DoTeardown (void);
+  void Write (uint32_t i);
+
+  enum BinaryTraceWriter::Compression m_compression;
+  uint32_t m_n;
+  std::string m_filename;
+  std::ostringstream m_text;
+  Ptr<OutputStreamWrapper> m_textStream;
+  Ptr<OutputStreamWrapper> m_binaryStream;
+};
+
+BinaryTraceConvertTestCase::BinaryTraceConvertTestCase (enum BinaryTraceWriter::Compression compression,
+                                                        uint32_t n)
+  : TestCase ("Check the conversion of a binary trace to ascii"),
+    m_compression (compression),
+    m_n (n)
+{
+}
+
+void
+BinaryTraceConvertTestCase::DoSetup (void)
+{
+  std::ostringstream filename;
+  filename << rand () << ".btr";
+  m_filename = CreateTempDirFilename (filename.str ());
+}
+
+void
+BinaryTraceConvertTestCase::DoTeardown (void)
+{
+  remove (m_filename.c_str ());
+}
+
+void
+BinaryTraceConvertTestCase::Write (uint32_t i)
+{
+  Ptr<Packet> p = CreateTracedPacket (i);
+  std::ostringstream context;
+  context << "/NodeList/" << i % 7 << "/DeviceList/0/Mac/Tx";
+  char event = "+-dr"[i % 4];
+  Ptr<OutputStreamWrapper> streams[2] = { m_textStream, m_binaryStream };
+  for (uint32_t j = 0; j < 2; j++)
+    {
+      if (i % 3 == 0)
+        {
+          AsciiTraceHelper::WritePacket (streams[j], event, p);
+        }
+      else
+        {
+          AsciiTraceHelper::WritePacket (streams[j], event, context.str (), p);
+        }
+      if (i % 10 == 0)
+        {
+          // a sink which writes its own text
+          *streams[j]->GetStream () << "text " << i << std::endl;
+        }
+    }
+}
+
+void
+BinaryTraceConvertTestCase::DoRun (void)
+{
+  m_textStream = Create<OutputStreamWrapper> (&m_text);
+  AsciiTraceHelper helper;
+  m_binaryStream = helper.CreateBinaryFileStream (m_filename, std::ios::out, m_compression);
+  for (uint32_t i = 0; i < m_n; i++)
+    {
+      Simulator::Schedule (MicroSeconds (i * 37), &BinaryTraceConvertTestCase::Write, this, i);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+  // closes the file
+  m_binaryStream = 0;
+
+  std::ostringstream converted;
+  BinaryTraceReader reader (m_filename);
+  NS_TEST_ASSERT_MSG_EQ (reader.ConvertToAscii (converted), true, "invalid binary trace");
+  NS_TEST_EXPECT_MSG_EQ (converted.str (), m_text.str (), "binary trace differs from the ascii trace");
+  m_textStream = 0;
+}
+
+class BinaryTraceAppendTestCase : public TestCase
+{
+public:
+  BinaryTraceAppendTestCase ();
+private:
+  virtual void DoSetup (void);
+  virtual void DoRun (void);
+  virtual void DoTeardown (void);
+
+  std::string m_filename;
+};
+
+BinaryTraceAppendTestCase::BinaryTraceAppendTestCase ()
+  : TestCase ("Check the conversion of binary traces appended to the same file")
+{
+}
+
+void
+BinaryTraceAppendTestCase::DoSetup (void)
+{
+  std::ostringstream filename;
+  filename << rand () << ".btr";
+  m_filename = CreateTempDirFilename (filename.str ());
+}
+
+void
+BinaryTraceAppendTestCase::DoTeardown (void)
+{
+  remove (m_filename.c_str ());
+}
+
+void
+BinaryTraceAppendTestCase::DoRun (void)
+{
+  std::ostringstream text;
+  Ptr<OutputStreamWrapper> textStream = Create<OutputStreamWrapper> (&text);
+  std::ios::openmode modes[2] = { std::ios::out, std::ios::app };
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      Ptr<BinaryTraceWriter> writer = Create<BinaryTraceWriter> (m_filename, modes[i]);
+      Ptr<OutputStreamWrapper> binaryStream = Create<OutputStreamWrapper> (writer);
+      Ptr<Packet> p = CreateTracedPacket (i);
+      // each trace has its own context strings
+      std::string context = i == 0 ? "/NodeList/0/A" : "/NodeList/1/B";
+      AsciiTraceHelper::WritePacket (textStream, 'r', context, p);
+      AsciiTraceHelper::WritePacket (binaryStream, 'r', context, p);
+      *textStream->GetStream () << "unfinished line";
+      *binaryStream->GetStream () << "unfinished line";
+    }
+  Simulator::Destroy ();
+
+  std::ostringstream converted;
+  BinaryTraceReader reader (m_filename);
+  NS_TEST_ASSERT_MSG_EQ (reader.ConvertToAscii (converted), true, "invalid binary trace");
+  NS_TEST_EXPECT_MSG_EQ (converted.str (), text.str (), "binary traces differ from the ascii traces");
+
+  std::ostringstream invalid;
+  BinaryTraceReader missing (m_filename + ".missing");
+  NS_TEST_EXPECT_MSG_EQ (missing.ConvertToAscii (invalid), false, "converted a missing file");
+}
+
+#if defined (HAVE_THREAD_LOCAL) && defined (HAVE_PTHREAD_H)
+class BinaryTraceThreadTestCase : public TestCase
+{
+public:
+  BinaryTraceThreadTestCase ();
+private:
+  virtual void DoSetup (void);
+  virtual void DoRun (void);
+  virtual void DoTeardown (void);
+  static void *Write (void *arg);
+
+  struct Thread
+  {
+    BinaryTraceThreadTestCase *test;
+    uint32_t index;
+  };
+  std::string m_filename;
+  Ptr<BinaryTraceWriter> m_writer;
+};
+
+BinaryTraceThreadTestCase::BinaryTraceThreadTestCase ()
+  : TestCase ("Check that each thread writes its own records")
+{
+}
+
+void
+BinaryTraceThreadTestCase::DoSetup (void)
+{
+  std::ostringstream filename;
+  filename << rand () << ".btr";
+  m_filename = CreateTempDirFilename (filename.str ());
+}
+
+void
+BinaryTraceThreadTestCase::DoTeardown (void)
+{
+  remove (m_filename.c_str ());
+}
+
+void *
+BinaryTraceThreadTestCase::Write (void *arg)
+{
+  struct Thread *thread = static_cast<struct Thread *> (arg);
+  for (uint32_t i = 0; i < 20000; i++)
+    {
+      std::ostringstream text;
+      text << thread->index << " " << i << "\n";
+      thread->test->m_writer->WriteText (text.str ().data (), text.str ().size ());
+    }
+  return 0;
+}
+
+void
+BinaryTraceThreadTestCase::DoRun (void)
+{
+  m_writer = Create<BinaryTraceWriter> (m_filename);
+  // create the simulator before the threads ask for the time
+  Simulator::Now ();
+  pthread_t threads[2];
+  struct Thread args[2];
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      args[i].test = this;
+      args[i].index = i;
+      pthread_create (&threads[i], 0, &BinaryTraceThreadTestCase::Write, &args[i]);
+    }
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      pthread_join (threads[i], 0);
+    }
+  m_writer = 0;
+  Simulator::Destroy ();
+
+  std::ostringstream converted;
+  BinaryTraceReader reader (m_filename);
+  NS_TEST_ASSERT_MSG_EQ (reader.ConvertToAscii (converted), true, "invalid binary trace");
+  // the records of the threads are interleaved block by block, but
+  // each thread keeps the order of its own records
+  std::istringstream lines (converted.str ());
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      uint32_t next = 0;
+      std::string line;
+      lines.clear ();
+      lines.seekg (0);
+      while (std::getline (lines, line))
+        {
+          std::istringstream fields (line);
+          uint32_t thread;
+          uint32_t j;
+          fields >> thread >> j;
+          if (thread == i)
+            {
+              NS_TEST_EXPECT_MSG_EQ (j, next, "record of thread " << i << " out of order");
+              next = j + 1;
+            }
+        }
+      NS_TEST_EXPECT_MSG_EQ (next, 20000, "records of thread " << i << " lost");
+    }
+}
+#endif /* HAVE_THREAD_LOCAL && HAVE_PTHREAD_H */
+
+class BinaryTraceTestSuite : public TestSuite
+{
+public:
+  BinaryTraceTestSuite ();
+};
+
+BinaryTraceTestSuite::BinaryTraceTestSuite ()
+  : TestSuite ("binary-trace", UNIT)
+{
+  AddTestCase (new BinaryTraceConvertTestCase (BinaryTraceWriter::NONE, 100));
+  // enough records for several blocks
+  AddTestCase (new BinaryTraceConvertTestCase (BinaryTraceWriter::NONE, 3000));
+  if (BinaryTraceWriter::IsSupported (BinaryTraceWriter::ZLIB))
+    {
+      AddTestCase (new BinaryTraceConvertTestCase (BinaryTraceWriter::ZLIB, 3000));
+    }
+  AddTestCase (new BinaryTraceAppendTestCase);
+#if defined (HAVE_THREAD_LOCAL) && defined (HAVE_PTHREAD_H)
+  AddTestCase (new BinaryTraceThreadTestCase);
+#endif
+}
+
+static BinaryTraceTestSuite g_binaryTraceTestSuite;
+
+} // namespace ns3
@@ -1,6 +1,8 @@
 #include "ns3/buffer.h"
+#include "ns3/packet-data-pool.h"
 #include "ns3/random-variable.h"
 #include "ns3/test.h"
+#include <vector>
 
 namespace ns3 {
 
@@ -320,6 +322,148 @@ BufferTest::DoRun (void)
   free (cBuf);
 }
 //-----------------------------------------------------------------------------
+class BufferChunkTest : public TestCase
+{
+public:
+  BufferChunkTest ();
+private:
+  virtual void DoRun (void);
+  Buffer MakeBuffer (uint32_t size, uint8_t seed);
+  bool Check (Buffer b, const std::vector<uint8_t> &expected);
+};
+
+BufferChunkTest::BufferChunkTest ()
+  : TestCase ("Buffer chunks")
+{
+}
+
+Buffer
+BufferChunkTest::MakeBuffer (uint32_t size, uint8_t seed)
+{
+  Buffer b;
+  b.AddAtStart (size);
+  Buffer::Iterator i = b.Begin ();
+  for (uint32_t j = 0; j < size; j++)
+    {
+      i.WriteU8 (seed + j);
+    }
+  return b;
+}
+
+bool
+BufferChunkTest::Check (Buffer b, const std::vector<uint8_t> &expected)
+{
+  if (b.GetSize () != expected.size ())
+    {
+      return false;
+    }
+  std::vector<uint8_t> copied (expected.size () + 1);
+  if (b.CopyData (&copied[0], expected.size ()) != expected.size ())
+    {
+      return false;
+    }
+  Buffer::Iterator i = b.Begin ();
+  for (uint32_t j = 0; j < expected.size (); j++)
+    {
+      if (copied[j] != expected[j] || i.ReadU8 () != expected[j])
+        {
+          return false;
+        }
+    }
+  uint8_t const *peeked = b.PeekData ();
+  return expected.empty () || memcmp (peeked, &expected[0], expected.size ()) == 0;
+}
+
+void
+BufferChunkTest::DoRun (void)
+{
+  std::vector<uint8_t> expected;
+  Buffer a = MakeBuffer (1000, 0);
+  Buffer b = MakeBuffer (1500, 7);
+  for (uint32_t j = 0; j < 1000; j++)
+    {
+      expected.push_back (j);
+    }
+  for (uint32_t j = 0; j < 1500; j++)
+    {
+      expected.push_back (7 + j);
+    }
+
+  // concatenating two large buffers does not copy their bytes
+  uint64_t allocations = PacketDataPool::GetStats ().allocations;
+  Buffer c = a;
+  c.AddAtEnd (b);
+  NS_TEST_ASSERT_MSG_EQ (PacketDataPool::GetStats ().allocations - allocations, 0,
+                         "AddAtEnd copied the buffers");
+  NS_TEST_ASSERT_MSG_EQ (c.GetSize (), 2500, "Bad concatenated size");
+
+  // reads across the chunk boundary
+  Buffer::Iterator i = c.Begin ();
+  i.Next (998);
+  NS_TEST_ASSERT_MSG_EQ (i.ReadNtohU32 (), 0xe6e70708, "Bad read across chunks");
+  i.Prev (4);
+  NS_TEST_ASSERT_MSG_EQ (i.ReadLsbtohU16 (), 0xe7e6, "Bad read before chunks");
+  NS_TEST_ASSERT_MSG_EQ (i.ReadU16 (), 0x0807, "Bad read in chunks");
+
+  // a fragment which spans both chunks
+  Buffer frag = c.CreateFragment (900, 200);
+  std::vector<uint8_t> fragExpected (expected.begin () + 900, expected.begin () + 1100);
+  NS_TEST_ASSERT_MSG_EQ (Check (frag, fragExpected), true, "Bad fragment");
+
+  // add a header and a trailer around a shared chunked buffer
+  Buffer d = c;
+  d.AddAtStart (4);
+  d.Begin ().WriteHtonU32 (0x01020304);
+  d.AddAtEnd (3);
+  i = d.End ();
+  i.Prev (3);
+  i.WriteU8 (0xaa);
+  i.WriteU8 (0xbb);
+  i.WriteU8 (0xcc);
+  std::vector<uint8_t> dExpected;
+  dExpected.push_back (1);
+  dExpected.push_back (2);
+  dExpected.push_back (3);
+  dExpected.push_back (4);
+  dExpected.insert (dExpected.end (), expected.begin (), expected.end ());
+  dExpected.push_back (0xaa);
+  dExpected.push_back (0xbb);
+  dExpected.push_back (0xcc);
+  NS_TEST_ASSERT_MSG_EQ (Check (d, dExpected), true, "Bad header or trailer");
+  NS_TEST_ASSERT_MSG_EQ (Check (c, expected), true, "Shared buffer was modified");
+
+  // remove bytes across the chunks from both ends
+  d.RemoveAtStart (1200);
+  d.RemoveAtEnd (1000);
+  std::vector<uint8_t> eExpected (dExpected.begin () + 1200, dExpected.end () - 1000);
+  NS_TEST_ASSERT_MSG_EQ (Check (d, eExpected), true, "Bad removal across chunks");
+  d.AddAtStart (2);
+  d.Begin ().WriteU16 (0x5555);
+  eExpected.insert (eExpected.begin (), 2, 0x55);
+  NS_TEST_ASSERT_MSG_EQ (Check (d, eExpected), true, "Bad header after removal");
+
+  // zero-filled chunks
+  Buffer z = MakeBuffer (300, 1);
+  z.AddAtEnd (Buffer (500));
+  z.AddAtEnd (Buffer (500));
+  std::vector<uint8_t> zExpected;
+  for (uint32_t j = 0; j < 300; j++)
+    {
+      zExpected.push_back (1 + j);
+    }
+  zExpected.insert (zExpected.end (), 1000, 0);
+  NS_TEST_ASSERT_MSG_EQ (Check (z, zExpected), true, "Bad zero chunk");
+
+  // serialization flattens the chunks
+  uint32_t size = c.GetSerializedSize ();
+  std::vector<uint8_t> serialized (size + 4);
+  NS_TEST_ASSERT_MSG_EQ (c.Serialize (&serialized[0], size), 1, "Could not serialize");
+  // like Packet::Deserialize, the size accounts for the buffer length field
+  Buffer f;
+  f.Deserialize (&serialized[0], size + 4);
+  NS_TEST_ASSERT_MSG_EQ (Check (f, expected), true, "Bad deserialized buffer");
+}
+//-----------------------------------------------------------------------------
 class BufferTestSuite : public TestSuite
 {
 public:
@@ -330,6 +474,7 @@ BufferTestSuite::BufferTestSuite ()
   : TestSuite ("buffer", UNIT)
 {
   AddTestCase (new BufferTest);
+  AddTestCase (new BufferChunkTest);
 }
 
 static BufferTestSuite g_bufferTestSuite;
@@ -0,0 +1,205 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "ns3/packet-data-pool.h"
+#include "ns3/core-config.h"
+#include "ns3/test.h"
+#include <vector>
+#include <string.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+namespace ns3 {
+
+class PacketDataPoolClassTestCase : public TestCase
+{
+public:
+  PacketDataPoolClassTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+PacketDataPoolClassTestCase::PacketDataPoolClassTestCase ()
+  : TestCase ("Check the size classes of the blocks")
+{
+}
+
+void
+PacketDataPoolClassTestCase::DoRun (void)
+{
+  for (uint32_t size = 1; size < 70000; size += 1 + size / 8)
+    {
+      uint32_t capacity;
+      uint8_t *block = static_cast<uint8_t *> (PacketDataPool::Allocate (size, &capacity));
+      NS_TEST_EXPECT_MSG_GT (capacity + 1, size, "block too small for " << size);
+      NS_TEST_EXPECT_MSG_EQ (((uintptr_t)block) % 8, 0, "block of " << size << " not aligned");
+      if (size >= 64)
+        {
+          // the classes are at most 50% apart, the header included
+          NS_TEST_EXPECT_MSG_LT (2 * capacity, 3 * size + 16, "block too large for " << size);
+        }
+      memset (block, 0x5a, capacity);
+      PacketDataPool::Deallocate (block);
+    }
+}
+
+class PacketDataPoolReuseTestCase : public TestCase
+{
+public:
+  PacketDataPoolReuseTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+PacketDataPoolReuseTestCase::PacketDataPoolReuseTestCase ()
+  : TestCase ("Check that the free blocks are reused up to the limit")
+{
+}
+
+void
+PacketDataPoolReuseTestCase::DoRun (void)
+{
+  uint32_t capacity;
+  void *first = PacketDataPool::Allocate (200, &capacity);
+  PacketDataPool::Deallocate (first);
+  PacketDataPool::Stats before = PacketDataPool::GetStats ();
+  void *second = PacketDataPool::Allocate (190, &capacity);
+  PacketDataPool::Stats after = PacketDataPool::GetStats ();
+  NS_TEST_EXPECT_MSG_EQ (second, first, "the free block of the same class is not reused");
+  NS_TEST_EXPECT_MSG_EQ (after.allocations - before.allocations, 1, "allocation not counted");
+  NS_TEST_EXPECT_MSG_EQ (after.hits - before.hits, 1, "hit not counted");
+  PacketDataPool::Deallocate (second);
+
+  // 100 blocks of the 4 KiB class, at most 16 of which are kept
+  PacketDataPool::SetMaxCachedBytes (64 * 1024);
+  std::vector<void *> blocks;
+  for (uint32_t i = 0; i < 100; i++)
+    {
+      blocks.push_back (PacketDataPool::Allocate (4000, &capacity));
+    }
+  before = PacketDataPool::GetStats ();
+  for (uint32_t i = 0; i < blocks.size (); i++)
+    {
+      PacketDataPool::Deallocate (blocks[i]);
+    }
+  after = PacketDataPool::GetStats ();
+  PacketDataPool::SetMaxCachedBytes (256 * 1024);
+  NS_TEST_EXPECT_MSG_LT (after.cachedBytes - before.cachedBytes, 16 * 4096 + 1, "too many free blocks kept");
+  NS_TEST_EXPECT_MSG_GT (after.releases - before.releases, 83, "the free blocks beyond the limit are not released");
+}
+
+#if defined (HAVE_THREAD_LOCAL) && defined (HAVE_PTHREAD_H)
+class PacketDataPoolThreadTestCase : public TestCase
+{
+public:
+  PacketDataPoolThreadTestCase ();
+private:
+  virtual void DoRun (void);
+  static void *FreeBlocks (void *context);
+  static void *AllocateAndFree (void *context);
+  std::vector<void *> m_blocks;
+};
+
+PacketDataPoolThreadTestCase::PacketDataPoolThreadTestCase ()
+  : TestCase ("Check the blocks freed by another thread")
+{
+}
+
+void *
+PacketDataPoolThreadTestCase::FreeBlocks (void *context)
+{
+  PacketDataPoolThreadTestCase *self = static_cast<PacketDataPoolThreadTestCase *> (context);
+  for (uint32_t i = 0; i < self->m_blocks.size (); i++)
+    {
+      PacketDataPool::Deallocate (self->m_blocks[i]);
+    }
+  self->m_blocks.clear ();
+  return 0;
+}
+
+void *
+PacketDataPoolThreadTestCase::AllocateAndFree (void *context)
+{
+  std::vector<void *> blocks;
+  uint32_t capacity;
+  for (uint32_t i = 0; i < 50; i++)
+    {
+      blocks.push_back (PacketDataPool::Allocate (1000, &capacity));
+    }
+  for (uint32_t i = 0; i < blocks.size (); i++)
+    {
+      PacketDataPool::Deallocate (blocks[i]);
+    }
+  return 0;
+}
+
+void
+PacketDataPoolThreadTestCase::DoRun (void)
+{
+  uint32_t capacity;
+  for (uint32_t i = 0; i < 100; i++)
+    {
+      m_blocks.push_back (PacketDataPool::Allocate (1500, &capacity));
+    }
+  PacketDataPool::Stats before = PacketDataPool::GetStats ();
+  pthread_t thread;
+  pthread_create (&thread, 0, &PacketDataPoolThreadTestCase::FreeBlocks, this);
+  pthread_join (thread, 0);
+  PacketDataPool::Stats after = PacketDataPool::GetStats ();
+  NS_TEST_EXPECT_MSG_EQ (after.remoteFrees - before.remoteFrees, 100, "remote frees not counted");
+
+  // the blocks come back to this thread on its next miss
+  for (uint32_t i = 0; i < 100; i++)
+    {
+      m_blocks.push_back (PacketDataPool::Allocate (1500, &capacity));
+    }
+  before = after;
+  after = PacketDataPool::GetStats ();
+  NS_TEST_EXPECT_MSG_EQ (after.hits - before.hits, 100, "the blocks freed by the other thread are not reused");
+  for (uint32_t i = 0; i < m_blocks.size (); i++)
+    {
+      PacketDataPool::Deallocate (m_blocks[i]);
+    }
+  m_blocks.clear ();
+
+  // a thread releases its free blocks when it exits
+  before = PacketDataPool::GetStats ();
+  pthread_create (&thread, 0, &PacketDataPoolThreadTestCase::AllocateAndFree, 0);
+  pthread_join (thread, 0);
+  after = PacketDataPool::GetStats ();
+  NS_TEST_EXPECT_MSG_EQ (after.cachedBytes, before.cachedBytes, "free blocks kept after the exit of their thread");
+}
+#endif /* HAVE_THREAD_LOCAL && HAVE_PTHREAD_H */
+
+class PacketDataPoolTestSuite : public TestSuite
+{
+public:
+  PacketDataPoolTestSuite ();
+};
+
+PacketDataPoolTestSuite::PacketDataPoolTestSuite ()
+  : TestSuite ("packet-data-pool", UNIT)
+{
+  AddTestCase (new PacketDataPoolClassTestCase);
+  AddTestCase (new PacketDataPoolReuseTestCase);
+#if defined (HAVE_THREAD_LOCAL) && defined (HAVE_PTHREAD_H)
+  AddTestCase (new PacketDataPoolThreadTestCase);
+#endif
+}
+
+static PacketDataPoolTestSuite g_packetDataPoolTestSuite;
+
+} // namespace ns3
@@ -258,6 +258,8 @@ public:
   virtual ~PacketMetadataTest ();
   void CheckHistory (Ptr<Packet> p, const char *file, int line, uint32_t n, ...);
   virtual void DoRun (void);
+protected:
+  PacketMetadataTest (std::string name);
 private:
   Ptr<Packet> DoAddHeader (Ptr<Packet> p);
 };
@@ -267,6 +269,11 @@ PacketMetadataTest::PacketMetadataTest ()
 {
 }
 
+PacketMetadataTest::PacketMetadataTest (std::string name)
+  : TestCase (name)
+{
+}
+
 PacketMetadataTest::~PacketMetadataTest ()
 {
 }
@@ -822,6 +829,82 @@ PacketMetadataTest::DoRun (void)
   NS_TEST_EXPECT_MSG_EQ (msg, std::string ("hello world"), "Could not find original data in received packet");
 }
 //-----------------------------------------------------------------------------
+class PacketMetadataCompactTest : public PacketMetadataTest
+{
+public:
+  PacketMetadataCompactTest ();
+  virtual void DoRun (void);
+private:
+  void DoRunCompact (void);
+};
+
+PacketMetadataCompactTest::PacketMetadataCompactTest ()
+  : PacketMetadataTest ("Compact packet metadata")
+{
+}
+
+void
+PacketMetadataCompactTest::DoRun (void)
+{
+  // the mode is global: switch to the compact metadata only while the
+  // packets of this test exist.
+  bool enable = PacketMetadata::m_enable;
+  bool enableCompact = PacketMetadata::m_enableCompact;
+  PacketMetadata::m_enable = true;
+  PacketMetadata::m_enableCompact = true;
+  DoRunCompact ();
+  PacketMetadata::m_enable = enable;
+  PacketMetadata::m_enableCompact = enableCompact;
+}
+
+void
+PacketMetadataCompactTest::DoRunCompact (void)
+{
+  Ptr<Packet> p = Create<Packet> (10);
+  ADD_TRAILER (p, 100);
+  CHECK_HISTORY (p, 2, 10, 100);
+  ADD_HEADER (p, 1);
+  ADD_HEADER (p, 2);
+  ADD_HEADER (p, 3);
+  CHECK_HISTORY (p, 5, 3, 2, 1, 10, 100);
+  REM_HEADER (p, 3);
+  CHECK_HISTORY (p, 4, 2, 1, 10, 100);
+
+  // only the outermost headers are recorded
+  ADD_HEADER (p, 4);
+  ADD_HEADER (p, 5);
+  ADD_HEADER (p, 6);
+  ADD_HEADER (p, 7);
+  ADD_HEADER (p, 8);
+  CHECK_HISTORY (p, 8, 8, 7, 6, 5, 4, 2, 11, 100);
+
+  // fragments
+  Ptr<Packet> p1 = p->CreateFragment (0, 8 + 7 + 6);
+  CHECK_HISTORY (p1, 3, 8, 7, 6);
+  p1 = p->CreateFragment (8, p->GetSize () - 8 - 50);
+  CHECK_HISTORY (p1, 6, 7, 6, 5, 4, 2, 61);
+  p1 = p->CreateFragment (3, p->GetSize () - 3);
+  CHECK_HISTORY (p1, 2, 40, 100);
+  p1->RemoveAtEnd (1);
+  CHECK_HISTORY (p1, 1, 139);
+
+  // concatenations
+  p1 = Create<Packet> (0);
+  ADD_HEADER (p1, 3);
+  Ptr<Packet> p2 = Create<Packet> (10);
+  ADD_HEADER (p2, 2);
+  p1->AddAtEnd (p2);
+  CHECK_HISTORY (p1, 3, 3, 2, 10);
+  p2 = Create<Packet> (0);
+  ADD_TRAILER (p2, 4);
+  p1->AddAtEnd (p2);
+  CHECK_HISTORY (p1, 4, 3, 2, 10, 4);
+  p1->AddAtEnd (p);
+  CHECK_HISTORY (p1, 4, 3, 2, 57, 100);
+  p1->AddPaddingAtEnd (2);
+  CHECK_HISTORY (p1, 3, 3, 2, 159);
+}
+//-----------------------------------------------------------------------------
 class PacketMetadataTestSuite : public TestSuite
 {
 public:
@@ -832,6 +915,7 @@ PacketMetadataTestSuite::PacketMetadataTestSuite ()
   : TestSuite ("packet-metadata", UNIT)
 {
   AddTestCase (new PacketMetadataTest);
+  AddTestCase (new PacketMetadataCompactTest);
 }
 
 PacketMetadataTestSuite g_packetMetadataTest;
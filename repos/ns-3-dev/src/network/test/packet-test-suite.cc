@@ -19,7 +19,16 @@
  */
 #include "ns3/packet.h"
 #include "ns3/test.h"
+#include "ns3/core-config.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "ns3/nstime.h"
+#if defined (HAVE_THREAD_LOCAL) && defined (HAVE_PTHREAD_H)
+#include "ns3/multithreaded-simulator-impl.h"
+#endif
 #include <string>
+#include <vector>
+#include <algorithm>
 #include <stdarg.h>
 
 namespace ns3 {
@@ -420,6 +429,78 @@ PacketTest::DoRun (void)
     NS_TEST_EXPECT_MSG_EQ (p.PeekPacketTag (b), false, "trivial");
   }
 
+  {
+    // more packet tags than fit in the inline storage of the list
+    Packet p;
+    p.AddPacketTag (ATestTag<1> ());
+    p.AddPacketTag (ATestTag<2> ());
+    p.AddPacketTag (ATestTag<3> ());
+    p.AddPacketTag (ATestTag<4> ());
+    Packet copy = p;
+    copy.AddPacketTag (ATestTag<5> ());
+    ATestTag<5> e;
+    NS_TEST_EXPECT_MSG_EQ (copy.PeekPacketTag (e), true, "trivial");
+    NS_TEST_EXPECT_MSG_EQ (e.m_error, false, "trivial");
+    NS_TEST_EXPECT_MSG_EQ (p.PeekPacketTag (e), false, "trivial");
+    ATestTag<2> b;
+    NS_TEST_EXPECT_MSG_EQ (copy.RemovePacketTag (b), true, "trivial");
+    NS_TEST_EXPECT_MSG_EQ (b.m_error, false, "trivial");
+    NS_TEST_EXPECT_MSG_EQ (copy.PeekPacketTag (b), false, "trivial");
+    NS_TEST_EXPECT_MSG_EQ (p.PeekPacketTag (b), true, "trivial");
+    ATestTag<4> d;
+    NS_TEST_EXPECT_MSG_EQ (copy.RemovePacketTag (d), true, "trivial");
+    NS_TEST_EXPECT_MSG_EQ (copy.RemovePacketTag (d), false, "trivial");
+    NS_TEST_EXPECT_MSG_EQ (p.PeekPacketTag (d), true, "trivial");
+    // most recently added tags are reported first
+    std::ostringstream oss;
+    copy.PrintPacketTags (oss);
+    NS_TEST_EXPECT_MSG_EQ (oss.str (), "5 3 1", "trivial");
+    oss.str ("");
+    p.PrintPacketTags (oss);
+    NS_TEST_EXPECT_MSG_EQ (oss.str (), "4 3 2 1", "trivial");
+  }
+
+  {
+    // removing a tag from a copy of a list one tag larger than the
+    // inline storage moves the other tags inline
+    Packet p;
+    p.AddPacketTag (ATestTag<1> ());
+    p.AddPacketTag (ATestTag<2> ());
+    p.AddPacketTag (ATestTag<3> ());
+    p.AddPacketTag (ATestTag<4> ());
+    Packet copy = p;
+    ATestTag<2> b;
+    NS_TEST_EXPECT_MSG_EQ (copy.RemovePacketTag (b), true, "trivial");
+    NS_TEST_EXPECT_MSG_EQ (b.m_error, false, "trivial");
+    NS_TEST_EXPECT_MSG_EQ (copy.PeekPacketTag (b), false, "trivial");
+    NS_TEST_EXPECT_MSG_EQ (p.PeekPacketTag (b), true, "trivial");
+    std::ostringstream oss;
+    copy.PrintPacketTags (oss);
+    NS_TEST_EXPECT_MSG_EQ (oss.str (), "4 3 1", "trivial");
+    oss.str ("");
+    p.PrintPacketTags (oss);
+    NS_TEST_EXPECT_MSG_EQ (oss.str (), "4 3 2 1", "trivial");
+    copy.AddPacketTag (ATestTag<5> ());
+    oss.str ("");
+    copy.PrintPacketTags (oss);
+    NS_TEST_EXPECT_MSG_EQ (oss.str (), "5 4 3 1", "trivial");
+  }
+
+  {
+    // more byte tags than fit in the initial block of the list
+    Ptr<Packet> tmp = Create<Packet> (100);
+    tmp->AddByteTag (ATestTag<20> ());
+    tmp->AddByteTag (ATestTag<19> ());
+    Ptr<Packet> copy = tmp->Copy ();
+    tmp->AddByteTag (ATestTag<18> ());
+    CHECK (tmp, 3, E (20, 0, 100), E (19, 0, 100), E (18, 0, 100));
+    CHECK (copy, 2, E (20, 0, 100), E (19, 0, 100));
+    tmp->AddHeader (ATestHeader<10> ());
+    CHECK (tmp, 3, E (20, 10, 110), E (19, 10, 110), E (18, 10, 110));
+    copy->AddAtEnd (tmp);
+    CHECK (copy, 5, E (20, 0, 100), E (19, 0, 100), E (20, 110, 210), E (19, 110, 210), E (18, 110, 210));
+  }
+
   {
     // bug 572
     Ptr<Packet> tmp = Create<Packet> (1000);
@@ -435,6 +516,204 @@ PacketTest::DoRun (void)
 #endif
   }
 }
+
+#if defined (HAVE_THREAD_LOCAL) && defined (HAVE_PTHREAD_H)
+/**
+ * Creates packets from the events of several nodes which run in
+ * different partitions at the same timestamps: the uids must still be
+ * unique.
+ */
+class PacketUidTest : public TestCase
+{
+public:
+  PacketUidTest ();
+  virtual void DoRun (void);
+private:
+  void CreatePackets (uint32_t node, uint32_t left);
+  std::vector<std::vector<uint64_t> > m_uids;
+};
+
+PacketUidTest::PacketUidTest ()
+  : TestCase ("Check that the packet uids are unique with the multithreaded simulator")
+{
+}
+
+void
+PacketUidTest::CreatePackets (uint32_t node, uint32_t left)
+{
+  for (uint32_t i = 0; i < 100; i++)
+    {
+      Ptr<Packet> p = Create<Packet> (10);
+      m_uids[node].push_back (p->GetUid ());
+    }
+  if (left > 0)
+    {
+      Simulator::Schedule (MicroSeconds (1), &PacketUidTest::CreatePackets, this, node, left - 1);
+    }
+}
+
+void
+PacketUidTest::DoRun (void)
+{
+  const uint32_t nodes = 8;
+  Simulator::Destroy ();
+  Ptr<MultithreadedSimulatorImpl> impl = CreateObject<MultithreadedSimulatorImpl> ();
+  impl->SetAttribute ("Partitions", UintegerValue (4));
+  impl->SetAttribute ("LookAhead", TimeValue (Seconds (0)));
+  Simulator::SetImplementation (impl);
+  m_uids.resize (nodes);
+  for (uint32_t i = 0; i < nodes; i++)
+    {
+      Simulator::ScheduleWithContext (i, Seconds (0), &PacketUidTest::CreatePackets, this, i, 50);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  std::vector<uint64_t> all;
+  for (uint32_t i = 0; i < nodes; i++)
+    {
+      all.insert (all.end (), m_uids[i].begin (), m_uids[i].end ());
+    }
+  NS_TEST_EXPECT_MSG_EQ (all.size (), nodes * 51 * 100, "missing packets");
+  std::sort (all.begin (), all.end ());
+  NS_TEST_EXPECT_MSG_EQ ((std::adjacent_find (all.begin (), all.end ()) == all.end ()), true,
+                         "two packets got the same uid");
+}
+
+/**
+ * Each node broadcasts a packet to all the other nodes, which run in
+ * different partitions, at every round. The receivers copy the shared
+ * packet and add headers, trailers and tags to their copy at the same
+ * time, and the sender copies and modifies it again at its next round,
+ * so that the copies race to claim the room around the shared buffers
+ * and tag arrays.
+ */
+class PacketHandoffTest : public TestCase
+{
+public:
+  PacketHandoffTest ();
+  virtual void DoRun (void);
+private:
+  void Send (uint32_t node, uint32_t left);
+  void Receive (uint32_t node, Ptr<const Packet> p);
+  bool CheckCopy (Ptr<const Packet> p);
+
+  static const uint32_t NODES = 8;
+  static const uint32_t PAYLOAD = 100;
+  std::vector<Ptr<const Packet> > m_sent;
+  std::vector<uint32_t> m_received;
+  std::vector<uint32_t> m_errors;
+};
+
+PacketHandoffTest::PacketHandoffTest ()
+  : TestCase ("Check that packets can be shared between the partitions of the multithreaded simulator")
+{
+}
+
+bool
+PacketHandoffTest::CheckCopy (Ptr<const Packet> p)
+{
+  Ptr<Packet> copy = p->Copy ();
+  copy->AddHeader (ATestHeader<8> ());
+  copy->AddTrailer (ATestTrailer<6> ());
+  copy->AddPacketTag (ATestTag<5> ());
+  copy->AddByteTag (ATestTag<6> ());
+
+  bool ok = true;
+  ATestTag<1> tag1;
+  ATestTag<4> tag4;
+  ATestTag<5> tag5;
+  ok = ok && copy->PeekPacketTag (tag1) && !tag1.m_error;
+  ok = ok && copy->PeekPacketTag (tag4) && !tag4.m_error;
+  ok = ok && copy->PeekPacketTag (tag5) && !tag5.m_error;
+  uint32_t byteTags = 0;
+  ByteTagIterator i = copy->GetByteTagIterator ();
+  while (i.HasNext ())
+    {
+      i.Next ();
+      byteTags++;
+    }
+  ok = ok && byteTags == 2;
+  ATestHeader<8> h8;
+  ATestHeader<10> h10;
+  ATestTrailer<6> t6;
+  ATestTrailer<4> t4;
+  copy->RemoveHeader (h8);
+  copy->RemoveHeader (h10);
+  copy->RemoveTrailer (t6);
+  copy->RemoveTrailer (t4);
+  ok = ok && !h8.m_error && !h10.m_error && !t6.m_error && !t4.m_error;
+  return ok && copy->GetSize () == PAYLOAD;
+}
+
+void
+PacketHandoffTest::Send (uint32_t node, uint32_t left)
+{
+  if (m_sent[node] != 0 && !CheckCopy (m_sent[node]))
+    {
+      m_errors[node]++;
+    }
+  Ptr<Packet> p = Create<Packet> (PAYLOAD);
+  p->AddHeader (ATestHeader<10> ());
+  p->AddTrailer (ATestTrailer<4> ());
+  // more tags than the list holds inline, to share a tag array
+  p->AddPacketTag (ATestTag<1> ());
+  p->AddPacketTag (ATestTag<2> ());
+  p->AddPacketTag (ATestTag<3> ());
+  p->AddPacketTag (ATestTag<4> ());
+  p->AddByteTag (ATestTag<7> ());
+  m_sent[node] = p;
+  for (uint32_t i = 0; i < NODES; i++)
+    {
+      if (i != node)
+        {
+          Simulator::ScheduleWithContext (i, MicroSeconds (1), &PacketHandoffTest::Receive, this, i,
+                                          Ptr<const Packet> (p));
+        }
+    }
+  if (left > 0)
+    {
+      Simulator::Schedule (MicroSeconds (1), &PacketHandoffTest::Send, this, node, left - 1);
+    }
+}
+
+void
+PacketHandoffTest::Receive (uint32_t node, Ptr<const Packet> p)
+{
+  m_received[node]++;
+  if (!CheckCopy (p))
+    {
+      m_errors[node]++;
+    }
+}
+
+void
+PacketHandoffTest::DoRun (void)
+{
+  Simulator::Destroy ();
+  Ptr<MultithreadedSimulatorImpl> impl = CreateObject<MultithreadedSimulatorImpl> ();
+  impl->SetAttribute ("Partitions", UintegerValue (4));
+  impl->SetAttribute ("LookAhead", TimeValue (MicroSeconds (1)));
+  Simulator::SetImplementation (impl);
+  m_sent.assign (NODES, 0);
+  m_received.assign (NODES, 0);
+  m_errors.assign (NODES, 0);
+  for (uint32_t i = 0; i < NODES; i++)
+    {
+      Simulator::ScheduleWithContext (i, Seconds (0), &PacketHandoffTest::Send, this, i, 200);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+  m_sent.clear ();
+
+  for (uint32_t i = 0; i < NODES; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_received[i], (NODES - 1) * 201, "missing packets at node " << i);
+      NS_TEST_EXPECT_MSG_EQ (m_errors[i], 0, "corrupted copies at node " << i);
+    }
+}
+#endif
+
 //-----------------------------------------------------------------------------
 class PacketTestSuite : public TestSuite
 {
@@ -446,6 +725,10 @@ PacketTestSuite::PacketTestSuite ()
   : TestSuite ("packet", UNIT)
 {
   AddTestCase (new PacketTest);
+#if defined (HAVE_THREAD_LOCAL) && defined (HAVE_PTHREAD_H)
+  AddTestCase (new PacketUidTest);
+  AddTestCase (new PacketHandoffTest);
+#endif
 }
 
 static PacketTestSuite g_packetTestSuite;
@@ -0,0 +1,666 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "binary-trace-writer.h"
+#include "sgi-hashmap.h"
+#include "ns3/packet.h"
+#include "ns3/packet-metadata.h"
+#include "ns3/simulator.h"
+#include "ns3/nstime.h"
+#include "ns3/core-config.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include <algorithm>
+#include <string.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+NS_LOG_COMPONENT_DEFINE ("BinaryTraceWriter");
+
+namespace ns3 {
+
+// a block is written once its columns hold that many bytes
+#define BLOCK_SIZE (64 * 1024)
+#define FILE_HEADER_SIZE 16
+#define BLOCK_HEADER_SIZE 20
+#define FILE_VERSION 1
+// more threads than that is a corrupted file
+#define MAX_STREAMS 65536
+// the number of bytes of the column sizes at the start of a block
+#define COLUMN_HEADER_SIZE (4 * BinaryTraceWriter::Block::COLUMNS)
+
+static const uint8_t g_magic[8] = { 'N', 'S', '3', 'B', 'T', 'R', 'A', 'C' };
+
+struct StringHash
+{
+  size_t operator () (std::string const &s) const
+  {
+    // FNV-1a
+    uint32_t hash = 2166136261U;
+    for (std::string::size_type i = 0; i < s.size (); i++)
+      {
+        hash ^= (uint8_t)s[i];
+        hash *= 16777619U;
+      }
+    return hash;
+  }
+};
+
+struct BinaryTraceWriter::Block
+{
+  enum Column
+  {
+    // the id, length and characters of the new context strings
+    STRINGS,
+    // the event character of each record
+    EVENTS,
+    // the delta of the time step of each record
+    TIMES,
+    // the context string id of each record
+    CONTEXTS,
+    // the length and bytes of the packet or text of each record
+    DATA,
+    COLUMNS
+  };
+  typedef sgi::hash_map<std::string, uint32_t, StringHash> Strings;
+
+  uint32_t stream;
+  uint32_t records;
+  int64_t lastTime;
+  Strings strings;
+  std::vector<uint8_t> columns[COLUMNS];
+  std::vector<uint32_t> packet;
+  std::vector<uint8_t> raw;
+  std::vector<uint8_t> compressed;
+#ifdef HAVE_PTHREAD_H
+  pthread_t thread;
+#endif
+};
+
+struct BinaryTraceWriter::Mutex
+{
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_t mutex;
+#endif
+  void Lock (void)
+  {
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock (&mutex);
+#endif
+  }
+  void Unlock (void)
+  {
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock (&mutex);
+#endif
+  }
+};
+
+#if defined (HAVE_THREAD_LOCAL) && defined (HAVE_PTHREAD_H)
+// the writer the calling thread wrote to last, and its block
+static __thread uint32_t g_lastWriter;
+static __thread BinaryTraceWriter::Block *g_lastBlock;
+#endif
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t g_idMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+static uint32_t g_nextId = 1;
+
+static void
+WriteU32 (uint8_t *buffer, uint32_t v)
+{
+  buffer[0] = v & 0xff;
+  buffer[1] = (v >> 8) & 0xff;
+  buffer[2] = (v >> 16) & 0xff;
+  buffer[3] = (v >> 24) & 0xff;
+}
+
+static uint32_t
+ReadU32 (uint8_t const *buffer)
+{
+  return buffer[0] | (buffer[1] << 8) | (buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+}
+
+static void
+AppendVarint (std::vector<uint8_t> &column, uint64_t v)
+{
+  while (v >= 0x80)
+    {
+      column.push_back ((v & 0x7f) | 0x80);
+      v >>= 7;
+    }
+  column.push_back (v);
+}
+
+static bool
+ReadVarint (uint8_t const **current, uint8_t const *end, uint64_t *v)
+{
+  *v = 0;
+  for (uint32_t shift = 0; shift < 64; shift += 7)
+    {
+      if (*current == end)
+        {
+          return false;
+        }
+      uint8_t byte = **current;
+      (*current)++;
+      *v |= (uint64_t)(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0)
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+BinaryTraceWriter::BinaryTraceWriter (std::string filename, std::ios::openmode filemode,
+                                      enum Compression compression)
+  : m_compression (IsSupported (compression) ? compression : NONE),
+    m_mutex (new Mutex)
+{
+  NS_LOG_FUNCTION (this << filename << filemode << compression);
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_init (&m_mutex->mutex, 0);
+  pthread_mutex_lock (&g_idMutex);
+#endif
+  m_id = g_nextId++;
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_unlock (&g_idMutex);
+#endif
+  m_file.open (filename.c_str (), filemode | std::ios::binary);
+  NS_ABORT_MSG_UNLESS (m_file.is_open (), "BinaryTraceWriter::BinaryTraceWriter():  " <<
+                       "Unable to Open " << filename << " for mode " << filemode);
+  uint8_t header[FILE_HEADER_SIZE];
+  memset (header, 0, FILE_HEADER_SIZE);
+  memcpy (header, g_magic, 8);
+  WriteU32 (header + 8, FILE_VERSION);
+  header[12] = Time::GetResolution ();
+  m_file.write ((char const *)header, FILE_HEADER_SIZE);
+}
+
+BinaryTraceWriter::~BinaryTraceWriter ()
+{
+  NS_LOG_FUNCTION (this);
+  Flush ();
+  for (std::vector<struct Block *>::iterator i = m_blocks.begin (); i != m_blocks.end (); i++)
+    {
+      delete *i;
+    }
+  m_blocks.clear ();
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_destroy (&m_mutex->mutex);
+#endif
+  delete m_mutex;
+  m_mutex = 0;
+}
+
+bool
+BinaryTraceWriter::IsSupported (enum Compression compression)
+{
+  switch (compression)
+    {
+    case NONE:
+      return true;
+    case ZLIB:
+#ifdef HAVE_ZLIB
+      return true;
+#else
+      return false;
+#endif
+    }
+  return false;
+}
+
+struct BinaryTraceWriter::Block *
+BinaryTraceWriter::GetBlock (void)
+{
+#if defined (HAVE_THREAD_LOCAL) && defined (HAVE_PTHREAD_H)
+  if (g_lastWriter == m_id)
+    {
+      return g_lastBlock;
+    }
+  struct Block *block = 0;
+  pthread_t self = pthread_self ();
+  m_mutex->Lock ();
+  for (std::vector<struct Block *>::const_iterator i = m_blocks.begin (); i != m_blocks.end (); i++)
+    {
+      if (pthread_equal ((*i)->thread, self))
+        {
+          block = *i;
+          break;
+        }
+    }
+  if (block == 0)
+    {
+      block = new Block ();
+      block->stream = m_blocks.size ();
+      block->records = 0;
+      block->lastTime = 0;
+      block->thread = self;
+      m_blocks.push_back (block);
+    }
+  m_mutex->Unlock ();
+  g_lastWriter = m_id;
+  g_lastBlock = block;
+  return block;
+#else
+  if (m_blocks.empty ())
+    {
+      struct Block *block = new Block ();
+      block->stream = 0;
+      block->records = 0;
+      block->lastTime = 0;
+      m_blocks.push_back (block);
+    }
+  return m_blocks[0];
+#endif
+}
+
+void
+BinaryTraceWriter::AddRecord (struct Block *block, uint8_t event, uint32_t context)
+{
+  int64_t now = Simulator::Now ().GetTimeStep ();
+  int64_t delta = now - block->lastTime;
+  block->lastTime = now;
+  block->columns[Block::EVENTS].push_back (event);
+  // zigzag encoding keeps small negative deltas small
+  AppendVarint (block->columns[Block::TIMES], ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+  AppendVarint (block->columns[Block::CONTEXTS], context);
+  block->records++;
+}
+
+void
+BinaryTraceWriter::AddData (struct Block *block, uint8_t const *data, uint32_t size)
+{
+  std::vector<uint8_t> &column = block->columns[Block::DATA];
+  AppendVarint (column, size);
+  column.insert (column.end (), data, data + size);
+  uint32_t total = 0;
+  for (uint32_t i = 0; i < Block::COLUMNS; i++)
+    {
+      total += block->columns[i].size ();
+    }
+  if (total >= BLOCK_SIZE)
+    {
+      WriteBlock (block);
+    }
+}
+
+void
+BinaryTraceWriter::AddPacket (struct Block *block, Ptr<const Packet> p)
+{
+  uint32_t size = p->GetSerializedSize ();
+  block->packet.resize ((size + 3) / 4);
+  uint8_t *buffer = (uint8_t *)&block->packet[0];
+  uint32_t ok = p->Serialize (buffer, size);
+  NS_ASSERT (ok);
+  AddData (block, buffer, size);
+}
+
+void
+BinaryTraceWriter::WritePacket (char event, Ptr<const Packet> p)
+{
+  NS_LOG_FUNCTION (this << event << p);
+  NS_ASSERT (event != 0);
+  struct Block *block = GetBlock ();
+  AddRecord (block, event, 0);
+  AddPacket (block, p);
+}
+
+void
+BinaryTraceWriter::WritePacket (char event, std::string const &context, Ptr<const Packet> p)
+{
+  NS_LOG_FUNCTION (this << event << context << p);
+  NS_ASSERT (event != 0);
+  struct Block *block = GetBlock ();
+  uint32_t id;
+  Block::Strings::const_iterator i = block->strings.find (context);
+  if (i == block->strings.end ())
+    {
+      // the ids start at 1: 0 means that the record has no context
+      id = block->strings.size () + 1;
+      block->strings[context] = id;
+      std::vector<uint8_t> &column = block->columns[Block::STRINGS];
+      AppendVarint (column, id);
+      AppendVarint (column, context.size ());
+      column.insert (column.end (), context.begin (), context.end ());
+    }
+  else
+    {
+      id = i->second;
+    }
+  AddRecord (block, event, id);
+  AddPacket (block, p);
+}
+
+void
+BinaryTraceWriter::WriteText (char const *text, uint32_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+  struct Block *block = GetBlock ();
+  AddRecord (block, 0, 0);
+  AddData (block, (uint8_t const *)text, size);
+}
+
+void
+BinaryTraceWriter::WriteBlock (struct Block *block)
+{
+  NS_LOG_FUNCTION (this << block);
+  if (block->records == 0)
+    {
+      return;
+    }
+  std::vector<uint8_t> &raw = block->raw;
+  raw.resize (COLUMN_HEADER_SIZE);
+  for (uint32_t i = 0; i < Block::COLUMNS; i++)
+    {
+      WriteU32 (&raw[4 * i], block->columns[i].size ());
+    }
+  for (uint32_t i = 0; i < Block::COLUMNS; i++)
+    {
+      raw.insert (raw.end (), block->columns[i].begin (), block->columns[i].end ());
+      block->columns[i].clear ();
+    }
+
+  uint8_t const *stored = &raw[0];
+  uint32_t storedSize = raw.size ();
+  uint8_t compression = NONE;
+#ifdef HAVE_ZLIB
+  if (m_compression == ZLIB)
+    {
+      uLongf size = compressBound (raw.size ());
+      block->compressed.resize (size);
+      if (compress2 (&block->compressed[0], &size, &raw[0], raw.size (), Z_BEST_SPEED) == Z_OK
+          && size < raw.size ())
+        {
+          stored = &block->compressed[0];
+          storedSize = size;
+          compression = ZLIB;
+        }
+    }
+#endif
+
+  uint8_t header[BLOCK_HEADER_SIZE];
+  memset (header, 0, BLOCK_HEADER_SIZE);
+  WriteU32 (header, block->stream);
+  WriteU32 (header + 4, block->records);
+  WriteU32 (header + 8, raw.size ());
+  WriteU32 (header + 12, storedSize);
+  header[16] = compression;
+  // the reader needs the packet metadata to deserialize the packets
+  header[17] = PacketMetadata::IsCompact () ? 2 : (PacketMetadata::IsEnabled () ? 1 : 0);
+  block->records = 0;
+  block->lastTime = 0;
+
+  m_mutex->Lock ();
+  m_file.write ((char const *)header, BLOCK_HEADER_SIZE);
+  m_file.write ((char const *)stored, storedSize);
+  m_mutex->Unlock ();
+}
+
+void
+BinaryTraceWriter::Flush (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_mutex->Lock ();
+  std::vector<struct Block *> blocks = m_blocks;
+  m_mutex->Unlock ();
+  for (std::vector<struct Block *>::const_iterator i = blocks.begin (); i != blocks.end (); i++)
+    {
+      WriteBlock (*i);
+    }
+  m_mutex->Lock ();
+  m_file.flush ();
+  m_mutex->Unlock ();
+}
+
+BinaryTraceReader::BinaryTraceReader (std::string filename)
+  : m_metadata (0)
+{
+  NS_LOG_FUNCTION (this << filename);
+  m_file.open (filename.c_str (), std::ios::in | std::ios::binary);
+}
+
+bool
+BinaryTraceReader::ConvertToAscii (std::ostream &os)
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_file.is_open ())
+    {
+      return false;
+    }
+  // a packet can only be deserialized with the packet metadata it
+  // was serialized with: find it before converting any block.
+  m_metadata = 0;
+  if (!Read (0) || !EnableMetadata ())
+    {
+      return false;
+    }
+  m_file.clear ();
+  m_file.seekg (0, std::ios::beg);
+  return Read (&os);
+}
+
+bool
+BinaryTraceReader::EnableMetadata (void)
+{
+  NS_LOG_FUNCTION (this);
+  switch (m_metadata)
+    {
+    case 0:
+      return !PacketMetadata::IsEnabled ();
+    case 1:
+      if (PacketMetadata::IsCompact ())
+        {
+          return false;
+        }
+      Packet::EnablePrinting ();
+      return true;
+    case 2:
+      if (PacketMetadata::IsEnabled () && !PacketMetadata::IsCompact ())
+        {
+          return false;
+        }
+      Packet::EnableCompactPrinting ();
+      return true;
+    }
+  return false;
+}
+
+bool
+BinaryTraceReader::Read (std::ostream *os)
+{
+  NS_LOG_FUNCTION (this << os);
+  // the context strings of each thread of the current trace
+  std::vector<std::vector<std::string> > streams;
+  std::vector<uint8_t> stored;
+  std::vector<uint8_t> raw;
+  bool hasHeader = false;
+  while (true)
+    {
+      uint8_t header[BLOCK_HEADER_SIZE];
+      m_file.read ((char *)header, 4);
+      if (m_file.gcount () == 0 && m_file.eof ())
+        {
+          return hasHeader;
+        }
+      if (m_file.gcount () != 4)
+        {
+          return false;
+        }
+      if (memcmp (header, g_magic, 4) == 0)
+        {
+          // the header of the file, or of a trace appended to it
+          m_file.read ((char *)header + 4, FILE_HEADER_SIZE - 4);
+          if (m_file.gcount () != FILE_HEADER_SIZE - 4
+              || memcmp (header, g_magic, 8) != 0
+              || ReadU32 (header + 8) != FILE_VERSION
+              || header[12] >= Time::LAST)
+            {
+              return false;
+            }
+          if (os != 0 && Time::GetResolution () != header[12])
+            {
+              Time::SetResolution ((enum Time::Unit)header[12]);
+            }
+          streams.clear ();
+          hasHeader = true;
+          continue;
+        }
+      m_file.read ((char *)header + 4, BLOCK_HEADER_SIZE - 4);
+      if (!hasHeader || m_file.gcount () != BLOCK_HEADER_SIZE - 4)
+        {
+          return false;
+        }
+      uint32_t stream = ReadU32 (header);
+      uint32_t records = ReadU32 (header + 4);
+      uint32_t rawSize = ReadU32 (header + 8);
+      uint32_t storedSize = ReadU32 (header + 12);
+      uint8_t compression = header[16];
+      uint8_t metadata = header[17];
+      if (!BinaryTraceWriter::IsSupported ((enum BinaryTraceWriter::Compression)compression)
+          || metadata > 2 || stream >= MAX_STREAMS)
+        {
+          return false;
+        }
+      if (os == 0)
+        {
+          m_metadata = std::max (m_metadata, metadata);
+          m_file.seekg (storedSize, std::ios::cur);
+          continue;
+        }
+      stored.resize (storedSize);
+      m_file.read ((char *)&stored[0], storedSize);
+      if ((uint32_t)m_file.gcount () != storedSize)
+        {
+          return false;
+        }
+      uint8_t const *data = &stored[0];
+#ifdef HAVE_ZLIB
+      if (compression == BinaryTraceWriter::ZLIB)
+        {
+          raw.resize (rawSize);
+          uLongf size = rawSize;
+          if (uncompress (&raw[0], &size, &stored[0], storedSize) != Z_OK || size != rawSize)
+            {
+              return false;
+            }
+          data = &raw[0];
+        }
+#endif
+      if (compression == BinaryTraceWriter::NONE && rawSize != storedSize)
+        {
+          return false;
+        }
+      if (stream >= streams.size ())
+        {
+          streams.resize (stream + 1);
+        }
+      if (!ConvertBlock (*os, data, rawSize, records, streams[stream]))
+        {
+          return false;
+        }
+    }
+}
+
+bool
+BinaryTraceReader::ConvertBlock (std::ostream &os, uint8_t const *data, uint32_t size,
+                                 uint32_t records, std::vector<std::string> &strings)
+{
+  NS_LOG_FUNCTION (this << size << records);
+  if (size < COLUMN_HEADER_SIZE)
+    {
+      return false;
+    }
+  uint8_t const *columns[BinaryTraceWriter::Block::COLUMNS + 1];
+  columns[0] = data + COLUMN_HEADER_SIZE;
+  for (uint32_t i = 0; i < BinaryTraceWriter::Block::COLUMNS; i++)
+    {
+      uint32_t columnSize = ReadU32 (data + 4 * i);
+      if (columnSize > (uint32_t)(data + size - columns[i]))
+        {
+          return false;
+        }
+      columns[i + 1] = columns[i] + columnSize;
+    }
+  if (columns[BinaryTraceWriter::Block::COLUMNS] != data + size
+      || columns[BinaryTraceWriter::Block::EVENTS + 1] - columns[BinaryTraceWriter::Block::EVENTS] != records)
+    {
+      return false;
+    }
+
+  uint8_t const *current = columns[BinaryTraceWriter::Block::STRINGS];
+  uint8_t const *end = columns[BinaryTraceWriter::Block::STRINGS + 1];
+  while (current != end)
+    {
+      uint64_t id;
+      uint64_t length;
+      if (!ReadVarint (&current, end, &id) || !ReadVarint (&current, end, &length)
+          || id != strings.size () + 1 || length > (uint64_t)(end - current))
+        {
+          return false;
+        }
+      strings.push_back (std::string ((char const *)current, length));
+      current += length;
+    }
+
+  uint8_t const *events = columns[BinaryTraceWriter::Block::EVENTS];
+  uint8_t const *times = columns[BinaryTraceWriter::Block::TIMES];
+  uint8_t const *contexts = columns[BinaryTraceWriter::Block::CONTEXTS];
+  uint8_t const *bytes = columns[BinaryTraceWriter::Block::DATA];
+  std::vector<uint32_t> packet;
+  int64_t time = 0;
+  for (uint32_t i = 0; i < records; i++)
+    {
+      uint64_t delta;
+      uint64_t context;
+      uint64_t length;
+      if (!ReadVarint (&times, columns[BinaryTraceWriter::Block::TIMES + 1], &delta)
+          || !ReadVarint (&contexts, columns[BinaryTraceWriter::Block::CONTEXTS + 1], &context)
+          || !ReadVarint (&bytes, columns[BinaryTraceWriter::Block::DATA + 1], &length)
+          || context > strings.size () || (events[i] != 0 && length == 0)
+          || length > (uint64_t)(columns[BinaryTraceWriter::Block::DATA + 1] - bytes))
+        {
+          return false;
+        }
+      time += (int64_t)(delta >> 1) ^ -(int64_t)(delta & 1);
+      char event = events[i];
+      if (event == 0)
+        {
+          os.write ((char const *)bytes, length);
+        }
+      else
+        {
+          // Packet::Deserialize reads 32 bit words
+          packet.resize ((length + 3) / 4);
+          memcpy (&packet[0], bytes, length);
+          Ptr<Packet> p = Create<Packet> ((uint8_t const *)&packet[0], length, true);
+          os << event << " " << TimeStep (time).GetSeconds () << " ";
+          if (context != 0)
+            {
+              os << strings[context - 1] << " ";
+            }
+          os << *p << "\n";
+        }
+      bytes += length;
+    }
+  return true;
+}
+
+} // namespace ns3
@@ -0,0 +1,181 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef BINARY_TRACE_WRITER_H
+#define BINARY_TRACE_WRITER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include "ns3/ptr.h"
+#include "ns3/simple-ref-count.h"
+
+namespace ns3 {
+
+class Packet;
+
+/**
+ * \ingroup packet
+ *
+ * \brief write the events of an ascii trace in a compact binary format
+ *
+ * Instead of formatting each event with an std::ostream, this class
+ * appends the event character, the time step, the context and the
+ * serialized packet of each event to a buffer of the calling thread.
+ * BinaryTraceReader converts the file back to the ascii format of
+ * the AsciiTraceHelper sinks.
+ *
+ * The file starts with a header (magic, version, time resolution)
+ * followed by blocks. Each block holds the records of one thread,
+ * split in columns: the context strings seen for the first time by
+ * this thread, one event character per record, the delta of the time
+ * step since the previous record, the id of the context of each
+ * record (0 without context) and the length-prefixed serialized
+ * packets. A record with a zero event character holds instead text
+ * written to the stream of an OutputStreamWrapper by a custom sink.
+ * Integers are stored as varints and blocks can be compressed.
+ *
+ * Each thread fills its own block without any lock; a full block is
+ * compressed by its thread and written to the file under a lock. Flush
+ * and the destructor write the blocks of all the threads, so they must
+ * not be called while other threads write to the same file.
+ */
+class BinaryTraceWriter : public SimpleRefCount<BinaryTraceWriter>
+{
+public:
+  /**
+   * \brief the compression applied to the blocks
+   */
+  enum Compression
+  {
+    NONE = 0,
+    ZLIB = 1
+  };
+
+  /**
+   * \param filename the name of the file to write
+   * \param filemode std::ios::out to truncate the file or std::ios::app
+   *        to append a new trace to it.
+   * \param compression the compression of the blocks. If it is not
+   *        supported by this build, the blocks are not compressed.
+   */
+  BinaryTraceWriter (std::string filename, std::ios::openmode filemode = std::ios::out,
+                     enum Compression compression = NONE);
+  ~BinaryTraceWriter ();
+
+  /**
+   * \param compression a compression
+   * \returns true if this build can compress and decompress the
+   *          blocks with this compression.
+   */
+  static bool IsSupported (enum Compression compression);
+
+  /**
+   * \param event the character which identifies the event ('+', 'r', ...)
+   * \param p the packet
+   *
+   * Record an event without context at the current simulation time.
+   */
+  void WritePacket (char event, Ptr<const Packet> p);
+  /**
+   * \param event the character which identifies the event ('+', 'r', ...)
+   * \param context the trace context
+   * \param p the packet
+   *
+   * Record an event with context at the current simulation time.
+   */
+  void WritePacket (char event, std::string const &context, Ptr<const Packet> p);
+  /**
+   * \param text the characters to record
+   * \param size the number of characters
+   *
+   * Record text which is copied as-is by the conversion to ascii.
+   */
+  void WriteText (char const *text, uint32_t size);
+  /**
+   * Write the pending records of all the threads to the file.
+   */
+  void Flush (void);
+
+  /**
+   * \internal
+   * \brief the pending records of a thread
+   */
+  struct Block;
+private:
+  BinaryTraceWriter (const BinaryTraceWriter &o);
+  BinaryTraceWriter &operator = (const BinaryTraceWriter &o);
+
+  struct Mutex;
+
+  struct Block *GetBlock (void);
+  void AddRecord (struct Block *block, uint8_t event, uint32_t context);
+  void AddData (struct Block *block, uint8_t const *data, uint32_t size);
+  void AddPacket (struct Block *block, Ptr<const Packet> p);
+  void WriteBlock (struct Block *block);
+
+  std::ofstream m_file;
+  enum Compression m_compression;
+  // distinguishes this writer from the ones the threads wrote to before
+  uint32_t m_id;
+  // one block per thread which wrote to this file
+  std::vector<struct Block *> m_blocks;
+  // protects m_file and m_blocks
+  struct Mutex *m_mutex;
+};
+
+/**
+ * \ingroup packet
+ *
+ * \brief convert a file written by BinaryTraceWriter to ascii
+ *
+ * The packets are printed with the packet metadata the trace was
+ * written with, which this class enables: the conversion must thus
+ * happen in a program which did not create packets with another
+ * packet metadata, and which knows all the headers and trailers of
+ * the traced packets, like utils/convert-binary-trace.
+ */
+class BinaryTraceReader
+{
+public:
+  /**
+   * \param filename the name of the file to read
+   */
+  BinaryTraceReader (std::string filename);
+
+  /**
+   * \param os the output stream
+   * \returns false if the file is not a valid binary trace.
+   *
+   * Write each record of the file to os, in the format of the
+   * AsciiTraceHelper sinks.
+   */
+  bool ConvertToAscii (std::ostream &os);
+
+private:
+  bool EnableMetadata (void);
+  bool Read (std::ostream *os);
+  bool ConvertBlock (std::ostream &os, uint8_t const *data, uint32_t size,
+                     uint32_t records, std::vector<std::string> &strings);
+
+  std::ifstream m_file;
+  // the packet metadata of the trace: 0 none, 1 full, 2 compact
+  uint8_t m_metadata;
+};
+
+} // namespace ns3
+
+#endif /* BINARY_TRACE_WRITER_H */
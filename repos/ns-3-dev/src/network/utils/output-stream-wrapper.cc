@@ -21,13 +21,83 @@
 #include "ns3/fatal-impl.h"
 #include "ns3/abort.h"
 #include <fstream>
+#include <string.h>
 
 NS_LOG_COMPONENT_DEFINE ("OutputStreamWrapper");
 
 namespace ns3 {
 
+/**
+ * \brief record the text written to an ostream in a BinaryTraceWriter
+ *
+ * The text is recorded at the end of each line, so that it keeps its
+ * place among the packet events.
+ */
+class BinaryTraceTextBuffer : public std::streambuf
+{
+public:
+  BinaryTraceTextBuffer (Ptr<BinaryTraceWriter> writer);
+private:
+  virtual int overflow (int c);
+  virtual std::streamsize xsputn (const char *s, std::streamsize n);
+  virtual int sync (void);
+  void Write (void);
+
+  Ptr<BinaryTraceWriter> m_writer;
+  std::string m_text;
+};
+
+BinaryTraceTextBuffer::BinaryTraceTextBuffer (Ptr<BinaryTraceWriter> writer)
+  : m_writer (writer)
+{
+}
+
+int
+BinaryTraceTextBuffer::overflow (int c)
+{
+  if (c != traits_type::eof ())
+    {
+      m_text.push_back (c);
+      if (c == '\n')
+        {
+          Write ();
+        }
+    }
+  return traits_type::not_eof (c);
+}
+
+std::streamsize
+BinaryTraceTextBuffer::xsputn (const char *s, std::streamsize n)
+{
+  m_text.append (s, n);
+  if (memchr (s, '\n', n) != 0)
+    {
+      Write ();
+    }
+  return n;
+}
+
+int
+BinaryTraceTextBuffer::sync (void)
+{
+  Write ();
+  return 0;
+}
+
+void
+BinaryTraceTextBuffer::Write (void)
+{
+  if (!m_text.empty ())
+    {
+      m_writer->WriteText (m_text.data (), m_text.size ());
+      m_text.clear ();
+    }
+}
+
+
 OutputStreamWrapper::OutputStreamWrapper (std::string filename, std::ios::openmode filemode)
-  : m_destroyable (true)
+  : m_destroyable (true),
+    m_textBuffer (0)
 {
   std::ofstream* os = new std::ofstream ();
   os->open (filename.c_str (), filemode);
@@ -38,17 +108,33 @@ OutputStreamWrapper::OutputStreamWrapper (std::string filename, std::ios::openmo
 }
 
 OutputStreamWrapper::OutputStreamWrapper (std::ostream* os)
-  : m_ostream (os), m_destroyable (false)
+  : m_ostream (os), m_destroyable (false), m_textBuffer (0)
 {
   FatalImpl::RegisterStream (m_ostream);
   NS_ABORT_MSG_UNLESS (m_ostream->good (), "Output stream is not vaild for writing.");
 }
 
+OutputStreamWrapper::OutputStreamWrapper (Ptr<BinaryTraceWriter> writer)
+  : m_destroyable (true),
+    m_writer (writer),
+    m_textBuffer (new BinaryTraceTextBuffer (writer))
+{
+  m_ostream = new std::ostream (m_textBuffer);
+  FatalImpl::RegisterStream (m_ostream);
+}
+
 OutputStreamWrapper::~OutputStreamWrapper ()
 {
   FatalImpl::UnregisterStream (m_ostream);
+  if (m_textBuffer != 0)
+    {
+      // record the end of an unfinished line
+      m_ostream->flush ();
+    }
   if (m_destroyable) delete m_ostream;
   m_ostream = 0;
+  delete m_textBuffer;
+  m_textBuffer = 0;
 }
 
 std::ostream *
@@ -57,4 +143,10 @@ OutputStreamWrapper::GetStream (void)
   return m_ostream;
 }
 
+Ptr<BinaryTraceWriter>
+OutputStreamWrapper::GetBinaryWriter (void) const
+{
+  return m_writer;
+}
+
 } // namespace ns3
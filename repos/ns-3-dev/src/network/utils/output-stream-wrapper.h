@@ -23,6 +23,7 @@
 #include "ns3/object.h"
 #include "ns3/ptr.h"
 #include "ns3/simple-ref-count.h"
+#include "binary-trace-writer.h"
 
 namespace ns3 {
 
@@ -64,6 +65,11 @@ namespace ns3 {
  * \endverbatim
  *
  *
+ * A wrapper can also write to a BinaryTraceWriter: the trace sinks
+ * which know about it record their events with GetBinaryWriter, and
+ * the text written to the stream by the other ones is recorded as-is
+ * one line at a time.
+ *
  * This class uses a basic ns-3 reference counting base class but is not 
  * an ns3::Object with attributes, TypeId, or aggregation.
  */
@@ -72,6 +78,7 @@ class OutputStreamWrapper : public SimpleRefCount<OutputStreamWrapper>
 public:
   OutputStreamWrapper (std::string filename, std::ios::openmode filemode);
   OutputStreamWrapper (std::ostream* os);
+  OutputStreamWrapper (Ptr<BinaryTraceWriter> writer);
   ~OutputStreamWrapper ();
 
   /**
@@ -83,9 +90,18 @@ public:
    */
   std::ostream *GetStream (void);
 
+  /**
+   * \returns the binary writer of this wrapper, or zero if it writes
+   *          to a plain ostream.
+   */
+  Ptr<BinaryTraceWriter> GetBinaryWriter (void) const;
+
 private:
   std::ostream *m_ostream;
   bool m_destroyable;
+  Ptr<BinaryTraceWriter> m_writer;
+  // forwards the text of m_ostream to m_writer
+  std::streambuf *m_textBuffer;
 };
 
 } // namespace ns3
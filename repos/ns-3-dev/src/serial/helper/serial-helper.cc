@@ -36,37 +36,34 @@ namespace ns3 {
 static void AsciiMacTxEventWithContext (Ptr<OutputStreamWrapper> stream, std::string context,
                                         Ptr<const Packet> packet)
 {
-  *stream->GetStream () << "t " << Simulator::Now ().GetSeconds () << " " << context << " "
-                        << *packet << std::endl;
+  AsciiTraceHelper::WritePacket (stream, 't', context, packet);
 }
 
 static void AsciiMacRxOkEventWithContext (Ptr<OutputStreamWrapper> stream, std::string context,
                                           Ptr<const Packet> packet)
 {
-  *stream->GetStream () << "r " << Simulator::Now ().GetSeconds () << " " << context << " "
-                        << *packet << std::endl;
+  AsciiTraceHelper::WritePacket (stream, 'r', context, packet);
 }
 
 static void AsciiMacTxDropEventWithContext (Ptr<OutputStreamWrapper> stream, std::string context,
                                             Ptr<const Packet> packet)
 {
-  *stream->GetStream () << "d " << Simulator::Now ().GetSeconds () << " " << context << " "
-                        << *packet << std::endl;
+  AsciiTraceHelper::WritePacket (stream, 'd', context, packet);
 }
 
 static void AsciiMacTxEventWithoutContext (Ptr<OutputStreamWrapper> stream, Ptr<const Packet> packet)
 {
-  *stream->GetStream () << "t " << Simulator::Now ().GetSeconds () << " " << *packet << std::endl;
+  AsciiTraceHelper::WritePacket (stream, 't', packet);
 }
 
 static void AsciiMacRxOkEventWithoutContext (Ptr<OutputStreamWrapper> stream, Ptr<const Packet> packet)
 {
-  *stream->GetStream () << "r " << Simulator::Now ().GetSeconds () << " " << *packet << std::endl;
+  AsciiTraceHelper::WritePacket (stream, 'r', packet);
 }
 
 static void AsciiMacTxDropEventWithoutContext (Ptr<OutputStreamWrapper> stream, Ptr<const Packet> packet)
 {
-  *stream->GetStream () << "d " << Simulator::Now ().GetSeconds () << " " << *packet << std::endl;
+  AsciiTraceHelper::WritePacket (stream, 'd', packet);
 }
 
 SerialHelper::SerialHelper (uint32_t numNodes, uint32_t numSlots) : m_controller (0),
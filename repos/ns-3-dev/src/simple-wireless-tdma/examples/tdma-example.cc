@@ -52,6 +52,7 @@ public:
   TdmaExample ();
   void CaseRun (bool usingWifi,
                 double txpDistance);
+  void WriteCsvHeader (void);
 
 public:
   uint32_t m_nWifis;
@@ -71,6 +72,7 @@ public:
   uint32_t m_slotTime;
   uint32_t m_gaurdTime;
   uint32_t m_interFrameGap;
+  std::string m_sweepRates;
 
 private:
 
@@ -90,6 +92,7 @@ private:
   Ptr <Socket> SetupPacketReceive (Ipv4Address, Ptr <Node> );
   void CheckThroughput ();
   void InsertIntoTxp (void);
+  bool RunSweep (void);
 
 };
 
@@ -147,15 +150,10 @@ int main (int argc, char **argv)
   cmd.AddValue ("slotTime", "Slot transmission Time [Default(us):1000]", test.m_slotTime);
   cmd.AddValue ("gaurdTime", "Duration to wait between slots [Default(us):0]", test.m_gaurdTime);
   cmd.AddValue ("interFrameGap", "Duration between frames [Default(us):0]", test.m_interFrameGap);
+  cmd.AddValue ("sweepRates", "Comma separated CBR rates to run from a single warm-up up to dataStart [Default:none]", test.m_sweepRates);
   cmd.Parse (argc, argv);
 
-  std::ofstream out (test.m_csvFileName.c_str ());
-  out << "SimulationSecond," <<
-  "ReceiveRate," <<
-  "PacketsReceived," <<
-  "NumberOfSinks," <<
-  std::endl;
-  out.close ();
+  test.WriteCsvHeader ();
 
   SeedManager::SetSeed (12345);
 
@@ -176,6 +174,57 @@ TdmaExample::TdmaExample ()
 {
 }
 
+void
+TdmaExample::WriteCsvHeader (void)
+{
+  std::ofstream out (m_csvFileName.c_str ());
+  out << "SimulationSecond," <<
+  "ReceiveRate," <<
+  "PacketsReceived," <<
+  "NumberOfSinks," <<
+  std::endl;
+  out.close ();
+}
+
+/**
+ * Run the simulation up to dataStart once, then go on with each rate of
+ * m_sweepRates in its own process, from the warmed up routing tables.
+ * Returns true in the process which ran the warm-up, once every rate is
+ * done, and false in the branches, which go on up to totalTime.
+ */
+bool
+TdmaExample::RunSweep (void)
+{
+  std::vector<std::string> rates;
+  std::istringstream list (m_sweepRates);
+  std::string rate;
+  while (std::getline (list, rate, ','))
+    {
+      rates.push_back (rate);
+    }
+  Simulator::Stop (Seconds (m_dataStart));
+  Simulator::Run ();
+  std::cout << "Warm-up done at " << Simulator::Now ().GetSeconds () << " s, running "
+            << rates.size () << " rates\n";
+
+  SimulationFork fork;
+  uint32_t branch = fork.Fork (rates.size ());
+  if (fork.IsParent ())
+    {
+      if (fork.GetFailures () != 0)
+        {
+          std::cout << fork.GetFailures () << " rates failed\n";
+        }
+      return true;
+    }
+  Config::Set ("/NodeList/*/ApplicationList/*/$ns3::OnOffApplication/DataRate",
+               StringValue (rates[branch]));
+  m_csvFileName += "-" + rates[branch];
+  WriteCsvHeader ();
+  std::cout << "Running rate " << rates[branch] << " into " << m_csvFileName << "\n";
+  return false;
+}
+
 void
 TdmaExample::ReceivePacket (Ptr <Socket> socket)
 {
@@ -265,7 +314,13 @@ TdmaExample::CaseRun (bool usingWifi, double txpDistance)
 
   CheckThroughput ();
 
-  Simulator::Stop (Seconds (m_totalTime));
+  if (!m_sweepRates.empty () && RunSweep ())
+    {
+      Simulator::Destroy ();
+      NS_LOG_INFO ("leave");
+      return;
+    }
+  Simulator::Stop (Seconds (m_totalTime) - Simulator::Now ());
   Simulator::Run ();
   Simulator::Destroy ();
   NS_LOG_INFO ("leave");
@@ -37,6 +37,10 @@
 #include "ns3/config.h"
 #include "ns3/simulator.h"
 #include "ns3/names.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <set>
 
 NS_LOG_COMPONENT_DEFINE ("TdmaHelper");
 
@@ -45,55 +49,53 @@ namespace ns3 {
 static void AsciiMacTxEventWithContext (Ptr<OutputStreamWrapper> stream, std::string context,
                                         Ptr<const Packet> packet)
 {
-  *stream->GetStream () << "t " << Simulator::Now ().GetSeconds () << " " << context << " "
-                        << *packet << std::endl;
+  AsciiTraceHelper::WritePacket (stream, 't', context, packet);
 }
 
 static void AsciiMacRxOkEventWithContext (Ptr<OutputStreamWrapper> stream, std::string context,
                                           Ptr<const Packet> packet)
 {
-  *stream->GetStream () << "r " << Simulator::Now ().GetSeconds () << " " << context << " "
-                        << *packet << std::endl;
+  AsciiTraceHelper::WritePacket (stream, 'r', context, packet);
 }
 
 static void AsciiMacTxDropEventWithContext (Ptr<OutputStreamWrapper> stream, std::string context,
                                             Ptr<const Packet> packet)
 {
-  *stream->GetStream () << "d " << Simulator::Now ().GetSeconds () << " " << context << " "
-                        << *packet << std::endl;
+  AsciiTraceHelper::WritePacket (stream, 'd', context, packet);
 }
 
 static void AsciiMacTxEventWithoutContext (Ptr<OutputStreamWrapper> stream, Ptr<const Packet> packet)
 {
-  *stream->GetStream () << "t " << Simulator::Now ().GetSeconds () << " " << *packet << std::endl;
+  AsciiTraceHelper::WritePacket (stream, 't', packet);
 }
 
 static void AsciiMacRxOkEventWithoutContext (Ptr<OutputStreamWrapper> stream, Ptr<const Packet> packet)
 {
-  *stream->GetStream () << "r " << Simulator::Now ().GetSeconds () << " " << *packet << std::endl;
+  AsciiTraceHelper::WritePacket (stream, 'r', packet);
 }
 
 static void AsciiMacTxDropEventWithoutContext (Ptr<OutputStreamWrapper> stream, Ptr<const Packet> packet)
 {
-  *stream->GetStream () << "d " << Simulator::Now ().GetSeconds () << " " << *packet << std::endl;
+  AsciiTraceHelper::WritePacket (stream, 'd', packet);
 }
 
 TdmaHelper::TdmaHelper (uint32_t numNodes, uint32_t numSlots) : m_controller (0),
                                                                 m_controllerHelper (0),
-                                                                m_slotAllotmentArray (0),
                                                                 m_numRows (numNodes),
-                                                                m_numCols (numSlots + 1)
+                                                                m_numCols (numSlots),
+                                                                m_spatialReuse (false)
 {
   NS_LOG_FUNCTION (this << numNodes << numSlots);
   m_mac.SetTypeId ("ns3::TdmaCentralMac");
   m_channel = CreateObject<SimpleWirelessChannel> ();
-  Allocate2D ();
   SetDefaultSlots ();
 }
 
 TdmaHelper::TdmaHelper (std::string filename) : m_controller (0),
                                                 m_controllerHelper (0),
-                                                m_slotAllotmentArray (0),
+                                                m_numRows (0),
+                                                m_numCols (0),
+                                                m_spatialReuse (false),
                                                 m_filename (filename)
 {
   NS_LOG_FUNCTION (this << m_filename);
@@ -102,45 +104,54 @@ TdmaHelper::TdmaHelper (std::string filename) : m_controller (0),
   m_parser = CreateObject<TdmaSlotAssignmentFileParser> (m_filename);
   if (! m_parser->GetParseState()) return;
   m_numRows = m_parser->GetNodeCount ();
-  m_numCols = m_parser->GetTotalSlots () + 1; // +1 for nodeid in first column
-  Allocate2D ();
+  m_numCols = m_parser->GetTotalSlots ();
   SetSlots ();
 }
 
 TdmaHelper::TdmaHelper (int numNodes, int numSlots, ...)
       : m_controller (0),
         m_controllerHelper (0),
-        m_slotAllotmentArray (0),
         m_numRows (numNodes),
-        m_numCols (numSlots + 1)
+        m_numCols (numSlots),
+        m_spatialReuse (false)
 {
   NS_LOG_FUNCTION (this << numNodes << numSlots);
   va_list args;
   va_start (args, numSlots);
   m_mac.SetTypeId ("ns3::TdmaCentralMac");
   m_channel = CreateObject<SimpleWirelessChannel> ();
-  Allocate2D ();
   NS_LOG_DEBUG ("Rows:" << m_numRows << " columns: " << m_numCols);
   for (uint32_t i = 0; i < m_numRows; i++)
     {
-      NS_LOG_DEBUG ("new row");
-      m_slotAllotmentArray[i][0] = va_arg (args, int);
-      for (uint32_t j = 1; j < m_numCols; j++)
+      uint32_t nodeId = va_arg (args, int);
+      uint32_t first = m_numCols;
+      for (uint32_t j = 0; j < m_numCols; j++)
         {
-          NS_LOG_DEBUG ("new column");
-          NS_LOG_DEBUG ("before: value at i: " << i << " j: " << j << " is " << m_slotAllotmentArray[i][j]);
-          m_slotAllotmentArray[i][j] = va_arg (args, int);
-          NS_LOG_DEBUG ("after: value at i: " << i << " j: " << j << " is " << m_slotAllotmentArray[i][j]);
+          int value = va_arg (args, int);
+          NS_ASSERT_MSG (value == 0 || value == 1, "Tdma slots should be assigned with only 0 or 1");
+          if (value == 1 && first == m_numCols)
+            {
+              first = j;
+            }
+          else if (value == 0 && first != m_numCols)
+            {
+              AddSlotRange (nodeId, first, j - 1);
+              first = m_numCols;
+            }
+        }
+      if (first != m_numCols)
+        {
+          AddSlotRange (nodeId, first, m_numCols - 1);
         }
     }
   va_end (args);
-  NS_LOG_DEBUG ("Rows:" << m_numRows << " columns: " << m_numCols << PrintSlotAllotmentArray() );
+  SortSlotRanges ();
+  NS_LOG_DEBUG ("Rows:" << m_numRows << " columns: " << m_numCols << PrintSlotAssignment () );
 }
 
 TdmaHelper::~TdmaHelper ()
 {
   NS_LOG_FUNCTION (this);
-  Deallocate2D ();
 }
 
 void
@@ -156,141 +167,240 @@ TdmaHelper::SetTdmaControllerHelper (const TdmaControllerHelper &controllerHelpe
   delete m_controllerHelper;
   m_controllerHelper = controllerHelper.Copy ();
   m_controller = m_controllerHelper->Create ();
-  m_controller->SetTotalSlotsAllowed (m_numCols - 1);
+  m_controller->SetTotalSlotsAllowed (m_numCols);
 }
 
-void TdmaHelper::Deallocate2D (void)
+void
+TdmaHelper::AddSlotRange (uint32_t nodeId, uint32_t first, uint32_t last)
 {
-  for (uint32_t i = 0; i < m_numRows; i++)
-    {
-      free (m_slotAllotmentArray[i]);
-    }
-  free (m_slotAllotmentArray);
+  TdmaSlotRange range;
+  range.nodeId = nodeId;
+  range.first = first;
+  range.last = last;
+  m_slotRanges.push_back (range);
 }
 
-/**
- * Allocate a 2 dimensional array with the
- * number of rows and columns specified.
- * Initialize it to 0
- */
-void TdmaHelper::Allocate2D (void)
+static bool
+SlotRangeNodeLess (const TdmaSlotRange &a, const TdmaSlotRange &b)
+{
+  return a.nodeId < b.nodeId;
+}
+
+static bool
+SlotRangeFirstLess (const TdmaSlotRange &a, const TdmaSlotRange &b)
+{
+  return a.first < b.first;
+}
+
+void
+TdmaHelper::SortSlotRanges (void)
 {
   NS_LOG_FUNCTION (this);
-  m_slotAllotmentArray = (uint32_t**)malloc (m_numRows * sizeof(int*));
-  for (uint32_t i = 0; i < m_numRows; i++)
+  if (!m_spatialReuse)
     {
-      m_slotAllotmentArray[i] = (uint32_t*)malloc (m_numCols * sizeof(int));
-    }
-  for (uint32_t i = 0; i < m_numRows; i++)
-    {
-      m_slotAllotmentArray[i][0] = i; //put in nodeId
-      for (uint32_t j = 1; j < m_numCols; j++)
+      std::vector<TdmaSlotRange> bySlot = m_slotRanges;
+      std::sort (bySlot.begin (), bySlot.end (), &SlotRangeFirstLess);
+      for (uint32_t i = 1; i < bySlot.size (); i++)
         {
-          m_slotAllotmentArray[i][j] = 0;
+          NS_ASSERT_MSG (bySlot[i].first > bySlot[i - 1].last, "Slot exclusivity is not maintained");
         }
     }
+  std::stable_sort (m_slotRanges.begin (), m_slotRanges.end (), &SlotRangeNodeLess);
 }
 
 /**
- * The number of rows is equal to the number of nodes.
- * The number of columns is one more than the number of slots.
- * If the number of slots exceeds the number of nodes
- * consecutive slots should be used for the same node as
- * much as possible, to give continuous slots for a node.
+ * The number of slots is given to the nodes in ascending order of node
+ * id. If the number of slots exceeds the number of nodes consecutive
+ * slots should be used for the same node as much as possible, to give
+ * continuous slots for a node.
  */
 void
 TdmaHelper::SetDefaultSlots (void)
 {
   NS_LOG_FUNCTION (this);
-  int continuousSlots = (m_numCols - 1) / m_numRows;
+  m_slotRanges.clear ();
+  uint32_t continuousSlots = m_numRows == 0 ? 0 : m_numCols / m_numRows;
   NS_LOG_DEBUG ("continuousSlots:" << continuousSlots
            << " m_numRows:" << m_numRows << " m_numCols:" << m_numCols);
-  for (uint32_t i = 0; i < m_numRows; i++)
+  for (uint32_t i = 0; i < m_numRows && continuousSlots > 0; i++)
     {
-      int tmp = 0;
-      while (tmp < continuousSlots)
-        {
-          tmp++;
-          if (continuousSlots * i + tmp > m_numCols)
-            {
-              break;
-            }
-          m_slotAllotmentArray[i][continuousSlots * i + tmp] = 1;
-        }
+      AddSlotRange (i, continuousSlots * i, continuousSlots * (i + 1) - 1);
     }
-  uint32_t remainingSlots = m_numCols - 1 - (continuousSlots * m_numRows);
+  uint32_t remainingSlots = m_numCols - (continuousSlots * m_numRows);
   NS_LOG_DEBUG ("remainingSlots:" << remainingSlots);
   for (uint32_t i = 0; i < remainingSlots; i++)
     {
-      m_slotAllotmentArray[i][continuousSlots * m_numRows + i + 1] = 1;
+      AddSlotRange (i, continuousSlots * m_numRows + i, continuousSlots * m_numRows + i);
     }
-  NS_LOG_INFO(PrintSlotAllotmentArray ());
+  SortSlotRanges ();
+  NS_LOG_INFO (PrintSlotAssignment ());
 }
 
 /**
- * Update the slot allotment array from the
- * arrays produced by the slot assignment parser.
+ * Take the runs of slots read by the slot assignment parser.
  */
 void
 TdmaHelper::SetSlots (void)
 {
-  NS_LOG_INFO("was " << PrintSlotAllotmentArray ());
-  std::vector<SlotArray> & slotArrays = m_parser->GetSlotArrays ();
-  for (uint32_t i = 0; i < m_numRows; i++)
+  m_slotRanges = m_parser->GetSlotRanges ();
+  SortSlotRanges ();
+  NS_LOG_INFO (PrintSlotAssignment ());
+}
+
+void
+TdmaHelper::AssignTdmaSlots (Ptr<TdmaMac> mac, uint32_t nodeId) const
+{
+  NS_LOG_FUNCTION (this << mac << nodeId);
+  TdmaSlotRange key;
+  key.nodeId = nodeId;
+  std::pair<std::vector<TdmaSlotRange>::const_iterator, std::vector<TdmaSlotRange>::const_iterator> ranges =
+    std::equal_range (m_slotRanges.begin (), m_slotRanges.end (), key, &SlotRangeNodeLess);
+  for (std::vector<TdmaSlotRange>::const_iterator i = ranges.first; i != ranges.second; ++i)
     {
-      m_slotAllotmentArray[i][0] = slotArrays[i][0]; //put in nodeId
-      for (uint32_t j = 1; j < m_numCols; j++)
+      for (uint32_t slot = i->first; slot <= i->last; slot++)
         {
-          m_slotAllotmentArray[i][j] = slotArrays[i][j];
+          m_controller->AddTdmaSlot (slot, mac);
         }
     }
-  NS_LOG_INFO(PrintSlotAllotmentArray ());
 }
 
-void
-TdmaHelper::AssignTdmaSlots (Ptr<TdmaMac> mac, uint32_t nodeId) const
+uint32_t
+TdmaHelper::AssignSpatialReuseSlots (NodeContainer c)
 {
-  NS_LOG_FUNCTION (this << mac << nodeId);
-  for (uint32_t i = 0; i < m_numRows; i++)
+  NS_LOG_FUNCTION (this);
+  double range = m_channel->GetMaxRange ();
+  NS_ASSERT_MSG (range > 0, "Spatial reuse needs a positive MaxRange");
+  uint32_t n = c.GetN ();
+  std::vector<Vector> positions;
+  positions.reserve (n);
+  // bucket the nodes in a grid of range sized cells, so the neighbours of
+  // a node are in the cells around it
+  typedef std::map<std::pair<int64_t, int64_t>, std::vector<uint32_t> > Grid;
+  Grid grid;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      Ptr<MobilityModel> mobility = c.Get (i)->GetObject<MobilityModel> ();
+      NS_ASSERT_MSG (mobility != 0, "Spatial reuse needs a mobility model on node " << c.Get (i)->GetId ());
+      positions.push_back (mobility->GetPosition ());
+      grid[std::make_pair ((int64_t) std::floor (positions[i].x / range),
+                           (int64_t) std::floor (positions[i].y / range))].push_back (i);
+    }
+  std::vector<std::vector<uint32_t> > neighbours (n);
+  for (uint32_t i = 0; i < n; i++)
     {
-      if (m_slotAllotmentArray[i][0] == nodeId)
+      int64_t x = (int64_t) std::floor (positions[i].x / range);
+      int64_t y = (int64_t) std::floor (positions[i].y / range);
+      for (int64_t dx = -1; dx <= 1; dx++)
         {
-          for (uint32_t j = 1; j < m_numCols; j++)
+          for (int64_t dy = -1; dy <= 1; dy++)
             {
-              //validation of the slots
-              NS_ASSERT_MSG (((m_slotAllotmentArray[i][j] == 0) || (m_slotAllotmentArray[i][j] == 1)),
-                             "Tdma slots should be assigned with only 0 or 1");
-              for (uint32_t k = 0; k < m_numRows; k++)
+              Grid::const_iterator cell = grid.find (std::make_pair (x + dx, y + dy));
+              if (cell == grid.end ())
                 {
-                  if (k == i)
-                    {
-                      continue;
-                    }
-                  NS_ASSERT_MSG (!(m_slotAllotmentArray[k][j] == 1 && m_slotAllotmentArray[i][j] == 1),
-                                 "Slot exclusivity is not maintained");
+                  continue;
                 }
-              if (m_slotAllotmentArray[i][j] == 1)
+              for (std::vector<uint32_t>::const_iterator j = cell->second.begin (); j != cell->second.end (); ++j)
                 {
-                  m_controller->AddTdmaSlot (j - 1,mac);
+                  if (*j != i && CalculateDistance (positions[i], positions[*j]) <= range)
+                    {
+                      neighbours[i].push_back (*j);
+                    }
                 }
             }
         }
     }
+  // a node also conflicts with the neighbours of its neighbours, which
+  // it cannot hear but whose frames would collide at the common neighbour
+  std::vector<std::vector<uint32_t> > conflicts (n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      std::vector<uint32_t> &conflict = conflicts[i];
+      conflict = neighbours[i];
+      for (std::vector<uint32_t>::const_iterator j = neighbours[i].begin (); j != neighbours[i].end (); ++j)
+        {
+          conflict.insert (conflict.end (), neighbours[*j].begin (), neighbours[*j].end ());
+        }
+      std::sort (conflict.begin (), conflict.end ());
+      conflict.erase (std::unique (conflict.begin (), conflict.end ()), conflict.end ());
+      conflict.erase (std::remove (conflict.begin (), conflict.end (), i), conflict.end ());
+    }
+  std::vector<uint32_t> colors = ColorConflictGraph (conflicts);
+  uint32_t numSlots = 0;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      numSlots = std::max (numSlots, colors[i] + 1);
+    }
+
+  m_numRows = n;
+  m_numCols = numSlots;
+  m_spatialReuse = true;
+  m_slotRanges.clear ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      AddSlotRange (c.Get (i)->GetId (), colors[i], colors[i]);
+    }
+  SortSlotRanges ();
+  if (m_controller != 0)
+    {
+      m_controller->SetTotalSlotsAllowed (numSlots);
+    }
+  NS_LOG_INFO ("Spatial reuse assigns " << n << " nodes to " << numSlots << " slots");
+  NS_LOG_DEBUG (PrintSlotAssignment ());
+  return numSlots;
+}
+
+std::vector<uint32_t>
+TdmaHelper::ColorConflictGraph (const std::vector<std::vector<uint32_t> > &conflicts)
+{
+  uint32_t n = conflicts.size ();
+  const uint32_t uncolored = std::numeric_limits<uint32_t>::max ();
+  std::vector<uint32_t> colors (n, uncolored);
+  std::vector<std::set<uint32_t> > neighbourColors (n);
+  // uncolored nodes keyed by (saturation, degree, n - 1 - node), so the
+  // last entry is the node to color next, the lowest one among equals
+  typedef std::pair<std::pair<uint32_t, uint32_t>, uint32_t> Key;
+  std::set<Key> queue;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      queue.insert (Key (std::make_pair (0, conflicts[i].size ()), n - 1 - i));
+    }
+  while (!queue.empty ())
+    {
+      std::set<Key>::iterator next = queue.end ();
+      --next;
+      uint32_t node = n - 1 - next->second;
+      queue.erase (next);
+      uint32_t color = 0;
+      for (std::set<uint32_t>::const_iterator c = neighbourColors[node].begin ();
+           c != neighbourColors[node].end () && *c == color; ++c)
+        {
+          color++;
+        }
+      colors[node] = color;
+      for (std::vector<uint32_t>::const_iterator j = conflicts[node].begin (); j != conflicts[node].end (); ++j)
+        {
+          if (colors[*j] != uncolored || neighbourColors[*j].count (color) != 0)
+            {
+              continue;
+            }
+          Key key (std::make_pair (neighbourColors[*j].size (), conflicts[*j].size ()), n - 1 - *j);
+          queue.erase (key);
+          neighbourColors[*j].insert (color);
+          key.first.first++;
+          queue.insert (key);
+        }
+    }
+  return colors;
 }
 
 std::string
-TdmaHelper::PrintSlotAllotmentArray (void) const
+TdmaHelper::PrintSlotAssignment (void) const
 {
   std::stringstream ss;
-  ss << "Slot Allotment Array\n";
-  for (uint32_t i = 0; i < m_numRows; i++)
+  ss << "Slot Assignment\n";
+  for (std::vector<TdmaSlotRange>::const_iterator i = m_slotRanges.begin (); i != m_slotRanges.end (); ++i)
     {
-      ss << m_slotAllotmentArray[i][0] << " : \t";
-      for (uint32_t j = 1; j < m_numCols; j++)
-        {
-          ss << m_slotAllotmentArray[i][j] << ",\t";
-        }
-      ss << "\n";
+      ss << i->nodeId << " : \t" << i->first << "-" << i->last << "\n";
     }
   return ss.str();
 }
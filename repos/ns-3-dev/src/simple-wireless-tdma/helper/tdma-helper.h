@@ -32,6 +32,7 @@
 #define TDMA_HELPER_H
 
 #include <string>
+#include <vector>
 #include <stdarg.h>
 #include "ns3/attribute.h"
 #include "ns3/tdma-mac.h"
@@ -92,6 +93,14 @@ public:
    * 1:0,0,1,0,0
    * 2:0,0,0,1,0
    * 3:0,0,0,0,1
+   * For large frames the same assignment can be given as the number of
+   * slots followed by the slots or ranges of slots of every node, see
+   * ns3::TdmaSlotAssignmentFileParser
+   * slots 5
+   * 0 0-1
+   * 1 2
+   * 2 3
+   * 3 4
    */
   TdmaHelper (std::string fileName);
   /**
@@ -134,6 +143,23 @@ public:
   NetDeviceContainer Install (std::string nodeName) const;
 
   void SetFileName (std::string filename);
+  /**
+   * \brief replace the slot assignment with one where nodes that cannot
+   * interfere with each other share slots
+   *
+   * Two nodes conflict when they are within the MaxRange of the channel of
+   * this helper, or when both are within range of a third node. The
+   * conflict graph of the nodes in the container, built from their current
+   * positions, is colored with DSatur and every color becomes one slot, so
+   * the frame is as long as the largest group of nodes around any one node
+   * instead of the number of nodes. Must be called before Install; set the
+   * range with ns3::SimpleWirelessChannel::MaxRange before creating the
+   * helper.
+   *
+   * \param c the nodes to assign slots to, each needs a mobility model
+   * \returns the number of slots in the frame
+   */
+  uint32_t AssignSpatialReuseSlots (NodeContainer c);
   /**
    * \brief Set the TdmaController for this TdamHelper class
    */
@@ -162,7 +188,7 @@ private:
   /**
    * \brief print the TDMA slot assignment for debugging purposes.
    */
-  std::string PrintSlotAllotmentArray (void) const;
+  std::string PrintSlotAssignment (void) const;
   /**
    * \brief Assigns a single TDMA slot in a frame for each node installed
    * by the TDMA helper.
@@ -177,15 +203,14 @@ private:
    */
   void SetSlots (void);
   /**
-   *  \brief memory allocation of the m_slotAllotmentArray when number of
-   *  nodes and total number of slots occupied by those nodes is specified
-   *  by the user
+   * \brief add a run of slots to the assignment of a node
    */
-  void Allocate2D (void);
+  void AddSlotRange (uint32_t nodeId, uint32_t first, uint32_t last);
   /**
-   * memory deallocation of the m_slotAllotmentArray during object deletion
+   * \brief sort the runs of slots by node, so AssignTdmaSlots can look
+   * up the slots of a node, and check that no slot is given twice
    */
-  void Deallocate2D (void);
+  void SortSlotRanges (void);
   /**
    * \brief Populate the m_slotArray in the TdmaController class with the
    * mac pointers of nodes assigned to those slots
@@ -194,14 +219,26 @@ private:
    * \param nodeId node id assigned to this TDMA slot
    */
   void AssignTdmaSlots (Ptr<TdmaMac> mac, uint32_t nodeId) const;
+  /**
+   * \brief color a graph with the DSatur heuristic
+   *
+   * Repeatedly colors the uncolored node with the most distinct colors
+   * among its neighbours, breaking ties by degree, with the smallest color
+   * none of its neighbours has.
+   *
+   * \param conflicts the neighbours of every node
+   * \returns the color of every node, starting at 0
+   */
+  static std::vector<uint32_t> ColorConflictGraph (const std::vector<std::vector<uint32_t> > &conflicts);
 
   ObjectFactory m_mac;
   Ptr<SimpleWirelessChannel> m_channel;
   Ptr<TdmaController> m_controller;
   const TdmaControllerHelper *m_controllerHelper;
-  uint32_t **m_slotAllotmentArray;
-  uint32_t m_numRows;
-  uint32_t m_numCols;
+  std::vector<TdmaSlotRange> m_slotRanges; //!< runs of slots, sorted by node
+  uint32_t m_numRows; //!< number of nodes
+  uint32_t m_numCols; //!< number of slots per frame
+  bool m_spatialReuse;
   std::string m_filename;
   Ptr<TdmaSlotAssignmentFileParser> m_parser;
 };
@@ -30,6 +30,7 @@
  */
 #include "tdma-slot-assignment-parser.h"
 #include <fstream>
+#include <cstring>
 #include "ns3/log.h"
 #include "ns3/uinteger.h"
 
@@ -39,6 +40,29 @@ NS_LOG_COMPONENT_DEFINE ("TdmaSlotAssignmentFileParser");
 
 NS_OBJECT_ENSURE_REGISTERED (TdmaSlotAssignmentFileParser);
 
+static void
+SkipSpaces (const char *&p)
+{
+  while (*p == ' ' || *p == '\t' || *p == '\r')
+    {
+      p++;
+    }
+}
+
+static uint32_t
+ReadNumber (const char *&p)
+{
+  SkipSpaces (p);
+  NS_ASSERT_MSG (*p >= '0' && *p <= '9', "expected a number in the slot file at \"" << p << "\"");
+  uint32_t value = 0;
+  while (*p >= '0' && *p <= '9')
+    {
+      value = value * 10 + (*p - '0');
+      p++;
+    }
+  return value;
+}
+
 TypeId TdmaSlotAssignmentFileParser::GetTypeId (void)
 {
   static TypeId tid = TypeId ("ns3::TdmaSlotAssignmentFileParser")
@@ -65,53 +89,132 @@ TdmaSlotAssignmentFileParser::ParseTdmaSlotInformation ()
   NS_LOG_FUNCTION (this);
   std::ifstream topgen;
   topgen.open (m_fileName.c_str ());
-  std::string line;
   if (!topgen.is_open ())
     {
       NS_LOG_WARN ("Couldn't open the file " << m_fileName);
       m_parseStatus = false;
       return;
     }
-  int numCells = 0;
-  while (!topgen.eof ())
+  m_numRows = 0;
+  m_numCols = 0;
+  m_slotRanges.clear ();
+  bool sparse = false;
+  bool first = true;
+  std::string line;
+  while (std::getline (topgen, line))
     {
-      SlotArray word;
-      int pos;
-      line.clear ();
-      //getline (topgen, line);
-      topgen >> line;
-      std::string nodeId ("");
-      std::stringstream stream (line);
-      NS_LOG_DEBUG ("line: " << line);
-      getline (stream,nodeId,':');
-      if (nodeId == "")
+      const char *p = line.c_str ();
+      SkipSpaces (p);
+      if (*p == '\0' || *p == '#')
         {
-          break;
+          continue;
+        }
+      if (first)
+        {
+          first = false;
+          if (std::strncmp (p, "slots", 5) == 0)
+            {
+              p += 5;
+              sparse = true;
+              m_numCols = ReadNumber (p);
+              continue;
+            }
+        }
+      if (sparse)
+        {
+          ParseSparseLine (p);
+        }
+      else
+        {
+          ParseDenseLine (p);
         }
       m_numRows++;
-      NS_LOG_DEBUG ("m_numRows:" << m_numRows);
-      line.erase (0,nodeId.size () + 1);
-      word.push_back (atoi (nodeId.c_str ()));
-      NS_LOG_DEBUG ("nodeId: " << nodeId << " line now:" << line);
-      while ( (pos = line.find (',')) > 0)
+    }
+  NS_LOG_DEBUG ("Nodes in TDMA: " << m_numRows << " slots per frame: " << m_numCols
+                << " runs of slots: " << m_slotRanges.size ());
+}
+
+void
+TdmaSlotAssignmentFileParser::ParseDenseLine (const char *p)
+{
+  TdmaSlotRange range;
+  range.nodeId = ReadNumber (p);
+  SkipSpaces (p);
+  NS_ASSERT_MSG (*p == ':', "expected ':' after node id " << range.nodeId);
+  p++;
+  uint32_t slot = 0;
+  bool inRange = false;
+  while (true)
+    {
+      SkipSpaces (p);
+      NS_ASSERT_MSG (*p == '0' || *p == '1', "slots should only be either 0 or 1");
+      if (*p != '0' && *p != '1')
+        {
+          break;
+        }
+      if (*p == '1' && !inRange)
+        {
+          range.first = slot;
+          inRange = true;
+        }
+      else if (*p == '0' && inRange)
+        {
+          range.last = slot - 1;
+          m_slotRanges.push_back (range);
+          inRange = false;
+        }
+      p++;
+      slot++;
+      SkipSpaces (p);
+      if (*p != ',')
+        {
+          break;
+        }
+      p++;
+    }
+  NS_ASSERT_MSG (*p == '\0', "slots should only be either 0 or 1");
+  if (inRange)
+    {
+      range.last = slot - 1;
+      m_slotRanges.push_back (range);
+    }
+  if (m_numRows == 0)
+    {
+      m_numCols = slot;
+    }
+  NS_ASSERT_MSG (slot == m_numCols, "node " << range.nodeId << " has " << slot << " slots instead of " << m_numCols);
+}
+
+void
+TdmaSlotAssignmentFileParser::ParseSparseLine (const char *p)
+{
+  TdmaSlotRange range;
+  range.nodeId = ReadNumber (p);
+  while (true)
+    {
+      SkipSpaces (p);
+      if (*p == ',')
+        {
+          p++;
+          SkipSpaces (p);
+        }
+      if (*p < '0' || *p > '9')
+        {
+          NS_ASSERT_MSG (*p == '\0', "expected a slot of node " << range.nodeId << " at \"" << p << "\"");
+          break;
+        }
+      range.first = ReadNumber (p);
+      range.last = range.first;
+      if (*p == '-')
         {
-          NS_LOG_DEBUG ("pos:" << pos);
-          std::string field = line.substr (0,pos);
-          NS_ASSERT_MSG (field == "0" || field == "1", "slots should only be either 0 or 1");
-          line = line.substr (pos + 1);
-          word.push_back (atoi (field.c_str ()));
-          NS_LOG_DEBUG ("field:" << word.back ());
-          numCells++;
+          p++;
+          range.last = ReadNumber (p);
         }
-      NS_ASSERT_MSG (line == "0" || line == "1", "slots should only be either 0 or 1");
-      word.push_back (atoi (line.c_str ()));
-      NS_LOG_DEBUG ("field:" << word.back ());
-      m_slotArray.push_back (word);
-      numCells++;
+      NS_ASSERT_MSG (range.first <= range.last && range.last < m_numCols,
+                     "slots " << range.first << "-" << range.last << " of node " << range.nodeId
+                              << " do not fit in a frame of " << m_numCols << " slots");
+      m_slotRanges.push_back (range);
     }
-  NS_ASSERT (numCells % m_numRows == 0);
-  m_numCols = numCells / m_numRows;
-  NS_LOG_DEBUG ("Nodes in TDMA: " << m_numRows << " slots per frame: " << m_numCols);
 }
 
 uint32_t
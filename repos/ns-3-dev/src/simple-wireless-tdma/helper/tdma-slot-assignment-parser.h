@@ -32,11 +32,42 @@
 #define __TDMA_PARSER_H__
 
 #include "ns3/object.h"
+#include <vector>
 
 namespace ns3 {
-typedef std::vector<uint32_t> SlotArray;
 class TdmaHelper;
 
+/**
+ * A run of consecutive slots of a frame given to one node.
+ */
+struct TdmaSlotRange
+{
+  uint32_t nodeId;
+  uint32_t first; //!< first slot of the run
+  uint32_t last;  //!< last slot of the run, included
+};
+
+/**
+ * \brief reads a TDMA slot assignment file
+ *
+ * Two formats are understood. The dense one has one line per node with
+ * the node id, ':' and a 0 or 1 for every slot of the frame:
+ * \verbatim
+   0:1,1,0,0
+   1:0,0,1,0
+   \endverbatim
+ * The sparse one starts with a line giving the number of slots of the
+ * frame, followed by one line per node with the node id and the slots or
+ * ranges of slots of the node:
+ * \verbatim
+   slots 4
+   0 0-1
+   1 2
+   \endverbatim
+ * Empty lines and lines starting with '#' are skipped. The file is read a
+ * line at a time and only the runs of slots are kept, so the memory used
+ * does not grow with the number of nodes times the number of slots.
+ */
 class TdmaSlotAssignmentFileParser : public Object
 {
 public:
@@ -46,9 +77,12 @@ public:
   void ParseTdmaSlotInformation (void);
   uint32_t GetNodeCount (void);
   uint32_t GetTotalSlots (void);
-  std::vector<SlotArray> & GetSlotArrays ()
+  /**
+   * \returns the runs of slots in the order they appear in the file
+   */
+  const std::vector<TdmaSlotRange> & GetSlotRanges (void) const
   {
-    return m_slotArray;
+    return m_slotRanges;
   }
   bool GetParseState()
   {
@@ -56,10 +90,13 @@ public:
   }
 
 private:
+  void ParseDenseLine (const char *line);
+  void ParseSparseLine (const char *line);
+
   std::string m_fileName;
   uint32_t m_numRows; /// Equivalent to number of nodes
-  uint32_t m_numCols; /// Equivalent to number of slots plus one
-  std::vector<SlotArray> m_slotArray;
+  uint32_t m_numCols; /// Equivalent to number of slots
+  std::vector<TdmaSlotRange> m_slotRanges;
   bool m_parseStatus;
 
 };
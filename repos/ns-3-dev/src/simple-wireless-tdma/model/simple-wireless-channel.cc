@@ -25,9 +25,13 @@
 #include "ns3/log.h"
 #include "ns3/double.h"
 #include "ns3/uinteger.h"
+#include "ns3/boolean.h"
 #include "ns3/ptr.h"
 #include "ns3/net-device.h"
+#include "ns3/trace-source-accessor.h"
 #include "ns3/mobility-model.h"
+#include <algorithm>
+#include <cmath>
 
 NS_LOG_COMPONENT_DEFINE ("SimpleWirelessChannel");
 
@@ -46,41 +50,405 @@ SimpleWirelessChannel::GetTypeId (void)
                    DoubleValue (250),
                    MakeDoubleAccessor (&SimpleWirelessChannel::m_range),
                    MakeDoubleChecker<double> ())
+    .AddAttribute ("SpatialIndex",
+                   "Look up receivers through a grid of MaxRange sized cells instead of "
+                   "checking the distance to every device on the channel.",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&SimpleWirelessChannel::m_useSpatialIndex),
+                   MakeBooleanChecker ())
+    .AddAttribute ("LinkTable",
+                   "Precompute the receivers in range of every stationary device and their "
+                   "propagation delay; the table is recomputed after a CourseChange.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SimpleWirelessChannel::m_useLinkTable),
+                   MakeBooleanChecker ())
+    .AddAttribute ("Interference",
+                   "Drop the frames that overlap in time with another frame at the receiver.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SimpleWirelessChannel::m_useInterference),
+                   MakeBooleanChecker ())
+    .AddTraceSource ("Collision",
+                     "A frame was dropped at the given receiving device because it overlapped "
+                     "with another frame.",
+                     MakeTraceSourceAccessor (&SimpleWirelessChannel::m_collisionTrace))
   ;
   return tid;
 }
 
 SimpleWirelessChannel::SimpleWirelessChannel ()
+  : m_indexValid (false),
+    m_cellSize (0),
+    m_linkTableValid (false),
+    m_collisions (0)
 {
 }
 
 void
-SimpleWirelessChannel::Send (Ptr<const Packet> p, Ptr<TdmaMacLow> sender)
+SimpleWirelessChannel::DoDispose (void)
 {
-  NS_LOG_FUNCTION (p << sender);
-  for (TdmaMacLowList::const_iterator i = m_tdmaMacLowList.begin (); i != m_tdmaMacLowList.end (); ++i)
+  NS_LOG_FUNCTION (this);
+  for (std::map<const MobilityModel *, std::vector<uint32_t> >::const_iterator i = m_mobilityToDevices.begin ();
+       i != m_mobilityToDevices.end (); ++i)
     {
-      Ptr<TdmaMacLow> tmp = *i;
+      Ptr<MobilityModel> mobility = m_index[i->second.front ()].mobility;
+      mobility->TraceDisconnectWithoutContext ("CourseChange",
+                                               MakeCallback (&SimpleWirelessChannel::CourseChanged, this));
+    }
+  m_mobilityToDevices.clear ();
+  m_index.clear ();
+  m_grid.clear ();
+  m_mobileDevices.clear ();
+  m_tdmaMacLowList.clear ();
+  m_tdmaMacLowIndex.clear ();
+  m_linkOffsets.clear ();
+  m_links.clear ();
+  m_busyPeriods.clear ();
+  m_indexValid = false;
+  m_linkTableValid = false;
+  Channel::DoDispose ();
+}
+
+void
+SimpleWirelessChannel::Send (Ptr<const Packet> p, Ptr<TdmaMacLow> sender, Time duration)
+{
+  NS_LOG_FUNCTION (p << sender << duration);
+  AddReceptions (p, sender, duration);
+  Simulator::ScheduleBatch (m_receptions);
+}
+
+void
+SimpleWirelessChannel::AddReceptions (Ptr<const Packet> p, Ptr<TdmaMacLow> sender, Time duration)
+{
+  if (m_useLinkTable && m_range > 0)
+    {
+      if (!m_indexValid || m_cellSize != m_range)
+        {
+          BuildIndex ();
+        }
+      if (!m_linkTableValid)
+        {
+          BuildLinkTable ();
+        }
+      std::map<const TdmaMacLow *, uint32_t>::const_iterator s = m_tdmaMacLowIndex.find (PeekPointer (sender));
+      NS_ASSERT_MSG (s != m_tdmaMacLowIndex.end (), "sender is not attached to this channel");
+      if (!m_index[s->second].mobile)
+        {
+          SendOverLinks (p, sender, s->second, duration);
+          return;
+        }
+    }
+  Ptr<MobilityModel> a = sender->GetDevice ()->GetNode ()->GetObject<MobilityModel> ();
+  if (!m_useSpatialIndex || m_range <= 0)
+    {
+      for (uint32_t j = 0; j < m_tdmaMacLowList.size (); j++)
+        {
+          Ptr<TdmaMacLow> tmp = m_tdmaMacLowList[j];
+          if (tmp->GetDevice () == sender->GetDevice ())
+            {
+              continue;
+            }
+          Ptr<MobilityModel> b = tmp->GetDevice ()->GetNode ()->GetObject<MobilityModel> ();
+          Deliver (p, sender, a, j, b, duration);
+        }
+      return;
+    }
+  if (!m_indexValid || m_cellSize != m_range)
+    {
+      BuildIndex ();
+    }
+  NS_ASSERT_MSG (a, "Error:  nodes must have mobility models");
+  // Devices in motion are always candidates, stationary ones only if
+  // they sit in one of the cells adjacent to the sender.
+  m_candidates = m_mobileDevices;
+  GridCell center = GetCell (a->GetPosition ());
+  for (int64_t dx = -1; dx <= 1; dx++)
+    {
+      for (int64_t dy = -1; dy <= 1; dy++)
+        {
+          Grid::const_iterator cell = m_grid.find (GridCell (center.first + dx, center.second + dy));
+          if (cell != m_grid.end ())
+            {
+              m_candidates.insert (m_candidates.end (), cell->second.begin (), cell->second.end ());
+            }
+        }
+    }
+  // visit the candidates in channel order so that receptions are scheduled
+  // in the same order as a scan over the whole device list would
+  std::sort (m_candidates.begin (), m_candidates.end ());
+  for (std::vector<uint32_t>::const_iterator i = m_candidates.begin (); i != m_candidates.end (); ++i)
+    {
+      Ptr<TdmaMacLow> tmp = m_tdmaMacLowList[*i];
       if (tmp->GetDevice () == sender->GetDevice ())
         {
           continue;
         }
-      Ptr<MobilityModel> a = sender->GetDevice ()->GetNode ()->GetObject<MobilityModel> ();
-      Ptr<MobilityModel> b = tmp->GetDevice ()->GetNode ()->GetObject<MobilityModel> ();
-      NS_ASSERT_MSG (a && b, "Error:  nodes must have mobility models");
-      double distance = a->GetDistanceFrom (b);
-      NS_LOG_DEBUG ("Distance: " << distance << " Max Range: " << m_range);
-      if (distance > m_range)
+      Deliver (p, sender, a, *i, m_index[*i].mobility, duration);
+    }
+}
+
+void
+SimpleWirelessChannel::Deliver (Ptr<const Packet> p, Ptr<TdmaMacLow> sender, Ptr<MobilityModel> a,
+                                uint32_t j, Ptr<MobilityModel> b, Time duration)
+{
+  Ptr<TdmaMacLow> receiver = m_tdmaMacLowList[j];
+  NS_ASSERT_MSG (a && b, "Error:  nodes must have mobility models");
+  double distance = a->GetDistanceFrom (b);
+  NS_LOG_DEBUG ("Distance: " << distance << " Max Range: " << m_range);
+  if (distance > m_range)
+    {
+      return;
+    }
+  // speed of light is 3.3 ns/meter
+  Time propagationTime = NanoSeconds (uint64_t (3.3 * distance));
+  NS_LOG_DEBUG ("Node " << sender->GetDevice ()->GetNode ()->GetId () << " sending to node " <<
+                receiver->GetDevice ()->GetNode ()->GetId () << " at distance " << distance <<
+                " meters; arriving time (ns): " << propagationTime);
+  ScheduleReception (p, j, receiver->GetDevice ()->GetNode ()->GetId (), propagationTime, duration);
+}
+
+void
+SimpleWirelessChannel::ScheduleReception (Ptr<const Packet> p, uint32_t j, uint32_t nodeId, Time delay, Time duration)
+{
+  if (!m_useInterference || duration.IsZero ())
+    {
+      m_receptions.Add (nodeId, delay + duration, MakeEvent (&TdmaMacLow::Receive, m_tdmaMacLowList[j], p));
+      return;
+    }
+  Time start = Simulator::Now () + delay;
+  Ptr<BusyPeriod> period = AddArrival (j, start, start + duration);
+  m_receptions.Add (nodeId, delay + duration, MakeEvent (&SimpleWirelessChannel::Receive, this, p, j, period));
+}
+
+Ptr<SimpleWirelessChannel::BusyPeriod>
+SimpleWirelessChannel::AddArrival (uint32_t j, Time start, Time end)
+{
+  if (m_busyPeriods.size () != m_tdmaMacLowList.size ())
+    {
+      m_busyPeriods.resize (m_tdmaMacLowList.size ());
+    }
+  BusyPeriods &periods = m_busyPeriods[j];
+  // the periods are disjoint, so they end in the order they start
+  Time now = Simulator::Now ();
+  while (!periods.empty () && periods.begin ()->second->end <= now)
+    {
+      periods.erase (periods.begin ());
+    }
+  BusyPeriods::iterator i = periods.upper_bound (start);
+  if (i != periods.begin ())
+    {
+      BusyPeriods::iterator previous = i;
+      --previous;
+      if (previous->second->end > start)
+        {
+          i = previous;
+        }
+    }
+  // merge every period the new frame overlaps with; the frames in them
+  // and the new one are all lost
+  Ptr<BusyPeriod> period = Create<BusyPeriod> ();
+  period->end = end;
+  period->collided = false;
+  while (i != periods.end () && i->first < end)
+    {
+      i->second->collided = true;
+      period->collided = true;
+      start = std::min (start, i->first);
+      period->end = std::max (period->end, i->second->end);
+      periods.erase (i++);
+    }
+  periods[start] = period;
+  return period;
+}
+
+void
+SimpleWirelessChannel::Receive (Ptr<const Packet> p, uint32_t j, Ptr<BusyPeriod> period)
+{
+  Ptr<TdmaMacLow> receiver = m_tdmaMacLowList[j];
+  if (period->collided)
+    {
+      NS_LOG_DEBUG ("Node " << receiver->GetDevice ()->GetNode ()->GetId () << " lost a frame in a collision");
+      m_collisions++;
+      m_collisionTrace (p, receiver->GetDevice ());
+      return;
+    }
+  receiver->Receive (p);
+}
+
+void
+SimpleWirelessChannel::SendOverLinks (Ptr<const Packet> p, Ptr<TdmaMacLow> sender, uint32_t s, Time duration)
+{
+  // merge the links with the moving devices so that receptions are
+  // scheduled in channel order, as with the other lookups
+  m_candidates = m_mobileDevices;
+  std::sort (m_candidates.begin (), m_candidates.end ());
+  std::vector<Link>::const_iterator link = m_links.begin () + m_linkOffsets[s];
+  std::vector<Link>::const_iterator end = m_links.begin () + m_linkOffsets[s + 1];
+  std::vector<uint32_t>::const_iterator mobile = m_candidates.begin ();
+  while (link != end || mobile != m_candidates.end ())
+    {
+      if (mobile == m_candidates.end () || (link != end && link->receiver < *mobile))
+        {
+          ScheduleReception (p, link->receiver, link->nodeId, link->delay, duration);
+          ++link;
+        }
+      else
+        {
+          Ptr<TdmaMacLow> receiver = m_tdmaMacLowList[*mobile];
+          if (receiver->GetDevice () != sender->GetDevice ())
+            {
+              Deliver (p, sender, m_index[s].mobility, *mobile, m_index[*mobile].mobility, duration);
+            }
+          ++mobile;
+        }
+    }
+}
+
+void
+SimpleWirelessChannel::BuildLinkTable (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_linkOffsets.resize (m_tdmaMacLowList.size () + 1);
+  m_links.clear ();
+  for (uint32_t i = 0; i < m_tdmaMacLowList.size (); i++)
+    {
+      m_linkOffsets[i] = m_links.size ();
+      const IndexEntry &sender = m_index[i];
+      if (sender.mobile)
         {
           continue;
         }
-      // speed of light is 3.3 ns/meter
-      Time propagationTime = NanoSeconds (uint64_t (3.3 * distance));
-      NS_LOG_DEBUG ("Node " << sender->GetDevice ()->GetNode ()->GetId () << " sending to node " <<
-                    tmp->GetDevice ()->GetNode ()->GetId () << " at distance " << distance <<
-                    " meters; arriving time (ns): " << propagationTime);
-      Simulator::ScheduleWithContext (tmp->GetDevice ()->GetNode ()->GetId (),(propagationTime),
-                                      &TdmaMacLow::Receive, tmp, p->Copy ());
+      m_candidates.clear ();
+      for (int64_t dx = -1; dx <= 1; dx++)
+        {
+          for (int64_t dy = -1; dy <= 1; dy++)
+            {
+              Grid::const_iterator cell = m_grid.find (GridCell (sender.cell.first + dx, sender.cell.second + dy));
+              if (cell != m_grid.end ())
+                {
+                  m_candidates.insert (m_candidates.end (), cell->second.begin (), cell->second.end ());
+                }
+            }
+        }
+      std::sort (m_candidates.begin (), m_candidates.end ());
+      Ptr<NetDevice> device = m_tdmaMacLowList[i]->GetDevice ();
+      for (std::vector<uint32_t>::const_iterator j = m_candidates.begin (); j != m_candidates.end (); ++j)
+        {
+          Ptr<TdmaMacLow> receiver = m_tdmaMacLowList[*j];
+          if (receiver->GetDevice () == device)
+            {
+              continue;
+            }
+          double distance = sender.mobility->GetDistanceFrom (m_index[*j].mobility);
+          if (distance > m_range)
+            {
+              continue;
+            }
+          Link link;
+          link.receiver = *j;
+          link.nodeId = receiver->GetDevice ()->GetNode ()->GetId ();
+          // speed of light is 3.3 ns/meter
+          link.delay = NanoSeconds (uint64_t (3.3 * distance));
+          m_links.push_back (link);
+        }
+    }
+  m_linkOffsets[m_tdmaMacLowList.size ()] = m_links.size ();
+  m_linkTableValid = true;
+  NS_LOG_DEBUG ("link table has " << m_links.size () << " links");
+}
+
+SimpleWirelessChannel::GridCell
+SimpleWirelessChannel::GetCell (const Vector &position) const
+{
+  return GridCell (static_cast<int64_t> (std::floor (position.x / m_cellSize)),
+                   static_cast<int64_t> (std::floor (position.y / m_cellSize)));
+}
+
+void
+SimpleWirelessChannel::BuildIndex (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_cellSize = m_range;
+  m_grid.clear ();
+  m_mobileDevices.clear ();
+  m_index.resize (m_tdmaMacLowList.size ());
+  m_linkTableValid = false;
+  for (uint32_t i = 0; i < m_tdmaMacLowList.size (); i++)
+    {
+      Ptr<MobilityModel> mobility = m_tdmaMacLowList[i]->GetDevice ()->GetNode ()->GetObject<MobilityModel> ();
+      NS_ASSERT_MSG (mobility, "Error:  nodes must have mobility models");
+      if (m_index[i].mobility == 0)
+        {
+          // several devices of one node share a single mobility model, so
+          // only hook its CourseChange trace once
+          std::vector<uint32_t> &devices = m_mobilityToDevices[PeekPointer (mobility)];
+          if (devices.empty ())
+            {
+              mobility->TraceConnectWithoutContext ("CourseChange",
+                                                    MakeCallback (&SimpleWirelessChannel::CourseChanged, this));
+            }
+          devices.push_back (i);
+          m_index[i].mobility = mobility;
+        }
+      InsertInIndex (i);
+    }
+  m_indexValid = true;
+  NS_LOG_DEBUG ("grid cells: " << m_grid.size () << " moving devices: " << m_mobileDevices.size ());
+}
+
+void
+SimpleWirelessChannel::InsertInIndex (uint32_t i)
+{
+  IndexEntry &entry = m_index[i];
+  Vector velocity = entry.mobility->GetVelocity ();
+  entry.mobile = (velocity.x != 0 || velocity.y != 0 || velocity.z != 0);
+  if (entry.mobile)
+    {
+      m_mobileDevices.push_back (i);
+    }
+  else
+    {
+      entry.cell = GetCell (entry.mobility->GetPosition ());
+      m_grid[entry.cell].push_back (i);
+    }
+}
+
+void
+SimpleWirelessChannel::RemoveFromIndex (uint32_t i)
+{
+  IndexEntry &entry = m_index[i];
+  if (entry.mobile)
+    {
+      m_mobileDevices.erase (std::find (m_mobileDevices.begin (), m_mobileDevices.end (), i));
+      return;
+    }
+  Grid::iterator cell = m_grid.find (entry.cell);
+  NS_ASSERT (cell != m_grid.end ());
+  cell->second.erase (std::find (cell->second.begin (), cell->second.end (), i));
+  if (cell->second.empty ())
+    {
+      m_grid.erase (cell);
+    }
+}
+
+void
+SimpleWirelessChannel::CourseChanged (Ptr<const MobilityModel> mobility)
+{
+  NS_LOG_FUNCTION (this << mobility);
+  m_linkTableValid = false;
+  if (!m_indexValid)
+    {
+      return;
+    }
+  std::map<const MobilityModel *, std::vector<uint32_t> >::const_iterator it =
+    m_mobilityToDevices.find (PeekPointer (mobility));
+  if (it == m_mobilityToDevices.end ())
+    {
+      return;
+    }
+  for (std::vector<uint32_t>::const_iterator i = it->second.begin (); i != it->second.end (); ++i)
+    {
+      RemoveFromIndex (*i);
+      InsertInIndex (*i);
     }
 }
 
@@ -88,7 +456,9 @@ void
 SimpleWirelessChannel::Add (Ptr<TdmaMacLow> tdmaMacLow)
 {
   NS_LOG_DEBUG (this << " " << tdmaMacLow);
+  m_tdmaMacLowIndex[PeekPointer (tdmaMacLow)] = m_tdmaMacLowList.size ();
   m_tdmaMacLowList.push_back (tdmaMacLow);
+  m_indexValid = false;
   NS_LOG_DEBUG ("current m_tdmaMacLowList size: " << m_tdmaMacLowList.size ());
 }
 
@@ -109,4 +479,10 @@ SimpleWirelessChannel::GetMaxRange (void) const
   return m_range;
 }
 
+uint64_t
+SimpleWirelessChannel::GetNCollisions (void) const
+{
+  return m_collisions;
+}
+
 } // namespace ns3
@@ -24,19 +24,44 @@
 #include "ns3/channel.h"
 #include "ns3/mac48-address.h"
 #include "ns3/nstime.h"
+#include "ns3/event-batch.h"
 #include "ns3/data-rate.h"
+#include "ns3/vector.h"
+#include "ns3/simple-ref-count.h"
+#include "ns3/traced-callback.h"
 #include "tdma-mac-low.h"
 #include "tdma-mac-net-device.h"
 #include <vector>
+#include <map>
 
 namespace ns3 {
 
 class TdmaMacLow;
 class Packet;
+class MobilityModel;
 
 /**
  * \ingroup channel
  * \brief A simple channel, for simple things and testing
+ *
+ * Receivers are looked up through a uniform grid whose cells are MaxRange
+ * wide, so a transmission only visits the devices in the 3x3 cells around
+ * the sender instead of every device on the channel. Devices whose
+ * mobility model reports a non-zero velocity cannot be binned and are
+ * always checked. The grid is kept up to date from the CourseChange trace
+ * of each mobility model.
+ *
+ * With the LinkTable attribute set, the channel goes one step further for
+ * stationary devices: it keeps, for every device, the list of stationary
+ * devices in range together with their propagation delay, so a send only
+ * walks that list plus the moving devices. The table is rebuilt on the
+ * first send after a CourseChange.
+ *
+ * With the Interference attribute set, a frame is dropped at a receiver
+ * if it overlaps in time with another frame arriving at that receiver;
+ * all the frames involved are lost. Each receiver keeps the periods it
+ * is busy receiving as a set of disjoint intervals, so an arrival costs
+ * O(log k) with k the frames in flight to that receiver.
  */
 class SimpleWirelessChannel : public Channel
 {
@@ -46,15 +71,16 @@ public:
   SimpleWirelessChannel ();
 
   /**
-   * Copy the packet to be received at a time equal to the transmission
+   * Schedule the reception of the packet at a time equal to the transmission
    * time plus the propagation delay between sender and all receivers
-   * on the channel that are within the range of the sender
+   * on the channel that are within the range of the sender. All receivers
+   * get the same packet, which must not be modified afterwards.
    *
    * \param p Pointer to packet
    * \param sender sending NetDevice
-   * \param txTime transmission time (seconds)
+   * \param duration transmission time, the packet is received after it
    */
-  void Send (Ptr<const Packet> p, Ptr<TdmaMacLow> sender);
+  void Send (Ptr<const Packet> p, Ptr<TdmaMacLow> sender, Time duration);
 
   /**
    * Add a device to the channel
@@ -63,14 +89,115 @@ public:
    */
   void Add (Ptr<TdmaMacLow> tdmaMacLow);
   double GetMaxRange (void) const;
+  /**
+   * \returns the number of frames dropped so far because they overlapped
+   * another frame at their receiver
+   */
+  uint64_t GetNCollisions (void) const;
 
   // inherited from ns3::Channel
   virtual uint32_t GetNDevices (void) const;
   virtual Ptr<NetDevice> GetDevice (uint32_t i) const;
 
 private:
+  typedef std::pair<int64_t, int64_t> GridCell;
+  typedef std::map<GridCell, std::vector<uint32_t> > Grid;
+
+  struct IndexEntry
+  {
+    Ptr<MobilityModel> mobility;
+    bool mobile;
+    GridCell cell;
+  };
+
+  /**
+   * A period during which a receiver is receiving one frame, or several
+   * overlapping ones that it will all lose
+   */
+  struct BusyPeriod : public SimpleRefCount<BusyPeriod>
+  {
+    Time end;
+    bool collided;
+  };
+  typedef std::map<Time, Ptr<BusyPeriod> > BusyPeriods;
+
+  /**
+   * A stationary receiver in range of a stationary sender
+   */
+  struct Link
+  {
+    uint32_t receiver;
+    uint32_t nodeId;
+    Time delay;
+  };
+
+  virtual void DoDispose (void);
+  /**
+   * Add the receptions of p by every receiver in range to m_receptions.
+   */
+  void AddReceptions (Ptr<const Packet> p, Ptr<TdmaMacLow> sender, Time duration);
+  /**
+   * Schedule the reception of p on the receiver at index j if it lies
+   * within MaxRange of the sender.
+   */
+  void Deliver (Ptr<const Packet> p, Ptr<TdmaMacLow> sender, Ptr<MobilityModel> a,
+                uint32_t j, Ptr<MobilityModel> b, Time duration);
+  /**
+   * Add the reception of p on the receiver at index j, which starts
+   * after delay and lasts duration, to m_receptions.
+   */
+  void ScheduleReception (Ptr<const Packet> p, uint32_t j, uint32_t nodeId, Time delay, Time duration);
+  /**
+   * Hand p to the receiver at index j unless it collided.
+   */
+  void Receive (Ptr<const Packet> p, uint32_t j, Ptr<BusyPeriod> period);
+  /**
+   * Record a frame arriving at the receiver at index j from start to end
+   * and return the busy period it belongs to.
+   */
+  Ptr<BusyPeriod> AddArrival (uint32_t j, Time start, Time end);
+  /**
+   * Rebuild the grid from scratch; done lazily on the first Send after
+   * a device was added or MaxRange was changed.
+   */
+  void BuildIndex (void);
+  void InsertInIndex (uint32_t i);
+  void RemoveFromIndex (uint32_t i);
+  void CourseChanged (Ptr<const MobilityModel> mobility);
+  /**
+   * Compute the links of every stationary device, in compressed sparse
+   * row form: the links of device i are m_links[m_linkOffsets[i]] up to
+   * m_links[m_linkOffsets[i + 1]], ordered by receiver.
+   */
+  void BuildLinkTable (void);
+  /**
+   * Deliver p from the stationary device at index s to its links and to
+   * the moving devices in range.
+   */
+  void SendOverLinks (Ptr<const Packet> p, Ptr<TdmaMacLow> sender, uint32_t s, Time duration);
+  GridCell GetCell (const Vector &position) const;
+
   TdmaMacLowList m_tdmaMacLowList;
   double m_range;
+  bool m_useSpatialIndex;
+  bool m_indexValid;
+  double m_cellSize;
+  std::vector<IndexEntry> m_index;
+  Grid m_grid;
+  std::vector<uint32_t> m_mobileDevices;
+  std::map<const MobilityModel *, std::vector<uint32_t> > m_mobilityToDevices;
+  std::vector<uint32_t> m_candidates;
+  bool m_useLinkTable;
+  bool m_linkTableValid;
+  std::vector<uint32_t> m_linkOffsets;
+  std::vector<Link> m_links;
+  std::map<const TdmaMacLow *, uint32_t> m_tdmaMacLowIndex;
+  bool m_useInterference;
+  std::vector<BusyPeriods> m_busyPeriods;
+  uint64_t m_collisions;
+  // the receptions of the frame being sent, scheduled in a single batch
+  EventBatch m_receptions;
+  TracedCallback<Ptr<const Packet>, Ptr<NetDevice> > m_collisionTrace;
 };
 
 } // namespace ns3
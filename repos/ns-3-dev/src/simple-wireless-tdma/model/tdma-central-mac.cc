@@ -30,10 +30,13 @@
  */
 #include "ns3/assert.h"
 #include "ns3/log.h"
+#include "ns3/pointer.h"
 #include "ns3/simulator.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/wifi-mac-header.h"
+#include "ns3/msdu-aggregator.h"
 #include "tdma-central-mac.h"
+#include "tdma-controller.h"
 
 NS_LOG_COMPONENT_DEFINE ("TdmaCentralMac");
 
@@ -50,6 +53,11 @@ TdmaCentralMac::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::TdmaCentralMac")
     .SetParent<TdmaMac> ()
     .AddConstructor<TdmaCentralMac> ()
+    .AddAttribute ("MsduAggregator", "If set, packets for the same receiver are sent as A-MSDUs that fill "
+                   "as much of the slot as possible.",
+                   PointerValue (),
+                   MakePointerAccessor (&TdmaCentralMac::m_msduAggregator),
+                   MakePointerChecker<MsduAggregator> ())
     .AddTraceSource ("MacTx",
                      "A packet has been received from higher layers and is being processed in preparation for "
                      "queueing for transmission.",
@@ -93,6 +101,9 @@ TdmaCentralMac::DoDispose (void)
   m_device = 0;
   m_queue = 0;
   m_tdmaController = 0;
+  m_idleSlots.clear ();
+  m_msduAggregator = 0;
+  m_aggregatedMsdus.clear ();
   TdmaMac::DoDispose ();
 }
 
@@ -221,6 +232,12 @@ TdmaCentralMac::GetNQueues (void)
   return 1;
 }
 
+uint32_t
+TdmaCentralMac::GetQueueSize (void)
+{
+  return m_queue->GetSize ();
+}
+
 void
 TdmaCentralMac::SetLinkDownCallback (Callback<void> linkDown)
 {
@@ -284,7 +301,19 @@ TdmaCentralMac::Queue (Ptr<const Packet> packet, const WifiMacHeader &hdr)
   if (!m_queue->Enqueue (packet, hdr))
     {
       NotifyTxDrop (packet);
+      return;
+    }
+  // the slots of this frame that were skipped because the queue was empty
+  // have to start after all
+  Time now = Simulator::Now ();
+  for (std::vector<std::pair<Time, uint64_t> >::const_iterator i = m_idleSlots.begin (); i != m_idleSlots.end (); ++i)
+    {
+      if (i->first >= now)
+        {
+          Simulator::Schedule (i->first - now, &TdmaCentralMac::StartTransmission, this, i->second);
+        }
     }
+  m_idleSlots.clear ();
   //Cannot request for channel access in tdma. Tdma schedules every node in round robin manner
   //RequestForChannelAccess();
 }
@@ -305,8 +334,13 @@ TdmaCentralMac::StartTransmission (uint64_t transmissionTimeUs)
   NS_LOG_DEBUG ("Packet TransmissionTime(microSeconds): " << packetTransmissionTime.GetMicroSeconds () << "usec");
   if (packetTransmissionTime < totalTransmissionSlot)
     {
+      if (m_msduAggregator != 0)
+        {
+          StartAggregateTransmission (totalTransmissionSlot);
+          return;
+        }
       totalTransmissionSlot -= packetTransmissionTime;
-      Simulator::Schedule (packetTransmissionTime, &TdmaCentralMac::SendPacketDown, this,totalTransmissionSlot);
+      SendPacketDown (packetTransmissionTime, totalTransmissionSlot);
     }
   else
     {
@@ -315,17 +349,115 @@ TdmaCentralMac::StartTransmission (uint64_t transmissionTimeUs)
 }
 
 void
-TdmaCentralMac::SendPacketDown (Time remainingTime)
+TdmaCentralMac::ScheduleTransmission (Time delay, uint64_t transmissionTimeUs)
+{
+  NS_LOG_FUNCTION (this << delay << transmissionTimeUs);
+  // forget the idle slots of the previous frame
+  Time now = Simulator::Now ();
+  while (!m_idleSlots.empty () && m_idleSlots.front ().first < now)
+    {
+      m_idleSlots.erase (m_idleSlots.begin ());
+    }
+  if (delay.IsZero ())
+    {
+      StartTransmission (transmissionTimeUs);
+    }
+  else if (m_queue->GetSize () == 0)
+    {
+      // no event for a slot that would find the queue empty; Queue arms it
+      // if a packet arrives before the slot starts
+      m_idleSlots.push_back (std::make_pair (now + delay, transmissionTimeUs));
+    }
+  else
+    {
+      Simulator::Schedule (delay, &TdmaCentralMac::StartTransmission, this, transmissionTimeUs);
+    }
+}
+
+void
+TdmaCentralMac::SendPacketDown (Time transmissionTime, Time remainingTime)
 {
   WifiMacHeader header;
   Ptr<const Packet> packet = m_queue->Dequeue (&header);
-  m_low->StartTransmission (packet, &header);
+  m_low->StartTransmission (packet, &header, transmissionTime);
+  Simulator::Schedule (transmissionTime, &TdmaCentralMac::EndPacketTransmission, this, packet, remainingTime);
+}
+
+void
+TdmaCentralMac::EndPacketTransmission (Ptr<const Packet> packet, Time remainingTime)
+{
   TxQueueStart (0);
   NotifyTx (packet);
   TxQueueStart (0);
   StartTransmission (remainingTime.GetMicroSeconds ());
 }
 
+void
+TdmaCentralMac::StartAggregateTransmission (Time remainingTime)
+{
+  NS_LOG_FUNCTION (this << remainingTime);
+  WifiMacHeader header;
+  Ptr<const Packet> packet = m_queue->Peek (&header);
+  WifiMacHeader next = header;
+  Ptr<Packet> aggregate = Create<Packet> ();
+  Time aggregateTransmissionTime;
+  NS_ASSERT (m_aggregatedMsdus.empty ());
+  while (packet != 0 && next.GetAddr1 () == header.GetAddr1 ())
+    {
+      // the aggregator changes the packet it is given, so try on a copy
+      Ptr<Packet> candidate = aggregate->Copy ();
+      if (!m_msduAggregator->Aggregate (packet, candidate, next.GetAddr3 (), next.GetAddr1 ()))
+        {
+          break;
+        }
+      Time candidateTransmissionTime = m_tdmaController->CalculateAggregateTxTime (candidate);
+      if (candidateTransmissionTime >= remainingTime)
+        {
+          break;
+        }
+      m_queue->Dequeue (&next);
+      aggregate = candidate;
+      aggregateTransmissionTime = candidateTransmissionTime;
+      m_aggregatedMsdus.push_back (packet);
+      packet = m_queue->Peek (&next);
+    }
+  if (m_aggregatedMsdus.size () < 2)
+    {
+      // a packet that does not fit in an A-MSDU or has nothing to share
+      // it with goes out as a plain frame, as without aggregation
+      if (m_aggregatedMsdus.empty ())
+        {
+          m_aggregatedMsdus.push_back (m_queue->Dequeue (&header));
+        }
+      aggregate = m_aggregatedMsdus.front ()->Copy ();
+      aggregateTransmissionTime = m_tdmaController->CalculateTxTime (aggregate);
+    }
+  else
+    {
+      NS_LOG_DEBUG ("A-MSDU of " << m_aggregatedMsdus.size () << " packets, " << aggregate->GetSize () << " bytes");
+      header.SetType (WIFI_MAC_QOSDATA);
+      header.SetQosTid (0);
+      header.SetQosNoEosp ();
+      header.SetQosAmsdu ();
+    }
+  NS_LOG_DEBUG ("Frame TransmissionTime(microSeconds): " << aggregateTransmissionTime.GetMicroSeconds () << "usec");
+  m_low->StartTransmission (aggregate, &header, aggregateTransmissionTime);
+  Simulator::Schedule (aggregateTransmissionTime, &TdmaCentralMac::EndAggregateTransmission, this,
+                       remainingTime - aggregateTransmissionTime);
+}
+
+void
+TdmaCentralMac::EndAggregateTransmission (Time remainingTime)
+{
+  TxQueueStart (0);
+  for (std::vector<Ptr<const Packet> >::const_iterator i = m_aggregatedMsdus.begin (); i != m_aggregatedMsdus.end (); ++i)
+    {
+      NotifyTx (*i);
+    }
+  m_aggregatedMsdus.clear ();
+  StartTransmission (remainingTime.GetMicroSeconds ());
+}
+
 void
 TdmaCentralMac::Enqueue (Ptr<const Packet> packet, Mac48Address to, Mac48Address from)
 {
@@ -384,6 +516,15 @@ TdmaCentralMac::TxQueueStop (uint32_t index)
 void
 TdmaCentralMac::Receive (Ptr<Packet> packet, const WifiMacHeader *hdr)
 {
+  if (hdr->IsQosData () && hdr->IsQosAmsdu ())
+    {
+      MsduAggregator::DeaggregatedMsdus msdus = MsduAggregator::Deaggregate (packet);
+      for (MsduAggregator::DeaggregatedMsdusCI i = msdus.begin (); i != msdus.end (); ++i)
+        {
+          ForwardUp (i->first, i->second.GetSourceAddr (), i->second.GetDestinationAddr ());
+        }
+      return;
+    }
   ForwardUp (packet, hdr->GetAddr3 (), hdr->GetAddr1 ());
 }
 
@@ -40,6 +40,7 @@
 namespace ns3 {
 
 class WifiMacHeader;
+class MsduAggregator;
 class TdmaController;
 class TdmaMacLow;
 
@@ -50,6 +51,10 @@ class TdmaMacLow;
  * manner depending on the number of slots allocated to a node and the
  * slot interval. Mac also be made to request for more slots or change in
  * slot interval which would take affect from the next epoch.
+ *
+ * When an MsduAggregator is set, the packets at the head of the queue that
+ * go to the same receiver and fit in the rest of the slot are sent as one
+ * A-MSDU frame instead of one frame each.
  */
 class TdmaCentralMac : public TdmaMac
 {
@@ -77,6 +82,7 @@ public:
   virtual Ptr<TdmaNetDevice> GetDevice (void) const;
   virtual void SetChannel (Ptr<SimpleWirelessChannel> channel);
   virtual void StartTransmission (uint64_t transmissionTime);
+  virtual void ScheduleTransmission (Time delay, uint64_t transmissionTime);
   virtual void NotifyTx (Ptr<const Packet> packet);
   virtual void NotifyTxDrop (Ptr<const Packet> packet);
   virtual void NotifyRx (Ptr<const Packet> packet);
@@ -86,6 +92,7 @@ public:
   virtual void SetTxQueueStopCallback (Callback<bool,uint32_t> queueStop);
   virtual uint32_t GetQueueState (uint32_t index);
   virtual uint32_t GetNQueues (void);
+  virtual uint32_t GetQueueSize (void);
 
   /**
    * \param packet packet to send
@@ -112,7 +119,36 @@ private:
   TdmaCentralMac &operator = (const TdmaCentralMac &o);
   void TxQueueStart (uint32_t index);
   void TxQueueStop (uint32_t index);
-  void SendPacketDown (Time remainingTime);
+  /**
+   * \param transmissionTime air time of the packet at the head of the queue
+   * \param remainingTime time left in the slot after that packet
+   *
+   * Send the packet at the head of the queue and look at the next one
+   * once it has been transmitted.
+   */
+  void SendPacketDown (Time transmissionTime, Time remainingTime);
+  /**
+   * \param packet the packet which has just been transmitted
+   * \param remainingTime time left in the slot
+   *
+   * Report the transmission of the packet and look at the next one.
+   */
+  void EndPacketTransmission (Ptr<const Packet> packet, Time remainingTime);
+  /**
+   * \param remainingTime time left in the slot, the packet at the head of
+   * the queue is known to fit
+   *
+   * Dequeue the packets at the head of the queue that fit in one A-MSDU
+   * and send it. A single packet is sent as a plain frame.
+   */
+  void StartAggregateTransmission (Time remainingTime);
+  /**
+   * \param remainingTime time left in the slot
+   *
+   * Report the transmission of the packets of the A-MSDU and look at the
+   * next one.
+   */
+  void EndAggregateTransmission (Time remainingTime);
 
   /**
    * The trace source fired when packets come into the "top" of the device
@@ -168,6 +204,16 @@ private:
   Ssid m_ssid;
   Ptr<Node> m_nodePtr;
   bool m_isTdmaRunning;
+  /**
+   * Slots of the current frame that had nothing queued when the frame
+   * started, as (start time, slot duration in microseconds).
+   */
+  std::vector<std::pair<Time, uint64_t> > m_idleSlots;
+  Ptr<MsduAggregator> m_msduAggregator;
+  /**
+   * Packets carried by the A-MSDU being transmitted
+   */
+  std::vector<Ptr<const Packet> > m_aggregatedMsdus;
 };
 
 } // namespace ns3
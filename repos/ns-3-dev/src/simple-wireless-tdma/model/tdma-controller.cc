@@ -36,7 +36,10 @@
 #include "tdma-controller.h"
 #include "tdma-mac.h"
 #include "tdma-mac-low.h"
+#include "tdma-slot-allocator.h"
 #include "ns3/abort.h"
+#include "ns3/pointer.h"
+#include <algorithm>
 
 NS_LOG_COMPONENT_DEFINE ("TdmaController");
 
@@ -95,14 +98,23 @@ TdmaController::GetTypeId (void)
                    MakeTimeAccessor (&TdmaController::SetInterFrameTimeInterval,
                                      &TdmaController::GetInterFrameTimeInterval),
                    MakeTimeChecker ())
-    .AddAttribute ("TdmaMode","Tdma Mode, Centralized",
+    .AddAttribute ("TdmaMode","Tdma Mode, Centralized or Dynamic. In Dynamic mode the slots of "
+                   "every frame are shared among the macs by the SlotAllocator according to their backlog.",
                    EnumValue (CENTRALIZED),
                    MakeEnumAccessor (&TdmaController::m_tdmaMode),
-                   MakeEnumChecker (CENTRALIZED, "Centralized"));
+                   MakeEnumChecker (CENTRALIZED, "Centralized",
+                                    DYNAMIC, "Dynamic"))
+    .AddAttribute ("SlotAllocator", "The policy that shares the slots of a frame in Dynamic mode. "
+                   "Defaults to ns3::MaxBacklogTdmaSlotAllocator.",
+                   PointerValue (),
+                   MakePointerAccessor (&TdmaController::m_slotAllocator),
+                   MakePointerChecker<TdmaSlotAllocator> ());
   return tid;
 }
 
-TdmaController::TdmaController () : m_activeEpoch (false),
+TdmaController::TdmaController () : m_totalSlotsAllowed (0),
+                                    m_activeEpoch (false),
+                                    m_framePlanValid (false),
                                     m_channel (0)
 {
   NS_LOG_FUNCTION (this);
@@ -113,6 +125,10 @@ TdmaController::~TdmaController ()
   m_channel = 0;
   m_bps = 0;
   m_slotPtrs.clear ();
+  m_framePlan.clear ();
+  m_dynamicFramePlan.clear ();
+  m_macs.clear ();
+  m_slotAllocator = 0;
 }
 
 void
@@ -130,23 +146,45 @@ void
 TdmaController::StartTdmaSessions (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
-  ScheduleTdmaSession (0);
+  if (!m_framePlanValid)
+    {
+      BuildFramePlan ();
+    }
+  if (m_frameLength.IsZero ())
+    {
+      NS_LOG_WARN ("No TDMA slots in TDMA controller");
+      return;
+    }
+  const FramePlan *plan = &m_framePlan;
+  Time frameLength = m_frameLength;
+  if (m_tdmaMode == DYNAMIC && ReallocateSlots ())
+    {
+      plan = &m_dynamicFramePlan;
+      frameLength = m_dynamicFrameLength;
+    }
+  for (FramePlan::const_iterator i = plan->begin (); i != plan->end (); ++i)
+    {
+      i->mac->ScheduleTransmission (i->offset, i->durationUs);
+    }
+  Simulator::Schedule (frameLength, &TdmaController::StartTdmaSessions, this);
 }
 
 void
 TdmaController::AddTdmaSlot (uint32_t slotPos, Ptr<TdmaMac> macPtr)
 {
   NS_LOG_FUNCTION (slotPos << macPtr);
-  std::pair<std::map<uint32_t, Ptr<TdmaMac> >::iterator, bool> result =
-    m_slotPtrs.insert (std::make_pair (slotPos,macPtr));
-  if (result.second == true)
-    {
-      NS_LOG_DEBUG ("Added mac : " << macPtr << " in slot " << slotPos);
-    }
-  else
+  std::pair<TdmaMacPtrMap::iterator, TdmaMacPtrMap::iterator> range = m_slotPtrs.equal_range (slotPos);
+  for (TdmaMacPtrMap::iterator i = range.first; i != range.second; ++i)
     {
-      NS_LOG_WARN ("Could not add mac: " << macPtr << " to slot " << slotPos);
+      if (i->second == macPtr)
+        {
+          NS_LOG_WARN ("Could not add mac: " << macPtr << " to slot " << slotPos);
+          return;
+        }
     }
+  m_slotPtrs.insert (range.second, std::make_pair (slotPos,macPtr));
+  NS_LOG_DEBUG ("Added mac : " << macPtr << " in slot " << slotPos);
+  m_framePlanValid = false;
 }
 
 void
@@ -154,6 +192,7 @@ TdmaController::SetSlotTime (Time slotTime)
 {
   NS_LOG_FUNCTION (this << slotTime);
   m_slotTime = slotTime.GetMicroSeconds ();
+  m_framePlanValid = false;
 }
 
 Time
@@ -203,6 +242,7 @@ TdmaController::SetGaurdTime (Time gaurdTime)
     {
       m_gaurdTime = gaurdTime.GetMicroSeconds ();
     }
+  m_framePlanValid = false;
 }
 
 Time
@@ -216,6 +256,7 @@ TdmaController::SetInterFrameTimeInterval (Time interFrameTime)
 {
   NS_LOG_FUNCTION (interFrameTime);
   m_tdmaInterFrameTime = interFrameTime.GetMicroSeconds ();
+  m_framePlanValid = false;
 }
 
 Time
@@ -229,6 +270,7 @@ TdmaController::SetTotalSlotsAllowed (uint32_t slotsAllowed)
 {
   m_totalSlotsAllowed = slotsAllowed;
   m_slotPtrs.clear ();
+  m_framePlanValid = false;
 }
 
 uint32_t
@@ -238,49 +280,116 @@ TdmaController::GetTotalSlotsAllowed (void) const
 }
 
 void
-TdmaController::ScheduleTdmaSession (const uint32_t slotNum)
+TdmaController::BuildFramePlan (void)
 {
-  NS_LOG_FUNCTION (slotNum);
-  std::map<uint32_t, Ptr<TdmaMac> >::iterator it = m_slotPtrs.find (slotNum);
-  if (it == m_slotPtrs.end ())
-    {
-      NS_LOG_WARN ("No MAC ptrs in TDMA controller");
-    }
-  uint32_t numOfSlotsAllotted = 1;
-  while (1)
+  NS_LOG_FUNCTION (this);
+  m_framePlan.clear ();
+  m_macs.clear ();
+  Time idleSlot = GetSlotTime () + GetGaurdTime ();
+  Time offset = Seconds (0);
+  uint32_t nextSlot = 0;
+  std::vector<Ptr<TdmaMac> > runMacs;
+  std::vector<Ptr<TdmaMac> > slotMacs;
+  TdmaMacPtrMap::const_iterator it = m_slotPtrs.begin ();
+  while (it != m_slotPtrs.end () && it->first < GetTotalSlotsAllowed ())
     {
-      std::map<uint32_t, Ptr<TdmaMac> >::iterator j = m_slotPtrs.find (slotNum + numOfSlotsAllotted);
-      if (j != m_slotPtrs.end ())
+      offset += MicroSeconds (idleSlot.GetMicroSeconds () * (it->first - nextSlot));
+      uint32_t firstSlot = it->first;
+      uint32_t numOfSlotsAllotted = 1;
+      runMacs.clear ();
+      for (; it != m_slotPtrs.end () && it->first == firstSlot; ++it)
+        {
+          NS_ASSERT (it->second != 0);
+          runMacs.push_back (it->second);
+        }
+      // the map is ordered by slot, so the slots of this run follow it
+      // directly; the run goes on as long as they have the same owners
+      while (it != m_slotPtrs.end () && it->first < GetTotalSlotsAllowed ()
+             && it->first == firstSlot + numOfSlotsAllotted)
         {
-          if (it->second == j->second)
+          slotMacs.clear ();
+          TdmaMacPtrMap::const_iterator next = it;
+          for (; next != m_slotPtrs.end () && next->first == it->first; ++next)
             {
-              numOfSlotsAllotted++;
+              slotMacs.push_back (next->second);
             }
-          else
+          if (slotMacs != runMacs)
             {
               break;
             }
+          it = next;
+          numOfSlotsAllotted++;
         }
-      else
+      NS_LOG_DEBUG ("Number of slots allotted from slot " << firstSlot << " is: " << numOfSlotsAllotted);
+      for (std::vector<Ptr<TdmaMac> >::const_iterator mac = runMacs.begin (); mac != runMacs.end (); ++mac)
         {
-          break;
+          FrameRun run;
+          run.mac = *mac;
+          run.offset = offset;
+          run.durationUs = GetSlotTime ().GetMicroSeconds () * numOfSlotsAllotted;
+          m_framePlan.push_back (run);
+          if (std::find (m_macs.begin (), m_macs.end (), run.mac) == m_macs.end ())
+            {
+              m_macs.push_back (run.mac);
+            }
         }
+      offset += MicroSeconds (GetSlotTime ().GetMicroSeconds () * numOfSlotsAllotted) + GetGaurdTime ();
+      nextSlot = firstSlot + numOfSlotsAllotted;
     }
-  NS_LOG_DEBUG ("Number of slots allotted for this node is: " << numOfSlotsAllotted);
-  Time transmissionSlot = MicroSeconds (GetSlotTime ().GetMicroSeconds () * numOfSlotsAllotted);
-  Time totalTransmissionTimeUs = GetGaurdTime () + transmissionSlot;
-  NS_ASSERT (it->second != NULL);
-  it->second->StartTransmission (transmissionSlot.GetMicroSeconds ());
-  if ((slotNum + numOfSlotsAllotted) == GetTotalSlotsAllowed ())
+  if (nextSlot < GetTotalSlotsAllowed ())
     {
-      NS_LOG_DEBUG ("Starting over all sessions again");
-      Simulator::Schedule ((totalTransmissionTimeUs + GetInterFrameTimeInterval ()), &TdmaController::StartTdmaSessions, this);
+      offset += MicroSeconds (idleSlot.GetMicroSeconds () * (GetTotalSlotsAllowed () - nextSlot));
     }
-  else
+  m_frameLength = offset;
+  if (!m_frameLength.IsZero ())
     {
-      NS_LOG_DEBUG ("Scheduling next session");
-      Simulator::Schedule (totalTransmissionTimeUs, &TdmaController::ScheduleTdmaSession, this, (slotNum + numOfSlotsAllotted));
+      m_frameLength += GetInterFrameTimeInterval ();
     }
+  m_framePlanValid = true;
+  NS_LOG_DEBUG ("Frame plan has " << m_framePlan.size () << " runs, frame length " << m_frameLength);
+}
+
+bool
+TdmaController::ReallocateSlots (void)
+{
+  NS_LOG_FUNCTION (this);
+  std::vector<uint32_t> backlog;
+  backlog.reserve (m_macs.size ());
+  uint32_t totalBacklog = 0;
+  for (std::vector<Ptr<TdmaMac> >::const_iterator i = m_macs.begin (); i != m_macs.end (); ++i)
+    {
+      backlog.push_back ((*i)->GetQueueSize ());
+      totalBacklog += backlog.back ();
+    }
+  if (totalBacklog == 0)
+    {
+      NS_LOG_DEBUG ("No backlog, keeping the static slot assignment");
+      return false;
+    }
+  if (m_slotAllocator == 0)
+    {
+      m_slotAllocator = CreateObject<MaxBacklogTdmaSlotAllocator> ();
+    }
+  std::vector<uint32_t> slots = m_slotAllocator->AllocateSlots (backlog, GetTotalSlotsAllowed ());
+  NS_ASSERT (slots.size () == m_macs.size ());
+  m_dynamicFramePlan.clear ();
+  Time offset = Seconds (0);
+  for (uint32_t i = 0; i < m_macs.size (); i++)
+    {
+      if (slots[i] == 0)
+        {
+          continue;
+        }
+      NS_LOG_DEBUG ("mac " << m_macs[i] << " backlog " << backlog[i] << " gets " << slots[i] << " slots");
+      FrameRun run;
+      run.offset = offset;
+      run.mac = m_macs[i];
+      run.durationUs = GetSlotTime ().GetMicroSeconds () * slots[i];
+      m_dynamicFramePlan.push_back (run);
+      offset += MicroSeconds (run.durationUs) + GetGaurdTime ();
+    }
+  m_dynamicFrameLength = offset + GetInterFrameTimeInterval ();
+  return true;
 }
 
 Time
@@ -291,4 +400,12 @@ TdmaController::CalculateTxTime (Ptr<const Packet> packet)
   return Seconds (m_bps.CalculateTxTime (packet->GetSize ()));
 }
 
+Time
+TdmaController::CalculateAggregateTxTime (Ptr<const Packet> amsdu)
+{
+  NS_LOG_FUNCTION (*amsdu);
+  NS_ASSERT_MSG (amsdu->GetSize () <= 7935,"A-MSDU size must not exceed 7935B, it is: " << amsdu->GetSize ());
+  return Seconds (m_bps.CalculateTxTime (amsdu->GetSize ()));
+}
+
 } // namespace ns3
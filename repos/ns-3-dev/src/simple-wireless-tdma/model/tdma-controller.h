@@ -45,9 +45,11 @@ namespace ns3 {
 enum TdmaMode
 {
   CENTRALIZED = 1,
+  DYNAMIC = 2,
 };
 
 class TdmaMac;
+class TdmaSlotAllocator;
 class TdmaMacLow;
 class SimpleWirelessChannel;
 
@@ -58,7 +60,7 @@ public:
   TdmaController ();
   ~TdmaController ();
 
-  typedef std::map<uint32_t,Ptr<TdmaMac> > TdmaMacPtrMap;
+  typedef std::multimap<uint32_t,Ptr<TdmaMac> > TdmaMacPtrMap;
 
   /**
    * \param slotTime the duration of a slot.
@@ -74,6 +76,11 @@ public:
    */
   void SetDataRate (DataRate bps);
   /**
+   * \param slot the slot to give to the mac
+   * \param macPtr the mac that transmits in the slot
+   *
+   * Several macs may share a slot, for instance nodes that are too far
+   * apart to interfere with each other.
    */
   void AddTdmaSlot (uint32_t slot, Ptr<TdmaMac> macPtr);
   /**
@@ -123,6 +130,14 @@ public:
    */
   void NotifyTxStartNow (Time duration);
   Time CalculateTxTime (Ptr<const Packet> packet);
+  /**
+   * \param amsdu an A-MSDU built by the mac
+   * \returns the time it takes to transmit the A-MSDU
+   *
+   * Unlike CalculateTxTime, accepts frames up to the maximum A-MSDU
+   * length of 7935 bytes.
+   */
+  Time CalculateAggregateTxTime (Ptr<const Packet> amsdu);
   void StartTdmaSessions (void);
   void SetChannel (Ptr<SimpleWirelessChannel> c);
   virtual void Start (void);
@@ -135,9 +150,33 @@ private:
   void DoGrantAccess (void);
   bool IsBusy (void) const;
   void UpdateFrameLength (void);
-  void ScheduleTdmaSession (const uint32_t slotNum);
+  /**
+   * Merge runs of consecutive slots owned by the same macs into the frame
+   * plan that StartTdmaSessions walks once per frame. Slots that nobody
+   * owns are left silent but still take up their slot and gaurd time.
+   * The macs sharing a slot each get a run that starts at the same time.
+   */
+  void BuildFramePlan (void);
+  /**
+   * In DYNAMIC mode, let the SlotAllocator share the slots of the next
+   * frame according to the backlog the macs have now, at the end of the
+   * previous frame. Returns false and leaves the static plan in place if
+   * no mac has anything queued.
+   */
+  bool ReallocateSlots (void);
   Ptr<SimpleWirelessChannel> GetChannel (void) const;
 
+  /**
+   * A run of consecutive slots owned by one mac.
+   */
+  struct FrameRun
+  {
+    Time offset;         //!< start of the run relative to the start of the frame
+    Ptr<TdmaMac> mac;
+    uint64_t durationUs; //!< transmission time of the run, gaurd time excluded
+  };
+  typedef std::vector<FrameRun> FramePlan;
+
 //  Time m_lastRxStart;
 //  Time m_lastRxDuration;
 //  bool m_lastRxReceivedOk;
@@ -154,6 +193,13 @@ private:
   bool m_activeEpoch;
   TdmaMode m_tdmaMode;
   TdmaMacPtrMap m_slotPtrs;
+  FramePlan m_framePlan;
+  Time m_frameLength;
+  bool m_framePlanValid;
+  std::vector<Ptr<TdmaMac> > m_macs;
+  FramePlan m_dynamicFramePlan;
+  Time m_dynamicFrameLength;
+  Ptr<TdmaSlotAllocator> m_slotAllocator;
   Ptr<SimpleWirelessChannel> m_channel;
 };
 
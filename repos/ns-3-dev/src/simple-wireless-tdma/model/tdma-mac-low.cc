@@ -117,9 +117,9 @@ TdmaMacLow::SetDevice (Ptr<TdmaNetDevice> device)
 
 void
 TdmaMacLow::StartTransmission (Ptr<const Packet> packet,
-                               const WifiMacHeader* hdr)
+                               const WifiMacHeader* hdr, Time duration)
 {
-  NS_LOG_FUNCTION (this << packet << hdr);
+  NS_LOG_FUNCTION (this << packet << hdr << duration);
   m_currentPacket = packet->Copy ();
   m_currentHdr = *hdr;
 
@@ -128,21 +128,23 @@ TdmaMacLow::StartTransmission (Ptr<const Packet> packet,
   m_currentPacket->AddHeader (m_currentHdr);
   WifiMacTrailer fcs;
   m_currentPacket->AddTrailer (fcs);
-  ForwardDown (m_currentPacket, &m_currentHdr);
+  ForwardDown (m_currentPacket, &m_currentHdr, duration);
   m_currentPacket = 0;
 }
 
 void
-TdmaMacLow::Receive (Ptr<Packet> packet)
+TdmaMacLow::Receive (Ptr<const Packet> frame)
 {
-  NS_LOG_DEBUG (*packet);
+  NS_LOG_DEBUG (*frame);
+  // the frame is shared by every receiver on the channel: only read the
+  // header here and make a packet of our own for the payload
   WifiMacHeader hdr;
-  packet->RemoveHeader (hdr);
+  uint32_t headerSize = frame->PeekHeader (hdr);
   if (hdr.IsData () || hdr.IsMgt ())
     {
       NS_LOG_DEBUG ("rx group from=" << hdr.GetAddr2 ());
       WifiMacTrailer fcs;
-      packet->RemoveTrailer (fcs);
+      Ptr<Packet> packet = frame->CreateFragment (headerSize, frame->GetSize () - headerSize - fcs.GetSerializedSize ());
       m_rxCallback (packet, &hdr);
     }
   else
@@ -160,13 +162,13 @@ TdmaMacLow::GetSize (Ptr<const Packet> packet, const WifiMacHeader *hdr) const
 }
 
 void
-TdmaMacLow::ForwardDown (Ptr<const Packet> packet, const WifiMacHeader* hdr)
+TdmaMacLow::ForwardDown (Ptr<const Packet> packet, const WifiMacHeader* hdr, Time duration)
 {
   NS_LOG_DEBUG ("send " << hdr->GetTypeString () <<
                 ", to=" << hdr->GetAddr1 () <<
                 ", size=" << packet->GetSize ());
   //HERE IT IS SIMPLEWIRELESSCHANNEL SEND CALL
-  m_channel->Send (packet, this);
+  m_channel->Send (packet, this, duration);
 }
 
 } // namespace ns3
@@ -83,26 +83,25 @@ public:
   /**
    * \param packet packet to send
    * \param hdr 802.11 header for packet to send
+   * \param duration time the packet takes on the air
    *
    * Start the transmission of the input packet and notify the listener
-   * of transmission events.
+   * of transmission events. The receivers get it once the transmission
+   * is over.
    */
   void StartTransmission (Ptr<const Packet> packet,
-                          const WifiMacHeader* hdr);
+                          const WifiMacHeader* hdr, Time duration);
 
   /**
-   * \param packet packet received
-   * \param rxSnr snr of packet received
-   * \param txMode transmission mode of packet received
-   * \param preamble type of preamble used for the packet received
+   * \param packet frame received, shared with the other receivers
    *
    * This method is typically invoked by the lower PHY layer to notify
    * the MAC layer that a packet was successfully received.
    */
-  void Receive (Ptr<Packet> packet);
+  void Receive (Ptr<const Packet> packet);
 private:
   uint32_t GetSize (Ptr<const Packet> packet, const WifiMacHeader *hdr) const;
-  void ForwardDown (Ptr<const Packet> packet, const WifiMacHeader *hdr);
+  void ForwardDown (Ptr<const Packet> packet, const WifiMacHeader *hdr, Time duration);
   virtual Ptr<SimpleWirelessChannel> GetChannel (void) const;
   virtual void DoDispose (void);
   TdmaMacLowRxCallback m_rxCallback;
@@ -32,6 +32,7 @@
 #include "ns3/uinteger.h"
 #include "ns3/log.h"
 #include "tdma-mac-queue.h"
+#include <algorithm>
 
 using namespace std;
 NS_LOG_COMPONENT_DEFINE ("TdmaMacQueue");
@@ -39,6 +40,10 @@ namespace ns3 {
 
 NS_OBJECT_ENSURE_REGISTERED (TdmaMacQueue);
 
+TdmaMacQueue::Item::Item ()
+{
+}
+
 TdmaMacQueue::Item::Item (Ptr<const Packet> packet,
                           const WifiMacHeader &hdr,
                           Time tstamp)
@@ -67,7 +72,9 @@ TdmaMacQueue::GetTypeId (void)
 }
 
 TdmaMacQueue::TdmaMacQueue ()
-  : m_size (0),
+  : m_head (0),
+    m_used (0),
+    m_size (0),
     m_count (0)
 {
   NS_LOG_FUNCTION_NOARGS ();
@@ -114,6 +121,12 @@ TdmaMacQueue::GetMaxDelay (void) const
   return m_maxDelay;
 }
 
+TdmaMacQueue::Item &
+TdmaMacQueue::At (uint32_t i)
+{
+  return m_queue[(m_head + i) % m_queue.size ()];
+}
+
 bool
 TdmaMacQueue::Enqueue (Ptr<const Packet> packet, const WifiMacHeader &hdr)
 {
@@ -123,8 +136,14 @@ TdmaMacQueue::Enqueue (Ptr<const Packet> packet, const WifiMacHeader &hdr)
     {
       return false;
     }
+  if (m_used == m_queue.size ())
+    {
+      Grow ();
+    }
   Time now = Simulator::Now ();
-  m_queue.push_back (Item (packet, hdr, now));
+  At (m_used) = Item (packet, hdr, now);
+  m_index.insert (std::make_pair (PeekPointer (packet), (m_head + m_used) % m_queue.size ()));
+  m_used++;
   m_size++;
   NS_LOG_DEBUG ("Inserted packet of size: " << packet->GetSize ()
                                             << " uid: " << packet->GetUid ());
@@ -132,34 +151,79 @@ TdmaMacQueue::Enqueue (Ptr<const Packet> packet, const WifiMacHeader &hdr)
 }
 
 void
-TdmaMacQueue::Cleanup (void)
+TdmaMacQueue::Grow (void)
 {
-  NS_LOG_FUNCTION_NOARGS ();
-  if (m_queue.empty ())
+  NS_LOG_FUNCTION (this << m_used << m_size);
+  uint32_t capacity = m_queue.size ();
+  if (m_size >= capacity / 2)
     {
-      return;
+      capacity = std::max<uint32_t> (16, 2 * capacity);
     }
-  Time now = Simulator::Now ();
-  uint32_t n = 0;
-  for (PacketQueueI i = m_queue.begin (); i != m_queue.end (); )
+  PacketQueue queue (capacity);
+  uint32_t j = 0;
+  for (uint32_t i = 0; i < m_used; i++)
     {
-      if (i->tstamp + m_maxDelay > now)
+      if (At (i).packet != 0)
         {
-          i++;
-        }
-      else
-        {
-          m_count++;
-          NS_LOG_DEBUG (Simulator::Now ().GetSeconds () << "s Dropping this packet as its exceeded queue time, pid: " << i->packet->GetUid ()
-                                                        << " macPtr: " << m_macPtr
-                                                        << " queueSize: " << m_queue.size ()
-                                                        << " count:" << m_count);
-          m_txDropCallback (i->packet);
-          i = m_queue.erase (i);
-          n++;
+          queue[j++] = At (i);
         }
     }
-  m_size -= n;
+  NS_ASSERT (j == m_size);
+  m_queue.swap (queue);
+  m_head = 0;
+  m_used = m_size;
+  // the entries moved: index them again, in ring order so that the
+  // entries of a packet stay oldest first
+  m_index.clear ();
+  for (uint32_t i = 0; i < m_used; i++)
+    {
+      m_index.insert (std::make_pair (PeekPointer (m_queue[i].packet), i));
+    }
+}
+
+void
+TdmaMacQueue::UnindexHead (void)
+{
+  PacketIndex::iterator it = m_index.lower_bound (PeekPointer (At (0).packet));
+  NS_ASSERT (it != m_index.end () && it->second == m_head);
+  m_index.erase (it);
+}
+
+void
+TdmaMacQueue::SkipRemoved (void)
+{
+  while (m_used > 0 && At (0).packet == 0)
+    {
+      m_head = (m_head + 1) % m_queue.size ();
+      m_used--;
+    }
+}
+
+void
+TdmaMacQueue::Cleanup (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  SkipRemoved ();
+  Time now = Simulator::Now ();
+  // packets are in enqueue order, so the first one that has not expired
+  // is followed by fresher packets only
+  while (m_used > 0 && At (0).tstamp + m_maxDelay <= now)
+    {
+      Item &item = At (0);
+      m_count++;
+      NS_LOG_DEBUG (Simulator::Now ().GetSeconds () << "s Dropping this packet as its exceeded queue time, pid: " << item.packet->GetUid ()
+                                                    << " macPtr: " << m_macPtr
+                                                    << " queueSize: " << m_size
+                                                    << " count:" << m_count);
+      Ptr<const Packet> packet = item.packet;
+      UnindexHead ();
+      item = Item ();
+      m_head = (m_head + 1) % m_queue.size ();
+      m_used--;
+      m_size--;
+      m_txDropCallback (packet);
+      SkipRemoved ();
+    }
 }
 
 Ptr<const Packet>
@@ -167,14 +231,19 @@ TdmaMacQueue::Dequeue (WifiMacHeader *hdr)
 {
   NS_LOG_FUNCTION_NOARGS ();
   Cleanup ();
-  if (!m_queue.empty ())
+  if (m_used > 0)
     {
-      Item i = m_queue.front ();
-      m_queue.pop_front ();
-      m_size--;
+      Item &i = At (0);
+      Ptr<const Packet> packet = i.packet;
       *hdr = i.hdr;
-      NS_LOG_DEBUG ("Dequeued packet of size: " << i.packet->GetSize ());
-      return i.packet;
+      UnindexHead ();
+      i = Item ();
+      m_head = (m_head + 1) % m_queue.size ();
+      m_used--;
+      m_size--;
+      SkipRemoved ();
+      NS_LOG_DEBUG ("Dequeued packet of size: " << packet->GetSize ());
+      return packet;
     }
   return 0;
 }
@@ -184,9 +253,9 @@ TdmaMacQueue::Peek (WifiMacHeader *hdr)
 {
   NS_LOG_FUNCTION_NOARGS ();
   Cleanup ();
-  if (!m_queue.empty ())
+  if (m_used > 0)
     {
-      Item i = m_queue.front ();
+      Item &i = At (0);
       *hdr = i.hdr;
       return i.packet;
     }
@@ -197,7 +266,7 @@ bool
 TdmaMacQueue::IsEmpty (void)
 {
   Cleanup ();
-  return m_queue.empty ();
+  return m_size == 0;
 }
 
 uint32_t
@@ -209,24 +278,30 @@ TdmaMacQueue::GetSize (void)
 void
 TdmaMacQueue::Flush (void)
 {
-  m_queue.erase (m_queue.begin (), m_queue.end ());
+  for (uint32_t i = 0; i < m_used; i++)
+    {
+      At (i) = Item ();
+    }
+  m_index.clear ();
+  m_head = 0;
+  m_used = 0;
   m_size = 0;
 }
 
 Mac48Address
-TdmaMacQueue::GetAddressForPacket (enum WifiMacHeader::AddressType type, PacketQueueI it)
+TdmaMacQueue::GetAddressForPacket (enum WifiMacHeader::AddressType type, const Item &item)
 {
   if (type == WifiMacHeader::ADDR1)
     {
-      return it->hdr.GetAddr1 ();
+      return item.hdr.GetAddr1 ();
     }
   if (type == WifiMacHeader::ADDR2)
     {
-      return it->hdr.GetAddr2 ();
+      return item.hdr.GetAddr2 ();
     }
   if (type == WifiMacHeader::ADDR3)
     {
-      return it->hdr.GetAddr3 ();
+      return item.hdr.GetAddr3 ();
     }
   return 0;
 }
@@ -234,16 +309,22 @@ TdmaMacQueue::GetAddressForPacket (enum WifiMacHeader::AddressType type, PacketQ
 bool
 TdmaMacQueue::Remove (Ptr<const Packet> packet)
 {
-  PacketQueueI it = m_queue.begin ();
-  for (; it != m_queue.end (); it++)
+  // lower_bound, unlike find, gives the oldest entry of the packet
+  PacketIndex::iterator it = m_index.lower_bound (PeekPointer (packet));
+  if (it == m_index.end () || it->first != PeekPointer (packet))
     {
-      if (it->packet == packet)
-        {
-          m_queue.erase (it);
-          m_size--;
-          return true;
-        }
+      return false;
     }
-  return false;
+  m_queue[it->second] = Item ();
+  m_index.erase (it);
+  m_size--;
+  // the entry is skipped once it reaches the head; one at the
+  // tail can be reused right away
+  while (m_used > 0 && At (m_used - 1).packet == 0)
+    {
+      m_used--;
+    }
+  SkipRemoved ();
+  return true;
 }
 } // namespace ns3
@@ -31,7 +31,8 @@
 #ifndef TDMA_MAC_QUEUE_H
 #define TDMA_MAC_QUEUE_H
 
-#include <list>
+#include <vector>
+#include <map>
 #include "ns3/packet.h"
 #include "ns3/nstime.h"
 #include "ns3/object.h"
@@ -53,6 +54,14 @@ namespace ns3 {
  * When a packet is dequeued, the queue checks its timestamp
  * to verify whether or not it should be dropped. If m_maxDelay has
  * elapsed, it is dropped. Otherwise, it is returned to the caller.
+ *
+ * The packets are kept in a ring buffer. Since packets are stamped in
+ * the order they are enqueued, the expired packets are always at the
+ * head and expiry stops at the first packet that is still fresh.
+ * Removed packets leave an empty entry behind that is skipped when it
+ * reaches the head, or squeezed out when the ring has to grow. An index
+ * from the packets to their entries lets Remove find a packet without
+ * scanning the ring.
  */
 class TdmaMacQueue : public Object
 {
@@ -92,8 +101,10 @@ public:
   Ptr<const Packet> Peek (WifiMacHeader *hdr);
   /**
    * If exists, removes <i>packet</i> from queue and returns true. Otherwise it
-   * takes no effects and return false. Deletion of the packet is
-   * performed in linear time (O(n)).
+   * takes no effects and return false. Finding the packet takes
+   * logarithmic time (O(log n)); removing it does not move the other
+   * packets. If the packet was enqueued more than once, its oldest entry
+   * is removed.
    */
   bool Remove (Ptr<const Packet> packet);
   void SetTdmaMacTxDropCallback (Callback<void,Ptr<const Packet> > callback);
@@ -109,24 +120,44 @@ public:
 private:
   struct Item;
 
-  typedef std::list<struct Item> PacketQueue;
-  typedef std::list<struct Item>::reverse_iterator PacketQueueRI;
-  typedef std::list<struct Item>::iterator PacketQueueI;
+  typedef std::vector<struct Item> PacketQueue;
+  /// the entries of each packet in the ring, oldest first
+  typedef std::multimap<const Packet *, uint32_t> PacketIndex;
 
   void Cleanup (void);
-  Mac48Address GetAddressForPacket (enum WifiMacHeader::AddressType type, PacketQueueI);
+  /**
+   * Drop the removed entries at the head of the ring
+   */
+  void SkipRemoved (void);
+  /**
+   * Called when every entry of the ring is used: squeeze out the removed
+   * entries, and double the ring unless that freed half of it.
+   */
+  void Grow (void);
+  Item &At (uint32_t i);
+  /**
+   * Forget the entry of the packet at the head of the ring, which is
+   * always the oldest entry of that packet in the index.
+   */
+  void UnindexHead (void);
+  Mac48Address GetAddressForPacket (enum WifiMacHeader::AddressType type, const Item &item);
 
   struct Item
   {
+    Item ();
     Item (Ptr<const Packet> packet,
           const WifiMacHeader &hdr,
           Time tstamp);
+    /// null once the packet was removed from the queue
     Ptr<const Packet> packet;
     WifiMacHeader hdr;
     Time tstamp;
   };
 
   PacketQueue m_queue;
+  PacketIndex m_index;
+  uint32_t m_head;
+  uint32_t m_used;
   uint32_t m_size;
   uint32_t m_maxSize;
   Time m_maxDelay;
@@ -33,6 +33,7 @@
 #include "ns3/pointer.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/log.h"
+#include "ns3/simulator.h"
 
 NS_LOG_COMPONENT_DEFINE ("TdmaMac");
 
@@ -82,4 +83,10 @@ TdmaMac::GetMaxPropagationDelay (void) const
 {
   return m_maxPropagationDelay;
 }
+
+void
+TdmaMac::ScheduleTransmission (Time delay, uint64_t transmissionTime)
+{
+  Simulator::Schedule (delay, &TdmaMac::StartTransmission, this, transmissionTime);
+}
 } // namespace ns3
@@ -126,7 +126,22 @@ public:
   virtual void SetTxQueueStopCallback (Callback<bool,uint32_t> queueStop) = 0;
   virtual uint32_t GetQueueState (uint32_t index) = 0;
   virtual uint32_t GetNQueues (void) = 0;
+  /**
+   * \returns the number of packets waiting in the transmit queue; used by
+   * the TdmaController in DYNAMIC mode to share the slots of a frame.
+   */
+  virtual uint32_t GetQueueSize (void) = 0;
   virtual void StartTransmission (uint64_t transmissionTime) = 0;
+  /**
+   * \param delay time from now at which the slot starts
+   * \param transmissionTime duration of the slot in microseconds
+   *
+   * Called by the TdmaController at the start of every frame for each of
+   * the slots of this mac. The default implementation schedules
+   * StartTransmission at the start of the slot; subclasses may avoid the
+   * event when they know they have nothing to send.
+   */
+  virtual void ScheduleTransmission (Time delay, uint64_t transmissionTime);
   /**
    * Public method used to fire a MacTx trace.  Implemented for encapsulation
    * purposes.
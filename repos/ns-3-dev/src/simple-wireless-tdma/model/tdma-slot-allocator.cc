@@ -0,0 +1,180 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "tdma-slot-allocator.h"
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE ("TdmaSlotAllocator");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (TdmaSlotAllocator);
+NS_OBJECT_ENSURE_REGISTERED (MaxBacklogTdmaSlotAllocator);
+NS_OBJECT_ENSURE_REGISTERED (ProportionalFairTdmaSlotAllocator);
+
+TypeId
+TdmaSlotAllocator::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TdmaSlotAllocator")
+    .SetParent<Object> ()
+    .AddAttribute ("PacketsPerSlot", "Number of queued packets a mac is assumed to send in one slot.",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&TdmaSlotAllocator::m_packetsPerSlot),
+                   MakeUintegerChecker<uint32_t> (1))
+  ;
+  return tid;
+}
+
+TdmaSlotAllocator::TdmaSlotAllocator ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+TdmaSlotAllocator::~TdmaSlotAllocator ()
+{
+}
+
+std::vector<uint32_t>
+TdmaSlotAllocator::AllocateSlots (const std::vector<uint32_t> &backlog, uint32_t totalSlots)
+{
+  NS_LOG_FUNCTION (this << backlog.size () << totalSlots);
+  std::vector<uint32_t> slots (backlog.size (), 0);
+  DoAllocateSlots (backlog, slots, totalSlots);
+  uint32_t assigned = 0;
+  uint32_t withBacklog = 0;
+  for (uint32_t i = 0; i < slots.size (); i++)
+    {
+      assigned += slots[i];
+      if (backlog[i] > 0)
+        {
+          withBacklog++;
+        }
+    }
+  NS_ASSERT (assigned <= totalSlots);
+  // the backlog is covered, share what is left among the macs with traffic
+  for (uint32_t i = 0; assigned < totalSlots && withBacklog > 0; i = (i + 1) % slots.size ())
+    {
+      if (backlog[i] > 0)
+        {
+          slots[i]++;
+          assigned++;
+        }
+    }
+  return slots;
+}
+
+TypeId
+MaxBacklogTdmaSlotAllocator::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::MaxBacklogTdmaSlotAllocator")
+    .SetParent<TdmaSlotAllocator> ()
+    .AddConstructor<MaxBacklogTdmaSlotAllocator> ()
+  ;
+  return tid;
+}
+
+MaxBacklogTdmaSlotAllocator::MaxBacklogTdmaSlotAllocator ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+MaxBacklogTdmaSlotAllocator::DoAllocateSlots (const std::vector<uint32_t> &backlog, std::vector<uint32_t> &slots,
+                                              uint32_t totalSlots)
+{
+  std::vector<int64_t> remaining (backlog.begin (), backlog.end ());
+  for (uint32_t slot = 0; slot < totalSlots; slot++)
+    {
+      uint32_t best = 0;
+      for (uint32_t i = 1; i < remaining.size (); i++)
+        {
+          if (remaining[i] > remaining[best])
+            {
+              best = i;
+            }
+        }
+      if (remaining.empty () || remaining[best] <= 0)
+        {
+          break;
+        }
+      slots[best]++;
+      remaining[best] -= m_packetsPerSlot;
+    }
+}
+
+TypeId
+ProportionalFairTdmaSlotAllocator::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ProportionalFairTdmaSlotAllocator")
+    .SetParent<TdmaSlotAllocator> ()
+    .AddConstructor<ProportionalFairTdmaSlotAllocator> ()
+    .AddAttribute ("Window", "Number of frames over which the slots given to a mac are averaged.",
+                   UintegerValue (10),
+                   MakeUintegerAccessor (&ProportionalFairTdmaSlotAllocator::m_window),
+                   MakeUintegerChecker<uint32_t> (1))
+  ;
+  return tid;
+}
+
+ProportionalFairTdmaSlotAllocator::ProportionalFairTdmaSlotAllocator ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+ProportionalFairTdmaSlotAllocator::DoAllocateSlots (const std::vector<uint32_t> &backlog, std::vector<uint32_t> &slots,
+                                                    uint32_t totalSlots)
+{
+  if (m_averageSlots.size () != backlog.size ())
+    {
+      m_averageSlots.assign (backlog.size (), 1.0);
+    }
+  std::vector<int64_t> remaining (backlog.begin (), backlog.end ());
+  for (uint32_t slot = 0; slot < totalSlots; slot++)
+    {
+      int32_t best = -1;
+      double bestMetric = 0;
+      for (uint32_t i = 0; i < remaining.size (); i++)
+        {
+          if (remaining[i] <= 0)
+            {
+              continue;
+            }
+          double metric = remaining[i] / m_averageSlots[i];
+          if (best < 0 || metric > bestMetric)
+            {
+              best = i;
+              bestMetric = metric;
+            }
+        }
+      if (best < 0)
+        {
+          break;
+        }
+      slots[best]++;
+      remaining[best] -= m_packetsPerSlot;
+    }
+  double alpha = 1.0 / m_window;
+  for (uint32_t i = 0; i < m_averageSlots.size (); i++)
+    {
+      // keep the average away from zero so that idle macs do not get an
+      // infinite priority once they have traffic again
+      m_averageSlots[i] = std::max ((1 - alpha) * m_averageSlots[i] + alpha * slots[i], alpha);
+    }
+}
+
+} // namespace ns3
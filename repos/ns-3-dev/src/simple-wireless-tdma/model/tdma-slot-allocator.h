@@ -0,0 +1,105 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef TDMA_SLOT_ALLOCATOR_H
+#define TDMA_SLOT_ALLOCATOR_H
+
+#include "ns3/object.h"
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief base class of the policies used by a TdmaController in DYNAMIC
+ * mode to share the slots of the next frame among its macs.
+ *
+ * The controller calls AllocateSlots at the end of every frame with the
+ * number of packets queued at each mac. Macs are always passed in the same
+ * order, so an allocator may keep per-mac state between frames.
+ */
+class TdmaSlotAllocator : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+  TdmaSlotAllocator ();
+  virtual ~TdmaSlotAllocator ();
+
+  /**
+   * \param backlog number of packets queued at each mac at the end of the frame
+   * \param totalSlots number of slots in the next frame
+   * \returns the number of slots each mac owns in the next frame. Unless
+   * the whole backlog is zero, the slots add up to totalSlots.
+   */
+  std::vector<uint32_t> AllocateSlots (const std::vector<uint32_t> &backlog, uint32_t totalSlots);
+
+protected:
+  /**
+   * \param backlog number of packets queued at each mac
+   * \param slots number of slots given to each mac so far, initially 0
+   * \param totalSlots number of slots in the next frame
+   *
+   * Give slots to the macs according to the policy. The allocator may
+   * stop as soon as all the backlog is covered; remaining slots are then
+   * handed round-robin to the macs that have backlog.
+   */
+  virtual void DoAllocateSlots (const std::vector<uint32_t> &backlog, std::vector<uint32_t> &slots,
+                                uint32_t totalSlots) = 0;
+
+  /**
+   * Number of packets a mac is assumed to send in one slot
+   */
+  uint32_t m_packetsPerSlot;
+};
+
+/**
+ * \brief gives every slot to the mac with the largest backlog left.
+ *
+ * Each slot lowers the backlog of its mac by PacketsPerSlot, so a mac
+ * with a deep queue gets as many slots as it can use before the others
+ * are served. Ties go to the mac that comes first.
+ */
+class MaxBacklogTdmaSlotAllocator : public TdmaSlotAllocator
+{
+public:
+  static TypeId GetTypeId (void);
+  MaxBacklogTdmaSlotAllocator ();
+private:
+  virtual void DoAllocateSlots (const std::vector<uint32_t> &backlog, std::vector<uint32_t> &slots,
+                                uint32_t totalSlots);
+};
+
+/**
+ * \brief proportional fair sharing of the slots.
+ *
+ * Every slot goes to the mac with the highest ratio between the backlog
+ * it has left and the average number of slots it got per frame. The
+ * average is an exponentially weighted moving average over Window frames,
+ * so a mac that was served a lot recently yields to the others.
+ */
+class ProportionalFairTdmaSlotAllocator : public TdmaSlotAllocator
+{
+public:
+  static TypeId GetTypeId (void);
+  ProportionalFairTdmaSlotAllocator ();
+private:
+  virtual void DoAllocateSlots (const std::vector<uint32_t> &backlog, std::vector<uint32_t> &slots,
+                                uint32_t totalSlots);
+  uint32_t m_window;
+  std::vector<double> m_averageSlots;
+};
+
+} // namespace ns3
+
+#endif /* TDMA_SLOT_ALLOCATOR_H */
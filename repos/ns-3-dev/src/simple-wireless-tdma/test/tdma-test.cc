@@ -45,6 +45,17 @@
 #include "ns3/config.h"
 #include "ns3/node-container.h"
 #include "ns3/mobility-helper.h"
+#include "ns3/constant-velocity-mobility-model.h"
+#include "ns3/wifi-mac-header.h"
+#include "ns3/wifi-mac-trailer.h"
+#include "ns3/tdma-slot-allocator.h"
+#include "ns3/tdma-mac-queue.h"
+#include "ns3/msdu-aggregator.h"
+#include "ns3/object-factory.h"
+#include "ns3/pointer.h"
+#include "ns3/enum.h"
+#include "ns3/tdma-slot-assignment-parser.h"
+#include <fstream>
 
 namespace ns3 {
 class TdmaSlotAllocationTestCase : public TestCase
@@ -215,12 +226,970 @@ TdmaSlotAllocationTestCase::MacTxTrace (Ptr<Packet> packet, const WifiMacHeader
     }
 }
 
+/// airtime of a 1000 byte packet at the default 11Mb/s of TdmaController
+static const int64_t AIRTIME_1000B_US = 727;
+/// propagation delay of SimpleWirelessChannel over 303m
+static const int64_t PROPAGATION_303M_US = 1;
+
+/**
+ * \param n the number of nodes
+ * \param spacing the distance between two consecutive nodes
+ * \returns nodes placed on the x axis, with a ConstantPositionMobilityModel
+ */
+static NodeContainer
+CreateTdmaNodes (uint32_t n, double spacing)
+{
+  NodeContainer nodes;
+  nodes.Create (n);
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (nodes);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      nodes.Get (i)->GetObject<MobilityModel> ()->SetPosition (Vector (spacing * i, 0, 0));
+    }
+  return nodes;
+}
+
+/**
+ * \param slotTime the duration of a slot
+ * \param slots the number of slots of a frame
+ * \returns a controller with 100us guard times and no inter frame time
+ */
+static Ptr<TdmaController>
+CreateTdmaController (Time slotTime, uint32_t slots)
+{
+  Ptr<TdmaController> controller = CreateObject<TdmaController> ();
+  controller->SetSlotTime (slotTime);
+  controller->SetGaurdTime (MicroSeconds (100));
+  controller->SetInterFrameTimeInterval (MicroSeconds (0));
+  controller->SetTotalSlotsAllowed (slots);
+  return controller;
+}
+
+/**
+ * \param nodes the nodes to give a device to
+ * \param controller the controller of all the devices
+ * \param channel the channel of all the devices
+ * \param rx the receive callback of the mac lows, if not null
+ * \param assignSlots whether to give slot i to the mac of node i
+ * \param macs filled with the mac of each node
+ * \returns the device of each node
+ */
+static std::vector<Ptr<TdmaNetDevice> >
+BuildTdmaNetwork (NodeContainer nodes, Ptr<TdmaController> controller, Ptr<SimpleWirelessChannel> channel,
+                  TdmaMacLow::TdmaMacLowRxCallback rx, bool assignSlots, std::vector<Ptr<TdmaCentralMac> > &macs)
+{
+  std::vector<Ptr<TdmaNetDevice> > devices;
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      Ptr<TdmaNetDevice> device = CreateObject<TdmaNetDevice> ();
+      device->SetNode (nodes.Get (i));
+      Ptr<TdmaCentralMac> mac = CreateObject<TdmaCentralMac> ();
+      mac->SetAddress (Mac48Address::Allocate ());
+      device->SetMac (mac);
+      device->SetTdmaController (controller);
+      device->SetChannel (channel);
+      if (!rx.IsNull ())
+        {
+          mac->GetTdmaMacLow ()->SetRxCallback (rx);
+        }
+      if (assignSlots)
+        {
+          controller->AddTdmaSlot (i, mac);
+        }
+      devices.push_back (device);
+      macs.push_back (mac);
+    }
+  return devices;
+}
+
+/**
+ * Destroys the simulator, then the devices built by BuildTdmaNetwork.
+ */
+static void
+DestroyTdmaNetwork (std::vector<Ptr<TdmaNetDevice> > &devices)
+{
+  Simulator::Destroy ();
+  for (uint32_t i = 0; i < devices.size (); i++)
+    {
+      devices[i]->Dispose ();
+    }
+  devices.clear ();
+}
+
+/**
+ * The MacTx trace of TdmaCentralMac fires once a packet has been
+ * transmitted, with or without the collision model of the channel.
+ */
+class TdmaMacTxTimeTestCase : public TestCase
+{
+public:
+  TdmaMacTxTimeTestCase (bool interference);
+  virtual void DoRun (void);
+private:
+  void MacTx (Ptr<const Packet> packet);
+  void Receive (Ptr<Packet> packet, const WifiMacHeader *hdr);
+  bool m_interference;
+  std::vector<int64_t> m_txTimesUs;
+  std::vector<int64_t> m_rxTimesUs;
+};
+
+TdmaMacTxTimeTestCase::TdmaMacTxTimeTestCase (bool interference)
+  : TestCase (interference ? "Tdma MacTx fires at the end of the transmission with interference"
+              : "Tdma MacTx fires at the end of the transmission"),
+    m_interference (interference)
+{
+}
+
+void
+TdmaMacTxTimeTestCase::MacTx (Ptr<const Packet> packet)
+{
+  m_txTimesUs.push_back (Simulator::Now ().GetMicroSeconds ());
+}
+
+void
+TdmaMacTxTimeTestCase::Receive (Ptr<Packet> packet, const WifiMacHeader *hdr)
+{
+  m_rxTimesUs.push_back (Simulator::Now ().GetMicroSeconds ());
+}
+
+void
+TdmaMacTxTimeTestCase::DoRun (void)
+{
+  Ptr<TdmaController> tdmaController = CreateTdmaController (MicroSeconds (2000), 2);
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  channel->SetAttribute ("MaxRange", DoubleValue (303));
+  channel->SetAttribute ("Interference", BooleanValue (m_interference));
+  std::vector<Ptr<TdmaCentralMac> > macs;
+  std::vector<Ptr<TdmaNetDevice> > devices = BuildTdmaNetwork (CreateTdmaNodes (2, 303), tdmaController, channel,
+                                                               MakeCallback (&TdmaMacTxTimeTestCase::Receive, this), true, macs);
+  macs[0]->TraceConnectWithoutContext ("MacTx", MakeCallback (&TdmaMacTxTimeTestCase::MacTx, this));
+
+  // two packets sent back to back in the first slot
+  macs[0]->Enqueue (Create<Packet> (1000), macs[1]->GetAddress ());
+  macs[0]->Enqueue (Create<Packet> (1000), macs[1]->GetAddress ());
+  tdmaController->StartTdmaSessions ();
+  Simulator::Stop (MilliSeconds (3));
+  Simulator::Run ();
+  DestroyTdmaNetwork (devices);
+
+  NS_TEST_ASSERT_MSG_EQ (m_txTimesUs.size (), 2, "both packets should be transmitted");
+  NS_TEST_EXPECT_MSG_EQ (m_txTimesUs[0], AIRTIME_1000B_US, "MacTx should fire at the end of the first transmission");
+  NS_TEST_EXPECT_MSG_EQ (m_txTimesUs[1], 2 * AIRTIME_1000B_US, "MacTx should fire at the end of the second transmission");
+  NS_TEST_ASSERT_MSG_EQ (m_rxTimesUs.size (), 2, "both packets should be received");
+  NS_TEST_EXPECT_MSG_EQ (m_rxTimesUs[0], AIRTIME_1000B_US + PROPAGATION_303M_US, "first packet received after its transmission");
+  NS_TEST_EXPECT_MSG_EQ (m_rxTimesUs[1], 2 * AIRTIME_1000B_US + PROPAGATION_303M_US, "second packet received after its transmission");
+}
+
+/**
+ * A mac whose queue is empty when the frame starts must still use its
+ * slot if a packet is queued before that slot begins.
+ */
+class TdmaIdleSlotTestCase : public TestCase
+{
+public:
+  TdmaIdleSlotTestCase ();
+  virtual void DoRun (void);
+private:
+  void Receive (Ptr<Packet> packet, const WifiMacHeader *hdr);
+  std::vector<int64_t> m_rxTimesUs;
+};
+
+TdmaIdleSlotTestCase::TdmaIdleSlotTestCase ()
+  : TestCase ("Tdma slot of an idle mac is used by a packet queued before the slot")
+{
+}
+
+void
+TdmaIdleSlotTestCase::Receive (Ptr<Packet> packet, const WifiMacHeader *hdr)
+{
+  m_rxTimesUs.push_back (Simulator::Now ().GetMicroSeconds ());
+}
+
+void
+TdmaIdleSlotTestCase::DoRun (void)
+{
+  Ptr<TdmaController> tdmaController = CreateTdmaController (MicroSeconds (1100), 2);
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  channel->SetAttribute ("MaxRange", DoubleValue (303));
+  std::vector<Ptr<TdmaCentralMac> > macs;
+  std::vector<Ptr<TdmaNetDevice> > devices = BuildTdmaNetwork (CreateTdmaNodes (2, 303), tdmaController, channel,
+                                                               MakeCallback (&TdmaIdleSlotTestCase::Receive, this), true, macs);
+
+  // the second slot starts at 1200us; the packet is queued at 500us, after
+  // the frame started with an empty queue. A packet queued at 1500us is
+  // too late for the first frame and goes out in the second slot of the
+  // next frame at 3600us.
+  void (TdmaCentralMac::*enqueue) (Ptr<const Packet>, Mac48Address) = &TdmaCentralMac::Enqueue;
+  Simulator::Schedule (MicroSeconds (500), enqueue, macs[1], Create<Packet> (1000), macs[0]->GetAddress ());
+  Simulator::Schedule (MicroSeconds (1500), enqueue, macs[1], Create<Packet> (1000), macs[0]->GetAddress ());
+  tdmaController->StartTdmaSessions ();
+  Simulator::Stop (MilliSeconds (5));
+  Simulator::Run ();
+  DestroyTdmaNetwork (devices);
+
+  NS_TEST_ASSERT_MSG_EQ (m_rxTimesUs.size (), 2, "both packets should be received");
+  NS_TEST_ASSERT_MSG_EQ (m_rxTimesUs[0], 1200 + AIRTIME_1000B_US + PROPAGATION_303M_US,
+                         "first packet should use the slot of the frame it was queued in");
+  NS_TEST_ASSERT_MSG_EQ (m_rxTimesUs[1], 3600 + AIRTIME_1000B_US + PROPAGATION_303M_US,
+                         "second packet should use the slot of the next frame");
+}
+
+/**
+ * Checks how the slot allocators of the DYNAMIC mode share a frame.
+ */
+class TdmaSlotAllocatorTestCase : public TestCase
+{
+public:
+  TdmaSlotAllocatorTestCase ();
+  virtual void DoRun (void);
+};
+
+TdmaSlotAllocatorTestCase::TdmaSlotAllocatorTestCase ()
+  : TestCase ("Tdma slot allocators share the slots of a frame according to the backlog")
+{
+}
+
+void
+TdmaSlotAllocatorTestCase::DoRun (void)
+{
+  Ptr<TdmaSlotAllocator> maxBacklog = CreateObject<MaxBacklogTdmaSlotAllocator> ();
+  std::vector<uint32_t> backlog;
+  backlog.push_back (5);
+  backlog.push_back (0);
+  backlog.push_back (2);
+  std::vector<uint32_t> slots = maxBacklog->AllocateSlots (backlog, 4);
+  NS_TEST_ASSERT_MSG_EQ (slots.size (), 3, "one entry per mac");
+  NS_TEST_ASSERT_MSG_EQ (slots[0], 4, "the deepest queue should get every slot it can use first");
+  NS_TEST_ASSERT_MSG_EQ (slots[1], 0, "a mac without backlog should get no slot");
+  NS_TEST_ASSERT_MSG_EQ (slots[2], 0, "the shorter queue waits");
+
+  // 7 slots cover the backlog, the 3 left over are shared round-robin
+  slots = maxBacklog->AllocateSlots (backlog, 10);
+  NS_TEST_ASSERT_MSG_EQ (slots[0] + slots[1] + slots[2], 10, "all slots should be given away");
+  NS_TEST_ASSERT_MSG_EQ (slots[0], 7, "the mac should get its backlog plus two leftover slots");
+  NS_TEST_ASSERT_MSG_EQ (slots[1], 0, "a mac without backlog should get no slot");
+  NS_TEST_ASSERT_MSG_EQ (slots[2], 3, "the mac should get its backlog plus one leftover slot");
+
+  std::vector<uint32_t> idle (3, 0);
+  slots = maxBacklog->AllocateSlots (idle, 4);
+  NS_TEST_ASSERT_MSG_EQ (slots[0] + slots[1] + slots[2], 0, "no slots should be given without backlog");
+
+  // with two equally backlogged macs and one slot per frame, max backlog
+  // always serves the first one while proportional fair alternates
+  std::vector<uint32_t> equal (2, 100);
+  Ptr<TdmaSlotAllocator> fair = CreateObject<ProportionalFairTdmaSlotAllocator> ();
+  uint32_t maxBacklogFirst = 0;
+  uint32_t fairFirst = 0;
+  for (uint32_t frame = 0; frame < 10; frame++)
+    {
+      maxBacklogFirst += maxBacklog->AllocateSlots (equal, 1)[0];
+      fairFirst += fair->AllocateSlots (equal, 1)[0];
+    }
+  NS_TEST_ASSERT_MSG_EQ (maxBacklogFirst, 10, "max backlog should break ties towards the first mac");
+  NS_TEST_ASSERT_MSG_EQ (fairFirst, 5, "proportional fair should share the slots evenly");
+}
+
+/**
+ * One of four macs has a backlog; in DYNAMIC mode it should get the
+ * slots of the idle macs and deliver more packets than in CENTRALIZED
+ * mode over the same time.
+ */
+class TdmaDynamicModeTestCase : public TestCase
+{
+public:
+  TdmaDynamicModeTestCase ();
+  virtual void DoRun (void);
+private:
+  uint32_t RunMode (TdmaMode mode);
+  void Receive (Ptr<Packet> packet, const WifiMacHeader *hdr);
+  uint32_t m_received;
+  uint32_t m_receiver;
+};
+
+TdmaDynamicModeTestCase::TdmaDynamicModeTestCase ()
+  : TestCase ("Tdma dynamic mode gives the slots of idle macs to a backlogged mac")
+{
+}
+
+void
+TdmaDynamicModeTestCase::Receive (Ptr<Packet> packet, const WifiMacHeader *hdr)
+{
+  if (Simulator::GetContext () == m_receiver)
+    {
+      m_received++;
+    }
+}
+
+uint32_t
+TdmaDynamicModeTestCase::RunMode (TdmaMode mode)
+{
+  m_received = 0;
+  NodeContainer nodes = CreateTdmaNodes (4, 0);
+  Ptr<TdmaController> tdmaController = CreateTdmaController (MicroSeconds (1100), 4);
+  tdmaController->SetAttribute ("TdmaMode", EnumValue (mode));
+  std::vector<Ptr<TdmaCentralMac> > macs;
+  std::vector<Ptr<TdmaNetDevice> > devices = BuildTdmaNetwork (nodes, tdmaController, CreateObject<SimpleWirelessChannel> (),
+                                                               MakeCallback (&TdmaDynamicModeTestCase::Receive, this), true, macs);
+  // count the packets at node 0, each slot fits one 1000 byte packet
+  m_receiver = nodes.Get (0)->GetId ();
+  for (uint32_t i = 0; i < 20; i++)
+    {
+      macs[2]->Enqueue (Create<Packet> (1000), macs[0]->GetAddress ());
+    }
+  tdmaController->StartTdmaSessions ();
+  Simulator::Stop (MicroSeconds (9600));
+  Simulator::Run ();
+  DestroyTdmaNetwork (devices);
+  return m_received;
+}
+
+void
+TdmaDynamicModeTestCase::DoRun (void)
+{
+  // two frames of 4 slots of 1200us. The four slots of the dynamic frame
+  // form a single run of 4400us, which fits six packets of 728us
+  uint32_t centralized = RunMode (CENTRALIZED);
+  uint32_t dynamic = RunMode (DYNAMIC);
+  NS_TEST_ASSERT_MSG_EQ (centralized, 2, "the mac should send once per frame in its own slot");
+  NS_TEST_ASSERT_MSG_EQ (dynamic, 12, "the mac should send in every slot of the frame");
+}
+
+/**
+ * Checks the order, expiry and removal of packets in a TdmaMacQueue
+ * while its ring buffer wraps around and grows.
+ */
+class TdmaMacQueueTestCase : public TestCase
+{
+public:
+  TdmaMacQueueTestCase ();
+  virtual void DoRun (void);
+private:
+  void Drop (Ptr<const Packet> packet);
+  void Enqueue (Ptr<TdmaMacQueue> queue, Ptr<const Packet> packet);
+  std::vector<uint32_t> m_dropped;
+};
+
+TdmaMacQueueTestCase::TdmaMacQueueTestCase ()
+  : TestCase ("TdmaMacQueue keeps fifo order and expires packets from the head")
+{
+}
+
+void
+TdmaMacQueueTestCase::Drop (Ptr<const Packet> packet)
+{
+  m_dropped.push_back (packet->GetUid ());
+}
+
+void
+TdmaMacQueueTestCase::Enqueue (Ptr<TdmaMacQueue> queue, Ptr<const Packet> packet)
+{
+  WifiMacHeader hdr;
+  queue->Enqueue (packet, hdr);
+}
+
+void
+TdmaMacQueueTestCase::DoRun (void)
+{
+  Ptr<TdmaMacQueue> queue = CreateObject<TdmaMacQueue> ();
+  queue->SetMaxSize (40);
+  queue->SetMaxDelay (Seconds (10.0));
+  queue->SetTdmaMacTxDropCallback (MakeCallback (&TdmaMacQueueTestCase::Drop, this));
+  WifiMacHeader hdr;
+  std::vector<Ptr<Packet> > packets;
+  for (uint32_t i = 0; i < 120; i++)
+    {
+      packets.push_back (Create<Packet> (10));
+    }
+
+  // push and pop so that the ring wraps, removing every third packet
+  uint32_t next = 0;
+  uint32_t expected = 0;
+  std::vector<bool> removed (packets.size (), false);
+  for (uint32_t round = 0; round < 5; round++)
+    {
+      for (uint32_t i = 0; i < 15; i++, next++)
+        {
+          NS_TEST_ASSERT_MSG_EQ (queue->Enqueue (packets[next], hdr), true, "queue should accept the packet");
+          if (next % 3 == 1)
+            {
+              NS_TEST_ASSERT_MSG_EQ (queue->Remove (packets[next]), true, "packet should be removed");
+              removed[next] = true;
+            }
+        }
+      for (uint32_t i = 0; i < 8; i++)
+        {
+          while (removed[expected])
+            {
+              expected++;
+            }
+          Ptr<const Packet> p = queue->Dequeue (&hdr);
+          NS_TEST_ASSERT_MSG_EQ (p, packets[expected], "packets should leave in the order they came");
+          expected++;
+        }
+    }
+  NS_TEST_ASSERT_MSG_EQ (queue->Remove (packets[0]), false, "a dequeued packet cannot be removed");
+  NS_TEST_ASSERT_MSG_EQ (queue->GetSize (), 10, "50 of 75 packets are kept, 40 dequeued");
+  uint32_t size = queue->GetSize ();
+  for (uint32_t i = size; i < 40; i++, next++)
+    {
+      queue->Enqueue (packets[next], hdr);
+    }
+  NS_TEST_ASSERT_MSG_EQ (queue->Enqueue (packets[next], hdr), false, "a full queue should drop");
+  queue->Flush ();
+  NS_TEST_ASSERT_MSG_EQ (queue->IsEmpty (), true, "flush should empty the queue");
+
+  // a packet queued twice loses its oldest entry first
+  queue->Enqueue (packets[0], hdr);
+  queue->Enqueue (packets[1], hdr);
+  queue->Enqueue (packets[0], hdr);
+  NS_TEST_ASSERT_MSG_EQ (queue->Remove (packets[0]), true, "packet should be removed");
+  NS_TEST_ASSERT_MSG_EQ (queue->Dequeue (&hdr), packets[1], "the oldest entry should be removed");
+  NS_TEST_ASSERT_MSG_EQ (queue->Dequeue (&hdr), packets[0], "the newest entry should be kept");
+  NS_TEST_ASSERT_MSG_EQ (queue->Remove (packets[0]), false, "no entry should be left");
+
+  // packets queued 1s apart with a MaxDelay of 2.5s: when the fifth
+  // packet arrives at 4s the first two have expired
+  queue->SetMaxDelay (Seconds (2.5));
+  for (uint32_t i = 0; i < 5; i++)
+    {
+      Simulator::Schedule (Seconds (i), &TdmaMacQueueTestCase::Enqueue, this, queue, packets[i]);
+    }
+  Simulator::Stop (Seconds (4.2));
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (m_dropped.size (), 2, "the two oldest packets should have expired");
+  NS_TEST_ASSERT_MSG_EQ (m_dropped[0], packets[0]->GetUid (), "the oldest packet expires first");
+  NS_TEST_ASSERT_MSG_EQ (m_dropped[1], packets[1]->GetUid (), "the second packet expires next");
+  NS_TEST_ASSERT_MSG_EQ (queue->GetSize (), 3, "the fresh packets should stay");
+  NS_TEST_ASSERT_MSG_EQ (queue->Peek (&hdr), packets[2], "the oldest fresh packet is at the head");
+  Simulator::Destroy ();
+  queue->Flush ();
+}
+
+/**
+ * Ten small packets queued for the same receiver should arrive in one
+ * A-MSDU when the mac has an MsduAggregator, and in ten frames otherwise.
+ */
+class TdmaAggregationTestCase : public TestCase
+{
+public:
+  TdmaAggregationTestCase ();
+  virtual void DoRun (void);
+private:
+  void RunAggregation (bool aggregate);
+  void ForwardUp (Ptr<Packet> packet, Mac48Address from, Mac48Address to);
+  std::vector<int64_t> m_rxTimesUs;
+  std::vector<uint32_t> m_rxSizes;
+};
+
+TdmaAggregationTestCase::TdmaAggregationTestCase ()
+  : TestCase ("Tdma mac sends the packets of a slot in one A-MSDU")
+{
+}
+
+void
+TdmaAggregationTestCase::ForwardUp (Ptr<Packet> packet, Mac48Address from, Mac48Address to)
+{
+  m_rxTimesUs.push_back (Simulator::Now ().GetMicroSeconds ());
+  m_rxSizes.push_back (packet->GetSize ());
+}
+
+void
+TdmaAggregationTestCase::RunAggregation (bool aggregate)
+{
+  m_rxTimesUs.clear ();
+  m_rxSizes.clear ();
+  std::vector<Ptr<TdmaCentralMac> > macs;
+  std::vector<Ptr<TdmaNetDevice> > devices = BuildTdmaNetwork (CreateTdmaNodes (2, 0), CreateTdmaController (MicroSeconds (1100), 2),
+                                                               CreateObject<SimpleWirelessChannel> (),
+                                                               TdmaMacLow::TdmaMacLowRxCallback (), true, macs);
+  for (uint32_t i = 0; aggregate && i < macs.size (); i++)
+    {
+      ObjectFactory factory;
+      factory.SetTypeId ("ns3::MsduStandardAggregator");
+      macs[i]->SetAttribute ("MsduAggregator", PointerValue (factory.Create<MsduAggregator> ()));
+    }
+  macs[0]->SetForwardUpCallback (MakeCallback (&TdmaAggregationTestCase::ForwardUp, this));
+  for (uint32_t i = 0; i < 10; i++)
+    {
+      macs[1]->Enqueue (Create<Packet> (100 + i), macs[0]->GetAddress ());
+    }
+  // starting the macs hooks up their receive path and starts the frames
+  for (uint32_t i = 0; i < macs.size (); i++)
+    {
+      macs[i]->Start ();
+    }
+  Simulator::Stop (MicroSeconds (2400));
+  Simulator::Run ();
+  DestroyTdmaNetwork (devices);
+}
+
+void
+TdmaAggregationTestCase::DoRun (void)
+{
+  RunAggregation (false);
+  NS_TEST_ASSERT_MSG_EQ (m_rxSizes.size (), 10, "all packets should be received without aggregation");
+  NS_TEST_ASSERT_MSG_EQ ((m_rxTimesUs[9] > m_rxTimesUs[0]), true, "every packet should be a frame of its own");
+
+  RunAggregation (true);
+  NS_TEST_ASSERT_MSG_EQ (m_rxSizes.size (), 10, "all packets should be received with aggregation");
+  for (uint32_t i = 0; i < m_rxSizes.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_rxSizes[i], 100 + i, "packets should be delivered whole and in order");
+      NS_TEST_ASSERT_MSG_EQ (m_rxTimesUs[i], m_rxTimesUs[0], "all packets should arrive in the same frame");
+    }
+  // 10 subframe headers of 14 bytes and 9 paddings of up to 3 bytes add
+  // less than 180 bytes, or 131us at 11Mb/s, to the 1045 bytes of payload
+  NS_TEST_ASSERT_MSG_LT (m_rxTimesUs[0], 1200 + 760 + 131 + 1, "the A-MSDU should go out in the slot of the sender");
+}
+
+/**
+ * A broadcast frame is shared by all the receivers on the channel: each
+ * reception holds a reference to the frame sent, and only the receivers
+ * which pass the frame up make a packet for its payload.
+ */
+class TdmaBroadcastSharingTestCase : public TestCase
+{
+public:
+  TdmaBroadcastSharingTestCase ();
+  virtual void DoRun (void);
+private:
+  void Receive (Ptr<Packet> packet, const WifiMacHeader *hdr);
+  void Transmit (Ptr<SimpleWirelessChannel> channel, Ptr<TdmaMacLow> low, WifiMacType type);
+  uint32_t m_received;
+  uint32_t m_receptions;
+  std::vector<uint64_t> m_uids;
+  Ptr<const Packet> m_frame;
+};
+
+TdmaBroadcastSharingTestCase::TdmaBroadcastSharingTestCase ()
+  : TestCase ("SimpleWirelessChannel broadcast frames are shared by the receivers")
+{
+}
+
+void
+TdmaBroadcastSharingTestCase::Receive (Ptr<Packet> packet, const WifiMacHeader *hdr)
+{
+  m_received++;
+  m_uids.push_back (packet->GetUid ());
+}
+
+void
+TdmaBroadcastSharingTestCase::Transmit (Ptr<SimpleWirelessChannel> channel, Ptr<TdmaMacLow> low, WifiMacType type)
+{
+  WifiMacHeader hdr;
+  hdr.SetType (type);
+  hdr.SetAddr1 (Mac48Address::GetBroadcast ());
+  hdr.SetAddr2 (low->GetAddress ());
+  hdr.SetAddr3 (low->GetAddress ());
+  Ptr<Packet> frame = Create<Packet> (500);
+  frame->AddHeader (hdr);
+  WifiMacTrailer fcs;
+  frame->AddTrailer (fcs);
+  m_frame = frame;
+  frame = 0;
+  channel->Send (m_frame, low, Seconds (0));
+  // the frame itself is scheduled for every receiver, not a copy of it
+  m_receptions = m_frame->GetReferenceCount () - 1;
+}
+
+void
+TdmaBroadcastSharingTestCase::DoRun (void)
+{
+  const uint32_t n = 50;
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  std::vector<Ptr<TdmaCentralMac> > macs;
+  std::vector<Ptr<TdmaNetDevice> > devices = BuildTdmaNetwork (CreateTdmaNodes (n, 1), CreateObject<TdmaController> (), channel,
+                                                               MakeCallback (&TdmaBroadcastSharingTestCase::Receive, this), false, macs);
+
+  m_received = 0;
+  Simulator::Schedule (Seconds (1), &TdmaBroadcastSharingTestCase::Transmit, this, channel, macs[0]->GetTdmaMacLow (), WIFI_MAC_CTL_ACK);
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (m_receptions, n - 1, "every other device should get the control frame itself");
+  NS_TEST_EXPECT_MSG_EQ (m_received, 0, "control frames should not be passed up");
+  NS_TEST_EXPECT_MSG_EQ (m_frame->GetReferenceCount (), 1, "the receivers should not keep the control frame");
+
+  m_received = 0;
+  Simulator::Schedule (Seconds (1), &TdmaBroadcastSharingTestCase::Transmit, this, channel, macs[1]->GetTdmaMacLow (), WIFI_MAC_DATA);
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (m_receptions, n - 1, "every other device should get the data frame itself");
+  NS_TEST_ASSERT_MSG_EQ (m_received, n - 1, "every other device should receive the data frame");
+  for (uint32_t i = 0; i < m_uids.size (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_uids[i], m_frame->GetUid (), "the payload should come from the frame sent");
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_frame->GetReferenceCount (), 1, "the receivers should not keep the data frame");
+  m_frame = 0;
+  DestroyTdmaNetwork (devices);
+}
+
+/**
+ * Sends one frame from every device of a channel, once with the spatial
+ * index and once with a scan over all devices, and checks that both
+ * deliver the same frames to the same receivers at the same times.
+ */
+class SimpleWirelessChannelSpatialIndexTestCase : public TestCase
+{
+public:
+  SimpleWirelessChannelSpatialIndexTestCase ();
+  virtual void DoRun (void);
+private:
+  struct Reception
+  {
+    uint32_t from;
+    uint32_t context;
+    int64_t timeNs;
+  };
+  void Receive (Ptr<Packet> packet, const WifiMacHeader *hdr);
+  void SendFromAll (std::vector<Ptr<TdmaCentralMac> > macs);
+  std::vector<Reception> RunScenario (bool useSpatialIndex, bool useLinkTable);
+  std::vector<Reception> m_receptions;
+  std::map<Mac48Address, uint32_t> m_nodeIds;
+};
+
+SimpleWirelessChannelSpatialIndexTestCase::SimpleWirelessChannelSpatialIndexTestCase ()
+  : TestCase ("SimpleWirelessChannel spatial index and link table match full scan")
+{
+}
+
+void
+SimpleWirelessChannelSpatialIndexTestCase::Receive (Ptr<Packet> packet, const WifiMacHeader *hdr)
+{
+  Reception r;
+  r.from = m_nodeIds[hdr->GetAddr2 ()];
+  r.context = Simulator::GetContext ();
+  r.timeNs = Simulator::Now ().GetNanoSeconds ();
+  m_receptions.push_back (r);
+}
+
+void
+SimpleWirelessChannelSpatialIndexTestCase::SendFromAll (std::vector<Ptr<TdmaCentralMac> > macs)
+{
+  for (std::vector<Ptr<TdmaCentralMac> >::const_iterator i = macs.begin (); i != macs.end (); ++i)
+    {
+      WifiMacHeader hdr;
+      hdr.SetTypeData ();
+      hdr.SetAddr1 (Mac48Address::GetBroadcast ());
+      hdr.SetAddr2 ((*i)->GetAddress ());
+      hdr.SetAddr3 ((*i)->GetAddress ());
+      (*i)->GetTdmaMacLow ()->StartTransmission (Create<Packet> (100), &hdr, Seconds (0));
+    }
+}
+
+std::vector<SimpleWirelessChannelSpatialIndexTestCase::Reception>
+SimpleWirelessChannelSpatialIndexTestCase::RunScenario (bool useSpatialIndex, bool useLinkTable)
+{
+  m_receptions.clear ();
+  m_nodeIds.clear ();
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  channel->SetAttribute ("MaxRange", DoubleValue (100));
+  channel->SetAttribute ("SpatialIndex", BooleanValue (useSpatialIndex));
+  channel->SetAttribute ("LinkTable", BooleanValue (useLinkTable));
+
+  NodeContainer nodes;
+  nodes.Create (60);
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantVelocityMobilityModel");
+  mobility.Install (nodes);
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      // scatter the nodes over a 500m x 500m square, including negative
+      // coordinates and points that fall exactly on cell boundaries
+      nodes.Get (i)->GetObject<MobilityModel> ()->SetPosition (Vector ((i * 37) % 500 - 250.0, (i * 83) % 500 - 100.0, 0));
+    }
+  std::vector<Ptr<TdmaCentralMac> > macs;
+  std::vector<Ptr<TdmaNetDevice> > devices = BuildTdmaNetwork (nodes, CreateObject<TdmaController> (), channel,
+                                                               MakeCallback (&SimpleWirelessChannelSpatialIndexTestCase::Receive, this), false, macs);
+  for (uint32_t i = 0; i < macs.size (); i++)
+    {
+      m_nodeIds[macs[i]->GetAddress ()] = i;
+    }
+  Simulator::Schedule (Seconds (1), &SimpleWirelessChannelSpatialIndexTestCase::SendFromAll, this, macs);
+  // start moving a few nodes, let them stop again elsewhere and resend
+  for (uint32_t i = 0; i < nodes.GetN (); i += 7)
+    {
+      Ptr<ConstantVelocityMobilityModel> model = nodes.Get (i)->GetObject<ConstantVelocityMobilityModel> ();
+      Simulator::Schedule (Seconds (2), &ConstantVelocityMobilityModel::SetVelocity, model, Vector (40, -25, 0));
+      Simulator::Schedule (Seconds (6), &ConstantVelocityMobilityModel::SetVelocity, model, Vector (0, 0, 0));
+    }
+  Simulator::Schedule (Seconds (4), &SimpleWirelessChannelSpatialIndexTestCase::SendFromAll, this, macs);
+  Simulator::Schedule (Seconds (7), &SimpleWirelessChannelSpatialIndexTestCase::SendFromAll, this, macs);
+  Simulator::Run ();
+  DestroyTdmaNetwork (devices);
+  return m_receptions;
+}
+
+void
+SimpleWirelessChannelSpatialIndexTestCase::DoRun (void)
+{
+  std::vector<Reception> scan = RunScenario (false, false);
+  std::vector<Reception> indexed = RunScenario (true, false);
+  std::vector<Reception> linked = RunScenario (false, true);
+  NS_TEST_ASSERT_MSG_NE (scan.size (), 0, "scenario should deliver frames");
+  NS_TEST_ASSERT_MSG_EQ (indexed.size (), scan.size (), "spatial index changed the number of receptions");
+  NS_TEST_ASSERT_MSG_EQ (linked.size (), scan.size (), "link table changed the number of receptions");
+  for (uint32_t i = 0; i < scan.size () && i < indexed.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (indexed[i].from, scan[i].from, "reception " << i << " differs in sender");
+      NS_TEST_ASSERT_MSG_EQ (indexed[i].context, scan[i].context, "reception " << i << " differs in receiver");
+      NS_TEST_ASSERT_MSG_EQ (indexed[i].timeNs, scan[i].timeNs, "reception " << i << " differs in time");
+    }
+  for (uint32_t i = 0; i < scan.size () && i < linked.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (linked[i].from, scan[i].from, "reception " << i << " differs in sender with link table");
+      NS_TEST_ASSERT_MSG_EQ (linked[i].context, scan[i].context, "reception " << i << " differs in receiver with link table");
+      NS_TEST_ASSERT_MSG_EQ (linked[i].timeNs, scan[i].timeNs, "reception " << i << " differs in time with link table");
+    }
+}
+
+/**
+ * Sends frames with overlapping and disjoint airtimes to one receiver and
+ * checks that, with the interference model enabled, every frame of an
+ * overlapping group is lost and the others are delivered.
+ */
+class TdmaCollisionTestCase : public TestCase
+{
+public:
+  TdmaCollisionTestCase ();
+  virtual void DoRun (void);
+private:
+  void Receive (Ptr<Packet> packet, const WifiMacHeader *hdr);
+  void Collision (Ptr<const Packet> packet, Ptr<NetDevice> device);
+  void Transmit (Ptr<TdmaMacLow> low);
+  void RunScenario (bool useInterference);
+  uint32_t m_receiver;
+  uint32_t m_received;
+  uint32_t m_collisions;
+};
+
+TdmaCollisionTestCase::TdmaCollisionTestCase ()
+  : TestCase ("SimpleWirelessChannel drops overlapping frames")
+{
+}
+
+void
+TdmaCollisionTestCase::Receive (Ptr<Packet> packet, const WifiMacHeader *hdr)
+{
+  if (Simulator::GetContext () == m_receiver)
+    {
+      m_received++;
+    }
+}
+
+void
+TdmaCollisionTestCase::Collision (Ptr<const Packet> packet, Ptr<NetDevice> device)
+{
+  if (device->GetNode ()->GetId () == m_receiver)
+    {
+      m_collisions++;
+    }
+}
+
+void
+TdmaCollisionTestCase::Transmit (Ptr<TdmaMacLow> low)
+{
+  WifiMacHeader hdr;
+  hdr.SetTypeData ();
+  hdr.SetAddr1 (Mac48Address::GetBroadcast ());
+  hdr.SetAddr2 (low->GetAddress ());
+  hdr.SetAddr3 (low->GetAddress ());
+  low->StartTransmission (Create<Packet> (100), &hdr, MicroSeconds (100));
+}
+
+void
+TdmaCollisionTestCase::RunScenario (bool useInterference)
+{
+  m_received = 0;
+  m_collisions = 0;
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  channel->SetAttribute ("Interference", BooleanValue (useInterference));
+  channel->TraceConnectWithoutContext ("Collision", MakeCallback (&TdmaCollisionTestCase::Collision, this));
+  NodeContainer nodes = CreateTdmaNodes (4, 1);
+  std::vector<Ptr<TdmaCentralMac> > macs;
+  std::vector<Ptr<TdmaNetDevice> > devices = BuildTdmaNetwork (nodes, CreateObject<TdmaController> (), channel,
+                                                               MakeCallback (&TdmaCollisionTestCase::Receive, this), false, macs);
+  std::vector<Ptr<TdmaMacLow> > lows;
+  for (uint32_t i = 0; i < macs.size (); i++)
+    {
+      lows.push_back (macs[i]->GetTdmaMacLow ());
+    }
+  m_receiver = nodes.Get (3)->GetId ();
+  // two frames sent at the same time
+  Simulator::Schedule (Seconds (1), &TdmaCollisionTestCase::Transmit, this, lows[0]);
+  Simulator::Schedule (Seconds (1), &TdmaCollisionTestCase::Transmit, this, lows[1]);
+  // a chain of three frames where the last one only overlaps the second
+  Simulator::Schedule (Seconds (2), &TdmaCollisionTestCase::Transmit, this, lows[0]);
+  Simulator::Schedule (Seconds (2) + MicroSeconds (50), &TdmaCollisionTestCase::Transmit, this, lows[1]);
+  Simulator::Schedule (Seconds (2) + MicroSeconds (120), &TdmaCollisionTestCase::Transmit, this, lows[2]);
+  // two frames separated by a gap
+  Simulator::Schedule (Seconds (3), &TdmaCollisionTestCase::Transmit, this, lows[0]);
+  Simulator::Schedule (Seconds (3) + MicroSeconds (200), &TdmaCollisionTestCase::Transmit, this, lows[1]);
+  Simulator::Run ();
+  DestroyTdmaNetwork (devices);
+}
+
+void
+TdmaCollisionTestCase::DoRun (void)
+{
+  RunScenario (false);
+  NS_TEST_ASSERT_MSG_EQ (m_received, 7, "without interference every frame should be received");
+  NS_TEST_ASSERT_MSG_EQ (m_collisions, 0, "without interference no frame should collide");
+  RunScenario (true);
+  NS_TEST_ASSERT_MSG_EQ (m_received, 2, "only the frames separated by a gap should be received");
+  NS_TEST_ASSERT_MSG_EQ (m_collisions, 5, "every frame of an overlapping group should be lost");
+}
+
+/**
+ * Places nodes on a line where every node only hears its direct
+ * neighbours and lets TdmaHelper assign slots with spatial reuse. Nodes
+ * two hops apart must not share a slot, so a frame needs three slots,
+ * and with the interference model enabled no frame should collide.
+ */
+class TdmaSpatialReuseTestCase : public TestCase
+{
+public:
+  TdmaSpatialReuseTestCase ();
+  virtual void DoRun (void);
+private:
+  void Receive (Ptr<const Packet> packet);
+  uint32_t m_received;
+};
+
+TdmaSpatialReuseTestCase::TdmaSpatialReuseTestCase ()
+  : TestCase ("TdmaHelper shares slots between nodes more than two hops apart")
+{
+}
+
+void
+TdmaSpatialReuseTestCase::Receive (Ptr<const Packet> packet)
+{
+  m_received++;
+}
+
+void
+TdmaSpatialReuseTestCase::DoRun (void)
+{
+  const uint32_t n = 20;
+  const uint32_t rounds = 5;
+  m_received = 0;
+  Config::SetDefault ("ns3::SimpleWirelessChannel::MaxRange", DoubleValue (303));
+  NodeContainer nodes = CreateTdmaNodes (n, 200);
+
+  TdmaHelper tdma = TdmaHelper (n, n);
+  uint32_t slots = tdma.AssignSpatialReuseSlots (nodes);
+  NS_TEST_ASSERT_MSG_EQ (slots, 3, "a line of nodes should need three slots");
+  TdmaControllerHelper controller;
+  controller.Set ("SlotTime", TimeValue (MicroSeconds (1100)));
+  controller.Set ("GaurdTime", TimeValue (MicroSeconds (100)));
+  controller.Set ("InterFrameTime", TimeValue (MicroSeconds (0)));
+  tdma.SetTdmaControllerHelper (controller);
+  NetDeviceContainer devices = tdma.Install (nodes);
+  Ptr<SimpleWirelessChannel> channel = DynamicCast<SimpleWirelessChannel> (devices.Get (0)->GetChannel ());
+  channel->SetAttribute ("Interference", BooleanValue (true));
+  for (uint32_t i = 0; i < n; i++)
+    {
+      devices.Get (i)->GetObject<TdmaNetDevice> ()->GetMac ()->TraceConnectWithoutContext (
+        "MacRx", MakeCallback (&TdmaSpatialReuseTestCase::Receive, this));
+      for (uint32_t j = 0; j < rounds; j++)
+        {
+          devices.Get (i)->Send (Create<Packet> (500), devices.Get (i)->GetBroadcast (), 0x0800);
+        }
+    }
+  // long enough for the three slot frames to send every packet, but
+  // shorter than a single frame with one slot per node
+  Simulator::Stop (MilliSeconds (20));
+  Simulator::Run ();
+  uint64_t collisions = channel->GetNCollisions ();
+  Simulator::Destroy ();
+  NS_TEST_ASSERT_MSG_EQ (collisions, 0, "nodes sharing a slot should not interfere");
+  NS_TEST_ASSERT_MSG_EQ (m_received, rounds * 2 * (n - 1), "every neighbour should receive every frame");
+}
+
+/**
+ * Writes the same slot assignment in the dense and in the sparse file
+ * format and checks that the parser reads both into the same runs of
+ * slots.
+ */
+class TdmaSlotAssignmentFileParserTestCase : public TestCase
+{
+public:
+  TdmaSlotAssignmentFileParserTestCase ();
+  virtual void DoRun (void);
+private:
+  Ptr<TdmaSlotAssignmentFileParser> Parse (std::string contents);
+};
+
+TdmaSlotAssignmentFileParserTestCase::TdmaSlotAssignmentFileParserTestCase ()
+  : TestCase ("TdmaSlotAssignmentFileParser reads dense and sparse slot files")
+{
+}
+
+Ptr<TdmaSlotAssignmentFileParser>
+TdmaSlotAssignmentFileParserTestCase::Parse (std::string contents)
+{
+  std::string fileName = CreateTempDirFilename ("tdma-slots.txt");
+  std::ofstream out (fileName.c_str ());
+  out << contents;
+  out.close ();
+  Ptr<TdmaSlotAssignmentFileParser> parser = CreateObject<TdmaSlotAssignmentFileParser> (fileName);
+  std::remove (fileName.c_str ());
+  return parser;
+}
+
+void
+TdmaSlotAssignmentFileParserTestCase::DoRun (void)
+{
+  Ptr<TdmaSlotAssignmentFileParser> dense = Parse ("3:1,1,0,0,0,0,1\n"
+                                                   "1:0,0,1,0,0,0,0\n"
+                                                   "\n"
+                                                   "0:0,0,0,0,0,0,0\n"
+                                                   "2:0,0,0,1,1,1,0\n");
+  Ptr<TdmaSlotAssignmentFileParser> sparse = Parse ("# same assignment, sparse\n"
+                                                    "slots 7\n"
+                                                    "3 0-1, 6\n"
+                                                    "1 2\n"
+                                                    "0\n"
+                                                    "2 3-5\n");
+  Ptr<TdmaSlotAssignmentFileParser> parsers[] = { dense, sparse };
+  for (uint32_t p = 0; p < 2; p++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (parsers[p]->GetParseState (), true, "parser " << p << " should read the file");
+      NS_TEST_ASSERT_MSG_EQ (parsers[p]->GetNodeCount (), 4, "parser " << p << " node count");
+      NS_TEST_ASSERT_MSG_EQ (parsers[p]->GetTotalSlots (), 7, "parser " << p << " slot count");
+      const std::vector<TdmaSlotRange> &ranges = parsers[p]->GetSlotRanges ();
+      NS_TEST_ASSERT_MSG_EQ (ranges.size (), 4, "parser " << p << " number of runs");
+      uint32_t expected[4][3] = { { 3, 0, 1 }, { 3, 6, 6 }, { 1, 2, 2 }, { 2, 3, 5 } };
+      for (uint32_t i = 0; i < ranges.size () && i < 4; i++)
+        {
+          NS_TEST_ASSERT_MSG_EQ (ranges[i].nodeId, expected[i][0], "parser " << p << " run " << i << " node");
+          NS_TEST_ASSERT_MSG_EQ (ranges[i].first, expected[i][1], "parser " << p << " run " << i << " first slot");
+          NS_TEST_ASSERT_MSG_EQ (ranges[i].last, expected[i][2], "parser " << p << " run " << i << " last slot");
+        }
+    }
+  Ptr<TdmaSlotAssignmentFileParser> missing =
+    CreateObject<TdmaSlotAssignmentFileParser> (CreateTempDirFilename ("no-such-slot-file.txt"));
+  NS_TEST_ASSERT_MSG_EQ (missing->GetParseState (), false, "a missing file should not parse");
+}
+
 class TdmaTestSuite : public TestSuite
 {
 public:
   TdmaTestSuite () : TestSuite ("tdma", SYSTEM)
   {
     AddTestCase (new TdmaSlotAllocationTestCase ());
+    AddTestCase (new TdmaIdleSlotTestCase ());
+    AddTestCase (new TdmaMacTxTimeTestCase (false));
+    AddTestCase (new TdmaMacTxTimeTestCase (true));
+    AddTestCase (new SimpleWirelessChannelSpatialIndexTestCase ());
+    AddTestCase (new TdmaSlotAllocatorTestCase ());
+    AddTestCase (new TdmaDynamicModeTestCase ());
+    AddTestCase (new TdmaMacQueueTestCase ());
+    AddTestCase (new TdmaAggregationTestCase ());
+    AddTestCase (new TdmaBroadcastSharingTestCase ());
+    AddTestCase (new TdmaCollisionTestCase ());
+    AddTestCase (new TdmaSpatialReuseTestCase ());
+    AddTestCase (new TdmaSlotAssignmentFileParserTestCase ());
   }
 } g_tdmaTestSuite;
 }
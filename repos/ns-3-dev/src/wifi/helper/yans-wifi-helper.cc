@@ -48,7 +48,7 @@ AsciiPhyTransmitSinkWithContext (
   uint8_t txLevel)
 {
   NS_LOG_FUNCTION (stream << context << p << mode << preamble << txLevel);
-  *stream->GetStream () << "t " << Simulator::Now ().GetSeconds () << " " << context << " " << *p << std::endl;
+  AsciiTraceHelper::WritePacket (stream, 't', context, p);
 }
 
 static void
@@ -60,7 +60,7 @@ AsciiPhyTransmitSinkWithoutContext (
   uint8_t txLevel)
 {
   NS_LOG_FUNCTION (stream << p << mode << preamble << txLevel);
-  *stream->GetStream () << "t " << Simulator::Now ().GetSeconds () << " " << *p << std::endl;
+  AsciiTraceHelper::WritePacket (stream, 't', p);
 }
 
 static void
@@ -73,7 +73,7 @@ AsciiPhyReceiveSinkWithContext (
   enum WifiPreamble preamble)
 {
   NS_LOG_FUNCTION (stream << context << p << snr << mode << preamble);
-  *stream->GetStream () << "r " << Simulator::Now ().GetSeconds () << " " << context << " " << *p << std::endl;
+  AsciiTraceHelper::WritePacket (stream, 'r', context, p);
 }
 
 static void
@@ -85,7 +85,7 @@ AsciiPhyReceiveSinkWithoutContext (
   enum WifiPreamble preamble)
 {
   NS_LOG_FUNCTION (stream << p << snr << mode << preamble);
-  *stream->GetStream () << "r " << Simulator::Now ().GetSeconds () << " " << *p << std::endl;
+  AsciiTraceHelper::WritePacket (stream, 'r', p);
 }
 
 YansWifiChannelHelper::YansWifiChannelHelper ()
@@ -0,0 +1,153 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "ns3/core-module.h"
+#include <iostream>
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * Each node broadcasts a frame to all the other nodes in turn, as a
+ * wireless channel does, while every node keeps a few timers pending far
+ * in the future, as the retransmission and beacon timers of a real
+ * simulation do. The receptions are scheduled a few nanoseconds ahead,
+ * before almost all the pending events, which is the worst case for one
+ * Scheduler::Insert per reception and the case Simulator::ScheduleBatch
+ * is for.
+ */
+class BroadcastBench
+{
+public:
+  BroadcastBench ();
+  void RunBench (void);
+
+  uint32_t m_nodes;
+  uint32_t m_timers;
+  uint32_t m_frames;
+  bool m_batch;
+  std::string m_scheduler;
+private:
+  void Send (uint32_t node);
+  void Receive (uint32_t node);
+  void Timeout (uint32_t node);
+
+  uint32_t m_sent;
+  uint64_t m_received;
+  EventBatch m_receptions;
+};
+
+BroadcastBench::BroadcastBench ()
+  : m_nodes (100),
+    m_timers (10),
+    m_frames (10000),
+    m_batch (true),
+    m_scheduler ("ns3::MapScheduler"),
+    m_sent (0),
+    m_received (0)
+{
+}
+
+void
+BroadcastBench::Receive (uint32_t node)
+{
+  m_received++;
+}
+
+void
+BroadcastBench::Timeout (uint32_t node)
+{
+  Simulator::Schedule (Seconds (1), &BroadcastBench::Timeout, this, node);
+}
+
+void
+BroadcastBench::Send (uint32_t node)
+{
+  if (m_sent == m_frames)
+    {
+      return;
+    }
+  m_sent++;
+  for (uint32_t i = 0; i < m_nodes; i++)
+    {
+      if (i == node)
+        {
+          continue;
+        }
+      // the nodes sit on a line, 1m apart
+      Time delay = NanoSeconds (3 + 3 * (i > node ? i - node : node - i));
+      if (m_batch)
+        {
+          m_receptions.Add (i, delay, MakeEvent (&BroadcastBench::Receive, this, i));
+        }
+      else
+        {
+          Simulator::ScheduleWithContext (i, delay, &BroadcastBench::Receive, this, i);
+        }
+    }
+  if (m_batch)
+    {
+      Simulator::ScheduleBatch (m_receptions);
+    }
+  uint32_t next = (node + 1) % m_nodes;
+  Simulator::ScheduleWithContext (next, MicroSeconds (10), &BroadcastBench::Send, this, next);
+}
+
+void
+BroadcastBench::RunBench (void)
+{
+  ObjectFactory factory;
+  factory.SetTypeId (m_scheduler);
+  Simulator::SetScheduler (factory);
+  for (uint32_t i = 0; i < m_nodes; i++)
+    {
+      for (uint32_t j = 0; j < m_timers; j++)
+        {
+          Simulator::ScheduleWithContext (i, MilliSeconds (100 + i + j * m_nodes), &BroadcastBench::Timeout, this, i);
+        }
+    }
+  Simulator::ScheduleWithContext (0, Seconds (0), &BroadcastBench::Send, this, 0);
+
+  SystemWallClockMs time;
+  time.Start ();
+  // the frames are sent 10us apart, which leaves the timers pending
+  Simulator::Stop (NanoSeconds (10000ULL * m_frames + 1000));
+  Simulator::Run ();
+  uint64_t ms = time.End ();
+  Simulator::Destroy ();
+
+  std::cout << m_scheduler << (m_batch ? " batch" : " one by one")
+            << " nodes=" << m_nodes
+            << " pending timers=" << m_nodes * m_timers
+            << " receptions=" << m_received
+            << " wall=" << ms << "ms"
+            << " (" << (ms * 1e6) / m_received << "ns per reception)" << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  BroadcastBench bench;
+  CommandLine cmd;
+  cmd.AddValue ("nodes", "Number of nodes", bench.m_nodes);
+  cmd.AddValue ("timers", "Number of timers pending in each node", bench.m_timers);
+  cmd.AddValue ("frames", "Number of frames broadcast", bench.m_frames);
+  cmd.AddValue ("batch", "Schedule the receptions with Simulator::ScheduleBatch", bench.m_batch);
+  cmd.AddValue ("scheduler", "Type of the event scheduler", bench.m_scheduler);
+  cmd.Parse (argc, argv);
+  bench.RunBench ();
+  return 0;
+}
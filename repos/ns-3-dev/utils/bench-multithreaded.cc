@@ -0,0 +1,151 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/multithreaded-simulator-impl.h"
+#include <iostream>
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * Forwards tokens between nodes with a delay of LookAhead plus a random
+ * jitter, which is what a wireless channel looks like to the simulator
+ * when the lookahead is the propagation delay: many windows, each with
+ * a few events in a few partitions. Each event burns some cpu so that
+ * the cost of the windows can be compared to the cost of the events.
+ */
+class MultithreadedBench
+{
+public:
+  MultithreadedBench ();
+  void RunBench (void);
+
+  uint32_t m_nodes;
+  uint32_t m_tokens;
+  uint32_t m_partitions;
+  uint32_t m_lookAheadNs;
+  uint32_t m_jitterNs;
+  uint32_t m_work;
+  double m_simTime;
+  bool m_default;
+private:
+  void Receive (uint32_t node);
+  uint32_t Random (uint32_t node, uint32_t n);
+
+  std::vector<uint32_t> m_rng;
+  std::vector<uint32_t> m_received;
+};
+
+MultithreadedBench::MultithreadedBench ()
+  : m_nodes (64),
+    m_tokens (8),
+    m_partitions (4),
+    m_lookAheadNs (0),
+    m_jitterNs (1000),
+    m_work (100),
+    m_simTime (0.01),
+    m_default (false)
+{
+}
+
+uint32_t
+MultithreadedBench::Random (uint32_t node, uint32_t n)
+{
+  // xorshift: each node has its own state, only used by its own events
+  uint32_t x = m_rng[node];
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  m_rng[node] = x;
+  return x % n;
+}
+
+void
+MultithreadedBench::Receive (uint32_t node)
+{
+  m_received[node]++;
+  volatile uint32_t sum = 0;
+  for (uint32_t i = 0; i < m_work; i++)
+    {
+      sum += i;
+    }
+  uint32_t next = Random (node, m_nodes);
+  Time delay = NanoSeconds (m_lookAheadNs + Random (node, m_jitterNs + 1));
+  Simulator::ScheduleWithContext (next, delay, &MultithreadedBench::Receive, this, next);
+}
+
+void
+MultithreadedBench::RunBench (void)
+{
+  if (m_default)
+    {
+      Simulator::SetImplementation (CreateObject<DefaultSimulatorImpl> ());
+    }
+  else
+    {
+      Ptr<MultithreadedSimulatorImpl> impl = CreateObject<MultithreadedSimulatorImpl> ();
+      impl->SetAttribute ("Partitions", UintegerValue (m_partitions));
+      impl->SetAttribute ("LookAhead", TimeValue (NanoSeconds (m_lookAheadNs)));
+      Simulator::SetImplementation (impl);
+    }
+  m_received.assign (m_nodes, 0);
+  for (uint32_t i = 0; i < m_nodes; i++)
+    {
+      m_rng.push_back (2463534242U + i * 7919);
+    }
+  for (uint32_t i = 0; i < m_tokens; i++)
+    {
+      uint32_t node = (i * m_nodes) / m_tokens;
+      Simulator::ScheduleWithContext (node, NanoSeconds (i), &MultithreadedBench::Receive, this, node);
+    }
+
+  SystemWallClockMs time;
+  time.Start ();
+  Simulator::Stop (Seconds (m_simTime));
+  Simulator::Run ();
+  uint64_t ms = time.End ();
+  Simulator::Destroy ();
+
+  uint64_t events = 0;
+  for (uint32_t i = 0; i < m_nodes; i++)
+    {
+      events += m_received[i];
+    }
+  std::cout << (m_default ? "default" : "multithreaded")
+            << " partitions=" << m_partitions
+            << " lookahead=" << m_lookAheadNs << "ns"
+            << " tokens=" << m_tokens
+            << " events=" << events
+            << " wall=" << ms << "ms" << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  MultithreadedBench bench;
+  CommandLine cmd;
+  cmd.AddValue ("nodes", "Number of nodes", bench.m_nodes);
+  cmd.AddValue ("tokens", "Number of tokens in flight", bench.m_tokens);
+  cmd.AddValue ("partitions", "Number of partitions", bench.m_partitions);
+  cmd.AddValue ("lookahead", "Smallest delay between two nodes, in nanoseconds", bench.m_lookAheadNs);
+  cmd.AddValue ("jitter", "Largest random delay added to the lookahead, in nanoseconds", bench.m_jitterNs);
+  cmd.AddValue ("work", "Loop iterations burnt by each event", bench.m_work);
+  cmd.AddValue ("time", "Simulated seconds", bench.m_simTime);
+  cmd.AddValue ("default", "Run with the default simulator instead", bench.m_default);
+  cmd.Parse (argc, argv);
+  bench.RunBench ();
+  return 0;
+}
@@ -242,6 +242,28 @@ benchC (uint32_t n)
 }
 
 
+static void
+benchE (uint32_t n)
+{
+  BenchHeader<8> udp;
+  uint8_t payload[14600];
+  memset (payload, 0x42, sizeof (payload));
+
+  // fragment a payload of real bytes and reassemble it, 10 fragments
+  // at a time
+  for (uint32_t i = 0; i < n; i += 10) {
+    Ptr<Packet> p = Create<Packet> (payload, sizeof (payload));
+    Ptr<Packet> whole = Create<Packet> ();
+    for (uint32_t offset = 0; offset < sizeof (payload); offset += 1460) {
+      Ptr<Packet> fragment = p->CreateFragment (offset, 1460);
+      fragment->AddHeader (udp);
+      fragment->RemoveHeader (udp);
+      whole->AddAtEnd (fragment);
+    }
+  }
+}
+
+
 static void
 runBench (void (*bench) (uint32_t), uint32_t n, char const *name)
 {
@@ -270,6 +292,10 @@ int main (int argc, char *argv[])
         {
           Packet::EnablePrinting ();
         }
+      if (strncmp ("--enable-compact-printing", argv[0], strlen ("--enable-compact-printing")) == 0)
+        {
+          Packet::EnableCompactPrinting ();
+        }
       argc--;
       argv++;
   }
@@ -285,6 +311,7 @@ int main (int argc, char *argv[])
   runBench (&benchB, n, "b");
   runBench (&benchC, n, "c");
   runBench (&benchD, n, "d");
+  runBench (&benchE, n, "e");
 
   return 0;
 }
@@ -35,20 +35,47 @@ public:
   Bench ();
   void ReadDistribution (std::istream &istream);
   void SetTotal (uint32_t total);
+  void SetTimers (uint32_t timers, bool cancel);
+  void SetHops (uint32_t hops);
   void RunBench (void);
 private:
   void Cb (void);
+  void RestartTimer (void);
+  void Timeout (void);
+  void Hop (uint32_t left);
   std::vector<uint64_t> m_distribution;
   std::vector<uint64_t>::const_iterator m_current;
   uint32_t m_n;
   uint32_t m_total;
+  std::vector<EventId> m_timers;
+  bool m_cancel;
+  uint32_t m_timeouts;
+  uint32_t m_hops;
+  uint32_t m_hopCount;
 };
 
 Bench::Bench ()
   : m_n (0),
-    m_total (0)
+    m_total (0),
+    m_cancel (false),
+    m_timeouts (0),
+    m_hops (0),
+    m_hopCount (0)
 {}
 
+void
+Bench::SetTimers (uint32_t timers, bool cancel)
+{
+  m_timers.resize (timers);
+  m_cancel = cancel;
+}
+
+void
+Bench::SetHops (uint32_t hops)
+{
+  m_hops = hops;
+}
+
 void 
 Bench::SetTotal (uint32_t total)
 {
@@ -80,6 +107,9 @@ Bench::RunBench (void)
 {
   SystemWallClockMs time;
   double init, simu;
+  m_n = 0;
+  m_timeouts = 0;
+  m_hopCount = 0;
   time.Start ();
   for (std::vector<uint64_t>::const_iterator i = m_distribution.begin ();
        i != m_distribution.end (); i++) 
@@ -104,6 +134,49 @@ Bench::RunBench (void)
       "simu " << ((double)m_n) / simu<< " hold/s, avg hold=" << 
       simu / ((double)m_n) << "s" << std::endl
       ;
+  if (m_hops > 0)
+    {
+      std::cout << "hops n=" << m_hopCount << " at the time of the holds" << std::endl;
+    }
+  if (!m_timers.empty ())
+    {
+      std::cout << "timers n=" << m_timers.size () << ", " << (m_cancel ? "cancelled" : "removed")
+                << " on every hold, expired=" << m_timeouts << std::endl;
+    }
+}
+
+void
+Bench::RestartTimer (void)
+{
+  // like a retransmission timer, one of the timers is pushed back on
+  // every hold, long before it would expire
+  EventId &timer = m_timers[m_n % m_timers.size ()];
+  if (m_cancel)
+    {
+      Simulator::Cancel (timer);
+    }
+  else
+    {
+      Simulator::Remove (timer);
+    }
+  timer = Simulator::Schedule (NanoSeconds (*m_current * 10), &Bench::Timeout, this);
+}
+
+void
+Bench::Timeout (void)
+{
+  m_timeouts++;
+}
+
+void
+Bench::Hop (uint32_t left)
+{
+  // like a packet going down a protocol stack, one layer per event
+  m_hopCount++;
+  if (left > 1)
+    {
+      Simulator::ScheduleNow (&Bench::Hop, this, left - 1);
+    }
 }
 
 void
@@ -122,6 +195,14 @@ Bench::Cb (void)
       std::cerr << "event at " << Simulator::Now ().GetSeconds () << "s" << std::endl;
     }
   Simulator::Schedule (NanoSeconds (*m_current), &Bench::Cb, this);
+  if (!m_timers.empty ())
+    {
+      RestartTimer ();
+    }
+  if (m_hops > 0)
+    {
+      Simulator::ScheduleNow (&Bench::Hop, this, m_hops);
+    }
   m_current++;
   m_n++;
 }
@@ -135,6 +216,15 @@ PrintHelp (void)
   std::cout << "      --list: use std::list scheduler"<<std::endl;
   std::cout << "      --map: use std::map cheduler"<<std::endl;
   std::cout << "      --heap: use Binary Heap scheduler"<<std::endl;
+  std::cout << "      --calendar: use Calendar scheduler"<<std::endl;
+  std::cout << "      --ns2calendar: use ns-2 Calendar scheduler"<<std::endl;
+  std::cout << "      --fourary: use 4-ary Heap scheduler"<<std::endl;
+  std::cout << "      --ladder: use Ladder Queue scheduler"<<std::endl;
+  std::cout << "      --all: run the bench with every scheduler in turn"<<std::endl;
+  std::cout << "      --timers=n: restart one of n timers on every event"<<std::endl;
+  std::cout << "      --cancel: restart the timers with Cancel instead of Remove"<<std::endl;
+  std::cout << "      --hops=n: run a chain of n events at the time of each event"<<std::endl;
+  std::cout << "      --profile=file: profile the events and write the report to file"<<std::endl;
   std::cout << "      --debug: enable some debugging"<<std::endl;
 }
 
@@ -144,6 +234,10 @@ int main (int argc, char *argv[])
   std::istream *input;
   uint32_t n = 1;
   uint32_t total = 20000;
+  uint32_t timers = 0;
+  uint32_t hops = 0;
+  bool cancel = false;
+  std::vector<std::string> schedulers;
   if (argc == 1)
     {
       PrintHelp ();
@@ -161,31 +255,60 @@ int main (int argc, char *argv[])
     }
   while (argc > 0) 
     {
-      ObjectFactory factory;
       if (strcmp ("--list", argv[0]) == 0) 
         {
-          factory.SetTypeId ("ns3::ListScheduler");
-          Simulator::SetScheduler (factory);
+          schedulers.push_back ("ns3::ListScheduler");
         } 
       else if (strcmp ("--heap", argv[0]) == 0) 
         {
-          factory.SetTypeId ("ns3::HeapScheduler");
-          Simulator::SetScheduler (factory);
+          schedulers.push_back ("ns3::HeapScheduler");
         } 
       else if (strcmp ("--map", argv[0]) == 0) 
         {
-          factory.SetTypeId ("ns3::HeapScheduler");
-          Simulator::SetScheduler (factory);
+          schedulers.push_back ("ns3::MapScheduler");
         } 
       else if (strcmp ("--calendar", argv[0]) == 0)
         {
-          factory.SetTypeId ("ns3::CalendarScheduler");
-          Simulator::SetScheduler (factory);
+          schedulers.push_back ("ns3::CalendarScheduler");
+        }
+      else if (strcmp ("--ns2calendar", argv[0]) == 0)
+        {
+          schedulers.push_back ("ns3::Ns2CalendarScheduler");
+        }
+      else if (strcmp ("--fourary", argv[0]) == 0)
+        {
+          schedulers.push_back ("ns3::FourAryHeapScheduler");
+        }
+      else if (strcmp ("--ladder", argv[0]) == 0)
+        {
+          schedulers.push_back ("ns3::LadderQueueScheduler");
+        }
+      else if (strcmp ("--all", argv[0]) == 0)
+        {
+          schedulers.push_back ("ns3::ListScheduler");
+          schedulers.push_back ("ns3::MapScheduler");
+          schedulers.push_back ("ns3::HeapScheduler");
+          schedulers.push_back ("ns3::CalendarScheduler");
+          schedulers.push_back ("ns3::Ns2CalendarScheduler");
+          schedulers.push_back ("ns3::FourAryHeapScheduler");
+          schedulers.push_back ("ns3::LadderQueueScheduler");
         }
       else if (strcmp ("--debug", argv[0]) == 0) 
         {
           g_debug = true;
         } 
+      else if (strcmp ("--cancel", argv[0]) == 0)
+        {
+          cancel = true;
+        }
+      else if (strncmp ("--timers=", argv[0], strlen("--timers=")) == 0)
+        {
+          timers = atoi (argv[0]+strlen ("--timers="));
+        }
+      else if (strncmp ("--hops=", argv[0], strlen("--hops=")) == 0)
+        {
+          hops = atoi (argv[0]+strlen ("--hops="));
+        }
       else if (strncmp ("--total=", argv[0], strlen("--total=")) == 0) 
         {
           total = atoi (argv[0]+strlen ("--total="));
@@ -194,16 +317,39 @@ int main (int argc, char *argv[])
         {
           n = atoi (argv[0]+strlen ("--n="));
         } 
+      else if (strncmp ("--profile=", argv[0], strlen("--profile=")) == 0)
+        {
+          Config::SetDefault ("ns3::DefaultSimulatorImpl::ProfileFile",
+                              StringValue (argv[0]+strlen ("--profile=")));
+        }
 
       argc--;
       argv++;
   }
+  if (schedulers.empty ())
+    {
+      // keep the default scheduler of the simulator
+      schedulers.push_back ("");
+    }
   Bench *bench = new Bench ();
   bench->ReadDistribution (*input);
   bench->SetTotal (total);
-  for (uint32_t i = 0; i < n; i++)
+  bench->SetTimers (timers, cancel);
+  bench->SetHops (hops);
+  for (std::vector<std::string>::const_iterator s = schedulers.begin (); s != schedulers.end (); ++s)
     {
-      bench->RunBench ();
+      if (!s->empty ())
+        {
+          ObjectFactory factory;
+          factory.SetTypeId (*s);
+          Simulator::SetScheduler (factory);
+          std::cout << *s << std::endl;
+        }
+      for (uint32_t i = 0; i < n; i++)
+        {
+          bench->RunBench ();
+        }
+      Simulator::Destroy ();
     }
 
   return 0;
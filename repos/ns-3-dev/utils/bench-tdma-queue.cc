@@ -0,0 +1,165 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/tdma-mac-queue.h"
+#include <iostream>
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * Keeps a TdmaMacQueue at a given depth and measures the cost of the
+ * operations the mac does on it: a steady enqueue/peek/dequeue cycle, an
+ * overloaded queue where every enqueue pushes the oldest packet past
+ * MaxDelay, and the removal of packets from anywhere in the queue.
+ */
+class TdmaMacQueueBench
+{
+public:
+  TdmaMacQueueBench (uint32_t depth, uint32_t ops);
+  void RunBench (void);
+private:
+  void SteadyState (void);
+  void RemoveAnywhere (void);
+  void OverloadStep (void);
+  void Drop (Ptr<const Packet> packet);
+
+  uint32_t m_depth;
+  uint32_t m_ops;
+  uint32_t m_done;
+  uint32_t m_drops;
+  Ptr<TdmaMacQueue> m_queue;
+  Ptr<const Packet> m_packet;
+  std::vector<Ptr<const Packet> > m_distinct;
+  WifiMacHeader m_hdr;
+};
+
+TdmaMacQueueBench::TdmaMacQueueBench (uint32_t depth, uint32_t ops)
+  : m_depth (depth),
+    m_ops (ops),
+    m_done (0),
+    m_drops (0)
+{
+  m_packet = Create<Packet> (64);
+  m_hdr.SetType (WIFI_MAC_DATA);
+}
+
+void
+TdmaMacQueueBench::SteadyState (void)
+{
+  WifiMacHeader hdr;
+  for (uint32_t i = 0; i < m_ops; i++)
+    {
+      m_queue->Enqueue (m_packet, m_hdr);
+      m_queue->Peek (&hdr);
+      m_queue->Dequeue (&hdr);
+    }
+}
+
+void
+TdmaMacQueueBench::RemoveAnywhere (void)
+{
+  // remove a packet from a spread of positions and queue it again at the
+  // tail, which keeps the depth
+  for (uint32_t i = 0; i < m_ops; i++)
+    {
+      Ptr<const Packet> packet = m_distinct[(i * 7919) % m_depth];
+      m_queue->Remove (packet);
+      m_queue->Enqueue (packet, m_hdr);
+    }
+}
+
+void
+TdmaMacQueueBench::OverloadStep (void)
+{
+  // one packet per microsecond: once the queue holds MaxDelay worth of
+  // packets, every enqueue finds the head expired
+  m_queue->Enqueue (m_packet, m_hdr);
+  if (++m_done < m_depth + m_ops)
+    {
+      Simulator::Schedule (MicroSeconds (1), &TdmaMacQueueBench::OverloadStep, this);
+    }
+}
+
+void
+TdmaMacQueueBench::Drop (Ptr<const Packet> packet)
+{
+  m_drops++;
+}
+
+void
+TdmaMacQueueBench::RunBench (void)
+{
+  m_queue = CreateObject<TdmaMacQueue> ();
+  m_queue->SetMaxSize (m_depth + 1);
+  m_queue->SetMaxDelay (MicroSeconds (m_depth));
+  m_queue->SetTdmaMacTxDropCallback (MakeCallback (&TdmaMacQueueBench::Drop, this));
+
+  SystemWallClockMs time;
+  Simulator::ScheduleNow (&TdmaMacQueueBench::OverloadStep, this);
+  time.Start ();
+  Simulator::Run ();
+  uint64_t overloadMs = time.End ();
+  Simulator::Destroy ();
+
+  m_queue->Flush ();
+  m_queue->SetMaxDelay (Seconds (10.0));
+  for (uint32_t i = 0; i < m_depth; i++)
+    {
+      m_queue->Enqueue (m_packet, m_hdr);
+    }
+  time.Start ();
+  SteadyState ();
+  uint64_t steadyMs = time.End ();
+  m_queue->Flush ();
+
+  for (uint32_t i = 0; i < m_depth; i++)
+    {
+      m_distinct.push_back (Create<Packet> (64));
+      m_queue->Enqueue (m_distinct.back (), m_hdr);
+    }
+  time.Start ();
+  RemoveAnywhere ();
+  uint64_t removeMs = time.End ();
+  m_queue->Flush ();
+  m_distinct.clear ();
+
+  std::cout << "depth=" << m_depth << " ops=" << m_ops
+            << " steady=" << steadyMs << "ms"
+            << " overload=" << overloadMs << "ms"
+            << " remove=" << removeMs << "ms"
+            << " expired=" << m_drops << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t ops = 10000;
+  uint32_t minDepth = 10;
+  uint32_t maxDepth = 10000;
+  CommandLine cmd;
+  cmd.AddValue ("ops", "Number of operations per depth", ops);
+  cmd.AddValue ("min", "Smallest queue depth", minDepth);
+  cmd.AddValue ("max", "Largest queue depth", maxDepth);
+  cmd.Parse (argc, argv);
+  for (uint32_t depth = minDepth; depth <= maxDepth; depth *= 10)
+    {
+      TdmaMacQueueBench bench (depth, ops);
+      bench.RunBench ();
+    }
+  return 0;
+}
@@ -0,0 +1,120 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/simple-wireless-tdma-module.h"
+#include <fstream>
+#include <iostream>
+#include <cstdio>
+
+using namespace ns3;
+
+/**
+ * Writes a slot assignment file for a given number of nodes and slots,
+ * where the slots are shared out in consecutive runs, and measures how
+ * long it takes to parse it into a TdmaHelper and to install the devices
+ * that hand the slots to the controller.
+ */
+class TdmaSlotFileBench
+{
+public:
+  TdmaSlotFileBench ();
+  void RunBench (void);
+
+  uint32_t m_nodes;
+  uint32_t m_slots;
+  bool m_sparse;
+  std::string m_fileName;
+private:
+  void WriteFile (void) const;
+};
+
+TdmaSlotFileBench::TdmaSlotFileBench ()
+  : m_nodes (1000),
+    m_slots (1000),
+    m_sparse (false),
+    m_fileName ("bench-tdma-slots.txt")
+{
+}
+
+void
+TdmaSlotFileBench::WriteFile (void) const
+{
+  std::ofstream out (m_fileName.c_str ());
+  uint32_t perNode = std::max (m_slots / m_nodes, 1U);
+  if (m_sparse)
+    {
+      out << "slots " << m_slots << "\n";
+    }
+  for (uint32_t i = 0; i < m_nodes; i++)
+    {
+      uint32_t first = i * perNode;
+      uint32_t last = std::min (first + perNode, m_slots);
+      if (m_sparse)
+        {
+          out << i;
+          if (first < last)
+            {
+              out << " " << first << "-" << last - 1;
+            }
+          out << "\n";
+          continue;
+        }
+      out << i << ":";
+      for (uint32_t j = 0; j < m_slots; j++)
+        {
+          out << (j >= first && j < last ? "1" : "0") << (j + 1 < m_slots ? "," : "\n");
+        }
+    }
+}
+
+void
+TdmaSlotFileBench::RunBench (void)
+{
+  WriteFile ();
+  SystemWallClockMs time;
+  time.Start ();
+  TdmaHelper tdma = TdmaHelper (m_fileName);
+  uint64_t parseMs = time.End ();
+
+  NodeContainer nodes;
+  nodes.Create (m_nodes);
+  tdma.SetTdmaControllerHelper (TdmaControllerHelper ());
+  time.Start ();
+  NetDeviceContainer devices = tdma.Install (nodes);
+  uint64_t installMs = time.End ();
+  Simulator::Destroy ();
+  std::remove (m_fileName.c_str ());
+
+  std::cout << "nodes=" << m_nodes << " slots=" << m_slots
+            << " sparse=" << m_sparse
+            << " parse=" << parseMs << "ms"
+            << " install=" << installMs << "ms" << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  TdmaSlotFileBench bench;
+  CommandLine cmd;
+  cmd.AddValue ("nodes", "Number of nodes in the slot file", bench.m_nodes);
+  cmd.AddValue ("slots", "Number of slots per frame", bench.m_slots);
+  cmd.AddValue ("sparse", "Write the file in the sparse slot range format", bench.m_sparse);
+  cmd.AddValue ("file", "Name of the temporary slot file", bench.m_fileName);
+  cmd.Parse (argc, argv);
+  bench.RunBench ();
+  return 0;
+}
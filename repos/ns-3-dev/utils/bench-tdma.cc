@@ -0,0 +1,202 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/simple-wireless-tdma-module.h"
+#include "ns3/msdu-aggregator.h"
+#include <iostream>
+#include <cstdlib>
+#include <new>
+
+using namespace ns3;
+
+// Count the heap allocations of this program, to report what a frame
+// costs. The benchmark runs a single thread, so a plain counter will do.
+static uint64_t g_allocations = 0;
+
+static void *
+CountedAllocate (std::size_t size)
+{
+  g_allocations++;
+  void *p = std::malloc (size == 0 ? 1 : size);
+  if (p == 0)
+    {
+      throw std::bad_alloc ();
+    }
+  return p;
+}
+
+// kept out of line: gcc warns about free called on the pointer given
+// to operator delete otherwise
+#ifdef __GNUC__
+__attribute__ ((noinline))
+#endif
+static void
+CountedRelease (void *p)
+{
+  std::free (p);
+}
+
+void *
+operator new (std::size_t size) throw (std::bad_alloc)
+{
+  return CountedAllocate (size);
+}
+
+void *
+operator new[] (std::size_t size) throw (std::bad_alloc)
+{
+  return CountedAllocate (size);
+}
+
+void
+operator delete (void *p) throw ()
+{
+  CountedRelease (p);
+}
+
+void
+operator delete[] (void *p) throw ()
+{
+  CountedRelease (p);
+}
+
+/**
+ * Runs a TDMA frame with one slot per node where only a fraction of the
+ * nodes have traffic, and reports how many simulator events that costs
+ * per simulated second and how many heap allocations per event.
+ */
+class TdmaFrameBench
+{
+public:
+  TdmaFrameBench ();
+  void RunBench (void);
+
+  uint32_t m_nodes;
+  uint32_t m_activeNodes;
+  uint32_t m_slotTimeUs;
+  uint32_t m_gaurdTimeUs;
+  double m_simTime;
+  double m_interval;
+  bool m_aggregate;
+  bool m_linkTable;
+private:
+  void Generate (Ptr<NetDevice> device);
+};
+
+static void
+Noop (void)
+{
+}
+
+TdmaFrameBench::TdmaFrameBench ()
+  : m_nodes (100),
+    m_activeNodes (10),
+    m_slotTimeUs (100),
+    m_gaurdTimeUs (10),
+    m_simTime (10.0),
+    m_interval (0.01),
+    m_aggregate (false),
+    m_linkTable (false)
+{
+}
+
+void
+TdmaFrameBench::Generate (Ptr<NetDevice> device)
+{
+  device->Send (Create<Packet> (64), device->GetBroadcast (), 0x0800);
+  Simulator::Schedule (Seconds (m_interval), &TdmaFrameBench::Generate, this, device);
+}
+
+void
+TdmaFrameBench::RunBench (void)
+{
+  NodeContainer nodes;
+  nodes.Create (m_nodes);
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator ("ns3::GridPositionAllocator",
+                                 "MinX", DoubleValue (0.0),
+                                 "MinY", DoubleValue (0.0),
+                                 "DeltaX", DoubleValue (10.0),
+                                 "DeltaY", DoubleValue (10.0),
+                                 "GridWidth", UintegerValue (10),
+                                 "LayoutType", StringValue ("RowFirst"));
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (nodes);
+
+  TdmaHelper tdma = TdmaHelper (m_nodes, m_nodes);
+  TdmaControllerHelper controller;
+  controller.Set ("SlotTime", TimeValue (MicroSeconds (m_slotTimeUs)));
+  controller.Set ("GaurdTime", TimeValue (MicroSeconds (m_gaurdTimeUs)));
+  controller.Set ("InterFrameTime", TimeValue (MicroSeconds (0)));
+  tdma.SetTdmaControllerHelper (controller);
+  NetDeviceContainer devices = tdma.Install (nodes);
+  devices.Get (0)->GetChannel ()->SetAttribute ("LinkTable", BooleanValue (m_linkTable));
+  if (m_aggregate)
+    {
+      ObjectFactory aggregator;
+      aggregator.SetTypeId ("ns3::MsduStandardAggregator");
+      Config::Set ("/NodeList/*/DeviceList/*/$ns3::TdmaNetDevice/Mac/$ns3::TdmaCentralMac/MsduAggregator",
+                   PointerValue (aggregator.Create<MsduAggregator> ()));
+    }
+
+  for (uint32_t i = 0; i < m_activeNodes && i < m_nodes; i++)
+    {
+      Simulator::Schedule (Seconds (m_interval * i / m_activeNodes), &TdmaFrameBench::Generate, this,
+                           devices.Get (i * (m_nodes / m_activeNodes)));
+    }
+
+  // every scheduled event gets the next uid, so the difference between the
+  // uids of two events is the number of events scheduled in between
+  uint64_t startUid = Simulator::ScheduleNow (&Noop).GetUid ();
+  uint64_t startAllocations = g_allocations;
+  SystemWallClockMs time;
+  time.Start ();
+  Simulator::Stop (Seconds (m_simTime));
+  Simulator::Run ();
+  uint64_t ms = time.End ();
+  uint64_t allocations = g_allocations - startAllocations;
+  uint64_t events = Simulator::ScheduleNow (&Noop).GetUid () - startUid;
+  Simulator::Destroy ();
+
+  std::cout << "nodes=" << m_nodes << " active=" << m_activeNodes
+            << " slot=" << m_slotTimeUs << "us"
+            << " aggregate=" << m_aggregate
+            << " linktable=" << m_linkTable
+            << " events=" << events
+            << " events/simulated-s=" << events / m_simTime
+            << " allocations/event=" << double (allocations) / events
+            << " wall=" << ms << "ms" << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  TdmaFrameBench bench;
+  CommandLine cmd;
+  cmd.AddValue ("nodes", "Number of nodes, each owns one slot", bench.m_nodes);
+  cmd.AddValue ("active", "Number of nodes with traffic", bench.m_activeNodes);
+  cmd.AddValue ("slot", "Slot time in microseconds", bench.m_slotTimeUs);
+  cmd.AddValue ("gaurd", "Gaurd time in microseconds", bench.m_gaurdTimeUs);
+  cmd.AddValue ("time", "Simulated seconds", bench.m_simTime);
+  cmd.AddValue ("interval", "Seconds between packets of an active node", bench.m_interval);
+  cmd.AddValue ("aggregate", "Send the packets of a slot as one A-MSDU", bench.m_aggregate);
+  cmd.AddValue ("linktable", "Use the precomputed link table of the channel", bench.m_linkTable);
+  cmd.Parse (argc, argv);
+  bench.RunBench ();
+  return 0;
+}
@@ -0,0 +1,71 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Convert a trace written by AsciiTraceHelper::CreateBinaryFileStream,
+// or by the EnableAscii methods of the helpers after a call to
+// AsciiTraceHelper::EnableBinaryFileStreams, to the usual ascii trace.
+//
+// This program is linked with all the enabled modules, so that it knows
+// the headers and trailers of the traced packets.
+//
+//   ./waf --run "convert-binary-trace --input=csma.tr --output=csma-ascii.tr"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include "ns3/command-line.h"
+#include "ns3/binary-trace-writer.h"
+
+using namespace ns3;
+
+int main (int argc, char *argv[])
+{
+  std::string input;
+  std::string output;
+
+  CommandLine cmd;
+  cmd.AddValue ("input", "the binary trace to convert", input);
+  cmd.AddValue ("output", "the ascii trace to write (default: standard output)", output);
+  cmd.Parse (argc, argv);
+
+  if (input.empty ())
+    {
+      std::cerr << "Error-- the binary trace must be specified "
+                << "by command-line argument --input=(file name)" << std::endl;
+      return 1;
+    }
+
+  std::ofstream file;
+  std::ostream *os = &std::cout;
+  if (!output.empty ())
+    {
+      file.open (output.c_str ());
+      if (!file.is_open ())
+        {
+          std::cerr << "Error-- unable to open " << output << std::endl;
+          return 1;
+        }
+      os = &file;
+    }
+
+  BinaryTraceReader reader (input);
+  if (!reader.ConvertToAscii (*os))
+    {
+      std::cerr << "Error-- " << input << " is not a valid binary trace" << std::endl;
+      return 1;
+    }
+  return 0;
+}